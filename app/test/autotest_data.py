@@ -224,6 +224,12 @@
         "Func":    default_autotest,
         "Report":  None,
     },
+    {
+        "Name":    "CoDel autotest",
+        "Command": "codel_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
     {
         "Name":    "Red autotest",
         "Command": "red_autotest",
@@ -374,6 +380,18 @@
         "Func":    default_autotest,
         "Report":  None,
     },
+    {
+        "Name":    "Sketch autotest",
+        "Command": "sketch_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
+    {
+        "Name":    "GRO autotest",
+        "Command": "gro_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
     {
         "Name":   "Efd_autotest",
         "Command": "efd_autotest",
@@ -506,6 +524,12 @@
         "Func":    default_autotest,
         "Report":  None,
     },
+    {
+        "Name":    "Pcapng autotest",
+        "Command": "pcapng_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
     {
         "Name":    "Pdump autotest",
         "Command": "pdump_autotest",
@@ -688,6 +712,12 @@
         "Func":    default_autotest,
         "Report":  None,
     },
+    {
+        "Name":    "GRO perf autotest",
+        "Command": "gro_perf_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
     {
         "Name":    "Reciprocal division perf",
         "Command": "reciprocal_division_perf",
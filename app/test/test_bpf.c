@@ -8,6 +8,12 @@
 #include <inttypes.h>
 
 #include <rte_memory.h>
+#include <rte_malloc.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_udp.h>
 #include <rte_debug.h>
 #include <rte_hexdump.h>
 #include <rte_random.h>
@@ -35,6 +41,15 @@ struct dummy_vect8 {
 	struct dummy_offset out[8];
 };
 
+#define TEST_MBUF_PKT_LEN	64
+#define TEST_MBUF_SEG_LEN	24
+#define TEST_MBUF_IP_VERSION	4
+
+struct dummy_mbuf {
+	struct rte_mbuf mb[2];
+	uint8_t buf[2][RTE_PKTMBUF_HEADROOM + TEST_MBUF_PKT_LEN];
+};
+
 #define	TEST_FILL_1	0xDEADBEEF
 
 #define	TEST_MUL_1	21
@@ -1777,6 +1792,320 @@ static const struct rte_bpf_xsym test_call2_xsym[] = {
 	},
 };
 
+/* load mbuf (BPF_ABS/BPF_IND) test-cases */
+static const struct ebpf_insn test_ld_mbuf1_prog[] = {
+
+	/* BPF_ABS/BPF_IND implicitly expect mbuf ptr in R6 */
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_6,
+		.src_reg = EBPF_REG_1,
+	},
+	/* load IPv4 version and IHL */
+	{
+		.code = (BPF_LD | BPF_ABS | BPF_B),
+		.imm = offsetof(struct ipv4_hdr, version_ihl),
+	},
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_0,
+	},
+	{
+		.code = (BPF_ALU | BPF_AND | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = 0xf0,
+	},
+	{
+		.code = (BPF_JMP | BPF_JEQ | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = TEST_MBUF_IP_VERSION << 4,
+		.off = 2,
+	},
+	/* invalid IP version, return 0 */
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = 0,
+	},
+	{
+		.code = (BPF_JMP | EBPF_EXIT),
+	},
+	/* R7 = IPv4 header length */
+	{
+		.code = (BPF_ALU | BPF_AND | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = IPV4_HDR_IHL_MASK,
+	},
+	{
+		.code = (BPF_ALU | BPF_LSH | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = 2,
+	},
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_7,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load 3-rd byte of IP data */
+	{
+		.code = (BPF_LD | BPF_IND | BPF_B),
+		.src_reg = EBPF_REG_7,
+		.imm = 3,
+	},
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_8,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load IPv4 src addr */
+	{
+		.code = (BPF_LD | BPF_ABS | BPF_W),
+		.imm = offsetof(struct ipv4_hdr, src_addr),
+	},
+	{
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_X),
+		.dst_reg = EBPF_REG_8,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load 4 bytes at the start of IP data */
+	{
+		.code = (BPF_LD | BPF_IND | BPF_W),
+		.src_reg = EBPF_REG_7,
+		.imm = 2,
+	},
+	{
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_X),
+		.dst_reg = EBPF_REG_8,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load IPv4 total length */
+	{
+		.code = (BPF_LD | BPF_ABS | BPF_H),
+		.imm = offsetof(struct ipv4_hdr, total_length),
+	},
+	{
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_9,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load last 4 bytes of IP data */
+	{
+		.code = (BPF_LD | BPF_IND | BPF_W),
+		.src_reg = EBPF_REG_9,
+		.imm = -(int32_t)sizeof(uint32_t),
+	},
+	{
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_X),
+		.dst_reg = EBPF_REG_8,
+		.src_reg = EBPF_REG_0,
+	},
+	/* load 2 bytes from the middle of IP data */
+	{
+		.code = (EBPF_ALU64 | BPF_RSH | BPF_K),
+		.dst_reg = EBPF_REG_9,
+		.imm = 1,
+	},
+	{
+		.code = (BPF_LD | BPF_IND | BPF_H),
+		.src_reg = EBPF_REG_9,
+	},
+	{
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_X),
+		.dst_reg = EBPF_REG_0,
+		.src_reg = EBPF_REG_8,
+	},
+	{
+		.code = (BPF_JMP | EBPF_EXIT),
+	},
+};
+
+static void
+dummy_mbuf_prep(struct rte_mbuf *mb, uint8_t buf[], uint32_t buf_len,
+	const uint8_t *data, uint32_t data_len)
+{
+	memset(mb, 0, sizeof(*mb));
+	mb->buf_addr = buf;
+	mb->buf_iova = (uintptr_t)buf;
+	mb->buf_len = buf_len;
+	rte_mbuf_refcnt_set(mb, 1);
+
+	/* set pool pointer to dummy value, test doesn't use it */
+	mb->pool = (void *)buf;
+
+	rte_pktmbuf_reset(mb);
+	memcpy(rte_pktmbuf_mtod(mb, void *), data, data_len);
+	mb->data_len = data_len;
+	mb->pkt_len = data_len;
+}
+
+/*
+ * Copy the packet into the dummy mbuf,
+ * split it into two segments if seg_len is less than the packet length.
+ */
+static void
+dummy_mbuf_fill(struct dummy_mbuf *dm, const uint8_t *pkt, uint32_t len,
+	uint32_t seg_len)
+{
+	if (len <= seg_len) {
+		dummy_mbuf_prep(&dm->mb[0], dm->buf[0], sizeof(dm->buf[0]),
+			pkt, len);
+		return;
+	}
+
+	dummy_mbuf_prep(&dm->mb[0], dm->buf[0], sizeof(dm->buf[0]),
+		pkt, seg_len);
+	dummy_mbuf_prep(&dm->mb[1], dm->buf[1], sizeof(dm->buf[1]),
+		pkt + seg_len, len - seg_len);
+	dm->mb[0].next = &dm->mb[1];
+	dm->mb[0].nb_segs = 2;
+	dm->mb[0].pkt_len = len;
+}
+
+/*
+ * Build IPv4 packet with random payload,
+ * split it into two segments if seg_len is less than the packet length.
+ */
+static void
+test_ld_mbuf_prepare(void *arg, uint32_t seg_len, uint16_t ip_len)
+{
+	uint32_t i;
+	struct dummy_mbuf *dm;
+	struct ipv4_hdr *ip;
+	uint8_t pkt[TEST_MBUF_PKT_LEN];
+
+	dm = arg;
+
+	for (i = 0; i != sizeof(pkt); i++)
+		pkt[i] = rte_rand();
+
+	ip = (struct ipv4_hdr *)pkt;
+	memset(ip, 0, sizeof(*ip));
+	ip->version_ihl = TEST_MBUF_IP_VERSION << 4 |
+		sizeof(*ip) / IPV4_IHL_MULTIPLIER;
+	ip->total_length = rte_cpu_to_be_16(ip_len);
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_UDP;
+	ip->src_addr = rte_cpu_to_be_32(IPv4(10, 0, 0, 1));
+	ip->dst_addr = rte_cpu_to_be_32(IPv4(10, 0, 0, 2));
+
+	dummy_mbuf_fill(dm, pkt, sizeof(pkt), seg_len);
+}
+
+/* multi-segment packet, loads span both segments */
+static void
+test_ld_mbuf1_prepare(void *arg)
+{
+	test_ld_mbuf_prepare(arg, TEST_MBUF_SEG_LEN, TEST_MBUF_PKT_LEN);
+}
+
+/* single segment packet */
+static void
+test_ld_mbuf2_prepare(void *arg)
+{
+	test_ld_mbuf_prepare(arg, TEST_MBUF_PKT_LEN, TEST_MBUF_PKT_LEN);
+}
+
+/* IPv4 total length beyond the end of the packet */
+static void
+test_ld_mbuf3_prepare(void *arg)
+{
+	test_ld_mbuf_prepare(arg, TEST_MBUF_SEG_LEN,
+		TEST_MBUF_PKT_LEN + sizeof(uint32_t));
+}
+
+/* load len bytes at given offset in network byte order */
+static int
+test_ld_mbuf_val(const struct rte_mbuf *mb, uint32_t ofs, uint32_t len,
+	uint64_t *val)
+{
+	uint32_t i;
+	const uint8_t *p;
+	uint8_t buf[sizeof(uint32_t)];
+
+	p = rte_pktmbuf_read(mb, ofs, len, buf);
+	if (p == NULL)
+		return -1;
+
+	*val = 0;
+	for (i = 0; i != len; i++)
+		*val = *val << CHAR_BIT | p[i];
+	return 0;
+}
+
+static uint64_t
+test_ld_mbuf1_expected(const struct rte_mbuf *mb)
+{
+	uint32_t hl, len;
+	uint64_t rc, v;
+
+	if (test_ld_mbuf_val(mb, offsetof(struct ipv4_hdr, version_ihl),
+			sizeof(uint8_t), &v) != 0 ||
+			(v & 0xf0) != TEST_MBUF_IP_VERSION << 4)
+		return 0;
+	hl = (v & IPV4_HDR_IHL_MASK) * IPV4_IHL_MULTIPLIER;
+
+	if (test_ld_mbuf_val(mb, hl + 3, sizeof(uint8_t), &v) != 0)
+		return 0;
+	rc = v;
+
+	if (test_ld_mbuf_val(mb, offsetof(struct ipv4_hdr, src_addr),
+			sizeof(uint32_t), &v) != 0)
+		return 0;
+	rc += v;
+
+	if (test_ld_mbuf_val(mb, hl + 2, sizeof(uint32_t), &v) != 0)
+		return 0;
+	rc += v;
+
+	if (test_ld_mbuf_val(mb, offsetof(struct ipv4_hdr, total_length),
+			sizeof(uint16_t), &v) != 0)
+		return 0;
+	len = v;
+
+	if (test_ld_mbuf_val(mb, len - sizeof(uint32_t), sizeof(uint32_t),
+			&v) != 0)
+		return 0;
+	rc += v;
+
+	if (test_ld_mbuf_val(mb, len / 2, sizeof(uint16_t), &v) != 0)
+		return 0;
+	return rc + v;
+}
+
+static int
+test_ld_mbuf1_check(uint64_t rc, const void *arg)
+{
+	uint64_t v;
+	const struct dummy_mbuf *dm;
+
+	dm = arg;
+	v = test_ld_mbuf1_expected(dm->mb);
+
+	if (v != rc) {
+		printf("%s@%d: invalid return value "
+			"expected=0x%" PRIx64 ", actual=0x%" PRIx64 "\n",
+			__func__, __LINE__, v, rc);
+		return -1;
+	}
+	return 0;
+}
+
+/* out of bounds load: the program has to return 0 */
+static int
+test_ld_mbuf3_check(uint64_t rc, const void *arg)
+{
+	RTE_SET_USED(arg);
+
+	if (rc != 0) {
+		printf("%s@%d: invalid return value "
+			"expected=0, actual=0x%" PRIx64 "\n",
+			__func__, __LINE__, rc);
+		return -1;
+	}
+	return 0;
+}
+
 static const struct bpf_test tests[] = {
 	{
 		.name = "test_store1",
@@ -1968,8 +2297,112 @@ static const struct bpf_test tests[] = {
 		/* for now don't support function calls on 32 bit platform */
 		.allow_fail = (sizeof(uint64_t) != sizeof(uintptr_t)),
 	},
+	{
+		.name = "test_ld_mbuf1",
+		.arg_sz = sizeof(struct dummy_mbuf),
+		.prm = {
+			.ins = test_ld_mbuf1_prog,
+			.nb_ins = RTE_DIM(test_ld_mbuf1_prog),
+			.prog_arg = {
+				.type = RTE_BPF_ARG_PTR_MBUF,
+				.size = sizeof(struct rte_mbuf),
+				.buf_size = RTE_PKTMBUF_HEADROOM +
+					TEST_MBUF_PKT_LEN,
+			},
+		},
+		.prepare = test_ld_mbuf1_prepare,
+		.check_result = test_ld_mbuf1_check,
+		/* mbuf as input argument is not supported on 32 bit platform */
+		.allow_fail = (sizeof(uint64_t) != sizeof(uintptr_t)),
+	},
+	{
+		.name = "test_ld_mbuf2",
+		.arg_sz = sizeof(struct dummy_mbuf),
+		.prm = {
+			.ins = test_ld_mbuf1_prog,
+			.nb_ins = RTE_DIM(test_ld_mbuf1_prog),
+			.prog_arg = {
+				.type = RTE_BPF_ARG_PTR_MBUF,
+				.size = sizeof(struct rte_mbuf),
+				.buf_size = RTE_PKTMBUF_HEADROOM +
+					TEST_MBUF_PKT_LEN,
+			},
+		},
+		.prepare = test_ld_mbuf2_prepare,
+		.check_result = test_ld_mbuf1_check,
+		/* mbuf as input argument is not supported on 32 bit platform */
+		.allow_fail = (sizeof(uint64_t) != sizeof(uintptr_t)),
+	},
+	{
+		.name = "test_ld_mbuf3",
+		.arg_sz = sizeof(struct dummy_mbuf),
+		.prm = {
+			.ins = test_ld_mbuf1_prog,
+			.nb_ins = RTE_DIM(test_ld_mbuf1_prog),
+			.prog_arg = {
+				.type = RTE_BPF_ARG_PTR_MBUF,
+				.size = sizeof(struct rte_mbuf),
+				.buf_size = RTE_PKTMBUF_HEADROOM +
+					TEST_MBUF_PKT_LEN,
+			},
+		},
+		.prepare = test_ld_mbuf3_prepare,
+		.check_result = test_ld_mbuf3_check,
+		/* mbuf as input argument is not supported on 32 bit platform */
+		.allow_fail = (sizeof(uint64_t) != sizeof(uintptr_t)),
+	},
 };
 
+/* number of contexts for the JIT-ed burst entry */
+#define TEST_BURST_NUM	4
+
+/*
+ * run JIT-ed burst entry over TEST_BURST_NUM contexts,
+ * each prepared in its own buffer.
+ */
+static int
+run_test_burst(const struct bpf_test *tst, const struct rte_bpf_jit *jit)
+{
+	int32_t ret, rv;
+	uint32_t i, n;
+	const size_t sz = RTE_ALIGN_CEIL(tst->arg_sz, RTE_CACHE_LINE_SIZE);
+	uint8_t tbuf[TEST_BURST_NUM][sz] __rte_cache_aligned;
+	void *ctx[TEST_BURST_NUM];
+	uint64_t rc[TEST_BURST_NUM];
+
+	for (i = 0; i != TEST_BURST_NUM; i++) {
+		ctx[i] = tbuf[i];
+		tst->prepare(tbuf[i]);
+	}
+
+	ret = 0;
+	n = jit->burst(ctx, rc, 0);
+	if (n != 0) {
+		printf("%s@%d: burst(%s) processed %u contexts instead of 0\n",
+			__func__, __LINE__, tst->name, n);
+		ret = -1;
+	}
+
+	n = jit->burst(ctx, rc, TEST_BURST_NUM);
+	if (n != TEST_BURST_NUM) {
+		printf("%s@%d: burst(%s) processed %u contexts instead of %u\n",
+			__func__, __LINE__, tst->name, n, TEST_BURST_NUM);
+		return -1;
+	}
+
+	for (i = 0; i != TEST_BURST_NUM; i++) {
+		rv = tst->check_result(rc[i], tbuf[i]);
+		if (rv != 0) {
+			printf("%s@%d: check_result(%s) failed for context %u, "
+				"error: %d(%s);\n", __func__, __LINE__,
+				tst->name, i, rv, strerror(rv));
+			ret |= rv;
+		}
+	}
+
+	return ret;
+}
+
 static int
 run_test(const struct bpf_test *tst)
 {
@@ -1977,7 +2410,7 @@ run_test(const struct bpf_test *tst)
 	int64_t rc;
 	struct rte_bpf *bpf;
 	struct rte_bpf_jit jit;
-	uint8_t tbuf[tst->arg_sz];
+	uint8_t tbuf[tst->arg_sz] __rte_cache_aligned;
 
 	printf("%s(%s) start\n", __func__, tst->name);
 
@@ -2010,22 +2443,903 @@ run_test(const struct bpf_test *tst)
 			__func__, __LINE__, tst->name, rv, strerror(ret));
 	}
 
+	if (jit.burst != NULL)
+		ret |= run_test_burst(tst, &jit);
+
 	rte_bpf_destroy(bpf);
 	return ret;
 
 }
 
-static int
-test_bpf(void)
-{
-	int32_t rc, rv;
-	uint32_t i;
+/*
+ * BPF maps test: the program counts the packets of each flow in a hash map,
+ * the packets of each index in a lcore array, and stores the last flow
+ * seen for each index in an array.
+ */
+enum {
+	TEST_MAP_HASH,
+	TEST_MAP_LCORE,
+	TEST_MAP_ARRAY,
+	TEST_MAP_NUM,
+};
 
-	rc = 0;
-	for (i = 0; i != RTE_DIM(tests); i++) {
-		rv = run_test(tests + i);
-		if (tests[i].allow_fail == 0)
-			rc |= rv;
+/* order of the external symbols filled by rte_bpf_map_xsym() */
+enum {
+	TEST_MAP_XSYM_VAR,
+	TEST_MAP_XSYM_LOOKUP,
+	TEST_MAP_XSYM_UPDATE,
+};
+
+#define TEST_MAP_XSYM(map, sym)	((map) * RTE_BPF_MAP_XSYM_NUM + (sym))
+
+#define TEST_MAP_FLOWS	4
+#define TEST_MAP_ENTRIES	4
+#define TEST_MAP_PKTS	60
+/* index of the NULL check of the hash lookup result in test_map1_prog */
+#define TEST_MAP1_NULL_CHECK	8
+
+static const struct ebpf_insn test_map1_prog[] = {
+
+	[0] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_6,
+		.src_reg = EBPF_REG_1,
+	},
+	/* hash key on the stack */
+	[1] = {
+		.code = (BPF_LDX | BPF_MEM | EBPF_DW),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_6,
+		.off = offsetof(struct dummy_offset, u64),
+	},
+	[2] = {
+		.code = (BPF_STX | BPF_MEM | EBPF_DW),
+		.dst_reg = EBPF_REG_10,
+		.src_reg = EBPF_REG_2,
+		.off = -8,
+	},
+	/* R1 = hash map, set at runtime */
+	[3] = {
+		.code = (BPF_LD | BPF_IMM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+	},
+	[4] = {
+		.imm = 0,
+	},
+	[5] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_10,
+	},
+	[6] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = -8,
+	},
+	[7] = {
+		.code = (BPF_JMP | EBPF_CALL),
+		.imm = TEST_MAP_XSYM(TEST_MAP_HASH, TEST_MAP_XSYM_LOOKUP),
+	},
+	[TEST_MAP1_NULL_CHECK] = {
+		.code = (BPF_JMP | BPF_JEQ | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = 0,
+		.off = 3,
+	},
+	/* existing flow, increment its counter */
+	[9] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_1,
+		.imm = 1,
+	},
+	[10] = {
+		.code = (BPF_STX | EBPF_XADD | EBPF_DW),
+		.dst_reg = EBPF_REG_0,
+		.src_reg = EBPF_REG_1,
+	},
+	[11] = {
+		.code = (BPF_JMP | BPF_JA),
+		.off = 9,
+	},
+	/* new flow, add it with a counter set to 1 */
+	[12] = {
+		.code = (BPF_ST | BPF_MEM | EBPF_DW),
+		.dst_reg = EBPF_REG_10,
+		.off = -16,
+		.imm = 1,
+	},
+	[13] = {
+		.code = (BPF_LD | BPF_IMM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+	},
+	[14] = {
+		.imm = 0,
+	},
+	[15] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_10,
+	},
+	[16] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = -8,
+	},
+	[17] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_3,
+		.src_reg = EBPF_REG_10,
+	},
+	[18] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_3,
+		.imm = -16,
+	},
+	[19] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_4,
+		.imm = RTE_BPF_MAP_NOEXIST,
+	},
+	[20] = {
+		.code = (BPF_JMP | EBPF_CALL),
+		.imm = TEST_MAP_XSYM(TEST_MAP_HASH, TEST_MAP_XSYM_UPDATE),
+	},
+	/* array index on the stack */
+	[21] = {
+		.code = (BPF_LDX | BPF_MEM | BPF_W),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_6,
+		.off = offsetof(struct dummy_offset, u32),
+	},
+	[22] = {
+		.code = (BPF_STX | BPF_MEM | BPF_W),
+		.dst_reg = EBPF_REG_10,
+		.src_reg = EBPF_REG_2,
+		.off = -24,
+	},
+	/* increment lcore array counter */
+	[23] = {
+		.code = (BPF_LD | BPF_IMM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+	},
+	[24] = {
+		.imm = 0,
+	},
+	[25] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_10,
+	},
+	[26] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = -24,
+	},
+	[27] = {
+		.code = (BPF_JMP | EBPF_CALL),
+		.imm = TEST_MAP_XSYM(TEST_MAP_LCORE, TEST_MAP_XSYM_LOOKUP),
+	},
+	[28] = {
+		.code = (BPF_JMP | BPF_JEQ | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = 0,
+		.off = 11,
+	},
+	[29] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_1,
+		.imm = 1,
+	},
+	[30] = {
+		.code = (BPF_STX | EBPF_XADD | EBPF_DW),
+		.dst_reg = EBPF_REG_0,
+		.src_reg = EBPF_REG_1,
+	},
+	/* store the flow into the array, return the update result */
+	[31] = {
+		.code = (BPF_LD | BPF_IMM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+	},
+	[32] = {
+		.imm = 0,
+	},
+	[33] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_2,
+		.src_reg = EBPF_REG_10,
+	},
+	[34] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_2,
+		.imm = -24,
+	},
+	[35] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_X),
+		.dst_reg = EBPF_REG_3,
+		.src_reg = EBPF_REG_10,
+	},
+	[36] = {
+		.code = (EBPF_ALU64 | BPF_ADD | BPF_K),
+		.dst_reg = EBPF_REG_3,
+		.imm = -8,
+	},
+	[37] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_4,
+		.imm = RTE_BPF_MAP_ANY,
+	},
+	[38] = {
+		.code = (BPF_JMP | EBPF_CALL),
+		.imm = TEST_MAP_XSYM(TEST_MAP_ARRAY, TEST_MAP_XSYM_UPDATE),
+	},
+	[39] = {
+		.code = (BPF_JMP | EBPF_EXIT),
+	},
+	/* index out of the array, return -1 */
+	[40] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = -1,
+	},
+	[41] = {
+		.code = (BPF_JMP | EBPF_EXIT),
+	},
+};
+
+/* program writing through the map handle, rejected by the verifier */
+#define TEST_MAP1_STORE	2
+static const struct ebpf_insn test_map1_store_prog[] = {
+	/* R1 = hash map, set at runtime */
+	[0] = {
+		.code = (BPF_LD | BPF_IMM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+	},
+	[1] = {
+		.imm = 0,
+	},
+	/* overwrite the start of the map */
+	[TEST_MAP1_STORE] = {
+		.code = (BPF_ST | BPF_MEM | EBPF_DW),
+		.dst_reg = EBPF_REG_1,
+		.imm = 0,
+	},
+	[3] = {
+		.code = (EBPF_ALU64 | EBPF_MOV | BPF_K),
+		.dst_reg = EBPF_REG_0,
+		.imm = 0,
+	},
+	[4] = {
+		.code = (BPF_JMP | EBPF_EXIT),
+	},
+};
+
+/* instructions loading the map pointers */
+static const struct {
+	uint32_t idx;
+	uint32_t map;
+} test_map1_ldimm[] = {
+	{ .idx = 3, .map = TEST_MAP_HASH, },
+	{ .idx = 13, .map = TEST_MAP_HASH, },
+	{ .idx = 23, .map = TEST_MAP_LCORE, },
+	{ .idx = 31, .map = TEST_MAP_ARRAY, },
+};
+
+static void
+test_map1_ctx(struct dummy_offset *dv, uint32_t i)
+{
+	memset(dv, 0, sizeof(*dv));
+	dv->u64 = TEST_FILL_1 + i % TEST_MAP_FLOWS;
+	dv->u32 = i % (TEST_MAP_ENTRIES + 1);
+}
+
+/* run the program on all packets, check the return values */
+static int
+test_map1_run(const struct rte_bpf *bpf, uint64_t (*jit)(void *))
+{
+	uint32_t i;
+	uint64_t exp, rc;
+	struct dummy_offset dv;
+
+	for (i = 0; i != TEST_MAP_PKTS; i++) {
+		test_map1_ctx(&dv, i);
+		rc = (jit != NULL) ? jit(&dv) : rte_bpf_exec(bpf, &dv);
+		exp = (dv.u32 < TEST_MAP_ENTRIES) ? 0 : UINT64_MAX;
+		if (rc != exp) {
+			printf("%s@%d: invalid return value for packet %u, "
+				"expected=0x%" PRIx64 ", actual=0x%" PRIx64
+				"\n", __func__, __LINE__, i, exp, rc);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* check the map contents after nb_run runs of the program */
+static int
+test_map1_check(struct rte_bpf_map *map[TEST_MAP_NUM], uint32_t nb_run)
+{
+	uint32_t i, n, next;
+	uint64_t sum, v;
+	const void *key;
+	void *val;
+	const uint64_t *p;
+	struct dummy_offset dv;
+
+	/* per flow counters */
+	for (i = 0; i != TEST_MAP_FLOWS; i++) {
+		test_map1_ctx(&dv, i);
+		p = rte_bpf_map_lookup(map[TEST_MAP_HASH], &dv.u64);
+		v = nb_run * TEST_MAP_PKTS / TEST_MAP_FLOWS;
+		if (p == NULL || *p != v) {
+			printf("%s@%d: invalid counter for flow %u\n",
+				__func__, __LINE__, i);
+			return -1;
+		}
+	}
+
+	n = 0;
+	sum = 0;
+	next = 0;
+	while (rte_bpf_map_iterate(map[TEST_MAP_HASH], &key, &val,
+			&next) >= 0) {
+		n++;
+		sum += *(uint64_t *)val;
+	}
+	if (n != TEST_MAP_FLOWS || sum != nb_run * TEST_MAP_PKTS) {
+		printf("%s@%d: invalid hash map contents, "
+			"flows: %u, packets: %" PRIu64 "\n",
+			__func__, __LINE__, n, sum);
+		return -1;
+	}
+
+	/* per index counters and last flow */
+	for (i = 0; i != TEST_MAP_ENTRIES; i++) {
+		p = rte_bpf_map_lookup_lcore(map[TEST_MAP_LCORE], &i,
+			rte_lcore_id());
+		v = nb_run * TEST_MAP_PKTS / (TEST_MAP_ENTRIES + 1);
+		if (p == NULL || *p != v) {
+			printf("%s@%d: invalid counter for index %u\n",
+				__func__, __LINE__, i);
+			return -1;
+		}
+
+		test_map1_ctx(&dv, TEST_MAP_PKTS - (TEST_MAP_ENTRIES + 1) + i);
+		p = rte_bpf_map_lookup(map[TEST_MAP_ARRAY], &i);
+		if (p == NULL || *p != dv.u64) {
+			printf("%s@%d: invalid flow for index %u\n",
+				__func__, __LINE__, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* map updates from the application */
+static int
+test_map1_update(struct rte_bpf_map *map[TEST_MAP_NUM])
+{
+	int32_t rc[8];
+	uint32_t i;
+	uint64_t v;
+	struct dummy_offset dv;
+
+	test_map1_ctx(&dv, 0);
+	v = 0;
+	i = TEST_MAP_ENTRIES;
+
+	rc[0] = rte_bpf_map_update(map[TEST_MAP_ARRAY], &i, &v,
+		RTE_BPF_MAP_ANY);
+	rc[1] = rte_bpf_map_update(map[TEST_MAP_ARRAY], &v, &v,
+		RTE_BPF_MAP_NOEXIST);
+	rc[2] = rte_bpf_map_delete(map[TEST_MAP_ARRAY], &v);
+	rc[3] = rte_bpf_map_update(map[TEST_MAP_HASH], &dv.u64, &v,
+		RTE_BPF_MAP_NOEXIST);
+	rc[4] = rte_bpf_map_delete(map[TEST_MAP_HASH], &dv.u64);
+	rc[5] = (rte_bpf_map_lookup(map[TEST_MAP_HASH], &dv.u64) == NULL) ?
+		-ENOENT : 0;
+	rc[6] = rte_bpf_map_delete(map[TEST_MAP_HASH], &dv.u64);
+	rc[7] = rte_bpf_map_update(map[TEST_MAP_HASH], &dv.u64, &v,
+		RTE_BPF_MAP_EXIST);
+
+	if (rc[0] != -E2BIG || rc[1] != -EEXIST || rc[2] != -EINVAL ||
+			rc[3] != -EEXIST || rc[4] != 0 || rc[5] != -ENOENT ||
+			rc[6] != -ENOENT || rc[7] != -ENOENT) {
+		printf("%s@%d: unexpected map update results: "
+			"%d, %d, %d, %d, %d, %d, %d, %d\n",
+			__func__, __LINE__, rc[0], rc[1], rc[2], rc[3],
+			rc[4], rc[5], rc[6], rc[7]);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* load a program expected to be rejected by the verifier */
+static int
+test_map1_reject(const struct rte_bpf_prm *prm, const char *what)
+{
+	struct rte_bpf *bpf;
+
+	bpf = rte_bpf_load(prm);
+	if (bpf != NULL || rte_errno != EINVAL) {
+		printf("%s@%d: %s not rejected;\n", __func__, __LINE__, what);
+		rte_bpf_destroy(bpf);
+		return -1;
+	}
+	return 0;
+}
+
+/* programs misusing the map handle */
+static int
+test_map1_handle(const struct rte_bpf_prm *prm, struct ebpf_insn *ins,
+	struct rte_bpf_map *map[TEST_MAP_NUM])
+{
+	int32_t rc;
+	uint64_t v;
+	struct rte_bpf *bpf;
+	struct ebpf_insn store[RTE_DIM(test_map1_store_prog)];
+	struct rte_bpf_prm sprm;
+
+	v = (uintptr_t)map[TEST_MAP_HASH];
+
+	/* handle of another map passed to the hash map lookup */
+	ins[test_map1_ldimm[0].idx].imm = (uintptr_t)map[TEST_MAP_ARRAY];
+	ins[test_map1_ldimm[0].idx + 1].imm = (uintptr_t)map[TEST_MAP_ARRAY] >>
+		32;
+	rc = test_map1_reject(prm, "handle of another map");
+
+	/* constant which is not a map handle */
+	ins[test_map1_ldimm[0].idx].imm = v + sizeof(uint64_t);
+	ins[test_map1_ldimm[0].idx + 1].imm = (v + sizeof(uint64_t)) >> 32;
+	rc |= test_map1_reject(prm, "forged map handle");
+
+	ins[test_map1_ldimm[0].idx].imm = v;
+	ins[test_map1_ldimm[0].idx + 1].imm = v >> 32;
+
+	memcpy(store, test_map1_store_prog, sizeof(store));
+	store[0].imm = v;
+	store[1].imm = v >> 32;
+	sprm = *prm;
+	sprm.ins = store;
+	sprm.nb_ins = RTE_DIM(store);
+	rc |= test_map1_reject(&sprm, "store through the map handle");
+
+	/* the same program without the store is valid */
+	store[TEST_MAP1_STORE].code = (EBPF_ALU64 | EBPF_MOV | BPF_X);
+	store[TEST_MAP1_STORE].dst_reg = EBPF_REG_2;
+	store[TEST_MAP1_STORE].src_reg = EBPF_REG_1;
+	bpf = rte_bpf_load(&sprm);
+	if (bpf == NULL) {
+		printf("%s@%d: failed to load bpf code, error=%d(%s);\n",
+			__func__, __LINE__, rte_errno, strerror(rte_errno));
+		rc = -1;
+	}
+	rte_bpf_destroy(bpf);
+
+	return rc;
+}
+
+static int
+test_map1(void)
+{
+	static const struct rte_bpf_map_prm map_prm[TEST_MAP_NUM] = {
+		[TEST_MAP_HASH] = {
+			.name = "test_flows",
+			.type = RTE_BPF_MAP_TYPE_HASH,
+			.key_size = sizeof(uint64_t),
+			.value_size = sizeof(uint64_t),
+			.max_entries = TEST_MAP_FLOWS,
+			.socket_id = SOCKET_ID_ANY,
+		},
+		[TEST_MAP_LCORE] = {
+			.name = "test_counters",
+			.type = RTE_BPF_MAP_TYPE_LCORE_ARRAY,
+			.key_size = sizeof(uint32_t),
+			.value_size = sizeof(uint64_t),
+			.max_entries = TEST_MAP_ENTRIES,
+			.socket_id = SOCKET_ID_ANY,
+		},
+		[TEST_MAP_ARRAY] = {
+			.name = "test_last",
+			.type = RTE_BPF_MAP_TYPE_ARRAY,
+			.key_size = sizeof(uint32_t),
+			.value_size = sizeof(uint64_t),
+			.max_entries = TEST_MAP_ENTRIES,
+			.socket_id = SOCKET_ID_ANY,
+		},
+	};
+	int32_t ret;
+	uint32_t i, j, nb_run;
+	uint64_t v;
+	struct rte_bpf *bpf;
+	struct rte_bpf_jit jit;
+	struct rte_bpf_map *map[TEST_MAP_NUM];
+	struct rte_bpf_xsym xsym[TEST_MAP_NUM * RTE_BPF_MAP_XSYM_NUM];
+	struct ebpf_insn ins[RTE_DIM(test_map1_prog)];
+	struct rte_bpf_prm prm;
+
+	printf("%s start\n", __func__);
+
+	memset(map, 0, sizeof(map));
+	memcpy(ins, test_map1_prog, sizeof(ins));
+	bpf = NULL;
+	ret = -1;
+
+	for (i = 0; i != RTE_DIM(map); i++) {
+		map[i] = rte_bpf_map_create(map_prm + i);
+		if (map[i] == NULL) {
+			printf("%s@%d: failed to create map %s, "
+				"error=%d(%s);\n", __func__, __LINE__,
+				map_prm[i].name, rte_errno,
+				strerror(rte_errno));
+			goto out;
+		}
+		rte_bpf_map_xsym(map[i], xsym + i * RTE_BPF_MAP_XSYM_NUM,
+			RTE_BPF_MAP_XSYM_NUM);
+	}
+
+	for (i = 0; i != RTE_DIM(test_map1_ldimm); i++) {
+		j = test_map1_ldimm[i].idx;
+		v = (uintptr_t)map[test_map1_ldimm[i].map];
+		ins[j].imm = v;
+		ins[j + 1].imm = v >> 32;
+	}
+
+	memset(&prm, 0, sizeof(prm));
+	prm.ins = ins;
+	prm.nb_ins = RTE_DIM(ins);
+	prm.xsym = xsym;
+	prm.nb_xsym = RTE_DIM(xsym);
+	prm.prog_arg.type = RTE_BPF_ARG_PTR;
+	prm.prog_arg.size = sizeof(struct dummy_offset);
+
+	/* the hash lookup result is used without checking it against NULL */
+	ins[TEST_MAP1_NULL_CHECK].dst_reg = EBPF_REG_6;
+	if (test_map1_reject(&prm, "unchecked lookup result") != 0)
+		goto out;
+	ins[TEST_MAP1_NULL_CHECK].dst_reg = EBPF_REG_0;
+
+	if (test_map1_handle(&prm, ins, map) != 0)
+		goto out;
+
+	bpf = rte_bpf_load(&prm);
+	if (bpf == NULL) {
+		printf("%s@%d: failed to load bpf code, error=%d(%s);\n",
+			__func__, __LINE__, rte_errno, strerror(rte_errno));
+		goto out;
+	}
+
+	/* run interpreter, then JIT-ed code on the same maps */
+	nb_run = 1;
+	ret = test_map1_run(bpf, NULL);
+	if (ret == 0)
+		ret = test_map1_check(map, nb_run);
+
+	rte_bpf_get_jit(bpf, &jit);
+	if (ret == 0 && jit.func != NULL) {
+		nb_run++;
+		ret = test_map1_run(bpf, jit.func);
+		if (ret == 0)
+			ret = test_map1_check(map, nb_run);
+	}
+
+	if (ret == 0)
+		ret = test_map1_update(map);
+
+out:
+	rte_bpf_destroy(bpf);
+	for (i = 0; i != RTE_DIM(map); i++)
+		rte_bpf_map_free(map[i]);
+	return ret;
+}
+
+/*
+ * cBPF conversion tests.
+ * Generated by: tcpdump -dd 'udp dst port 53'
+ */
+static const struct cbpf_insn test_cbpf1_prog[] = {
+	{ 0x28, 0, 0, 0x0000000c },
+	{ 0x15, 0, 4, 0x000086dd },
+	{ 0x30, 0, 0, 0x00000014 },
+	{ 0x15, 0, 11, 0x00000011 },
+	{ 0x28, 0, 0, 0x00000038 },
+	{ 0x15, 8, 9, 0x00000035 },
+	{ 0x15, 0, 8, 0x00000800 },
+	{ 0x30, 0, 0, 0x00000017 },
+	{ 0x15, 0, 6, 0x00000011 },
+	{ 0x28, 0, 0, 0x00000014 },
+	{ 0x45, 4, 0, 0x00001fff },
+	{ 0xb1, 0, 0, 0x0000000e },
+	{ 0x48, 0, 0, 0x00000010 },
+	{ 0x15, 0, 1, 0x00000035 },
+	{ 0x06, 0, 0, 0x00040000 },
+	{ 0x06, 0, 0, 0x00000000 },
+};
+
+#define TEST_CBPF_SNAPLEN	0x40000
+
+static const struct {
+	uint16_t ether_type;
+	uint8_t proto;
+	uint16_t frag_ofs;
+	uint16_t dport;
+	uint32_t len;
+	uint32_t rc;
+} test_cbpf1_pkt[] = {
+	{ ETHER_TYPE_IPv4, IPPROTO_UDP, 0, 53, 64, TEST_CBPF_SNAPLEN, },
+	{ ETHER_TYPE_IPv4, IPPROTO_UDP, 0, 54, 64, 0, },
+	{ ETHER_TYPE_IPv4, IPPROTO_TCP, 0, 53, 64, 0, },
+	/* non-first fragment */
+	{ ETHER_TYPE_IPv4, IPPROTO_UDP, 1, 53, 64, 0, },
+	{ ETHER_TYPE_IPv6, IPPROTO_UDP, 0, 53, 80, TEST_CBPF_SNAPLEN, },
+	{ ETHER_TYPE_IPv6, IPPROTO_TCP, 0, 53, 80, 0, },
+	{ ETHER_TYPE_ARP, 0, 0, 53, 64, 0, },
+	/* truncated before the UDP destination port */
+	{ ETHER_TYPE_IPv4, IPPROTO_UDP, 0, 53, 36, 0, },
+};
+
+static void
+test_cbpf1_prepare(struct dummy_mbuf *dm, uint32_t i)
+{
+	struct ether_hdr *eth;
+	struct ipv4_hdr *ip4;
+	struct ipv6_hdr *ip6;
+	struct udp_hdr *udp;
+	uint8_t pkt[RTE_DIM(dm->buf) * TEST_MBUF_PKT_LEN];
+
+	memset(pkt, 0, sizeof(pkt));
+	eth = (struct ether_hdr *)pkt;
+	eth->ether_type = rte_cpu_to_be_16(test_cbpf1_pkt[i].ether_type);
+
+	if (test_cbpf1_pkt[i].ether_type == ETHER_TYPE_IPv4) {
+		ip4 = (struct ipv4_hdr *)(eth + 1);
+		ip4->version_ihl = TEST_MBUF_IP_VERSION << 4 |
+			sizeof(*ip4) / IPV4_IHL_MULTIPLIER;
+		ip4->fragment_offset =
+			rte_cpu_to_be_16(test_cbpf1_pkt[i].frag_ofs);
+		ip4->next_proto_id = test_cbpf1_pkt[i].proto;
+		udp = (struct udp_hdr *)(ip4 + 1);
+	} else {
+		ip6 = (struct ipv6_hdr *)(eth + 1);
+		ip6->proto = test_cbpf1_pkt[i].proto;
+		udp = (struct udp_hdr *)(ip6 + 1);
+	}
+	udp->dst_port = rte_cpu_to_be_16(test_cbpf1_pkt[i].dport);
+
+	dummy_mbuf_fill(dm, pkt, test_cbpf1_pkt[i].len, TEST_MBUF_SEG_LEN);
+}
+
+static uint32_t
+test_cbpf1_expected(const struct dummy_mbuf *dm, uint32_t i)
+{
+	RTE_SET_USED(dm);
+	return test_cbpf1_pkt[i].rc;
+}
+
+/* arithmetic and scratch memory */
+static const struct cbpf_insn test_cbpf2_prog[] = {
+	/* ld #len */
+	{ BPF_LD | BPF_W | BPF_LEN, 0, 0, 0 },
+	/* st M[3] */
+	{ BPF_ST, 0, 0, 3 },
+	/* ldx #3 */
+	{ BPF_LDX | BPF_W | BPF_IMM, 0, 0, 3 },
+	/* div x */
+	{ BPF_ALU | BPF_DIV | BPF_X, 0, 0, 0 },
+	/* mul #5 */
+	{ BPF_ALU | BPF_MUL | BPF_K, 0, 0, 5 },
+	/* tax */
+	{ BPF_MISC | BPF_TAX, 0, 0, 0 },
+	/* ld M[3] */
+	{ BPF_LD | BPF_W | BPF_MEM, 0, 0, 3 },
+	/* sub x */
+	{ BPF_ALU | BPF_SUB | BPF_X, 0, 0, 0 },
+	/* neg */
+	{ BPF_ALU | BPF_NEG, 0, 0, 0 },
+	/* st M[15] */
+	{ BPF_ST, 0, 0, 15 },
+	/* jgt #0xfffffff0, L11, L12 */
+	{ BPF_JMP | BPF_JGT | BPF_K, 0, 1, 0xfffffff0 },
+	/* or #0x100000 */
+	{ BPF_ALU | BPF_OR | BPF_K, 0, 0, 0x100000 },
+	/* jge x, L14, L13 */
+	{ BPF_JMP | BPF_JGE | BPF_X, 1, 0, 0 },
+	/* ja L15 */
+	{ BPF_JMP | BPF_JA, 0, 0, 1 },
+	/* mod #7 */
+	{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, 7 },
+	/* lsh #4 */
+	{ BPF_ALU | BPF_LSH | BPF_K, 0, 0, 4 },
+	/* xor x */
+	{ BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+	/* ldx M[15] */
+	{ BPF_LDX | BPF_W | BPF_MEM, 0, 0, 15 },
+	/* add x */
+	{ BPF_ALU | BPF_ADD | BPF_X, 0, 0, 0 },
+	/* ret a */
+	{ BPF_RET | BPF_A, 0, 0, 0 },
+};
+
+static uint32_t
+test_cbpf2_calc(uint32_t len)
+{
+	uint32_t a, x, m3, m15;
+
+	a = len;
+	m3 = a;
+	x = 3;
+	a /= x;
+	a *= 5;
+	x = a;
+	a = m3;
+	a -= x;
+	a = -a;
+	m15 = a;
+	if (a > 0xfffffff0)
+		a |= 0x100000;
+	if (a >= x)
+		a %= 7;
+	a <<= 4;
+	a ^= x;
+	x = m15;
+	return a + x;
+}
+
+#define TEST_CBPF2_PKTS	8
+
+static void
+test_cbpf2_prepare(struct dummy_mbuf *dm, uint32_t i)
+{
+	uint8_t pkt[RTE_DIM(dm->buf) * TEST_MBUF_PKT_LEN];
+
+	memset(pkt, 0, sizeof(pkt));
+	dummy_mbuf_fill(dm, pkt, 1 + i * 11, TEST_MBUF_SEG_LEN);
+}
+
+static uint32_t
+test_cbpf2_expected(const struct dummy_mbuf *dm, uint32_t i)
+{
+	RTE_SET_USED(i);
+	return test_cbpf2_calc(rte_pktmbuf_pkt_len(dm->mb));
+}
+
+/* run JIT-ed burst entry over all packets at once */
+static int
+test_cbpf_burst(const char *name, const struct rte_bpf_jit *jit,
+	void (*prepare)(struct dummy_mbuf *, uint32_t),
+	uint32_t (*expected)(const struct dummy_mbuf *, uint32_t),
+	uint32_t nb_pkt)
+{
+	int32_t ret;
+	uint32_t i, n;
+	uint64_t exp;
+	struct dummy_mbuf dm[nb_pkt];
+	void *ctx[nb_pkt];
+	uint64_t rc[nb_pkt];
+
+	for (i = 0; i != nb_pkt; i++) {
+		prepare(dm + i, i);
+		ctx[i] = dm[i].mb;
+	}
+
+	n = jit->burst(ctx, rc, nb_pkt);
+	if (n != nb_pkt) {
+		printf("%s(%s)@%d: processed %u packets instead of %u\n",
+			__func__, name, __LINE__, n, nb_pkt);
+		return -1;
+	}
+
+	ret = 0;
+	for (i = 0; i != nb_pkt; i++) {
+		exp = expected(dm + i, i);
+		if (rc[i] != exp) {
+			printf("%s(%s)@%d: invalid return value for packet %u, "
+				"expected=0x%" PRIx64 ", actual=0x%" PRIx64
+				"\n", __func__, name, __LINE__, i, exp, rc[i]);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/* convert cBPF program, run it over given packets with and without JIT */
+static int
+test_cbpf(const char *name, const struct cbpf_insn *cins, uint32_t nb_cins,
+	void (*prepare)(struct dummy_mbuf *, uint32_t),
+	uint32_t (*expected)(const struct dummy_mbuf *, uint32_t),
+	uint32_t nb_pkt)
+{
+	int32_t ret;
+	uint32_t i, j;
+	uint64_t exp, rc;
+	struct rte_bpf *bpf;
+	struct rte_bpf_prm *prm;
+	struct rte_bpf_jit jit;
+	struct dummy_mbuf dm;
+
+	printf("%s(%s) start\n", __func__, name);
+
+	prm = rte_bpf_convert(cins, nb_cins);
+	if (prm == NULL) {
+		printf("%s@%d: failed to convert cBPF code, error=%d(%s);\n",
+			__func__, __LINE__, rte_errno, strerror(rte_errno));
+		return -1;
+	}
+
+	bpf = rte_bpf_load(prm);
+	rte_free(prm);
+	if (bpf == NULL) {
+		printf("%s@%d: failed to load bpf code, error=%d(%s);\n",
+			__func__, __LINE__, rte_errno, strerror(rte_errno));
+		return -1;
+	}
+
+	rte_bpf_get_jit(bpf, &jit);
+
+	ret = 0;
+	for (i = 0; i != nb_pkt; i++) {
+		prepare(&dm, i);
+		exp = expected(&dm, i);
+		for (j = 0; j != 2; j++) {
+			if (j == 0)
+				rc = rte_bpf_exec(bpf, dm.mb);
+			else if (jit.func != NULL)
+				rc = jit.func(dm.mb);
+			else
+				break;
+			if (rc != exp) {
+				printf("%s(%s)@%d: invalid return value "
+					"for packet %u%s, expected=0x%" PRIx64
+					", actual=0x%" PRIx64 "\n",
+					__func__, name, __LINE__, i,
+					(j == 0) ? "" : " (JIT)", exp, rc);
+				ret = -1;
+			}
+		}
+	}
+
+	if (jit.burst != NULL)
+		ret |= test_cbpf_burst(name, &jit, prepare, expected, nb_pkt);
+
+	rte_bpf_destroy(bpf);
+	return ret;
+}
+
+static int
+test_bpf_convert(void)
+{
+	int32_t rc;
+
+	rc = test_cbpf("udp_dst_port", test_cbpf1_prog,
+		RTE_DIM(test_cbpf1_prog), test_cbpf1_prepare,
+		test_cbpf1_expected, RTE_DIM(test_cbpf1_pkt));
+	rc |= test_cbpf("alu", test_cbpf2_prog, RTE_DIM(test_cbpf2_prog),
+		test_cbpf2_prepare, test_cbpf2_expected, TEST_CBPF2_PKTS);
+	return rc;
+}
+
+static int
+test_bpf(void)
+{
+	int32_t rc, rv;
+	uint32_t i;
+
+	rc = 0;
+	for (i = 0; i != RTE_DIM(tests); i++) {
+		rv = run_test(tests + i);
+		if (tests[i].allow_fail == 0)
+			rc |= rv;
+	}
+
+	/*
+	 * function calls and mbuf as input argument
+	 * are not supported on 32 bit platform
+	 */
+	if (sizeof(uint64_t) == sizeof(uintptr_t)) {
+		rc |= test_map1();
+		rc |= test_bpf_convert();
 	}
 
 	return rc;
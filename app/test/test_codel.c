@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <rte_codel.h>
+
+#include "test.h"
+
+#define TARGET_US     5000
+#define INTERVAL_US   100000
+#define QLEN          64
+
+static int
+test_codel_config(void)
+{
+	struct rte_codel_config cfg;
+	struct rte_codel codel;
+
+	TEST_ASSERT_FAIL(rte_codel_config_init(NULL, TARGET_US, INTERVAL_US),
+			 "NULL config accepted");
+	TEST_ASSERT_FAIL(rte_codel_config_init(&cfg, 0, INTERVAL_US),
+			 "Zero target accepted");
+	TEST_ASSERT_FAIL(rte_codel_config_init(&cfg, TARGET_US, TARGET_US),
+			 "Interval not larger than target accepted");
+	TEST_ASSERT_SUCCESS(rte_codel_config_init(&cfg, TARGET_US,
+						  INTERVAL_US),
+			    "Valid config rejected");
+	TEST_ASSERT(cfg.target != 0 && cfg.interval > cfg.target,
+		    "Bad config conversion");
+
+	TEST_ASSERT_FAIL(rte_codel_rt_data_init(NULL), "NULL data accepted");
+	TEST_ASSERT_SUCCESS(rte_codel_rt_data_init(&codel), "Init failed");
+	TEST_ASSERT(codel.dropping == 0 && codel.count == 0,
+		    "Bad run-time data init");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_codel_below_target(void)
+{
+	struct rte_codel_config cfg;
+	struct rte_codel codel;
+	uint64_t time;
+	uint32_t i;
+
+	rte_codel_config_init(&cfg, TARGET_US, INTERVAL_US);
+	rte_codel_rt_data_init(&codel);
+
+	/* Short sojourn time, or a single packet queued: never drop */
+	for (i = 0, time = 1; i < 1000; i++, time += cfg.interval / 10) {
+		TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel,
+				cfg.target - 1, QLEN, time), 0,
+				"Dropped packet below target");
+		TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel,
+				cfg.target * 10, 1, time), 0,
+				"Dropped last packet of the queue");
+	}
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_codel_drop(void)
+{
+	struct rte_codel_config cfg;
+	struct rte_codel codel;
+	uint64_t time, prev_drop, spacing, expected;
+	uint32_t count;
+
+	rte_codel_config_init(&cfg, TARGET_US, INTERVAL_US);
+	rte_codel_rt_data_init(&codel);
+
+	/* Above target for less than an interval: no drop */
+	time = 1000;
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target * 2,
+			QLEN, time), 0, "Dropped on first packet above target");
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target * 2,
+			QLEN, time + cfg.interval - 1), 0,
+			"Dropped before interval elapsed");
+
+	/* One interval above target: enter drop state */
+	time += cfg.interval;
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target * 2,
+			QLEN, time), 1, "No drop after interval above target");
+	TEST_ASSERT(codel.dropping && codel.count == 1, "Not in drop state");
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target * 2,
+			QLEN, time), 0, "Dropped twice at the same time");
+
+	/* Drops get closer as interval / sqrt(count) */
+	prev_drop = time;
+	for (count = 2; count <= 16; count++) {
+		time = codel.drop_next;
+		TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel,
+				cfg.target * 2, QLEN, time), 1,
+				"No drop at drop_next");
+		TEST_ASSERT_EQUAL(codel.count, count, "Wrong drop count");
+
+		spacing = codel.drop_next - time;
+		expected = (uint64_t)(cfg.interval / sqrt((double)count));
+		TEST_ASSERT(spacing > expected - expected / 50 &&
+			    spacing < expected + expected / 50,
+			    "Drop spacing %" PRIu64 ", expected %" PRIu64,
+			    spacing, expected);
+		TEST_ASSERT(time > prev_drop, "Drop time not increasing");
+		prev_drop = time;
+	}
+
+	/* Back below target: leave drop state */
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target - 1,
+			QLEN, codel.drop_next), 0, "Dropped below target");
+	TEST_ASSERT_EQUAL(codel.dropping, 0, "Still in drop state");
+
+	/* Above target again soon after: resume with the previous rate */
+	time = codel.drop_next + 1;
+	rte_codel_dequeue(&cfg, &codel, cfg.target * 2, QLEN, time);
+	time += cfg.interval;
+	TEST_ASSERT_EQUAL(rte_codel_dequeue(&cfg, &codel, cfg.target * 2,
+			QLEN, time), 1, "No drop when above target again");
+	TEST_ASSERT(codel.count > 1, "Drop rate not resumed");
+
+	return TEST_SUCCESS;
+}
+
+static struct unit_test_suite codel_test_suite  = {
+	.suite_name = "CoDel Unit Test Suite",
+	.unit_test_cases = {
+		TEST_CASE(test_codel_config),
+		TEST_CASE(test_codel_below_target),
+		TEST_CASE(test_codel_drop),
+		TEST_CASES_END()
+	}
+};
+
+static int
+test_codel(void)
+{
+	return unit_test_suite_runner(&codel_test_suite);
+}
+
+REGISTER_TEST_COMMAND(codel_autotest, test_codel);
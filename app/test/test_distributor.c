@@ -559,6 +559,156 @@ int test_error_distributor_create_numworkers(void)
 }
 
 
+#define SCALABLE_WORKERS 4
+#define SCALABLE_RING_SIZE 16
+#define SCALABLE_NB_PKTS 80
+
+/* Get the packets of all the workers of a scalable distributor */
+static unsigned int
+scalable_get_all(struct rte_distributor_scalable *d,
+		struct rte_mbuf **pkts, unsigned int *worker)
+{
+	unsigned int i, n, w, total = 0;
+
+	for (w = 0; w < SCALABLE_WORKERS; w++) {
+		n = rte_distributor_scalable_get_pkt(d, w, &pkts[total],
+				RTE_DISTRIB_SCALABLE_MAX_BURST);
+		for (i = 0; i < n; i++)
+			worker[total + i] = w;
+		total += n;
+	}
+	return total;
+}
+
+/*
+ * Check with a single lcore that the scalable distributor keeps the
+ * packets of a flow on the same worker while they are in flight, and
+ * gives back in order the packets which do not fit in the rings.
+ */
+static int
+test_scalable_distributor(void)
+{
+	struct rte_distributor_scalable_params params = {
+		.name = "Test_dist_scalable",
+		.socket_id = rte_socket_id(),
+		.num_distributors = 2,
+		.num_workers = SCALABLE_WORKERS,
+		.ring_size = SCALABLE_RING_SIZE,
+		.flow_table_size = 256,
+	};
+	struct rte_distributor_scalable *d;
+	struct rte_mempool *p;
+	struct rte_mbuf *bufs[SCALABLE_NB_PKTS], *orig[SCALABLE_NB_PKTS];
+	struct rte_mbuf *pkts[SCALABLE_NB_PKTS];
+	unsigned int worker[SCALABLE_NB_PKTS];
+	unsigned int flow_worker[8];
+	unsigned int i, n, nb_ret;
+	int ret = -1;
+
+	params.ring_size = SCALABLE_RING_SIZE - 1;
+	d = rte_distributor_scalable_create(&params);
+	if (d != NULL || rte_errno != EINVAL) {
+		printf("ERROR: No error on create() with bad ring size\n");
+		return -1;
+	}
+	params.ring_size = SCALABLE_RING_SIZE;
+
+	d = rte_distributor_scalable_create(&params);
+	if (d == NULL) {
+		printf("Error creating scalable distributor\n");
+		return -1;
+	}
+	p = rte_pktmbuf_pool_create("DT_SCALABLE_POOL", 2 * SCALABLE_NB_PKTS,
+			0, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (p == NULL) {
+		printf("Error creating mempool\n");
+		goto out;
+	}
+	if (rte_mempool_get_bulk(p, (void *)bufs, SCALABLE_NB_PKTS) != 0)
+		goto out;
+
+	/* 32 packets of 8 flows, then all flows are pinned to a worker */
+	for (i = 0; i < 32; i++)
+		bufs[i]->hash.usr = i % 8;
+	if (rte_distributor_scalable_process(d, 0, bufs, 32) != 32) {
+		printf("Scalable distributor could not process 32 packets\n");
+		goto out;
+	}
+	n = scalable_get_all(d, pkts, worker);
+	if (n != 32) {
+		printf("Workers got %u packets instead of 32\n", n);
+		goto out;
+	}
+	for (i = 0; i < 8; i++)
+		flow_worker[i] = SCALABLE_WORKERS;
+	for (i = 0; i < n; i++) {
+		uint32_t flow = pkts[i]->hash.usr;
+
+		if (flow_worker[flow] == SCALABLE_WORKERS)
+			flow_worker[flow] = worker[i];
+		if (flow_worker[flow] != worker[i]) {
+			printf("Flow %u processed by two workers\n", flow);
+			goto out;
+		}
+	}
+
+	/* the flows are still in flight: the other distributor follows */
+	if (rte_distributor_scalable_process(d, 1, bufs, 8) != 8)
+		goto out;
+	n = scalable_get_all(d, pkts, worker);
+	for (i = 0; i < n; i++)
+		if (flow_worker[pkts[i]->hash.usr] != worker[i]) {
+			printf("Flow %u moved while in flight\n",
+					pkts[i]->hash.usr);
+			goto out;
+		}
+
+	/* a single flow overflows the ring of its worker */
+	for (i = 0; i < SCALABLE_NB_PKTS; i++) {
+		bufs[i]->hash.usr = 42;
+		orig[i] = bufs[i];
+	}
+	n = rte_distributor_scalable_process(d, 0, bufs, SCALABLE_NB_PKTS);
+	if (n != SCALABLE_RING_SIZE - 1) {
+		printf("Scalable distributor processed %u packets of one flow\n",
+				n);
+		goto out;
+	}
+	for (i = 0; i < SCALABLE_NB_PKTS - n; i++)
+		if (bufs[i] != orig[n + i]) {
+			printf("Packets not distributed are out of order\n");
+			goto out;
+		}
+	if (scalable_get_all(d, pkts, worker) != n)
+		goto out;
+	for (i = 0; i < n; i++)
+		if (pkts[i] != orig[i]) {
+			printf("Packets of a flow received out of order\n");
+			goto out;
+		}
+
+	/* return the packets to the distributor lcores */
+	if (rte_distributor_scalable_return_pkt(d, worker[0], pkts, n) != n)
+		goto out;
+	nb_ret = rte_distributor_scalable_returned_pkts(d, 1, pkts,
+			SCALABLE_NB_PKTS);
+	if (nb_ret != n) {
+		printf("Got %u returned packets instead of %u\n", nb_ret, n);
+		goto out;
+	}
+	scalable_get_all(d, pkts, worker);
+
+	printf("Scalable distributor test passed\n\n");
+	ret = 0;
+
+out:
+	rte_distributor_scalable_free(d);
+	if (p != NULL && ret == 0)
+		rte_mempool_put_bulk(p, (void *)orig, SCALABLE_NB_PKTS);
+	rte_mempool_free(p);
+	return ret;
+}
+
 /* Useful function which ensures that all worker functions terminate */
 static void
 quit_workers(struct worker_params *wp, struct rte_mempool *p)
@@ -593,6 +743,10 @@ test_distributor(void)
 	static struct rte_mempool *p;
 	int i;
 
+	/* the scalable distributor test runs on a single lcore */
+	if (test_scalable_distributor() < 0)
+		return -1;
+
 	if (rte_lcore_count() < 2) {
 		printf("ERROR: not enough cores to test distributor\n");
 		return -1;
@@ -9,12 +9,16 @@
 #include <rte_random.h>
 #include <rte_debug.h>
 #include <rte_ip.h>
+#include <rte_lcore.h>
+#include <rte_launch.h>
 
 #include "test.h"
 
 #define EFD_TEST_KEY_LEN 8
 #define TABLE_SIZE (1 << 21)
 #define ITERATIONS 3
+#define MW_TABLE_SIZE (1 << 18)
+#define MW_NUM_KEYS (1 << 16)
 
 #if RTE_EFD_VALUE_NUM_BITS == 32
 #define VALUE_BITMASK 0xffffffff
@@ -386,6 +390,119 @@ static int test_average_table_utilization(void)
 	return 0;
 }
 
+/* Multi-writer test state */
+static struct rte_efd_table *mw_handle;
+static uint32_t mw_next_writer;
+static uint32_t mw_num_writers;
+static uint32_t mw_failures;
+
+static void
+mw_key(struct flow_key *key, uint32_t i)
+{
+	memset(key, 0, sizeof(*key));
+	key->ip_src = i;
+	key->ip_dst = IPv4(10, 0, 0, 1);
+	key->port_src = i >> 16;
+	key->proto = 17;
+}
+
+static efd_value_t
+mw_value(uint32_t i, uint32_t round)
+{
+	return (i * 7 + round) & VALUE_BITMASK;
+}
+
+/*
+ * Each writer inserts its share of the keys, updates them and
+ * deletes one key out of four.
+ */
+static int
+test_efd_mw_writer(__attribute__((unused)) void *arg)
+{
+	uint32_t w = __atomic_fetch_add(&mw_next_writer, 1, __ATOMIC_RELAXED);
+	unsigned int socket_id = rte_socket_id();
+	struct flow_key key;
+	uint32_t i, failures = 0;
+
+	for (i = w; i < MW_NUM_KEYS; i += mw_num_writers) {
+		mw_key(&key, i);
+		if (rte_efd_update(mw_handle, socket_id, &key,
+				mw_value(i, 0)) == RTE_EFD_UPDATE_FAILED)
+			failures++;
+	}
+	for (i = w; i < MW_NUM_KEYS; i += mw_num_writers) {
+		mw_key(&key, i);
+		if ((i & 3) == 3) {
+			if (rte_efd_delete(mw_handle, socket_id, &key, NULL))
+				failures++;
+		} else if (rte_efd_update(mw_handle, socket_id, &key,
+				mw_value(i, 1)) == RTE_EFD_UPDATE_FAILED)
+			failures++;
+	}
+
+	__atomic_fetch_add(&mw_failures, failures, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/*
+ * Update a multi-writer table from all the lcores, then check the values
+ * of all the keys with bulk and single lookups.
+ */
+static int test_efd_multi_writer(void)
+{
+	struct flow_key key_array[RTE_EFD_BURST_MAX];
+	const void *key_ptrs[RTE_EFD_BURST_MAX];
+	efd_value_t result[RTE_EFD_BURST_MAX];
+	uint32_t i, j, n, k;
+	unsigned int lcore_id;
+
+	printf("Entering %s\n", __func__);
+
+	mw_handle = rte_efd_create_flags("test_efd_mw", MW_TABLE_SIZE,
+			sizeof(struct flow_key), efd_get_all_sockets_bitmask(),
+			test_socket_id, RTE_EFD_F_MULTI_WRITER);
+	TEST_ASSERT_NOT_NULL(mw_handle, "Error creating the efd table\n");
+
+	mw_next_writer = 0;
+	mw_failures = 0;
+	mw_num_writers = rte_lcore_count();
+
+	RTE_LCORE_FOREACH_SLAVE(lcore_id)
+		rte_eal_remote_launch(test_efd_mw_writer, NULL, lcore_id);
+	test_efd_mw_writer(NULL);
+	rte_eal_mp_wait_lcore();
+
+	TEST_ASSERT_EQUAL(mw_failures, 0, "%u updates failed", mw_failures);
+
+	/* Bursts of all sizes, to cover the tails of the vector paths */
+	for (i = 0, n = 1; i < MW_NUM_KEYS; i += n,
+			n = n % RTE_EFD_BURST_MAX + 1) {
+		n = RTE_MIN(n, MW_NUM_KEYS - i);
+		for (j = 0; j < n; j++) {
+			mw_key(&key_array[j], i + j);
+			key_ptrs[j] = &key_array[j];
+		}
+		rte_efd_lookup_bulk(mw_handle, test_socket_id, n, key_ptrs,
+				result);
+		for (j = 0; j < n; j++) {
+			k = i + j;
+			if ((k & 3) == 3)
+				continue;
+			TEST_ASSERT_EQUAL(result[j], mw_value(k, 1),
+					"bulk: wrong value for key %u", k);
+			TEST_ASSERT_EQUAL(rte_efd_lookup(mw_handle,
+					test_socket_id, &key_array[j]),
+					mw_value(k, 1),
+					"wrong value for key %u", k);
+		}
+	}
+
+	rte_efd_free(mw_handle);
+	mw_handle = NULL;
+
+	return 0;
+}
+
 /*
  * Do tests for EFD creation with bad parameters.
  */
@@ -460,6 +577,8 @@ test_efd(void)
 		return -1;
 	if (test_efd_creation_with_bad_parameters() < 0)
 		return -1;
+	if (test_efd_multi_writer() < 0)
+		return -1;
 	if (test_average_table_utilization() < 0)
 		return -1;
 
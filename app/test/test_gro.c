@@ -0,0 +1,555 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_gro.h>
+
+#include "test.h"
+
+#define NB_MBUF 1023
+#define TCP_ACK_FLAG 0x10
+#define IPV6_EXT_LEN 8
+#define PAD_LEN 4
+#define UDP_MAX_MERGE 64
+
+/* Description of a test packet */
+struct test_pkt {
+	uint32_t flow;       /* added to the source port */
+	uint32_t seq;        /* TCP sequence, or offset of the UDP payload */
+	uint16_t len;        /* L4 payload length */
+	uint16_t frag_off;   /* IPv4 fragment offset field */
+	uint32_t flow_label; /* IPv6 flow label */
+	uint8_t ipv6;
+	uint8_t udp;
+	uint8_t ext;         /* IPv6 extension header before the L4 header */
+	uint8_t pad;         /* trailing padding after the L4 payload */
+};
+
+static struct rte_mempool *pkt_pool;
+
+static void
+free_pkts(struct rte_mbuf **pkts, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		rte_pktmbuf_free(pkts[i]);
+}
+
+static uint32_t
+pkt_hdr_len(const struct test_pkt *p)
+{
+	uint32_t len = sizeof(struct ether_hdr);
+
+	if (p->ipv6)
+		len += sizeof(struct ipv6_hdr) + (p->ext ? IPV6_EXT_LEN : 0);
+	else
+		len += sizeof(struct ipv4_hdr);
+	if (p->udp)
+		len += sizeof(struct udp_hdr);
+	else
+		len += sizeof(struct tcp_hdr);
+	return len;
+}
+
+/*
+ * Build a packet of a TCP or UDP flow. The payload bytes are the low bytes
+ * of their offset in the flow, so that merged payloads can be checked.
+ */
+static struct rte_mbuf *
+build_pkt(const struct test_pkt *p)
+{
+	struct rte_mbuf *m;
+	struct ether_hdr *eth;
+	struct ipv4_hdr *ip4;
+	struct ipv6_hdr *ip6;
+	struct tcp_hdr *tcp;
+	struct udp_hdr *udp;
+	uint8_t *l3, *l4, *data;
+	uint32_t hdr_len, l4_len, i, l3_type;
+
+	m = rte_pktmbuf_alloc(pkt_pool);
+	if (m == NULL)
+		return NULL;
+
+	hdr_len = pkt_hdr_len(p);
+	eth = (struct ether_hdr *)rte_pktmbuf_append(m,
+			hdr_len + p->len + p->pad);
+	if (eth == NULL) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+	memset(eth, 0, hdr_len + p->len + p->pad);
+	eth->d_addr.addr_bytes[5] = 1;
+	eth->s_addr.addr_bytes[5] = 2;
+
+	l3 = (uint8_t *)(eth + 1);
+	l4_len = p->udp ? sizeof(struct udp_hdr) : sizeof(struct tcp_hdr);
+	m->l2_len = sizeof(struct ether_hdr);
+	m->l4_len = l4_len;
+
+	if (p->ipv6) {
+		eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv6);
+		ip6 = (struct ipv6_hdr *)l3;
+		ip6->vtc_flow = rte_cpu_to_be_32(6 << 28 | p->flow_label);
+		ip6->payload_len = rte_cpu_to_be_16(hdr_len -
+				sizeof(struct ether_hdr) -
+				sizeof(struct ipv6_hdr) + p->len);
+		ip6->proto = p->udp ? IPPROTO_UDP : IPPROTO_TCP;
+		ip6->hop_limits = 64;
+		ip6->src_addr[0] = 0x20;
+		ip6->src_addr[15] = 1;
+		ip6->dst_addr[0] = 0x20;
+		ip6->dst_addr[15] = 2;
+		m->l3_len = sizeof(struct ipv6_hdr);
+		l3_type = RTE_PTYPE_L3_IPV6;
+		if (p->ext) {
+			/* empty hop-by-hop options header */
+			l3[sizeof(struct ipv6_hdr)] = ip6->proto;
+			ip6->proto = IPPROTO_HOPOPTS;
+			m->l3_len += IPV6_EXT_LEN;
+			l3_type = RTE_PTYPE_L3_IPV6_EXT;
+		}
+	} else {
+		eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+		ip4 = (struct ipv4_hdr *)l3;
+		ip4->version_ihl = 0x45;
+		ip4->total_length = rte_cpu_to_be_16(hdr_len -
+				sizeof(struct ether_hdr) + p->len);
+		ip4->fragment_offset = rte_cpu_to_be_16(p->frag_off);
+		ip4->time_to_live = 64;
+		ip4->next_proto_id = p->udp ? IPPROTO_UDP : IPPROTO_TCP;
+		ip4->src_addr = rte_cpu_to_be_32(IPv4(10, 0, 0, 1));
+		ip4->dst_addr = rte_cpu_to_be_32(IPv4(192, 168, 0, 1));
+		m->l3_len = sizeof(struct ipv4_hdr);
+		l3_type = RTE_PTYPE_L3_IPV4;
+	}
+	m->packet_type = RTE_PTYPE_L2_ETHER | l3_type |
+		(p->udp ? RTE_PTYPE_L4_UDP : RTE_PTYPE_L4_TCP);
+
+	l4 = l3 + m->l3_len;
+	if (p->udp) {
+		udp = (struct udp_hdr *)l4;
+		udp->src_port = rte_cpu_to_be_16(1024 + p->flow);
+		udp->dst_port = rte_cpu_to_be_16(5000);
+		udp->dgram_len = rte_cpu_to_be_16(l4_len + p->len);
+	} else {
+		tcp = (struct tcp_hdr *)l4;
+		tcp->src_port = rte_cpu_to_be_16(1024 + p->flow);
+		tcp->dst_port = rte_cpu_to_be_16(80);
+		tcp->sent_seq = rte_cpu_to_be_32(p->seq);
+		tcp->data_off = sizeof(struct tcp_hdr) << 2;
+		tcp->tcp_flags = TCP_ACK_FLAG;
+	}
+
+	data = l4 + l4_len;
+	for (i = 0; i < p->len; i++)
+		data[i] = p->seq + i;
+
+	return m;
+}
+
+static int
+build_burst(struct rte_mbuf **pkts, const struct test_pkt *p, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		pkts[i] = build_pkt(&p[i]);
+		if (pkts[i] == NULL) {
+			free_pkts(pkts, i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Find the output packet starting with the mbuf m */
+static struct rte_mbuf *
+find_pkt(struct rte_mbuf **pkts, uint32_t n, const struct rte_mbuf *m)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		if (pkts[i] == m)
+			return pkts[i];
+	return NULL;
+}
+
+/*
+ * Check that a packet holds len bytes of payload of its flow starting at
+ * offset seq, after the headers of p, and that its IP and UDP lengths
+ * were updated.
+ */
+static int
+check_pkt(const struct rte_mbuf *m, const struct test_pkt *p,
+		uint32_t seq, uint32_t len)
+{
+	const struct ipv4_hdr *ip4;
+	const struct ipv6_hdr *ip6;
+	const struct udp_hdr *udp;
+	const uint8_t *d;
+	uint32_t hdr_len, ip_len, i;
+	uint8_t b;
+
+	if (m == NULL)
+		return -1;
+
+	hdr_len = pkt_hdr_len(p);
+	if (m->pkt_len != hdr_len + len)
+		return -1;
+
+	/* length of the IP and L4 headers */
+	ip_len = hdr_len - sizeof(struct ether_hdr);
+	if (p->ipv6) {
+		ip6 = rte_pktmbuf_mtod_offset(m, const struct ipv6_hdr *,
+				sizeof(struct ether_hdr));
+		if (rte_be_to_cpu_16(ip6->payload_len) !=
+				ip_len - sizeof(*ip6) + len)
+			return -1;
+	} else {
+		ip4 = rte_pktmbuf_mtod_offset(m, const struct ipv4_hdr *,
+				sizeof(struct ether_hdr));
+		if (rte_be_to_cpu_16(ip4->total_length) != ip_len + len)
+			return -1;
+	}
+	if (p->udp) {
+		udp = rte_pktmbuf_mtod_offset(m, const struct udp_hdr *,
+				hdr_len - sizeof(*udp));
+		if (rte_be_to_cpu_16(udp->dgram_len) != sizeof(*udp) + len)
+			return -1;
+	}
+
+	for (i = 0; i < len; i++) {
+		d = rte_pktmbuf_read(m, hdr_len + i, 1, &b);
+		if (d == NULL || *d != (uint8_t)(seq + i))
+			return -1;
+	}
+	return 0;
+}
+
+static const struct rte_gro_param burst_param = {
+	.max_flow_num = 4,
+	.max_item_per_flow = 32,
+};
+
+static int
+test_gro_tcp6(void)
+{
+	/* headers of the merged packets */
+	static const struct test_pkt tcp6 = { .ipv6 = 1 };
+	static const struct test_pkt in[] = {
+		{ .ipv6 = 1, .seq = 1000, .len = 100, },
+		/* next segment, merged */
+		{ .ipv6 = 1, .seq = 1100, .len = 100, },
+		/* gap in the sequence */
+		{ .ipv6 = 1, .seq = 1300, .len = 100, },
+		/* previous segment, pre-pended */
+		{ .ipv6 = 1, .seq = 900, .len = 100, },
+		/* next segment of another flow label */
+		{ .ipv6 = 1, .seq = 1200, .len = 100, .flow_label = 1, },
+		/* next segment, but after an extension header */
+		{ .ipv6 = 1, .seq = 1200, .len = 100, .ext = 1, },
+	};
+	struct rte_gro_param param = burst_param;
+	struct rte_mbuf *pkts[RTE_DIM(in)], *orig[RTE_DIM(in)];
+	uint16_t n;
+
+	TEST_ASSERT_SUCCESS(build_burst(pkts, in, RTE_DIM(in)),
+			"Cannot allocate packets");
+	memcpy(orig, pkts, sizeof(orig));
+
+	param.gro_types = RTE_GRO_TCP_IPV6;
+	n = rte_gro_reassemble_burst(pkts, RTE_DIM(in), &param);
+	TEST_ASSERT_EQUAL(n, 4, "%u TCP/IPv6 packets after GRO", n);
+
+	TEST_ASSERT_SUCCESS(check_pkt(find_pkt(pkts, n, orig[3]), &tcp6,
+				900, 300),
+			"Bad merged TCP/IPv6 packet");
+	TEST_ASSERT_SUCCESS(check_pkt(find_pkt(pkts, n, orig[2]), &tcp6,
+				1300, 100),
+			"Out of order TCP/IPv6 packet not kept alone");
+	TEST_ASSERT_SUCCESS(check_pkt(find_pkt(pkts, n, orig[4]), &in[4],
+				1200, 100),
+			"TCP/IPv6 packets of different flow labels merged");
+	TEST_ASSERT_SUCCESS(check_pkt(find_pkt(pkts, n, orig[5]), &in[5],
+				1200, 100),
+			"TCP/IPv6 packet with extension header merged");
+	TEST_ASSERT_EQUAL(pkts[n - 1], orig[5],
+			"Unprocessed packet not returned last");
+
+	free_pkts(pkts, n);
+	return TEST_SUCCESS;
+}
+
+static int
+test_gro_udp(uint8_t ipv6)
+{
+	const struct test_pkt in[] = {
+		{ .ipv6 = ipv6, .udp = 1, .seq = 0, .len = 100, },
+		{ .ipv6 = ipv6, .udp = 1, .seq = 100, .len = 100, },
+		/* longer than the first datagram, starts a new packet */
+		{ .ipv6 = ipv6, .udp = 1, .seq = 200, .len = 120, },
+		{ .ipv6 = ipv6, .udp = 1, .seq = 320, .len = 120, },
+		/* short datagram, merged and closing the packet */
+		{ .ipv6 = ipv6, .udp = 1, .seq = 440, .len = 60, },
+		{ .ipv6 = ipv6, .udp = 1, .seq = 500, .len = 60, },
+		/* another flow */
+		{ .ipv6 = ipv6, .udp = 1, .seq = 0, .len = 100, .flow = 1, },
+	};
+	struct rte_gro_param param = burst_param;
+	struct rte_mbuf *pkts[RTE_DIM(in)], *orig[RTE_DIM(in)], *m;
+	uint16_t n;
+
+	TEST_ASSERT_SUCCESS(build_burst(pkts, in, RTE_DIM(in)),
+			"Cannot allocate packets");
+	memcpy(orig, pkts, sizeof(orig));
+
+	param.gro_types = ipv6 ? RTE_GRO_UDP_IPV6 : RTE_GRO_UDP_IPV4;
+	n = rte_gro_reassemble_burst(pkts, RTE_DIM(in), &param);
+	TEST_ASSERT_EQUAL(n, 4, "%u UDP packets after GRO", n);
+
+	m = find_pkt(pkts, n, orig[0]);
+	TEST_ASSERT_SUCCESS(check_pkt(m, &in[0], 0, 200),
+			"Bad merged UDP packet");
+	TEST_ASSERT(m->nb_segs == 2 && (m->ol_flags & PKT_RX_LRO) &&
+			m->tso_segsz == 100,
+			"Bad metadata of merged UDP packet");
+
+	m = find_pkt(pkts, n, orig[2]);
+	TEST_ASSERT_SUCCESS(check_pkt(m, &in[2], 200, 300),
+			"Bad UDP packet closed by a short datagram");
+	TEST_ASSERT(m->nb_segs == 3 && m->tso_segsz == 120,
+			"Bad metadata of closed UDP packet");
+
+	m = find_pkt(pkts, n, orig[5]);
+	TEST_ASSERT_SUCCESS(check_pkt(m, &in[5], 500, 60),
+			"Datagram merged after a short one");
+	TEST_ASSERT((m->ol_flags & PKT_RX_LRO) == 0,
+			"Single datagram flagged as merged");
+
+	TEST_ASSERT_SUCCESS(check_pkt(find_pkt(pkts, n, orig[6]), &in[6],
+				0, 100),
+			"UDP datagrams of different flows merged");
+
+	free_pkts(pkts, n);
+	return TEST_SUCCESS;
+}
+
+static int
+test_gro_udp4(void)
+{
+	return test_gro_udp(0);
+}
+
+static int
+test_gro_udp6(void)
+{
+	return test_gro_udp(1);
+}
+
+/* A packet holds at most UDP_MAX_MERGE datagrams */
+static int
+test_gro_udp_max_merge(void)
+{
+	struct test_pkt in[UDP_MAX_MERGE + 6];
+	struct rte_gro_param param = burst_param;
+	struct rte_mbuf *pkts[RTE_DIM(in)], *orig[RTE_DIM(in)], *m;
+	uint32_t i;
+	uint16_t n;
+
+	memset(in, 0, sizeof(in));
+	for (i = 0; i < RTE_DIM(in); i++) {
+		in[i].udp = 1;
+		in[i].seq = i * 16;
+		in[i].len = 16;
+	}
+
+	TEST_ASSERT_SUCCESS(build_burst(pkts, in, RTE_DIM(in)),
+			"Cannot allocate packets");
+	memcpy(orig, pkts, sizeof(orig));
+
+	param.gro_types = RTE_GRO_UDP_IPV4;
+	n = rte_gro_reassemble_burst(pkts, RTE_DIM(in), &param);
+	TEST_ASSERT_EQUAL(n, 2, "%u UDP packets after GRO", n);
+
+	m = find_pkt(pkts, n, orig[0]);
+	TEST_ASSERT_SUCCESS(check_pkt(m, &in[0], 0, UDP_MAX_MERGE * 16),
+			"Bad first merged UDP packet");
+	TEST_ASSERT_EQUAL(m->nb_segs, UDP_MAX_MERGE,
+			"Bad number of merged datagrams");
+
+	m = find_pkt(pkts, n, orig[UDP_MAX_MERGE]);
+	TEST_ASSERT_SUCCESS(check_pkt(m, &in[0], UDP_MAX_MERGE * 16,
+				(RTE_DIM(in) - UDP_MAX_MERGE) * 16),
+			"Bad second merged UDP packet");
+
+	free_pkts(pkts, n);
+	return TEST_SUCCESS;
+}
+
+/* IPv4 fragments and padded datagrams are left unprocessed */
+static int
+test_gro_udp4_skip(void)
+{
+	static const struct test_pkt in[] = {
+		{ .udp = 1, .seq = 0, .len = 100, },
+		/* first fragment */
+		{ .udp = 1, .seq = 100, .len = 100,
+			.frag_off = IPV4_HDR_MF_FLAG, },
+		{ .udp = 1, .seq = 100, .len = 100, },
+		/* padded to a minimum frame size */
+		{ .udp = 1, .seq = 200, .len = 100, .pad = PAD_LEN, },
+		/* last fragment */
+		{ .udp = 1, .seq = 200, .len = 100, .frag_off = 1, },
+	};
+	struct rte_gro_param param = burst_param;
+	struct rte_mbuf *pkts[RTE_DIM(in)], *orig[RTE_DIM(in)];
+	uint16_t n;
+
+	TEST_ASSERT_SUCCESS(build_burst(pkts, in, RTE_DIM(in)),
+			"Cannot allocate packets");
+	memcpy(orig, pkts, sizeof(orig));
+
+	param.gro_types = RTE_GRO_UDP_IPV4;
+	n = rte_gro_reassemble_burst(pkts, RTE_DIM(in), &param);
+	TEST_ASSERT_EQUAL(n, 4, "%u UDP packets after GRO", n);
+
+	TEST_ASSERT_SUCCESS(check_pkt(pkts[0], &in[0], 0, 200),
+			"Bad merged UDP packet");
+	TEST_ASSERT(pkts[1] == orig[1] && pkts[2] == orig[3] &&
+			pkts[3] == orig[4],
+			"Fragments or padded datagram processed");
+	TEST_ASSERT(pkts[2]->pkt_len == pkt_hdr_len(&in[3]) + 100 + PAD_LEN &&
+			pkts[2]->nb_segs == 1,
+			"Padded datagram modified");
+
+	free_pkts(pkts, n);
+	return TEST_SUCCESS;
+}
+
+/* Flushing several GRO types never writes past max_nb_out packets */
+static int
+test_gro_timeout_flush(void)
+{
+	static const struct test_pkt in[] = {
+		{ .ipv6 = 1, .seq = 0, .len = 100, .flow = 0, },
+		{ .ipv6 = 1, .seq = 0, .len = 100, .flow = 1, },
+		{ .ipv6 = 1, .seq = 0, .len = 100, .flow = 2, },
+		{ .udp = 1, .len = 100, .flow = 0, },
+		{ .udp = 1, .len = 100, .flow = 1, },
+		{ .udp = 1, .len = 100, .flow = 2, },
+		{ .ipv6 = 1, .udp = 1, .len = 100, .flow = 0, },
+		{ .ipv6 = 1, .udp = 1, .len = 100, .flow = 1, },
+		{ .ipv6 = 1, .udp = 1, .len = 100, .flow = 2, },
+	};
+	/* flushes ending on a type boundary, in the middle of a type, all */
+	static const uint16_t max_out[] = { 3, 5, 2 };
+	struct rte_gro_param param = {
+		.gro_types = RTE_GRO_TCP_IPV6 | RTE_GRO_UDP_IPV4 |
+			RTE_GRO_UDP_IPV6,
+		.max_flow_num = 4,
+		.max_item_per_flow = 4,
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_mbuf *pkts[RTE_DIM(in)], *out[RTE_DIM(in) + 1];
+	uint32_t i, total = 0;
+	uint16_t n, exp;
+	int ret = TEST_FAILED;
+	void *ctx;
+
+	ctx = rte_gro_ctx_create(&param);
+	TEST_ASSERT_NOT_NULL(ctx, "Cannot create GRO context");
+
+	if (build_burst(pkts, in, RTE_DIM(in)) < 0) {
+		printf("Cannot allocate packets\n");
+		goto out;
+	}
+
+	n = rte_gro_reassemble(pkts, RTE_DIM(in), ctx);
+	if (n != 0 || rte_gro_get_pkt_count(ctx) != RTE_DIM(in)) {
+		printf("Packets not stored in the GRO tables\n");
+		free_pkts(pkts, n);
+		goto out;
+	}
+
+	for (i = 0; i < RTE_DIM(max_out); i++) {
+		memset(out, 0, sizeof(out));
+		exp = RTE_MIN(max_out[i], RTE_DIM(in) - total);
+		n = rte_gro_timeout_flush(ctx, 0, param.gro_types, out,
+				max_out[i]);
+		free_pkts(out, RTE_MIN(n, max_out[i]));
+		total += n;
+		if (n != exp || out[max_out[i]] != NULL) {
+			printf("Flush %u returned %u packets out of %u, "
+					"or wrote past max_nb_out\n",
+					i, n, exp);
+			goto out;
+		}
+	}
+	if (rte_gro_get_pkt_count(ctx) == 0)
+		ret = TEST_SUCCESS;
+
+out:
+	/* release what may be left in the tables */
+	n = rte_gro_timeout_flush(ctx, 0, param.gro_types, out,
+			RTE_DIM(in));
+	free_pkts(out, n);
+	rte_gro_ctx_destroy(ctx);
+	return ret;
+}
+
+static int
+test_setup(void)
+{
+	if (pkt_pool == NULL)
+		pkt_pool = rte_pktmbuf_pool_create("GRO_TEST_POOL", NB_MBUF,
+				0, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+				rte_socket_id());
+	if (pkt_pool == NULL) {
+		printf("%s: Cannot create mbuf pool\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+test_teardown(void)
+{
+	rte_mempool_free(pkt_pool);
+	pkt_pool = NULL;
+}
+
+static struct unit_test_suite gro_test_suite  = {
+	.setup = test_setup,
+	.teardown = test_teardown,
+	.suite_name = "GRO Unit Test Suite",
+	.unit_test_cases = {
+		TEST_CASE(test_gro_tcp6),
+		TEST_CASE(test_gro_udp4),
+		TEST_CASE(test_gro_udp6),
+		TEST_CASE(test_gro_udp_max_merge),
+		TEST_CASE(test_gro_udp4_skip),
+		TEST_CASE(test_gro_timeout_flush),
+		TEST_CASES_END()
+	}
+};
+
+static int
+test_gro(void)
+{
+	return unit_test_suite_runner(&gro_test_suite);
+}
+
+REGISTER_TEST_COMMAND(gro_autotest, test_gro);
@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_gro.h>
+
+#include "test.h"
+
+#define BURST_SIZE RTE_GRO_MAX_BURST_ITEM_NUM
+#define NUM_ITERATIONS 2000
+#define PAYLOAD_LEN 100
+#define HDR_LEN (sizeof(struct ether_hdr) + sizeof(struct ipv4_hdr) + \
+		sizeof(struct tcp_hdr))
+#define NB_MBUF 4095
+#define TCP_ACK_FLAG 0x10
+
+static struct rte_mempool *pkt_pool;
+
+static void
+free_pkts(struct rte_mbuf **pkts, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		rte_pktmbuf_free(pkts[i]);
+}
+
+/* Build a TCP/IPv4 segment of a flow, carrying the n-th payload */
+static struct rte_mbuf *
+build_tcp4_pkt(uint32_t flow, uint32_t n)
+{
+	struct rte_mbuf *m;
+	struct ether_hdr *eth;
+	struct ipv4_hdr *ip;
+	struct tcp_hdr *tcp;
+
+	m = rte_pktmbuf_alloc(pkt_pool);
+	if (m == NULL)
+		return NULL;
+
+	eth = (struct ether_hdr *)rte_pktmbuf_append(m,
+			HDR_LEN + PAYLOAD_LEN);
+	memset(eth, 0, HDR_LEN);
+	eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
+
+	ip = (struct ipv4_hdr *)(eth + 1);
+	ip->version_ihl = 0x45;
+	ip->total_length = rte_cpu_to_be_16(sizeof(struct ipv4_hdr) +
+			sizeof(struct tcp_hdr) + PAYLOAD_LEN);
+	ip->fragment_offset = rte_cpu_to_be_16(IPV4_HDR_DF_FLAG);
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_TCP;
+	ip->src_addr = rte_cpu_to_be_32(IPv4(10, 0, flow >> 8, flow));
+	ip->dst_addr = rte_cpu_to_be_32(IPv4(192, 168, 0, 1));
+
+	tcp = (struct tcp_hdr *)(ip + 1);
+	tcp->src_port = rte_cpu_to_be_16(1024 + flow);
+	tcp->dst_port = rte_cpu_to_be_16(80);
+	tcp->sent_seq = rte_cpu_to_be_32(n * PAYLOAD_LEN);
+	tcp->data_off = sizeof(struct tcp_hdr) << 2;
+	tcp->tcp_flags = TCP_ACK_FLAG;
+
+	m->l2_len = sizeof(struct ether_hdr);
+	m->l3_len = sizeof(struct ipv4_hdr);
+	m->l4_len = sizeof(struct tcp_hdr);
+	m->packet_type = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4 |
+		RTE_PTYPE_L4_TCP;
+
+	return m;
+}
+
+/* Fill a burst with interleaved in-order segments of nb_flows flows */
+static int
+build_burst(struct rte_mbuf **pkts, uint32_t nb_flows)
+{
+	uint32_t i;
+
+	for (i = 0; i < BURST_SIZE; i++) {
+		pkts[i] = build_tcp4_pkt(i % nb_flows, i / nb_flows);
+		if (pkts[i] == NULL) {
+			free_pkts(pkts, i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+test_gro_burst_perf(uint32_t nb_flows)
+{
+	struct rte_mbuf *pkts[BURST_SIZE];
+	struct rte_gro_param param = {
+		.gro_types = RTE_GRO_TCP_IPV4,
+		.max_flow_num = BURST_SIZE,
+		.max_item_per_flow = BURST_SIZE,
+	};
+	uint64_t start, cycles = 0;
+	uint16_t nb_out;
+	uint32_t i;
+
+	for (i = 0; i < NUM_ITERATIONS; i++) {
+		if (build_burst(pkts, nb_flows) < 0)
+			return -1;
+
+		start = rte_rdtsc_precise();
+		nb_out = rte_gro_reassemble_burst(pkts, BURST_SIZE, &param);
+		cycles += rte_rdtsc_precise() - start;
+
+		if (nb_out != nb_flows) {
+			printf("%u flows merged into %u packets\n",
+					nb_flows, nb_out);
+			free_pkts(pkts, nb_out);
+			return -1;
+		}
+		free_pkts(pkts, nb_out);
+	}
+
+	printf("%-10s%10u%16"PRIu64"%16"PRIu64"\n", "burst", nb_flows,
+			cycles / NUM_ITERATIONS,
+			cycles / (NUM_ITERATIONS * BURST_SIZE));
+	return 0;
+}
+
+static int
+test_gro_ctx_perf(uint32_t nb_flows)
+{
+	struct rte_mbuf *pkts[BURST_SIZE];
+	struct rte_gro_param param = {
+		.gro_types = RTE_GRO_TCP_IPV4,
+		.max_flow_num = BURST_SIZE,
+		.max_item_per_flow = BURST_SIZE,
+		.socket_id = rte_socket_id(),
+	};
+	uint64_t start, cycles = 0;
+	uint16_t nb_out;
+	uint32_t i;
+	void *ctx;
+
+	ctx = rte_gro_ctx_create(&param);
+	if (ctx == NULL) {
+		printf("Cannot create GRO context\n");
+		return -1;
+	}
+
+	for (i = 0; i < NUM_ITERATIONS; i++) {
+		if (build_burst(pkts, nb_flows) < 0)
+			goto fail;
+
+		start = rte_rdtsc_precise();
+		rte_gro_reassemble(pkts, BURST_SIZE, ctx);
+		nb_out = rte_gro_timeout_flush(ctx, 0, RTE_GRO_TCP_IPV4,
+				pkts, BURST_SIZE);
+		cycles += rte_rdtsc_precise() - start;
+
+		free_pkts(pkts, nb_out);
+		if (nb_out != nb_flows) {
+			printf("%u flows merged into %u packets\n",
+					nb_flows, nb_out);
+			goto fail;
+		}
+	}
+	rte_gro_ctx_destroy(ctx);
+
+	printf("%-10s%10u%16"PRIu64"%16"PRIu64"\n", "context", nb_flows,
+			cycles / NUM_ITERATIONS,
+			cycles / (NUM_ITERATIONS * BURST_SIZE));
+	return 0;
+
+fail:
+	rte_gro_ctx_destroy(ctx);
+	return -1;
+}
+
+static int
+test_gro_perf(void)
+{
+	uint32_t nb_flows;
+
+	pkt_pool = rte_pktmbuf_pool_create("GRO_PERF_POOL", NB_MBUF, 0, 0,
+			RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (pkt_pool == NULL) {
+		printf("Cannot create mbuf pool\n");
+		return -1;
+	}
+
+	printf("\nTCP/IPv4 GRO cost for bursts of %u packets\n", BURST_SIZE);
+	printf("%-10s%10s%16s%16s\n", "API", "flows", "cycles/burst",
+			"cycles/pkt");
+
+	for (nb_flows = 1; nb_flows <= BURST_SIZE; nb_flows <<= 1) {
+		if (test_gro_burst_perf(nb_flows) < 0 ||
+				test_gro_ctx_perf(nb_flows) < 0) {
+			rte_mempool_free(pkt_pool);
+			return -1;
+		}
+	}
+
+	rte_mempool_free(pkt_pool);
+	return 0;
+}
+
+REGISTER_TEST_COMMAND(gro_perf_autotest, test_gro_perf);
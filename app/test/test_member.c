@@ -17,6 +17,7 @@
 struct rte_member_setsum *setsum_ht;
 struct rte_member_setsum *setsum_cache;
 struct rte_member_setsum *setsum_vbf;
+struct rte_member_setsum *setsum_cf;
 
 /* 5-tuple key type */
 struct flow_key {
@@ -92,6 +93,8 @@ static struct rte_member_parameters params = {
 		/* num_set and false_positive_rate only relevant to vBF */
 		.num_set = 16,
 		.false_positive_rate = 0.03,
+		/* fp_bits only relevant to CF */
+		.fp_bits = 12,
 		.prim_hash_seed = 1,
 		.sec_hash_seed = 11,
 		.socket_id = 0			/* NUMA Socket ID for memory. */
@@ -217,7 +220,22 @@ test_member_create_bad_param(void)
 		return -1;
 	}
 
+	bad_params.name = "bad_param6";
+	bad_params.type = RTE_MEMBER_TYPE_CF;
+	bad_params.num_keys = MAX_ENTRIES;
+	bad_params.fp_bits = 10;
+	/* Test with unsupported fingerprint size for CF should fail */
+	bad_setsum = rte_member_create(&bad_params);
+	if (bad_setsum != NULL) {
+		rte_member_free(bad_setsum);
+		printf("Impossible creating setsum successfully with invalid "
+			"fingerprint size for CF\n");
+		return -1;
+	}
+
 	bad_params.name = "bad_param5";
+	bad_params.type = RTE_MEMBER_TYPE_HT;
+	bad_params.num_keys = RTE_MEMBER_ENTRIES_MAX + 1;
 	/* Test with same name should fail */
 	bad_setsum = rte_member_create(&bad_params);
 	if (bad_setsum != NULL) {
@@ -249,7 +267,12 @@ static int test_member_create(void)
 	params.type = RTE_MEMBER_TYPE_VBF;
 	setsum_vbf = rte_member_create(&params);
 
-	if (setsum_ht == NULL || setsum_cache == NULL || setsum_vbf == NULL) {
+	params.name = "test_member_cf";
+	params.type = RTE_MEMBER_TYPE_CF;
+	setsum_cf = rte_member_create(&params);
+
+	if (setsum_ht == NULL || setsum_cache == NULL || setsum_vbf == NULL ||
+			setsum_cf == NULL) {
 		printf("Creation of setsums fail\n");
 		return -1;
 	}
@@ -259,14 +282,16 @@ static int test_member_create(void)
 
 static int test_member_insert(void)
 {
-	int ret_ht, ret_cache, ret_vbf, i;
+	int ret_ht, ret_cache, ret_vbf, ret_cf, i;
 
 	for (i = 0; i < NUM_SAMPLES; i++) {
 		ret_ht = rte_member_add(setsum_ht, &keys[i], test_set[i]);
 		ret_cache = rte_member_add(setsum_cache, &keys[i],
 						test_set[i]);
 		ret_vbf = rte_member_add(setsum_vbf, &keys[i], test_set[i]);
-		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0,
+		ret_cf = rte_member_add(setsum_cf, &keys[i], test_set[i]);
+		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0 &&
+				ret_cf >= 0,
 				"insert error");
 	}
 	printf("insert key success\n");
@@ -275,15 +300,17 @@ static int test_member_insert(void)
 
 static int test_member_lookup(void)
 {
-	int ret_ht, ret_cache, ret_vbf, i;
-	uint16_t set_ht, set_cache, set_vbf;
+	int ret_ht, ret_cache, ret_vbf, ret_cf, i;
+	uint16_t set_ht, set_cache, set_vbf, set_cf;
 	member_set_t set_ids_ht[NUM_SAMPLES] = {0};
 	member_set_t set_ids_cache[NUM_SAMPLES] = {0};
 	member_set_t set_ids_vbf[NUM_SAMPLES] = {0};
+	member_set_t set_ids_cf[NUM_SAMPLES] = {0};
 
 	uint32_t num_key_ht = NUM_SAMPLES;
 	uint32_t num_key_cache = NUM_SAMPLES;
 	uint32_t num_key_vbf = NUM_SAMPLES;
+	uint32_t num_key_cf = NUM_SAMPLES;
 
 	const void *key_array[NUM_SAMPLES];
 
@@ -293,12 +320,15 @@ static int test_member_lookup(void)
 		ret_cache = rte_member_lookup(setsum_cache, &keys[i],
 							&set_cache);
 		ret_vbf = rte_member_lookup(setsum_vbf, &keys[i], &set_vbf);
-		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0,
+		ret_cf = rte_member_lookup(setsum_cf, &keys[i], &set_cf);
+		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0 &&
+				ret_cf >= 0,
 				"single lookup function error");
 
 		TEST_ASSERT(set_ht == test_set[i] &&
 				set_cache == test_set[i] &&
-				set_vbf == test_set[i],
+				set_vbf == test_set[i] &&
+				set_cf == test_set[i],
 				"single lookup set value error");
 	}
 	printf("lookup single key success\n");
@@ -316,13 +346,18 @@ static int test_member_lookup(void)
 	ret_vbf = rte_member_lookup_bulk(setsum_vbf, key_array,
 			num_key_vbf, set_ids_vbf);
 
-	TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0,
+	ret_cf = rte_member_lookup_bulk(setsum_cf, key_array,
+			num_key_cf, set_ids_cf);
+
+	TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0 &&
+			ret_cf >= 0,
 			"bulk lookup function error");
 
 	for (i = 0; i < NUM_SAMPLES; i++) {
 		TEST_ASSERT((set_ids_ht[i] == test_set[i]) &&
 				(set_ids_cache[i] == test_set[i]) &&
-				(set_ids_vbf[i] == test_set[i]),
+				(set_ids_vbf[i] == test_set[i]) &&
+				(set_ids_cf[i] == test_set[i]),
 				"bulk lookup result error");
 	}
 
@@ -331,15 +366,17 @@ static int test_member_lookup(void)
 
 static int test_member_delete(void)
 {
-	int ret_ht, ret_cache, ret_vbf, i;
-	uint16_t set_ht, set_cache, set_vbf;
+	int ret_ht, ret_cache, ret_vbf, ret_cf, i;
+	uint16_t set_ht, set_cache, set_vbf, set_cf;
 	const void *key_array[NUM_SAMPLES];
 	member_set_t set_ids_ht[NUM_SAMPLES] = {0};
 	member_set_t set_ids_cache[NUM_SAMPLES] = {0};
 	member_set_t set_ids_vbf[NUM_SAMPLES] = {0};
+	member_set_t set_ids_cf[NUM_SAMPLES] = {0};
 	uint32_t num_key_ht = NUM_SAMPLES;
 	uint32_t num_key_cache = NUM_SAMPLES;
 	uint32_t num_key_vbf = NUM_SAMPLES;
+	uint32_t num_key_cf = NUM_SAMPLES;
 
 	/* Delete part of all inserted keys */
 	for (i = 0; i < NUM_SAMPLES / 2; i++) {
@@ -347,8 +384,9 @@ static int test_member_delete(void)
 		ret_cache = rte_member_delete(setsum_cache, &keys[i],
 						test_set[i]);
 		ret_vbf = rte_member_delete(setsum_vbf, &keys[i], test_set[i]);
+		ret_cf = rte_member_delete(setsum_cf, &keys[i], test_set[i]);
 		/* VBF does not support delete yet, so return error code */
-		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0,
+		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_cf >= 0,
 				"key deletion function error");
 		TEST_ASSERT(ret_vbf < 0,
 				"vbf does not support deletion, error");
@@ -366,19 +404,25 @@ static int test_member_delete(void)
 	ret_vbf = rte_member_lookup_bulk(setsum_vbf, key_array,
 			num_key_vbf, set_ids_vbf);
 
-	TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0,
+	ret_cf = rte_member_lookup_bulk(setsum_cf, key_array,
+			num_key_cf, set_ids_cf);
+
+	TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_vbf >= 0 &&
+			ret_cf >= 0,
 			"bulk lookup function error");
 
 	for (i = 0; i < NUM_SAMPLES / 2; i++) {
 		TEST_ASSERT((set_ids_ht[i] == RTE_MEMBER_NO_MATCH) &&
-				(set_ids_cache[i] == RTE_MEMBER_NO_MATCH),
+				(set_ids_cache[i] == RTE_MEMBER_NO_MATCH) &&
+				(set_ids_cf[i] == RTE_MEMBER_NO_MATCH),
 				"bulk lookup result error");
 	}
 
 	for (i = NUM_SAMPLES / 2; i < NUM_SAMPLES; i++) {
 		TEST_ASSERT((set_ids_ht[i] == test_set[i]) &&
 				(set_ids_cache[i] == test_set[i]) &&
-				(set_ids_vbf[i] == test_set[i]),
+				(set_ids_vbf[i] == test_set[i]) &&
+				(set_ids_cf[i] == test_set[i]),
 				"bulk lookup result error");
 	}
 
@@ -388,8 +432,9 @@ static int test_member_delete(void)
 		ret_cache = rte_member_delete(setsum_cache, &keys[i],
 						test_set[i]);
 		ret_vbf = rte_member_delete(setsum_vbf, &keys[i], test_set[i]);
+		ret_cf = rte_member_delete(setsum_cf, &keys[i], test_set[i]);
 		/* VBF does not support delete yet, so return error code */
-		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0,
+		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_cf >= 0,
 				"key deletion function error");
 		TEST_ASSERT(ret_vbf < 0,
 				"vbf does not support deletion, error");
@@ -400,12 +445,32 @@ static int test_member_delete(void)
 		ret_cache = rte_member_lookup(setsum_cache, &keys[i],
 						&set_cache);
 		ret_vbf = rte_member_lookup(setsum_vbf, &keys[i], &set_vbf);
-		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0,
+		ret_cf = rte_member_lookup(setsum_cf, &keys[i], &set_cf);
+		TEST_ASSERT(ret_ht >= 0 && ret_cache >= 0 && ret_cf >= 0,
 				"key lookup function error");
 		TEST_ASSERT(set_ht == RTE_MEMBER_NO_MATCH &&
-				ret_cache == RTE_MEMBER_NO_MATCH,
+				ret_cache == RTE_MEMBER_NO_MATCH &&
+				set_cf == RTE_MEMBER_NO_MATCH,
 				"key deletion failed");
 	}
+	/* A key added twice in CF stays until it is deleted twice */
+	for (i = 0; i < 2; i++) {
+		ret_cf = rte_member_add(setsum_cf, &keys[0], test_set[0]);
+		TEST_ASSERT(ret_cf >= 0, "cf insert error");
+	}
+	for (i = 0; i < 2; i++) {
+		ret_cf = rte_member_lookup(setsum_cf, &keys[0], &set_cf);
+		TEST_ASSERT(ret_cf == 1 && set_cf == test_set[0],
+				"cf key deleted too early");
+		ret_cf = rte_member_delete(setsum_cf, &keys[0], test_set[0]);
+		TEST_ASSERT(ret_cf == 0, "cf key deletion function error");
+	}
+	ret_cf = rte_member_lookup(setsum_cf, &keys[0], &set_cf);
+	TEST_ASSERT(ret_cf == 0 && set_cf == RTE_MEMBER_NO_MATCH,
+			"cf key deletion failed");
+	ret_cf = rte_member_delete(setsum_cf, &keys[0], test_set[0]);
+	TEST_ASSERT(ret_cf == -ENOENT, "cf deleted a missing key");
+
 	/* Reset vbf for other following tests */
 	rte_member_reset(setsum_vbf);
 
@@ -415,36 +480,44 @@ static int test_member_delete(void)
 
 static int test_member_multimatch(void)
 {
-	int ret_ht, ret_vbf, ret_cache;
+	int ret_ht, ret_vbf, ret_cache, ret_cf;
 	member_set_t set_ids_ht[MAX_MATCH] = {0};
 	member_set_t set_ids_vbf[MAX_MATCH] = {0};
 	member_set_t set_ids_cache[MAX_MATCH] = {0};
+	member_set_t set_ids_cf[MAX_MATCH] = {0};
 
 	member_set_t set_ids_ht_m[NUM_SAMPLES][MAX_MATCH] = {{0} };
 	member_set_t set_ids_vbf_m[NUM_SAMPLES][MAX_MATCH] = {{0} };
 	member_set_t set_ids_cache_m[NUM_SAMPLES][MAX_MATCH] = {{0} };
+	member_set_t set_ids_cf_m[NUM_SAMPLES][MAX_MATCH] = {{0} };
 
 	uint32_t match_count_ht[NUM_SAMPLES];
 	uint32_t match_count_vbf[NUM_SAMPLES];
 	uint32_t match_count_cache[NUM_SAMPLES];
+	uint32_t match_count_cf[NUM_SAMPLES];
 
 	uint32_t num_key_ht = NUM_SAMPLES;
 	uint32_t num_key_vbf = NUM_SAMPLES;
 	uint32_t num_key_cache = NUM_SAMPLES;
+	uint32_t num_key_cf = NUM_SAMPLES;
 
 	const void *key_array[NUM_SAMPLES];
 
 	uint32_t i, j;
 
-	/* Same key at most inserted 2*entry_per_bucket times for HT mode */
+	/*
+	 * Same key at most inserted 2*entry_per_bucket times for HT and CF
+	 * modes
+	 */
 	for (i = M_MATCH_S; i <= M_MATCH_E; i += M_MATCH_STEP) {
 		for (j = 0; j < NUM_SAMPLES; j++) {
 			ret_ht = rte_member_add(setsum_ht, &keys[j], i);
 			ret_vbf = rte_member_add(setsum_vbf, &keys[j], i);
 			ret_cache = rte_member_add(setsum_cache, &keys[j], i);
+			ret_cf = rte_member_add(setsum_cf, &keys[j], i);
 
 			TEST_ASSERT(ret_ht >= 0 && ret_vbf >= 0 &&
-					ret_cache >= 0,
+					ret_cache >= 0 && ret_cf >= 0,
 					"insert function error");
 		}
 	}
@@ -457,12 +530,14 @@ static int test_member_multimatch(void)
 							MAX_MATCH, set_ids_ht);
 		ret_cache = rte_member_lookup_multi(setsum_cache, &keys[i],
 						MAX_MATCH, set_ids_cache);
+		ret_cf = rte_member_lookup_multi(setsum_cf, &keys[i],
+						MAX_MATCH, set_ids_cf);
 		/*
 		 * For cache mode, keys overwrite when signature same.
 		 * the mutimatch should work like single match.
 		 */
 		TEST_ASSERT(ret_ht == M_MATCH_CNT && ret_vbf == M_MATCH_CNT &&
-				ret_cache == 1,
+				ret_cache == 1 && ret_cf == M_MATCH_CNT,
 				"single lookup_multi error");
 		TEST_ASSERT(set_ids_cache[0] == M_MATCH_E,
 				"single lookup_multi cache error");
@@ -470,6 +545,8 @@ static int test_member_multimatch(void)
 		for (j = 1; j <= M_MATCH_CNT; j++) {
 			TEST_ASSERT(set_ids_ht[j-1] == j * M_MATCH_STEP - 1 &&
 					set_ids_vbf[j-1] ==
+							j * M_MATCH_STEP - 1 &&
+					set_ids_cf[j-1] ==
 							j * M_MATCH_STEP - 1,
 					"single multimatch lookup error");
 		}
@@ -491,6 +568,10 @@ static int test_member_multimatch(void)
 			&key_array[0], num_key_cache, MAX_MATCH,
 			match_count_cache, (member_set_t *)set_ids_cache_m);
 
+	ret_cf = rte_member_lookup_multi_bulk(setsum_cf,
+			&key_array[0], num_key_cf, MAX_MATCH, match_count_cf,
+			(member_set_t *)set_ids_cf_m);
+
 
 	for (j = 0; j < NUM_SAMPLES; j++) {
 		TEST_ASSERT(match_count_ht[j] == M_MATCH_CNT,
@@ -499,6 +580,8 @@ static int test_member_multimatch(void)
 			"bulk multimatch lookup vBF match count error");
 		TEST_ASSERT(match_count_cache[j] == 1,
 			"bulk multimatch lookup CACHE match count error");
+		TEST_ASSERT(match_count_cf[j] == M_MATCH_CNT,
+			"bulk multimatch lookup CF match count error");
 		TEST_ASSERT(set_ids_cache_m[j][0] == M_MATCH_E,
 			"bulk multimatch lookup CACHE set value error");
 
@@ -509,6 +592,9 @@ static int test_member_multimatch(void)
 			TEST_ASSERT(set_ids_vbf_m[j][i-1] ==
 							i * M_MATCH_STEP - 1,
 				"bulk multimatch lookup vBF set value error");
+			TEST_ASSERT(set_ids_cf_m[j][i-1] ==
+							i * M_MATCH_STEP - 1,
+				"bulk multimatch lookup CF set value error");
 		}
 	}
 
@@ -598,6 +684,7 @@ test_member_loadfactor(void)
 	rte_member_free(setsum_ht);
 	rte_member_free(setsum_cache);
 	rte_member_free(setsum_vbf);
+	rte_member_free(setsum_cf);
 
 	params.key_len = KEY_SIZE;
 	params.name = "test_member_ht";
@@ -609,8 +696,11 @@ test_member_loadfactor(void)
 	params.is_cache = 1;
 	setsum_cache = rte_member_create(&params);
 
+	params.name = "test_member_cf";
+	params.type = RTE_MEMBER_TYPE_CF;
+	setsum_cf = rte_member_create(&params);
 
-	if (setsum_ht == NULL || setsum_cache == NULL) {
+	if (setsum_ht == NULL || setsum_cache == NULL || setsum_cf == NULL) {
 		printf("Creation of setsums fail\n");
 		return -1;
 	}
@@ -662,6 +752,31 @@ test_member_loadfactor(void)
 	printf("\nKeys inserted when eviction happens(cache)= %.2f%% (%u/%u)\n",
 		((double) average_keys_added / params.num_keys * 100),
 		average_keys_added, params.num_keys);
+
+	/* Test cuckoo filter */
+	added_keys = average_keys_added = 0;
+	for (j = 0; j < ITERATIONS; j++) {
+		/* Add random entries until key cannot be added */
+		ret = add_generated_keys(setsum_cf, &added_keys);
+		if (ret != -ENOSPC) {
+			printf("Unexpected error when adding keys\n");
+			return -1;
+		}
+		average_keys_added += added_keys;
+
+		/* Reset the table */
+		rte_member_reset(setsum_cf);
+
+		/* Print a dot to show progress on operations */
+		printf(".");
+		fflush(stdout);
+	}
+
+	average_keys_added /= ITERATIONS;
+
+	printf("\nKeys inserted when no space(cuckoo filter) = %.2f%% (%u/%u)\n",
+		((double) average_keys_added / params.num_keys * 100),
+		average_keys_added, params.num_keys);
 	return 0;
 }
 
@@ -671,6 +786,7 @@ perform_free(void)
 	rte_member_free(setsum_ht);
 	rte_member_free(setsum_cache);
 	rte_member_free(setsum_vbf);
+	rte_member_free(setsum_cf);
 }
 
 static int
@@ -705,6 +821,7 @@ test_member(void)
 	if (test_member_loadfactor() < 0) {
 		rte_member_free(setsum_ht);
 		rte_member_free(setsum_cache);
+		rte_member_free(setsum_cf);
 		return -1;
 	}
 
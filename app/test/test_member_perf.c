@@ -24,6 +24,7 @@
 #define VBF_SET_CNT 16
 #define BURST_SIZE 64
 #define VBF_FALSE_RATE 0.03
+#define CF_FP_BITS 12
 
 static unsigned int test_socket_id;
 
@@ -31,6 +32,7 @@ enum sstype {
 	HT = 0,
 	CACHE,
 	VBF,
+	CF,
 	NUM_TYPE
 };
 
@@ -139,7 +141,7 @@ setup_keys_and_data(struct member_perf_params *params, unsigned int cycle,
 			keys[i][j] = rte_rand() & 0xFF;
 
 		data[HT][i] = data[CACHE][i] = (rte_rand() & 0x7FFE) + 1;
-		data[VBF][i] = rte_rand() % VBF_SET_CNT + 1;
+		data[VBF][i] = data[CF][i] = rte_rand() % VBF_SET_CNT + 1;
 	}
 
 	/* Remove duplicates from the keys array */
@@ -197,6 +199,14 @@ setup_keys_and_data(struct member_perf_params *params, unsigned int cycle,
 	params->setsum[VBF] = rte_member_create(&member_params);
 	if (params->setsum[VBF] == NULL)
 		fprintf(stderr, "VBF create fail\n");
+
+	member_params.name = "test_member_cf";
+	member_params.type = RTE_MEMBER_TYPE_CF;
+	member_params.num_keys = entry_cnt;
+	member_params.fp_bits = CF_FP_BITS;
+	params->setsum[CF] = rte_member_create(&member_params);
+	if (params->setsum[CF] == NULL)
+		fprintf(stderr, "CF create fail\n");
 	for (i = 0; i < NUM_TYPE; i++) {
 		if (params->setsum[i] == NULL)
 			return -1;
@@ -251,8 +261,10 @@ timed_lookups(struct member_perf_params *params, int type)
 				printf("lookup wrong internally");
 				return -1;
 			}
-			if (type == HT && result == RTE_MEMBER_NO_MATCH) {
-				printf("HT mode shouldn't have false negative");
+			if ((type == HT || type == CF) &&
+					result == RTE_MEMBER_NO_MATCH) {
+				printf("HT and CF modes shouldn't have false "
+					"negative");
 				return -1;
 			}
 			if (result != data[type][j])
@@ -10,8 +10,10 @@
 
 #include "test.h"
 
+#include <rte_common.h>
 #include <rte_cycles.h>
 #include <rte_meter.h>
+#include <rte_random.h>
 
 #define mlog(format, ...) do{\
 		printf("Line %d:",__LINE__);\
@@ -676,6 +678,207 @@ tm_test_trtcm_rfc4115_color_aware_check(void)
 	return 0;
 }
 
+#define TM_TEST_BULK_FLOWS	4
+#define TM_TEST_BULK_PKTS	64
+#define TM_TEST_BULK_ROUNDS	64
+
+/* Burst made of sequences of packets of the same flow */
+static void
+tm_test_bulk_burst(uint32_t *flow, uint32_t *pkt_len, enum rte_color *color)
+{
+	uint32_t i, f = 0, n_run = 0;
+
+	for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+		if (n_run == 0) {
+			f = rte_rand() % TM_TEST_BULK_FLOWS;
+			n_run = 1 + rte_rand() % 12;
+		}
+		n_run--;
+		flow[i] = f;
+		pkt_len[i] = 64 + rte_rand() % 512;
+		color[i] = (rte_rand() % 4 == 0) ?
+			(enum rte_color)(rte_rand() % RTE_COLORS) :
+			RTE_COLOR_GREEN;
+	}
+}
+
+/**
+ * functional test for the srTCM bulk check functions, checked against the
+ * single packet ones
+ */
+static inline int
+tm_test_srtcm_check_bulk(int aware)
+{
+#define SRTCM_CHECK_BULK_MSG "srtcm_check_bulk"
+	struct rte_meter_srtcm_profile sp;
+	struct rte_meter_srtcm sm[TM_TEST_BULK_FLOWS];
+	struct rte_meter_srtcm sm_bulk[TM_TEST_BULK_FLOWS];
+	struct rte_meter_srtcm *m[TM_TEST_BULK_PKTS];
+	struct rte_meter_srtcm_profile *p[TM_TEST_BULK_PKTS];
+	uint32_t flow[TM_TEST_BULK_PKTS], pkt_len[TM_TEST_BULK_PKTS];
+	enum rte_color in[TM_TEST_BULK_PKTS], out[TM_TEST_BULK_PKTS];
+	enum rte_color color;
+	uint64_t time = rte_get_tsc_cycles();
+	uint32_t i, r;
+
+	if (rte_meter_srtcm_profile_config(&sp, &sparams) != 0)
+		melog(SRTCM_CHECK_BULK_MSG);
+	for (i = 0; i < TM_TEST_BULK_FLOWS; i++)
+		if (rte_meter_srtcm_config(&sm[i], &sp) != 0)
+			melog(SRTCM_CHECK_BULK_MSG);
+	memcpy(sm_bulk, sm, sizeof(sm));
+
+	for (r = 0; r < TM_TEST_BULK_ROUNDS; r++) {
+		tm_test_bulk_burst(flow, pkt_len, in);
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			m[i] = &sm_bulk[flow[i]];
+			p[i] = &sp;
+		}
+		time += rte_rand() % 2000;
+
+		if (aware)
+			rte_meter_srtcm_color_aware_check_bulk(m, p, time,
+				pkt_len, in, out, TM_TEST_BULK_PKTS);
+		else
+			rte_meter_srtcm_color_blind_check_bulk(m, p, time,
+				pkt_len, out, TM_TEST_BULK_PKTS);
+
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			if (aware)
+				color = rte_meter_srtcm_color_aware_check(
+					&sm[flow[i]], &sp, time, pkt_len[i],
+					in[i]);
+			else
+				color = rte_meter_srtcm_color_blind_check(
+					&sm[flow[i]], &sp, time, pkt_len[i]);
+			if (color != out[i])
+				melog(SRTCM_CHECK_BULK_MSG" color");
+		}
+		if (memcmp(sm, sm_bulk, sizeof(sm)) != 0)
+			melog(SRTCM_CHECK_BULK_MSG" state");
+	}
+
+	return 0;
+}
+
+/**
+ * functional test for the trTCM bulk check functions, checked against the
+ * single packet ones
+ */
+static inline int
+tm_test_trtcm_check_bulk(int aware)
+{
+#define TRTCM_CHECK_BULK_MSG "trtcm_check_bulk"
+	struct rte_meter_trtcm_profile tp;
+	struct rte_meter_trtcm tm[TM_TEST_BULK_FLOWS];
+	struct rte_meter_trtcm tm_bulk[TM_TEST_BULK_FLOWS];
+	struct rte_meter_trtcm *m[TM_TEST_BULK_PKTS];
+	struct rte_meter_trtcm_profile *p[TM_TEST_BULK_PKTS];
+	uint32_t flow[TM_TEST_BULK_PKTS], pkt_len[TM_TEST_BULK_PKTS];
+	enum rte_color in[TM_TEST_BULK_PKTS], out[TM_TEST_BULK_PKTS];
+	enum rte_color color;
+	uint64_t time = rte_get_tsc_cycles();
+	uint32_t i, r;
+
+	if (rte_meter_trtcm_profile_config(&tp, &tparams) != 0)
+		melog(TRTCM_CHECK_BULK_MSG);
+	for (i = 0; i < TM_TEST_BULK_FLOWS; i++)
+		if (rte_meter_trtcm_config(&tm[i], &tp) != 0)
+			melog(TRTCM_CHECK_BULK_MSG);
+	memcpy(tm_bulk, tm, sizeof(tm));
+
+	for (r = 0; r < TM_TEST_BULK_ROUNDS; r++) {
+		tm_test_bulk_burst(flow, pkt_len, in);
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			m[i] = &tm_bulk[flow[i]];
+			p[i] = &tp;
+		}
+		time += rte_rand() % 2000;
+
+		if (aware)
+			rte_meter_trtcm_color_aware_check_bulk(m, p, time,
+				pkt_len, in, out, TM_TEST_BULK_PKTS);
+		else
+			rte_meter_trtcm_color_blind_check_bulk(m, p, time,
+				pkt_len, out, TM_TEST_BULK_PKTS);
+
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			if (aware)
+				color = rte_meter_trtcm_color_aware_check(
+					&tm[flow[i]], &tp, time, pkt_len[i],
+					in[i]);
+			else
+				color = rte_meter_trtcm_color_blind_check(
+					&tm[flow[i]], &tp, time, pkt_len[i]);
+			if (color != out[i])
+				melog(TRTCM_CHECK_BULK_MSG" color");
+		}
+		if (memcmp(tm, tm_bulk, sizeof(tm)) != 0)
+			melog(TRTCM_CHECK_BULK_MSG" state");
+	}
+
+	return 0;
+}
+
+/**
+ * functional test for the trTCM RFC4115 bulk check functions, checked
+ * against the single packet ones
+ */
+static inline int
+tm_test_trtcm_rfc4115_check_bulk(int aware)
+{
+#define TRTCM_RFC4115_CHECK_BULK_MSG "trtcm_rfc4115_check_bulk"
+	struct rte_meter_trtcm_rfc4115_profile tp;
+	struct rte_meter_trtcm_rfc4115 tm[TM_TEST_BULK_FLOWS];
+	struct rte_meter_trtcm_rfc4115 tm_bulk[TM_TEST_BULK_FLOWS];
+	struct rte_meter_trtcm_rfc4115 *m[TM_TEST_BULK_PKTS];
+	struct rte_meter_trtcm_rfc4115_profile *p[TM_TEST_BULK_PKTS];
+	uint32_t flow[TM_TEST_BULK_PKTS], pkt_len[TM_TEST_BULK_PKTS];
+	enum rte_color in[TM_TEST_BULK_PKTS], out[TM_TEST_BULK_PKTS];
+	enum rte_color color;
+	uint64_t time = rte_get_tsc_cycles();
+	uint32_t i, r;
+
+	if (rte_meter_trtcm_rfc4115_profile_config(&tp, &rfc4115params) != 0)
+		melog(TRTCM_RFC4115_CHECK_BULK_MSG);
+	for (i = 0; i < TM_TEST_BULK_FLOWS; i++)
+		if (rte_meter_trtcm_rfc4115_config(&tm[i], &tp) != 0)
+			melog(TRTCM_RFC4115_CHECK_BULK_MSG);
+	memcpy(tm_bulk, tm, sizeof(tm));
+
+	for (r = 0; r < TM_TEST_BULK_ROUNDS; r++) {
+		tm_test_bulk_burst(flow, pkt_len, in);
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			m[i] = &tm_bulk[flow[i]];
+			p[i] = &tp;
+		}
+		time += rte_rand() % 2000;
+
+		if (aware)
+			rte_meter_trtcm_rfc4115_color_aware_check_bulk(m, p,
+				time, pkt_len, in, out, TM_TEST_BULK_PKTS);
+		else
+			rte_meter_trtcm_rfc4115_color_blind_check_bulk(m, p,
+				time, pkt_len, out, TM_TEST_BULK_PKTS);
+
+		for (i = 0; i < TM_TEST_BULK_PKTS; i++) {
+			if (aware)
+				color = rte_meter_trtcm_rfc4115_color_aware_check(
+					&tm[flow[i]], &tp, time, pkt_len[i],
+					in[i]);
+			else
+				color = rte_meter_trtcm_rfc4115_color_blind_check(
+					&tm[flow[i]], &tp, time, pkt_len[i]);
+			if (color != out[i])
+				melog(TRTCM_RFC4115_CHECK_BULK_MSG" color");
+		}
+		if (memcmp(tm, tm_bulk, sizeof(tm)) != 0)
+			melog(TRTCM_RFC4115_CHECK_BULK_MSG" state");
+	}
+
+	return 0;
+}
+
 /**
  * test main entrance for library meter
  */
@@ -709,6 +912,18 @@ test_meter(void)
 	if (tm_test_trtcm_rfc4115_color_aware_check() != 0)
 		return -1;
 
+	if (tm_test_srtcm_check_bulk(0) != 0 ||
+			tm_test_srtcm_check_bulk(1) != 0)
+		return -1;
+
+	if (tm_test_trtcm_check_bulk(0) != 0 ||
+			tm_test_trtcm_check_bulk(1) != 0)
+		return -1;
+
+	if (tm_test_trtcm_rfc4115_check_bulk(0) != 0 ||
+			tm_test_trtcm_rfc4115_check_bulk(1) != 0)
+		return -1;
+
 	return 0;
 
 }
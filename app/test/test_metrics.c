@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <rte_lcore.h>
 #include <rte_metrics.h>
@@ -17,6 +18,8 @@
 #define	METRIC_LESSER_COUNT	3
 #define	KEY	1
 #define	VALUE	1
+#define	MERGE_PORT	5
+#define	MAX_VALUES	64
 
 /* Initializes metric module. This function must be called
  * from a primary process before metrics are used
@@ -259,6 +262,62 @@ test_metrics_get_values(void)
 	return TEST_SUCCESS;
 }
 
+static uint64_t thread_value;
+
+/* Runs outside of EAL, so updates go through the locked path */
+static void *
+update_from_thread(void *arg __rte_unused)
+{
+	return (void *)(intptr_t)rte_metrics_update_value(MERGE_PORT, KEY,
+			thread_value);
+}
+
+static uint64_t
+get_value(int port_id, uint16_t key)
+{
+	struct rte_metric_value values[MAX_VALUES];
+	int cnt;
+
+	cnt = rte_metrics_get_values(port_id, values, RTE_DIM(values));
+	if (cnt <= key || cnt > (int)RTE_DIM(values))
+		return UINT64_MAX;
+	return values[key].value;
+}
+
+/* Test that values from lcore shards and the locked path are merged */
+static int
+test_metrics_update_merge(void)
+{
+	pthread_t thread;
+	void *ret;
+	int err;
+
+	/* Update from this lcore's shard */
+	err = rte_metrics_update_value(MERGE_PORT, KEY, 10);
+	TEST_ASSERT(err == 0, "%s, %d", __func__, __LINE__);
+	TEST_ASSERT(get_value(MERGE_PORT, KEY) == 10, "%s, %d",
+			__func__, __LINE__);
+
+	/* A later update from a non-EAL thread takes over */
+	thread_value = 20;
+	TEST_ASSERT(pthread_create(&thread, NULL, update_from_thread,
+			NULL) == 0, "%s, %d", __func__, __LINE__);
+	pthread_join(thread, &ret);
+	TEST_ASSERT((intptr_t)ret == 0, "%s, %d", __func__, __LINE__);
+	TEST_ASSERT(get_value(MERGE_PORT, KEY) == 20, "%s, %d",
+			__func__, __LINE__);
+
+	/* And back to the shard, other ports being untouched */
+	err = rte_metrics_update_value(MERGE_PORT, KEY, 30);
+	TEST_ASSERT(err == 0, "%s, %d", __func__, __LINE__);
+	TEST_ASSERT(get_value(MERGE_PORT, KEY) == 30, "%s, %d",
+			__func__, __LINE__);
+	TEST_ASSERT(get_value(MERGE_PORT + 1, KEY) == 0, "%s, %d",
+			__func__, __LINE__);
+
+	return TEST_SUCCESS;
+}
+
 static struct unit_test_suite metrics_testsuite  = {
 	.suite_name = "Metrics Unit Test Suite",
 	.setup = NULL,
@@ -300,6 +359,11 @@ static struct unit_test_suite metrics_testsuite  = {
 		 * arraylist, count size
 		 */
 		TEST_CASE(test_metrics_get_values),
+
+		/* TEST CASE 8: Test merging of values updated from EAL
+		 * lcores and from non-EAL threads
+		 */
+		TEST_CASE(test_metrics_update_merge),
 		TEST_CASES_END()
 	}
 };
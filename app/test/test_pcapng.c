@@ -0,0 +1,383 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_pcapng.h>
+#include <rte_ring.h>
+
+#include "test.h"
+
+#define NUM_MBUFS 1024
+#define MBUF_SIZE (RTE_MBUF_DEFAULT_DATAROOM + RTE_PKTMBUF_HEADROOM)
+#define BURST 32
+#define PKT_LEN 128
+#define SNAPLEN 100
+
+#define SHB_TYPE 0x0A0D0D0A
+#define IDB_TYPE 1
+#define EPB_TYPE 6
+
+struct pcapng_unittest_params {
+	struct rte_mempool *p;
+	struct rte_ring *r;
+	char path[64];
+};
+
+static struct pcapng_unittest_params default_params;
+static struct pcapng_unittest_params *test_params = &default_params;
+
+/* Block counters and checks from a parsed file */
+struct pcapng_file_info {
+	unsigned int shb;
+	unsigned int idb;
+	unsigned int epb;
+	unsigned int epb_per_if[4];
+	unsigned int bad_data;
+	unsigned int truncated;
+	uint64_t last_ts;
+	unsigned int ts_backwards;
+};
+
+static int
+fill_burst(struct rte_mbuf **pkts, unsigned int n, uint16_t len)
+{
+	unsigned int i, j;
+	uint8_t *data;
+
+	if (rte_pktmbuf_alloc_bulk(test_params->p, pkts, n) != 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		data = (uint8_t *)rte_pktmbuf_append(pkts[i], len);
+		if (data == NULL)
+			return -1;
+		for (j = 0; j < len; j++)
+			data[j] = (uint8_t)(i + j);
+		pkts[i]->timestamp = 0;
+	}
+
+	return 0;
+}
+
+static void
+free_burst(struct rte_mbuf **pkts, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		rte_pktmbuf_free(pkts[i]);
+}
+
+static int
+parse_file(const char *path, struct pcapng_file_info *info)
+{
+	uint32_t type, len, ifid, caplen, origlen, i;
+	uint64_t ts;
+	uint8_t *buf, *p, *end, *data;
+	struct stat st;
+	FILE *f;
+
+	memset(info, 0, sizeof(*info));
+
+	if (stat(path, &st) < 0 || st.st_size == 0)
+		return -1;
+
+	buf = malloc(st.st_size);
+	if (buf == NULL)
+		return -1;
+
+	f = fopen(path, "r");
+	if (f == NULL || fread(buf, st.st_size, 1, f) != 1) {
+		if (f != NULL)
+			fclose(f);
+		free(buf);
+		return -1;
+	}
+	fclose(f);
+
+	end = buf + st.st_size;
+	for (p = buf; p + 12 <= end; p += len) {
+		memcpy(&type, p, sizeof(type));
+		memcpy(&len, p + 4, sizeof(len));
+		if (len < 12 || (len & 3) || p + len > end ||
+				memcmp(p + 4, p + len - 4, 4) != 0) {
+			free(buf);
+			return -1;
+		}
+
+		switch (type) {
+		case SHB_TYPE:
+			info->shb++;
+			break;
+		case IDB_TYPE:
+			info->idb++;
+			break;
+		case EPB_TYPE:
+			memcpy(&ifid, p + 8, 4);
+			memcpy(&ts, p + 12, 8);
+			ts = (ts << 32) | (ts >> 32);
+			memcpy(&caplen, p + 20, 4);
+			memcpy(&origlen, p + 24, 4);
+			info->epb++;
+			if (ifid < RTE_DIM(info->epb_per_if))
+				info->epb_per_if[ifid]++;
+			if (caplen < origlen)
+				info->truncated++;
+			if (ts < info->last_ts)
+				info->ts_backwards++;
+			info->last_ts = ts;
+			/* packets are filled with (index + offset) pattern */
+			data = p + 28;
+			for (i = 1; i < caplen; i++)
+				if ((uint8_t)(data[i] - data[i - 1]) != 1)
+					info->bad_data++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	free(buf);
+	return p == end ? 0 : -1;
+}
+
+static int
+test_pcapng_open_invalid(void)
+{
+	struct rte_pcapng_params params = {
+		.bufsize = RTE_PCAPNG_BUFSIZE_MIN - 1,
+		.socket_id = SOCKET_ID_ANY,
+	};
+	struct rte_pcapng *pcapng;
+
+	pcapng = rte_pcapng_open("/nonexistent/dir/test.pcapng", NULL);
+	TEST_ASSERT_NULL(pcapng, "Open succeeded on invalid path");
+
+	pcapng = rte_pcapng_open(test_params->path, &params);
+	TEST_ASSERT(pcapng == NULL && rte_errno == EINVAL,
+			"Open succeeded with too small buffer");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_pcapng_write(void)
+{
+	struct rte_mbuf *pkts[BURST];
+	struct pcapng_file_info info;
+	struct rte_pcapng_stats stats;
+	struct rte_pcapng *pcapng;
+	struct stat st;
+	int if0, if1;
+	uint16_t n;
+
+	pcapng = rte_pcapng_open(test_params->path, NULL);
+	TEST_ASSERT_NOT_NULL(pcapng, "Cannot open %s", test_params->path);
+
+	if0 = rte_pcapng_add_interface(pcapng, 0, 0, 0);
+	if1 = rte_pcapng_add_interface(pcapng, 0, 1, SNAPLEN);
+	TEST_ASSERT(if0 == 0 && if1 == 1, "Unexpected interface ids %d %d",
+			if0, if1);
+
+	TEST_ASSERT_SUCCESS(fill_burst(pkts, BURST, PKT_LEN),
+			"Cannot allocate mbufs");
+	rte_pcapng_stamp(pkts, BURST);
+
+	n = rte_pcapng_write_packets(pcapng, if0, pkts, BURST,
+			RTE_PCAPNG_DIRECTION_IN);
+	TEST_ASSERT_EQUAL(n, BURST, "Wrote %u of %u packets", n, BURST);
+	n = rte_pcapng_write_packets(pcapng, if1, pkts, BURST,
+			RTE_PCAPNG_DIRECTION_OUT);
+	TEST_ASSERT_EQUAL(n, BURST, "Wrote %u of %u packets", n, BURST);
+
+	n = rte_pcapng_write_packets(pcapng, 2, pkts, BURST,
+			RTE_PCAPNG_DIRECTION_IN);
+	TEST_ASSERT_EQUAL(n, 0, "Wrote packets to unknown interface");
+	free_burst(pkts, BURST);
+
+	TEST_ASSERT_SUCCESS(rte_pcapng_flush(pcapng), "Flush failed");
+	TEST_ASSERT_SUCCESS(stat(test_params->path, &st), "Cannot stat %s",
+			test_params->path);
+
+	rte_pcapng_stats_get(pcapng, &stats);
+	TEST_ASSERT_EQUAL(stats.pkts, 2 * BURST, "Bad packet count");
+	TEST_ASSERT_EQUAL(stats.truncated, BURST, "Bad truncated count");
+	TEST_ASSERT_EQUAL(stats.file_bytes, (uint64_t)st.st_size,
+			"Bad file byte count");
+
+	TEST_ASSERT_SUCCESS(rte_pcapng_close(pcapng), "Close failed");
+
+	TEST_ASSERT_SUCCESS(parse_file(test_params->path, &info),
+			"Malformed pcapng file");
+	TEST_ASSERT(info.shb == 1 && info.idb == 2 && info.epb == 2 * BURST,
+			"Unexpected blocks: %u SHB, %u IDB, %u EPB",
+			info.shb, info.idb, info.epb);
+	TEST_ASSERT(info.epb_per_if[0] == BURST && info.epb_per_if[1] == BURST,
+			"Packets written to the wrong interface");
+	TEST_ASSERT_EQUAL(info.truncated, BURST, "Snap length not applied");
+	TEST_ASSERT_EQUAL(info.bad_data, 0, "Packet data corrupted");
+
+	return TEST_SUCCESS;
+}
+
+/* Device timestamps must be written unchanged, not converted from TSC */
+static int
+test_pcapng_hw_timestamp(void)
+{
+	const uint64_t base = 1500000000ULL * 1000000000ULL;
+	struct rte_mbuf *pkts[BURST];
+	struct pcapng_file_info info;
+	struct rte_pcapng *pcapng;
+	unsigned int i;
+	uint16_t n;
+
+	pcapng = rte_pcapng_open(test_params->path, NULL);
+	TEST_ASSERT_NOT_NULL(pcapng, "Cannot open %s", test_params->path);
+	TEST_ASSERT_EQUAL(rte_pcapng_add_interface(pcapng, 0, 0, 0), 0,
+			"Cannot add interface");
+
+	TEST_ASSERT_SUCCESS(fill_burst(pkts, BURST, PKT_LEN),
+			"Cannot allocate mbufs");
+	for (i = 0; i < BURST; i++) {
+		pkts[i]->ol_flags |= PKT_RX_TIMESTAMP;
+		pkts[i]->timestamp = base + i;
+	}
+	rte_pcapng_stamp(pkts, BURST);
+	TEST_ASSERT_EQUAL(pkts[BURST - 1]->timestamp, base + BURST - 1,
+			"Device timestamp overwritten");
+
+	n = rte_pcapng_write_packets(pcapng, 0, pkts, BURST,
+			RTE_PCAPNG_DIRECTION_IN);
+	TEST_ASSERT_EQUAL(n, BURST, "Wrote %u of %u packets", n, BURST);
+	free_burst(pkts, BURST);
+	TEST_ASSERT_SUCCESS(rte_pcapng_close(pcapng), "Close failed");
+
+	TEST_ASSERT_SUCCESS(parse_file(test_params->path, &info),
+			"Malformed pcapng file");
+	TEST_ASSERT_EQUAL(info.epb, BURST, "Unexpected EPB count");
+	TEST_ASSERT_EQUAL(info.last_ts, base + BURST - 1,
+			"Device timestamp not written as is");
+	TEST_ASSERT_EQUAL(info.ts_backwards, 0, "Timestamps out of order");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_pcapng_drain(void)
+{
+	struct rte_pcapng_params params = {
+		.bufsize = RTE_PCAPNG_BUFSIZE_MIN,
+		.socket_id = SOCKET_ID_ANY,
+	};
+	struct rte_mbuf *pkts[BURST];
+	struct pcapng_file_info info;
+	struct rte_pcapng *pcapng;
+	unsigned int i, total = 0;
+	int ifid, ret;
+
+	pcapng = rte_pcapng_open(test_params->path, &params);
+	TEST_ASSERT_NOT_NULL(pcapng, "Cannot open %s", test_params->path);
+
+	ifid = rte_pcapng_add_interface(pcapng, 1, RTE_PCAPNG_ALL_QUEUES, 0);
+	TEST_ASSERT(ifid >= 0, "Cannot add interface");
+	TEST_ASSERT_SUCCESS(rte_pcapng_add_ring(pcapng, test_params->r, ifid,
+			RTE_PCAPNG_DIRECTION_IN), "Cannot attach ring");
+	TEST_ASSERT_FAIL(rte_pcapng_add_ring(pcapng, test_params->r, ifid + 1,
+			RTE_PCAPNG_DIRECTION_IN), "Attached ring to bad interface");
+
+	/* enough packets to go through several buffer flushes */
+	for (i = 0; i < 100; i++) {
+		TEST_ASSERT_SUCCESS(fill_burst(pkts, BURST, 1500),
+				"Cannot allocate mbufs");
+		rte_pcapng_stamp(pkts, BURST);
+		TEST_ASSERT_EQUAL(rte_ring_enqueue_burst(test_params->r,
+				(void **)pkts, BURST, NULL), BURST,
+				"Cannot enqueue");
+		ret = rte_pcapng_drain(pcapng, 0);
+		TEST_ASSERT(ret == BURST, "Drained %d packets", ret);
+		total += ret;
+	}
+	TEST_ASSERT_EQUAL(rte_pcapng_drain(pcapng, 0), 0,
+			"Drained packets from empty ring");
+
+	TEST_ASSERT_SUCCESS(rte_pcapng_close(pcapng), "Close failed");
+
+	TEST_ASSERT_SUCCESS(parse_file(test_params->path, &info),
+			"Malformed pcapng file");
+	TEST_ASSERT_EQUAL(info.epb, total, "Found %u packets, expected %u",
+			info.epb, total);
+	TEST_ASSERT_EQUAL(info.ts_backwards, 0, "Timestamps not monotonic");
+	TEST_ASSERT_EQUAL(info.bad_data, 0, "Packet data corrupted");
+	TEST_ASSERT_EQUAL(rte_mempool_in_use_count(test_params->p), 0,
+			"Drained mbufs were not freed");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_setup(void)
+{
+	snprintf(test_params->path, sizeof(test_params->path),
+		 "/tmp/dpdk_test_pcapng_%d.pcapng", getpid());
+
+	if (test_params->p == NULL) {
+		test_params->p = rte_pktmbuf_pool_create("PCAPNG_MBUF_POOL",
+				NUM_MBUFS, 0, 0, MBUF_SIZE, rte_socket_id());
+		if (test_params->p == NULL) {
+			printf("%s: Error creating mempool\n", __func__);
+			return -1;
+		}
+	}
+
+	if (test_params->r == NULL) {
+		test_params->r = rte_ring_create("PCAPNG_RING", 256,
+				rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+		if (test_params->r == NULL) {
+			printf("%s: Error creating ring\n", __func__);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+test_teardown(void)
+{
+	unlink(test_params->path);
+	rte_ring_free(test_params->r);
+	test_params->r = NULL;
+	rte_mempool_free(test_params->p);
+	test_params->p = NULL;
+}
+
+static struct unit_test_suite pcapng_test_suite  = {
+	.setup = test_setup,
+	.teardown = test_teardown,
+	.suite_name = "pcapng Unit Test Suite",
+	.unit_test_cases = {
+		TEST_CASE(test_pcapng_open_invalid),
+		TEST_CASE(test_pcapng_write),
+		TEST_CASE(test_pcapng_hw_timestamp),
+		TEST_CASE(test_pcapng_drain),
+		TEST_CASES_END()
+	}
+};
+
+static int
+test_pcapng(void)
+{
+	return unit_test_suite_runner(&pcapng_test_suite);
+}
+
+REGISTER_TEST_COMMAND(pcapng_autotest, test_pcapng);
@@ -9,6 +9,8 @@
 #include <rte_eth_ring.h>
 #include <rte_ethdev.h>
 #include <rte_bus_vdev.h>
+#include <rte_malloc.h>
+#include <rte_rcu_qsbr.h>
 
 #define SOCKET0 0
 #define RING_SIZE 256
@@ -213,6 +215,152 @@ test_stats_reset(int port)
 	return 0;
 }
 
+static int
+get_xstat(int port, const char *name, uint64_t *value)
+{
+	uint64_t id;
+
+	if (rte_eth_xstats_get_id_by_name(port, name, &id) != 0)
+		return -1;
+	return rte_eth_xstats_get_by_id(port, &id, value, 1) == 1 ? 0 : -1;
+}
+
+static int
+test_burst_profile(int port)
+{
+	struct rte_mbuf bufs[5], *pbufs[32];
+	uint64_t value;
+	int i;
+
+	printf("Testing ring PMD burst profiling port %d\n", port);
+
+	if (rte_eth_dev_profile_enable(port) != 0) {
+		printf("Error enabling profiling on port %d\n", port);
+		return -1;
+	}
+	if (rte_eth_dev_profile_enable(port) != -EBUSY) {
+		printf("Error: profiling enabled twice on port %d\n", port);
+		return -1;
+	}
+
+	for (i = 0; i < 5; i++)
+		pbufs[i] = &bufs[i];
+
+	/* one burst of 5 packets, then an empty poll */
+	if (rte_eth_tx_burst(port, 0, pbufs, 5) != 5 ||
+			rte_eth_rx_burst(port, 0, pbufs, 32) != 5 ||
+			rte_eth_rx_burst(port, 0, pbufs, 32) != 0) {
+		printf("Error sending and receiving on port %d\n", port);
+		return -1;
+	}
+
+	if (get_xstat(port, "rx_q0_profile_polls", &value) != 0 ||
+			value != 2 ||
+			get_xstat(port, "rx_q0_profile_empty_poll_pct",
+				&value) != 0 || value != 50 ||
+			get_xstat(port, "rx_q0_profile_burst_4_7",
+				&value) != 0 || value != 1 ||
+			get_xstat(port, "rx_q0_profile_burst_0",
+				&value) != 0 || value != 1 ||
+			get_xstat(port, "tx_q0_profile_pkts", &value) != 0 ||
+			value != 5) {
+		printf("Error: port %d profile xstats not as expected\n",
+			port);
+		return -1;
+	}
+
+	rte_eth_xstats_reset(port);
+	if (get_xstat(port, "rx_q0_profile_polls", &value) != 0 ||
+			value != 0) {
+		printf("Error: port %d profile xstats not reset\n", port);
+		return -1;
+	}
+
+	if (rte_eth_dev_profile_disable(port) != 0 ||
+			get_xstat(port, "rx_q0_profile_polls", &value) == 0) {
+		printf("Error disabling profiling on port %d\n", port);
+		return -1;
+	}
+
+	return 0;
+}
+
+static uint16_t
+count_rx_cb(uint16_t port __rte_unused, uint16_t queue __rte_unused,
+	struct rte_mbuf *pkts[] __rte_unused, uint16_t nb_pkts,
+	uint16_t max_pkts __rte_unused, void *user_param)
+{
+	(*(unsigned int *)user_param)++;
+	return nb_pkts;
+}
+
+static int
+test_callback_rcu(int port)
+{
+	const struct rte_eth_rxtx_callback *cb;
+	struct rte_mbuf buf, *pbuf = &buf;
+	struct rte_rcu_qsbr *v;
+	unsigned int calls = 0;
+	unsigned int lcore_id = rte_lcore_id();
+	int ret = -1;
+
+	printf("Testing RCU freeing of rx callbacks port %d\n", port);
+
+	v = rte_zmalloc(NULL, rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE),
+			RTE_CACHE_LINE_SIZE);
+	if (v == NULL || rte_rcu_qsbr_init(v, RTE_MAX_LCORE) != 0 ||
+			rte_rcu_qsbr_thread_register(v, lcore_id) != 0) {
+		printf("Error creating QSBR variable\n");
+		goto out;
+	}
+	rte_rcu_qsbr_thread_online(v, lcore_id);
+
+	if (rte_eth_callback_rcu_qsbr_set(v) != 0) {
+		printf("Error setting QSBR variable\n");
+		goto out;
+	}
+
+	cb = rte_eth_add_rx_callback(port, 0, count_rx_cb, &calls);
+	if (cb == NULL ||
+			rte_eth_tx_burst(port, 0, &pbuf, 1) != 1 ||
+			rte_eth_rx_burst(port, 0, &pbuf, 1) != 1 ||
+			calls != 1) {
+		printf("Error running rx callback on port %d\n", port);
+		goto out;
+	}
+
+	/* this thread may still be running the callback until quiescent */
+	if (rte_eth_remove_rx_callback(port, 0, cb) != 0 ||
+			rte_eth_callback_reclaim(0) != 1 ||
+			rte_eth_callback_rcu_qsbr_set(NULL) != -EBUSY) {
+		printf("Error: removed callback freed too early\n");
+		goto out;
+	}
+	rte_eth_rx_burst(port, 0, &pbuf, 1);
+	if (calls != 1) {
+		printf("Error: removed callback still called\n");
+		goto out;
+	}
+
+	rte_rcu_qsbr_quiescent(v, lcore_id);
+	if (rte_eth_callback_reclaim(0) != 0) {
+		printf("Error: removed callback not freed\n");
+		goto out;
+	}
+	ret = 0;
+
+out:
+	/* waiting while online would wait for this thread itself */
+	if (v != NULL)
+		rte_rcu_qsbr_thread_offline(v, lcore_id);
+	rte_eth_callback_reclaim(1);
+	rte_eth_callback_rcu_qsbr_set(NULL);
+	if (v != NULL)
+		rte_rcu_qsbr_thread_unregister(v, lcore_id);
+	rte_free(v);
+	return ret;
+}
+
 static int
 test_pmd_ring_pair_create_attach(void)
 {
@@ -541,6 +689,22 @@ test_stats_reset_for_port(void)
 	return TEST_SUCCESS;
 }
 
+static int
+test_burst_profile_for_port(void)
+{
+	TEST_ASSERT(test_burst_profile(rxtx_portc) == 0,
+			"test burst profile failed");
+	return TEST_SUCCESS;
+}
+
+static int
+test_callback_rcu_for_port(void)
+{
+	TEST_ASSERT(test_callback_rcu(rxtx_portc) == 0,
+			"test callback rcu failed");
+	return TEST_SUCCESS;
+}
+
 static struct
 unit_test_suite test_pmd_ring_suite  = {
 	.setup = test_pmd_ringcreate_setup,
@@ -551,6 +715,8 @@ unit_test_suite test_pmd_ring_suite  = {
 		TEST_CASE(test_send_basic_packets),
 		TEST_CASE(test_get_stats_for_port),
 		TEST_CASE(test_stats_reset_for_port),
+		TEST_CASE(test_burst_profile_for_port),
+		TEST_CASE(test_callback_rcu_for_port),
 		TEST_CASE(test_pmd_ring_pair_create_attach),
 		TEST_CASE(test_command_line_ring_port),
 		TEST_CASES_END()
@@ -330,6 +330,111 @@ test_reorder_drain(void)
 	return ret;
 }
 
+static int
+test_reorder_ms(void)
+{
+	struct rte_reorder_ms_buffer *b = NULL;
+	struct rte_mempool *p = test_params->p;
+	const unsigned int size = 4;
+	const unsigned int num_bufs = 6;
+	/* stream 0 misses its second packet, stream 1 is complete */
+	const uint32_t streams[] = {0, 1, 0, 1, 1, 5};
+	const uint32_t seqns[] = {0, 0, 2, 1, 2, 0};
+	const uint32_t drained_seqns[] = {0, 0, 1, 2};
+	struct rte_mbuf *bufs[num_bufs];
+	struct rte_mbuf *robufs[num_bufs];
+	unsigned int i, cnt;
+	int ret = 0;
+
+	for (i = 0; i < num_bufs; i++)
+		bufs[i] = robufs[i] = NULL;
+
+	b = rte_reorder_ms_create(NULL, rte_socket_id(), 2, size);
+	TEST_ASSERT((b == NULL) && (rte_errno == EINVAL),
+			"No error on create() with NULL name");
+	b = rte_reorder_ms_create("test_ms", rte_socket_id(), 0, size);
+	TEST_ASSERT((b == NULL) && (rte_errno == EINVAL),
+			"No error on create() with no stream");
+
+	b = rte_reorder_ms_create("test_ms", rte_socket_id(), 2, size);
+	TEST_ASSERT_NOT_NULL(b, "Failed to create reorder buffer");
+
+	for (i = 0; i < num_bufs; i++) {
+		bufs[i] = rte_pktmbuf_alloc(p);
+		TEST_ASSERT_NOT_NULL(bufs[i], "Packet allocation failed\n");
+		bufs[i]->seqn = seqns[i];
+	}
+
+	/* the burst is inserted up to the packet of the invalid stream */
+	cnt = rte_reorder_ms_insert_burst(b, bufs, streams, num_bufs);
+	if (cnt != num_bufs - 1 || rte_errno != EINVAL) {
+		printf("%s:%d: %u packets inserted\n", __func__, __LINE__, cnt);
+		ret = -1;
+		goto exit;
+	}
+	for (i = 0; i < cnt; i++)
+		bufs[i] = NULL;
+
+	/* stream 1 is not blocked by the missing packet of stream 0 */
+	cnt = rte_reorder_ms_drain(b, robufs, num_bufs);
+	if (cnt != RTE_DIM(drained_seqns)) {
+		printf("%s:%d:%u: number of expected packets not drained\n",
+				__func__, __LINE__, cnt);
+		ret = -1;
+		goto exit;
+	}
+	for (i = 0; i < cnt; i++) {
+		if (robufs[i]->seqn != drained_seqns[i]) {
+			printf("%s:%d: packet %u drained out of order\n",
+					__func__, __LINE__, i);
+			ret = -1;
+			goto exit;
+		}
+		rte_pktmbuf_free(robufs[i]);
+		robufs[i] = NULL;
+	}
+
+	/* the missing packet releases the packets of stream 0 */
+	bufs[num_bufs - 1]->seqn = 1;
+	cnt = rte_reorder_ms_insert_burst(b, &bufs[num_bufs - 1], streams, 1);
+	if (cnt != 1) {
+		printf("%s:%d: missing packet not inserted\n",
+				__func__, __LINE__);
+		ret = -1;
+		goto exit;
+	}
+	bufs[num_bufs - 1] = NULL;
+
+	cnt = rte_reorder_ms_drain_stream(b, 0, robufs, num_bufs);
+	if (cnt != 2) {
+		printf("%s:%d:%u: number of expected packets not drained\n",
+				__func__, __LINE__, cnt);
+		ret = -1;
+		goto exit;
+	}
+	for (i = 0; i < cnt; i++) {
+		if (robufs[i]->seqn != i + 1) {
+			printf("%s:%d: packet %u drained out of order\n",
+					__func__, __LINE__, i);
+			ret = -1;
+			goto exit;
+		}
+		rte_pktmbuf_free(robufs[i]);
+		robufs[i] = NULL;
+	}
+
+	ret = 0;
+exit:
+	rte_reorder_ms_free(b);
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i] != NULL)
+			rte_pktmbuf_free(bufs[i]);
+		if (robufs[i] != NULL)
+			rte_pktmbuf_free(robufs[i]);
+	}
+	return ret;
+}
+
 static int
 test_setup(void)
 {
@@ -380,6 +485,7 @@ static struct unit_test_suite reorder_test_suite  = {
 		TEST_CASE(test_reorder_free),
 		TEST_CASE(test_reorder_insert),
 		TEST_CASE(test_reorder_drain),
+		TEST_CASE(test_reorder_ms),
 		TEST_CASES_END()
 	}
 };
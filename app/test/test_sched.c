@@ -104,6 +104,280 @@ prepare_pkt(struct rte_sched_port *port, struct rte_mbuf *mbuf)
 }
 
 
+static struct rte_mbuf *
+layout_pkt(struct rte_mempool *mp, struct rte_sched_port *port,
+	   uint32_t subport, uint32_t tc, uint32_t queue)
+{
+	struct rte_mbuf *mbuf = rte_pktmbuf_alloc(mp);
+
+	if (mbuf == NULL)
+		return NULL;
+
+	rte_sched_port_pkt_write(port, mbuf, subport, PIPE, tc, queue,
+				 RTE_COLOR_GREEN);
+	mbuf->pkt_len = 60;
+	mbuf->data_len = 60;
+
+	return mbuf;
+}
+
+static int
+test_sched_queue_layout(struct rte_mempool *mp)
+{
+	struct rte_sched_subport_queue_params subport_queues[] = {
+		{ .n_tcs = 1, .n_queues_per_tc = 1, },
+		{ .queue_sp = 1, },
+	};
+	struct rte_sched_port_params params = port_param;
+	struct rte_sched_port *port;
+	struct rte_mbuf *in_mbufs[6];
+	struct rte_mbuf *out_mbufs[6];
+	uint32_t subport, pipe, tc, queue, size_full, n_queue3;
+	int i, err;
+
+	params.n_subports_per_port = RTE_DIM(subport_queues);
+	size_full = rte_sched_port_get_memory_footprint(&params);
+	params.subport_queues = subport_queues;
+	TEST_ASSERT(rte_sched_port_get_memory_footprint(&params) < size_full,
+		    "Unused queues got some memory\n");
+
+	port = rte_sched_port_config(&params);
+	TEST_ASSERT_NOT_NULL(port, "Error config sched port\n");
+
+	for (subport = 0; subport < params.n_subports_per_port; subport++) {
+		err = rte_sched_subport_config(port, subport, subport_param);
+		TEST_ASSERT_SUCCESS(err, "Error config subport, err=%d\n",
+				    err);
+
+		for (pipe = 0; pipe < params.n_pipes_per_subport; pipe++) {
+			err = rte_sched_pipe_config(port, subport, pipe, 0);
+			TEST_ASSERT_SUCCESS(err,
+				"Error config sched pipe %u, err=%d\n",
+				pipe, err);
+		}
+	}
+
+	/* Subport 0 only has TC 0 queue 0, subport 1 has strict priority
+	 * between the queues of a TC
+	 */
+	in_mbufs[0] = layout_pkt(mp, port, 0, 0, 0);
+	in_mbufs[1] = layout_pkt(mp, port, 0, 2, 0);
+	in_mbufs[2] = layout_pkt(mp, port, 1, TC, 3);
+	in_mbufs[3] = layout_pkt(mp, port, 1, TC, 3);
+	in_mbufs[4] = layout_pkt(mp, port, 1, TC, 0);
+	in_mbufs[5] = layout_pkt(mp, port, 1, TC, 0);
+	for (i = 0; i < 6; i++)
+		TEST_ASSERT_NOT_NULL(in_mbufs[i], "Packet allocation failed\n");
+
+	err = rte_sched_port_enqueue(port, in_mbufs, 6);
+	TEST_ASSERT_EQUAL(err, 5, "Wrong enqueue, err=%d\n", err);
+
+	err = rte_sched_port_dequeue(port, out_mbufs, 6);
+	TEST_ASSERT_EQUAL(err, 5, "Wrong dequeue, err=%d\n", err);
+
+	for (i = 0, n_queue3 = 0; i < err; i++) {
+		rte_sched_port_pkt_read_tree_path(port, out_mbufs[i],
+				&subport, &pipe, &tc, &queue);
+		if (subport == 0) {
+			TEST_ASSERT(tc == 0 && queue == 0,
+				    "Packet from unused queue\n");
+		} else {
+			TEST_ASSERT(queue == 0 || queue == 3,
+				    "Wrong queue\n");
+			if (queue == 3)
+				n_queue3++;
+			else
+				TEST_ASSERT_EQUAL(n_queue3, 0,
+						  "Queue 0 not served first\n");
+		}
+		rte_pktmbuf_free(out_mbufs[i]);
+	}
+
+	rte_sched_port_free(port);
+
+	return 0;
+}
+
+#ifdef RTE_SCHED_CODEL
+
+#define CODEL_TARGET_US   1000
+#define CODEL_INTERVAL_US 10000
+#define CODEL_N_PKTS      10
+
+static int
+test_sched_codel(struct rte_mempool *mp)
+{
+	struct rte_sched_port_params params = port_param;
+	struct rte_mbuf *mbufs[CODEL_N_PKTS];
+	struct rte_sched_port *port;
+	uint32_t pipe;
+	int i, err, n_out;
+
+	params.codel_params[TC].target = CODEL_TARGET_US;
+	params.codel_params[TC].interval = CODEL_INTERVAL_US;
+
+	port = rte_sched_port_config(&params);
+	TEST_ASSERT_NOT_NULL(port, "Error config sched port\n");
+
+	err = rte_sched_subport_config(port, SUBPORT, subport_param);
+	TEST_ASSERT_SUCCESS(err, "Error config subport, err=%d\n", err);
+	for (pipe = 0; pipe < params.n_pipes_per_subport; pipe++) {
+		err = rte_sched_pipe_config(port, SUBPORT, pipe, 0);
+		TEST_ASSERT_SUCCESS(err, "Error config pipe, err=%d\n", err);
+	}
+
+	for (i = 0; i < CODEL_N_PKTS; i++) {
+		mbufs[i] = layout_pkt(mp, port, SUBPORT, TC, QUEUE);
+		TEST_ASSERT_NOT_NULL(mbufs[i], "Packet allocation failed\n");
+	}
+	err = rte_sched_port_enqueue(port, mbufs, CODEL_N_PKTS);
+	TEST_ASSERT_EQUAL(err, CODEL_N_PKTS, "Wrong enqueue, err=%d\n", err);
+
+	/* Above target, but not yet for a full interval */
+	rte_delay_us(2 * CODEL_TARGET_US);
+	n_out = rte_sched_port_dequeue(port, mbufs, 1);
+	TEST_ASSERT_EQUAL(n_out, 1, "Wrong dequeue, n_out=%d\n", n_out);
+	rte_pktmbuf_free(mbufs[0]);
+
+	/* A full interval above target: one packet dropped */
+	rte_delay_us(CODEL_INTERVAL_US);
+	n_out = rte_sched_port_dequeue(port, mbufs, CODEL_N_PKTS);
+	TEST_ASSERT_EQUAL(n_out, CODEL_N_PKTS - 2,
+			  "Wrong dequeue, n_out=%d\n", n_out);
+	for (i = 0; i < n_out; i++)
+		rte_pktmbuf_free(mbufs[i]);
+
+#ifdef RTE_SCHED_COLLECT_STATS
+	struct rte_sched_subport_stats subport_stats;
+	uint32_t tc_ov;
+
+	rte_sched_subport_read_stats(port, SUBPORT, &subport_stats, &tc_ov);
+	TEST_ASSERT_EQUAL(subport_stats.n_pkts_tc_dropped[TC], 1,
+			  "Wrong subport drop stats\n");
+	TEST_ASSERT_EQUAL(subport_stats.n_bytes_tc_dropped[TC], 60,
+			  "Wrong subport dropped bytes\n");
+#endif
+
+	/* Traffic classes without CoDel keep the mbuf timestamp */
+	mbufs[0] = layout_pkt(mp, port, SUBPORT, TC - 1, QUEUE);
+	TEST_ASSERT_NOT_NULL(mbufs[0], "Packet allocation failed\n");
+	mbufs[0]->timestamp = 0x1234;
+	err = rte_sched_port_enqueue(port, mbufs, 1);
+	TEST_ASSERT_EQUAL(err, 1, "Wrong enqueue, err=%d\n", err);
+	n_out = rte_sched_port_dequeue(port, mbufs, 1);
+	TEST_ASSERT_EQUAL(n_out, 1, "Wrong dequeue, n_out=%d\n", n_out);
+	TEST_ASSERT_EQUAL(mbufs[0]->timestamp, 0x1234,
+			  "Timestamp overwritten\n");
+	rte_pktmbuf_free(mbufs[0]);
+
+	rte_sched_port_free(port);
+
+	return 0;
+}
+
+#endif /* RTE_SCHED_CODEL */
+
+#define SHARD_N_SHARDS   2
+#define SHARD_N_PKTS     5
+#define SHARD_PKT_LEN    60
+
+static int
+test_sched_shard_run(struct rte_mempool *mp, uint64_t arbiter_rate,
+		     uint64_t arbiter_tb_size, uint32_t n_pkts_expected)
+{
+	struct rte_sched_port_params params = port_param;
+	struct rte_sched_port *shard[SHARD_N_SHARDS];
+	struct rte_sched_arbiter *arbiter;
+	struct rte_mbuf *in_mbufs[SHARD_N_PKTS];
+	struct rte_mbuf *out_mbufs[SHARD_N_PKTS];
+	uint32_t s, pipe, subport, tc, queue, n_out;
+	int i, err;
+
+	params.n_subports_per_port = SHARD_N_SHARDS;
+
+	arbiter = rte_sched_arbiter_create(arbiter_rate, arbiter_tb_size,
+					   SOCKET_ID_ANY);
+	TEST_ASSERT_NOT_NULL(arbiter, "Error creating arbiter\n");
+
+	for (s = 0; s < SHARD_N_SHARDS; s++) {
+		shard[s] = rte_sched_port_shard_config(&params, arbiter,
+						       s, SHARD_N_SHARDS);
+		TEST_ASSERT_NOT_NULL(shard[s], "Error config shard %u\n", s);
+
+		/* Shard s only owns subport s */
+		err = rte_sched_subport_config(shard[s],
+				(s + 1) % SHARD_N_SHARDS, subport_param);
+		TEST_ASSERT_FAIL(err, "Foreign subport configured\n");
+
+		err = rte_sched_subport_config(shard[s], s, subport_param);
+		TEST_ASSERT_SUCCESS(err, "Error config subport, err=%d\n",
+				    err);
+
+		for (pipe = 0; pipe < params.n_pipes_per_subport; pipe++) {
+			err = rte_sched_pipe_config(shard[s], s, pipe, 0);
+			TEST_ASSERT_SUCCESS(err,
+				"Error config sched pipe %u, err=%d\n",
+				pipe, err);
+		}
+
+		for (i = 0; i < SHARD_N_PKTS; i++) {
+			in_mbufs[i] = rte_pktmbuf_alloc(mp);
+			TEST_ASSERT_NOT_NULL(in_mbufs[i],
+					     "Packet allocation failed\n");
+			rte_sched_port_pkt_write(shard[s], in_mbufs[i], s,
+					PIPE, TC, QUEUE, RTE_COLOR_GREEN);
+			in_mbufs[i]->pkt_len = SHARD_PKT_LEN;
+			in_mbufs[i]->data_len = SHARD_PKT_LEN;
+		}
+
+		err = rte_sched_port_enqueue(shard[s], in_mbufs, SHARD_N_PKTS);
+		TEST_ASSERT_EQUAL(err, SHARD_N_PKTS,
+				  "Wrong enqueue, err=%d\n", err);
+	}
+
+	/* The arbiter bounds the packets dequeued from all the shards */
+	for (s = 0, n_out = 0; s < SHARD_N_SHARDS; s++) {
+		err = rte_sched_port_dequeue(shard[s], out_mbufs,
+					     SHARD_N_PKTS);
+		TEST_ASSERT(err >= 0 && n_out + err <= n_pkts_expected,
+			    "Wrong dequeue, err=%d\n", err);
+
+		for (i = 0; i < err; i++) {
+			rte_sched_port_pkt_read_tree_path(shard[s],
+					out_mbufs[i], &subport, &pipe,
+					&tc, &queue);
+			TEST_ASSERT_EQUAL(subport, s, "Wrong subport\n");
+			TEST_ASSERT_EQUAL(pipe, PIPE, "Wrong pipe\n");
+			rte_pktmbuf_free(out_mbufs[i]);
+		}
+		n_out += err;
+	}
+	TEST_ASSERT_EQUAL(n_out, n_pkts_expected,
+			  "Wrong total dequeue %u\n", n_out);
+
+	for (s = 0; s < SHARD_N_SHARDS; s++)
+		rte_sched_port_free(shard[s]);
+	rte_sched_arbiter_free(arbiter);
+
+	return 0;
+}
+
+static int
+test_sched_shard(struct rte_mempool *mp)
+{
+	uint32_t pkt_len = SHARD_PKT_LEN + RTE_SCHED_FRAME_OVERHEAD_DEFAULT;
+	int err;
+
+	/* Shared port rate not limiting */
+	err = test_sched_shard_run(mp, port_param.rate, 1000000,
+				   SHARD_N_SHARDS * SHARD_N_PKTS);
+	if (err != 0)
+		return err;
+
+	/* Shared port bucket only holds 3 packets, refilled very slowly */
+	return test_sched_shard_run(mp, 1, 3 * pkt_len, 3);
+}
+
 /**
  * test main entrance for library sched
  */
@@ -182,7 +456,17 @@ test_sched(void)
 
 	rte_sched_port_free(port);
 
-	return 0;
+	err = test_sched_queue_layout(mp);
+	if (err != 0)
+		return err;
+
+#ifdef RTE_SCHED_CODEL
+	err = test_sched_codel(mp);
+	if (err != 0)
+		return err;
+#endif
+
+	return test_sched_shard(mp);
 }
 
 REGISTER_TEST_COMMAND(sched_autotest, test_sched);
@@ -0,0 +1,377 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_errno.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_sketch.h>
+
+#include "test.h"
+
+#define NUM_MBUFS 256
+#define MBUF_SIZE (RTE_MBUF_DEFAULT_DATAROOM + RTE_PKTMBUF_HEADROOM)
+#define BURST 32
+
+#define WIDTH 4096
+#define DEPTH 4
+#define TOPK 16
+
+/* Number of small flows, and of heavy hitters among them */
+#define NUM_FLOWS 20000
+#define NUM_HEAVY 8
+#define HEAVY_PKTS 1000
+#define KEY_OFFSET 26
+
+struct flow_key {
+	uint32_t src;
+	uint32_t dst;
+	uint16_t sport;
+	uint16_t dport;
+};
+
+struct sketch_unittest_params {
+	struct rte_mempool *p;
+	struct rte_sketch *sk[2];
+};
+
+static struct sketch_unittest_params default_params;
+static struct sketch_unittest_params *test_params = &default_params;
+
+static struct rte_sketch_params sketch_params = {
+	.name = "test_sketch",
+	.key_len = sizeof(struct flow_key),
+	.width = WIDTH,
+	.depth = DEPTH,
+	.topk = TOPK,
+	.seed = 0x12345678,
+};
+
+static void
+flow_key_init(struct flow_key *key, uint32_t flow)
+{
+	memset(key, 0, sizeof(*key));
+	key->src = 0x0a000000 | flow;
+	key->dst = 0xc0a80001;
+	key->sport = flow & 0xffff;
+	key->dport = 80;
+}
+
+/* Heavy hitter i has (NUM_HEAVY - i) * HEAVY_PKTS packets of 100 bytes */
+static void
+account_flows(struct rte_sketch *sk, uint32_t first, uint32_t step)
+{
+	struct flow_key keys[BURST];
+	const void *key_ptrs[BURST];
+	uint32_t bytes[BURST];
+	uint32_t i, j, n = 0;
+
+	for (i = first; i < NUM_FLOWS; i += step) {
+		flow_key_init(&keys[n], i);
+		key_ptrs[n] = &keys[n];
+		bytes[n] = 64 + i % 64;
+		if (++n == BURST) {
+			rte_sketch_update_bulk(sk, key_ptrs, bytes, n);
+			n = 0;
+		}
+	}
+	rte_sketch_update_bulk(sk, key_ptrs, bytes, n);
+
+	for (i = first; i < NUM_HEAVY; i += step) {
+		flow_key_init(&keys[0], i);
+		for (j = 0; j < (NUM_HEAVY - i) * HEAVY_PKTS; j++)
+			rte_sketch_update(sk, &keys[0], 100);
+	}
+}
+
+static int
+check_heavy_hitters(struct rte_sketch *sk)
+{
+	struct rte_sketch_flow flows[TOPK];
+	struct rte_sketch_flow heavy[NUM_HEAVY];
+	struct flow_key key;
+	uint64_t pkts, bytes;
+	uint32_t i, n;
+
+	n = rte_sketch_topk(sk, flows, RTE_DIM(flows));
+	TEST_ASSERT_EQUAL(n, TOPK, "Unexpected number of heavy hitters %u", n);
+
+	for (i = 0; i < NUM_HEAVY; i++) {
+		flow_key_init(&key, i);
+		TEST_ASSERT_BUFFERS_ARE_EQUAL(flows[i].key, &key, sizeof(key),
+				"Heavy hitter %u is not the expected flow", i);
+		/* One packet from the small flows, plus some collisions */
+		TEST_ASSERT(flows[i].pkts >= (NUM_HEAVY - i) * HEAVY_PKTS + 1 &&
+				flows[i].pkts < (NUM_HEAVY - i) * HEAVY_PKTS +
+				HEAVY_PKTS / 2,
+				"Bad estimate %"PRIu64" for heavy hitter %u",
+				flows[i].pkts, i);
+
+		rte_sketch_estimate(sk, &key, &pkts, &bytes);
+		TEST_ASSERT_EQUAL(pkts, flows[i].pkts,
+				"Heavy hitter and estimate differ");
+		TEST_ASSERT(bytes >= (NUM_HEAVY - i) * HEAVY_PKTS * 100,
+				"Bytes underestimated for heavy hitter %u", i);
+	}
+	for (i = 1; i < n; i++)
+		TEST_ASSERT(flows[i - 1].pkts >= flows[i].pkts,
+				"Heavy hitters are not sorted");
+
+	/* A shorter array only gets the biggest flows */
+	n = rte_sketch_topk(sk, heavy, RTE_DIM(heavy));
+	TEST_ASSERT_EQUAL(n, NUM_HEAVY, "Unexpected number of heavy hitters");
+	for (i = 0; i < n; i++)
+		TEST_ASSERT(heavy[i].key == flows[i].key &&
+				heavy[i].pkts == flows[i].pkts,
+				"Heavy hitter %u differs in a shorter array", i);
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_sketch_create_invalid(void)
+{
+	struct rte_sketch_params params;
+
+	params = sketch_params;
+	params.width = 1000;
+	TEST_ASSERT_NULL(rte_sketch_create(&params),
+			"Sketch created with a width not power of 2");
+	TEST_ASSERT_EQUAL(rte_errno, EINVAL, "rte_errno is not EINVAL");
+
+	params = sketch_params;
+	params.depth = RTE_SKETCH_MAX_DEPTH + 1;
+	TEST_ASSERT_NULL(rte_sketch_create(&params),
+			"Sketch created with a too large depth");
+
+	params = sketch_params;
+	params.key_len = 0;
+	TEST_ASSERT_NULL(rte_sketch_create(&params),
+			"Sketch created with an empty key");
+
+	params = sketch_params;
+	params.topk = RTE_SKETCH_MAX_TOPK + 1;
+	TEST_ASSERT_NULL(rte_sketch_create(&params),
+			"Sketch created with too many heavy hitters");
+
+	TEST_ASSERT_NULL(rte_sketch_create(NULL),
+			"Sketch created without parameters");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_sketch_estimate(void)
+{
+	struct rte_sketch *sk = test_params->sk[0];
+	struct flow_key key;
+	struct rte_sketch_flow flow;
+	uint64_t pkts, bytes, total_pkts, max_error;
+	uint32_t i, errors = 0;
+
+	rte_sketch_reset(sk);
+	account_flows(sk, 0, 1);
+
+	/* The error bound e * N / width holds with probability 1 - e^-depth */
+	total_pkts = NUM_FLOWS + HEAVY_PKTS * NUM_HEAVY * (NUM_HEAVY + 1) / 2;
+	max_error = total_pkts * 272 / 100 / WIDTH;
+
+	for (i = NUM_HEAVY; i < NUM_FLOWS; i++) {
+		flow_key_init(&key, i);
+		rte_sketch_estimate(sk, &key, &pkts, NULL);
+		rte_sketch_estimate(sk, &key, NULL, &bytes);
+		TEST_ASSERT(pkts >= 1 && bytes >= 64 + i % 64,
+				"Flow %u underestimated", i);
+		if (pkts > 1 + max_error)
+			errors++;
+	}
+	TEST_ASSERT(errors < (NUM_FLOWS - NUM_HEAVY) / 20,
+			"%u estimates above the error bound", errors);
+
+	TEST_ASSERT_SUCCESS(check_heavy_hitters(sk),
+			"Heavy hitters check failed");
+
+	rte_sketch_reset(sk);
+	flow_key_init(&key, 0);
+	rte_sketch_estimate(sk, &key, &pkts, &bytes);
+	TEST_ASSERT(pkts == 0 && bytes == 0, "Sketch not reset");
+	TEST_ASSERT_EQUAL(rte_sketch_topk(sk, &flow, 1), 0,
+			"Heavy hitters not reset");
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_sketch_topk_bytes(void)
+{
+	struct rte_sketch_params params = sketch_params;
+	struct rte_sketch_flow flows[TOPK];
+	struct rte_sketch *sk;
+	struct flow_key key;
+	uint32_t i, n;
+
+	params.name = "test_sketch_bytes";
+	params.flags = RTE_SKETCH_F_TOPK_BYTES;
+	sk = rte_sketch_create(&params);
+	TEST_ASSERT_NOT_NULL(sk, "Cannot create sketch");
+
+	/* Flow i has i packets and about 100000 / i bytes */
+	for (i = 1; i <= 2 * TOPK; i++) {
+		flow_key_init(&key, i);
+		for (n = 0; n < i; n++)
+			rte_sketch_update(sk, &key, 100000 / (i * i));
+	}
+
+	n = rte_sketch_topk(sk, flows, RTE_DIM(flows));
+	TEST_ASSERT_EQUAL(n, TOPK, "Unexpected number of heavy hitters");
+	for (i = 0; i < n; i++) {
+		flow_key_init(&key, i + 1);
+		TEST_ASSERT_BUFFERS_ARE_EQUAL(flows[i].key, &key, sizeof(key),
+				"Heavy hitters not ranked by bytes");
+	}
+
+	n = rte_sketch_topk(sk, flows, TOPK / 2);
+	TEST_ASSERT_EQUAL(n, TOPK / 2, "Unexpected number of heavy hitters");
+	for (i = 0; i < n; i++) {
+		flow_key_init(&key, i + 1);
+		TEST_ASSERT_BUFFERS_ARE_EQUAL(flows[i].key, &key, sizeof(key),
+				"Biggest flows not returned in a shorter array");
+	}
+
+	rte_sketch_free(sk);
+	return TEST_SUCCESS;
+}
+
+static int
+test_sketch_merge(void)
+{
+	struct rte_sketch_params params = sketch_params;
+	struct rte_sketch *sk;
+
+	rte_sketch_reset(test_params->sk[0]);
+	rte_sketch_reset(test_params->sk[1]);
+
+	/* Each sketch gets half of the flows, as two lcores would */
+	account_flows(test_params->sk[0], 0, 2);
+	account_flows(test_params->sk[1], 1, 2);
+	TEST_ASSERT_SUCCESS(rte_sketch_merge(test_params->sk[0],
+				test_params->sk[1]), "Merge failed");
+	TEST_ASSERT_SUCCESS(check_heavy_hitters(test_params->sk[0]),
+			"Heavy hitters check failed after merge");
+
+	params.name = "test_sketch_seed";
+	params.seed++;
+	sk = rte_sketch_create(&params);
+	TEST_ASSERT_NOT_NULL(sk, "Cannot create sketch");
+	TEST_ASSERT_EQUAL(rte_sketch_merge(test_params->sk[0], sk), -EINVAL,
+			"Sketches with different seeds merged");
+	rte_sketch_free(sk);
+
+	return TEST_SUCCESS;
+}
+
+static int
+test_sketch_burst(void)
+{
+	struct rte_sketch *sk = test_params->sk[0];
+	struct rte_mbuf *pkts[BURST];
+	struct flow_key key;
+	uint64_t npkts, bytes;
+	uint16_t i, n;
+
+	rte_sketch_reset(sk);
+	TEST_ASSERT_SUCCESS(rte_pktmbuf_alloc_bulk(test_params->p, pkts, BURST),
+			"Cannot allocate mbufs");
+
+	for (i = 0; i < BURST; i++) {
+		/* The last packet is too short to hold the key */
+		n = (i == BURST - 1) ? KEY_OFFSET : 128;
+		rte_pktmbuf_append(pkts[i], n);
+		flow_key_init(&key, i % 2);
+		if (i != BURST - 1)
+			memcpy(rte_pktmbuf_mtod_offset(pkts[i], void *,
+						KEY_OFFSET), &key, sizeof(key));
+	}
+
+	n = rte_sketch_update_burst(sk, pkts, BURST, KEY_OFFSET);
+	TEST_ASSERT_EQUAL(n, BURST - 1, "Unexpected accounted packets %u", n);
+
+	for (i = 0; i < 2; i++) {
+		flow_key_init(&key, i);
+		rte_sketch_estimate(sk, &key, &npkts, &bytes);
+		TEST_ASSERT(npkts == (uint64_t)(BURST / 2 - i) &&
+				bytes == npkts * 128,
+				"Bad estimate for flow %u", i);
+	}
+
+	for (i = 0; i < BURST; i++)
+		rte_pktmbuf_free(pkts[i]);
+	return TEST_SUCCESS;
+}
+
+static int
+test_setup(void)
+{
+	struct rte_sketch_params params = sketch_params;
+
+	if (test_params->p == NULL) {
+		test_params->p = rte_pktmbuf_pool_create("SKETCH_POOL",
+				NUM_MBUFS, 32, 0, MBUF_SIZE, rte_socket_id());
+		if (test_params->p == NULL) {
+			printf("%s: Error creating mempool\n", __func__);
+			return -1;
+		}
+	}
+
+	params.socket_id = rte_socket_id();
+	if (test_params->sk[0] == NULL) {
+		params.name = "test_sketch0";
+		test_params->sk[0] = rte_sketch_create(&params);
+	}
+	if (test_params->sk[1] == NULL) {
+		params.name = "test_sketch1";
+		test_params->sk[1] = rte_sketch_create(&params);
+	}
+	if (test_params->sk[0] == NULL || test_params->sk[1] == NULL) {
+		printf("%s: Error creating sketches\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+test_teardown(void)
+{
+	rte_sketch_free(test_params->sk[0]);
+	test_params->sk[0] = NULL;
+	rte_sketch_free(test_params->sk[1]);
+	test_params->sk[1] = NULL;
+	rte_mempool_free(test_params->p);
+	test_params->p = NULL;
+}
+
+static struct unit_test_suite sketch_test_suite  = {
+	.setup = test_setup,
+	.teardown = test_teardown,
+	.suite_name = "sketch Unit Test Suite",
+	.unit_test_cases = {
+		TEST_CASE(test_sketch_create_invalid),
+		TEST_CASE(test_sketch_estimate),
+		TEST_CASE(test_sketch_topk_bytes),
+		TEST_CASE(test_sketch_merge),
+		TEST_CASE(test_sketch_burst),
+		TEST_CASES_END()
+	}
+};
+
+static int
+test_sketch(void)
+{
+	return unit_test_suite_runner(&sketch_test_suite);
+}
+
+REGISTER_TEST_COMMAND(sketch_autotest, test_sketch);
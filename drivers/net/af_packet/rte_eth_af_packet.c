@@ -31,21 +31,33 @@
 #define ETH_AF_PACKET_FRAMESIZE_ARG	"framesz"
 #define ETH_AF_PACKET_FRAMECOUNT_ARG	"framecnt"
 #define ETH_AF_PACKET_QDISC_BYPASS_ARG	"qdisc_bypass"
+#define ETH_AF_PACKET_TPACKET_V3_ARG	"tpacket_v3"
+#define ETH_AF_PACKET_BLOCK_TMO_ARG	"block_tmo"
+#define ETH_AF_PACKET_RX_ZERO_COPY_ARG	"rx_zero_copy"
 
 #define DFLT_BLOCK_SIZE		(1 << 12)
 #define DFLT_FRAME_SIZE		(1 << 11)
 #define DFLT_FRAME_COUNT	(1 << 9)
+#define DFLT_BLOCK_TMO		1
 
 #define RTE_PMD_AF_PACKET_MAX_RINGS 16
 
 struct pkt_rx_queue {
 	int sockfd;
 
+	/* frames with TPACKET_V2, blocks with TPACKET_V3 */
 	struct iovec *rd;
 	uint8_t *map;
 	unsigned int framecount;
 	unsigned int framenum;
 
+	/* next packet of the current TPACKET_V3 block, NULL if none */
+	struct tpacket3_hdr *ppd;
+	unsigned int pkts_left;
+	/* references to each block from the mbufs attached to it */
+	struct rte_mbuf_ext_shared_info *shinfo;
+	int zero_copy;
+
 	struct rte_mempool *mb_pool;
 	uint16_t in_port;
 
@@ -56,6 +68,8 @@ struct pkt_rx_queue {
 
 struct pkt_tx_queue {
 	int sockfd;
+	int tpver;
+	unsigned int frame_data_off;
 	unsigned int frame_data_size;
 
 	struct iovec *rd;
@@ -75,7 +89,9 @@ struct pmd_internals {
 	char *if_name;
 	struct ether_addr eth_addr;
 
-	struct tpacket_req req;
+	int tpver;
+	/* tpacket_req is the leading part of tpacket_req3 */
+	struct tpacket_req3 req;
 
 	struct pkt_rx_queue rx_queue[RTE_PMD_AF_PACKET_MAX_RINGS];
 	struct pkt_tx_queue tx_queue[RTE_PMD_AF_PACKET_MAX_RINGS];
@@ -88,6 +104,9 @@ static const char *valid_arguments[] = {
 	ETH_AF_PACKET_FRAMESIZE_ARG,
 	ETH_AF_PACKET_FRAMECOUNT_ARG,
 	ETH_AF_PACKET_QDISC_BYPASS_ARG,
+	ETH_AF_PACKET_TPACKET_V3_ARG,
+	ETH_AF_PACKET_BLOCK_TMO_ARG,
+	ETH_AF_PACKET_RX_ZERO_COPY_ARG,
 	NULL
 };
 
@@ -164,13 +183,181 @@ eth_af_packet_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_rx;
 }
 
+/*
+ * Gives a TPACKET_V3 block back to the kernel, once the last mbuf
+ * attached to it is freed.
+ */
+static void
+eth_af_packet_block_free(void *addr __rte_unused, void *opaque)
+{
+	struct tpacket_block_desc *pbd = opaque;
+
+	/* complete the reads of the packets before releasing them */
+	rte_smp_mb();
+	pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+}
+
+/* Done with the packets of the current TPACKET_V3 block */
+static inline void
+eth_af_packet_block_done(struct pkt_rx_queue *pkt_q, unsigned int blocknum)
+{
+	struct tpacket_block_desc *pbd = pkt_q->rd[blocknum].iov_base;
+
+	/* drop the reference of the queue, the mbufs may still hold some */
+	if (pkt_q->zero_copy &&
+	    rte_mbuf_ext_refcnt_update(&pkt_q->shinfo[blocknum], -1) != 0)
+		return;
+
+	pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+}
+
+/*
+ * Receives packets from the TPACKET_V3 ring: the status of a block is
+ * checked once for all its packets, which are either copied into mbufs
+ * or attached to mbufs as external buffers.
+ */
+static uint16_t
+eth_af_packet_rx_v3(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct tpacket_block_desc *pbd;
+	struct tpacket3_hdr *ppd;
+	struct rte_mbuf *mbuf;
+	uint8_t *pbuf;
+	struct pkt_rx_queue *pkt_q = queue;
+	uint16_t num_rx = 0;
+	unsigned long num_rx_bytes = 0;
+	unsigned long num_rx_err = 0;
+	unsigned int blockcount, blocknum, pkts_left;
+	uint32_t len;
+
+	if (unlikely(nb_pkts == 0))
+		return 0;
+
+	blockcount = pkt_q->framecount;
+	blocknum = pkt_q->framenum;
+	ppd = pkt_q->ppd;
+	pkts_left = pkt_q->pkts_left;
+	while (num_rx < nb_pkts) {
+		if (ppd == NULL) {
+			/* open the next block */
+			pbd = pkt_q->rd[blocknum].iov_base;
+			if ((pbd->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+				break;
+			rte_smp_rmb();
+
+			pkts_left = pbd->hdr.bh1.num_pkts;
+			if (unlikely(pkts_left == 0)) {
+				pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+				if (++blocknum >= blockcount)
+					blocknum = 0;
+				continue;
+			}
+			ppd = (struct tpacket3_hdr *)((uint8_t *)pbd +
+				pbd->hdr.bh1.offset_to_first_pkt);
+			if (pkt_q->zero_copy)
+				rte_mbuf_ext_refcnt_set(
+					&pkt_q->shinfo[blocknum], 1);
+		}
+
+		/* allocate the next mbuf */
+		mbuf = rte_pktmbuf_alloc(pkt_q->mb_pool);
+		if (unlikely(mbuf == NULL))
+			break;
+
+		len = ppd->tp_snaplen;
+		pbuf = (uint8_t *)ppd + ppd->tp_mac;
+		if (pkt_q->zero_copy && likely(len <= UINT16_MAX)) {
+			rte_mbuf_ext_refcnt_update(&pkt_q->shinfo[blocknum],
+						   1);
+			rte_pktmbuf_attach_extbuf(mbuf, pbuf, RTE_BAD_IOVA,
+					len, &pkt_q->shinfo[blocknum]);
+		} else if (!pkt_q->zero_copy &&
+			   likely(len <= rte_pktmbuf_tailroom(mbuf))) {
+			memcpy(rte_pktmbuf_mtod(mbuf, void *), pbuf, len);
+		} else {
+			/* drop the packets which do not fit in an mbuf */
+			rte_pktmbuf_free(mbuf);
+			mbuf = NULL;
+			num_rx_err++;
+		}
+
+		if (mbuf != NULL) {
+			rte_pktmbuf_pkt_len(mbuf) = len;
+			rte_pktmbuf_data_len(mbuf) = len;
+
+			/* check for vlan info */
+			if (ppd->tp_status & TP_STATUS_VLAN_VALID) {
+				mbuf->vlan_tci = ppd->hv1.tp_vlan_tci;
+				mbuf->ol_flags |= (PKT_RX_VLAN |
+						   PKT_RX_VLAN_STRIPPED);
+			}
+			mbuf->hash.rss = ppd->hv1.tp_rxhash;
+			mbuf->ol_flags |= PKT_RX_RSS_HASH;
+			mbuf->port = pkt_q->in_port;
+
+			/* account for the receive frame */
+			bufs[num_rx++] = mbuf;
+			num_rx_bytes += len;
+		}
+
+		/* advance in the block, releasing it after its last packet */
+		if (--pkts_left == 0) {
+			eth_af_packet_block_done(pkt_q, blocknum);
+			ppd = NULL;
+			if (++blocknum >= blockcount)
+				blocknum = 0;
+		} else {
+			ppd = (struct tpacket3_hdr *)((uint8_t *)ppd +
+				ppd->tp_next_offset);
+		}
+	}
+	pkt_q->framenum = blocknum;
+	pkt_q->ppd = ppd;
+	pkt_q->pkts_left = pkts_left;
+	pkt_q->rx_pkts += num_rx;
+	pkt_q->err_pkts += num_rx_err;
+	pkt_q->rx_bytes += num_rx_bytes;
+	return num_rx;
+}
+
+/* Checks if a frame of the Tx ring can be filled */
+static inline int
+tx_frame_available(int tpver, void *ppd)
+{
+	if (tpver == TPACKET_V3)
+		return ((struct tpacket3_hdr *)ppd)->tp_status ==
+			TP_STATUS_AVAILABLE;
+	return ((struct tpacket2_hdr *)ppd)->tp_status == TP_STATUS_AVAILABLE;
+}
+
+/* Hands a filled frame of the Tx ring to the kernel */
+static inline void
+tx_frame_send(int tpver, void *ppd, uint32_t len)
+{
+	struct tpacket3_hdr *ppd3;
+	struct tpacket2_hdr *ppd2;
+
+	if (tpver == TPACKET_V3) {
+		ppd3 = ppd;
+		ppd3->tp_next_offset = 0;
+		ppd3->tp_len = len;
+		ppd3->tp_snaplen = len;
+		ppd3->tp_status = TP_STATUS_SEND_REQUEST;
+	} else {
+		ppd2 = ppd;
+		ppd2->tp_len = len;
+		ppd2->tp_snaplen = len;
+		ppd2->tp_status = TP_STATUS_SEND_REQUEST;
+	}
+}
+
 /*
  * Callback to handle sending packets through a real NIC.
  */
 static uint16_t
 eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 {
-	struct tpacket2_hdr *ppd;
+	void *ppd;
 	struct rte_mbuf *mbuf;
 	uint8_t *pbuf;
 	unsigned int framecount, framenum;
@@ -190,7 +377,7 @@ eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 
 	framecount = pkt_q->framecount;
 	framenum = pkt_q->framenum;
-	ppd = (struct tpacket2_hdr *) pkt_q->rd[framenum].iov_base;
+	ppd = pkt_q->rd[framenum].iov_base;
 	for (i = 0; i < nb_pkts; i++) {
 		mbuf = *bufs++;
 
@@ -209,13 +396,12 @@ eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 		}
 
 		/* point at the next incoming frame */
-		if ((ppd->tp_status != TP_STATUS_AVAILABLE) &&
+		if (!tx_frame_available(pkt_q->tpver, ppd) &&
 		    (poll(&pfd, 1, -1) < 0))
 			break;
 
 		/* copy the tx frame data */
-		pbuf = (uint8_t *) ppd + TPACKET2_HDRLEN -
-			sizeof(struct sockaddr_ll);
+		pbuf = (uint8_t *)ppd + pkt_q->frame_data_off;
 
 		struct rte_mbuf *tmp_mbuf = mbuf;
 		while (tmp_mbuf) {
@@ -225,14 +411,11 @@ eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 			tmp_mbuf = tmp_mbuf->next;
 		}
 
-		ppd->tp_len = mbuf->pkt_len;
-		ppd->tp_snaplen = mbuf->pkt_len;
-
 		/* release incoming frame and advance ring buffer */
-		ppd->tp_status = TP_STATUS_SEND_REQUEST;
+		tx_frame_send(pkt_q->tpver, ppd, mbuf->pkt_len);
 		if (++framenum >= framecount)
 			framenum = 0;
-		ppd = (struct tpacket2_hdr *) pkt_q->rd[framenum].iov_base;
+		ppd = pkt_q->rd[framenum].iov_base;
 
 		num_tx++;
 		num_tx_bytes += mbuf->pkt_len;
@@ -240,7 +423,8 @@ eth_af_packet_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	}
 
 	/* kick-off transmits */
-	if (sendto(pkt_q->sockfd, NULL, 0, MSG_DONTWAIT, NULL, 0) == -1) {
+	if (num_tx > 0 &&
+	    sendto(pkt_q->sockfd, NULL, 0, MSG_DONTWAIT, NULL, 0) == -1) {
 		/* error sending -- no packets transmitted */
 		num_tx = 0;
 		num_tx_bytes = 0;
@@ -397,9 +581,10 @@ eth_rx_queue_setup(struct rte_eth_dev *dev,
 	buf_size = rte_pktmbuf_data_room_size(pkt_q->mb_pool) -
 		RTE_PKTMBUF_HEADROOM;
 	data_size = internals->req.tp_frame_size;
-	data_size -= TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+	data_size -= internals->tx_queue[rx_queue_id].frame_data_off;
 
-	if (data_size > buf_size) {
+	/* with zero copy, the mbufs are only attached to the ring */
+	if (!pkt_q->zero_copy && data_size > buf_size) {
 		PMD_LOG(ERR,
 			"%s: %d bytes will not fit in mbuf (%d bytes)",
 			dev->device->name, data_size, buf_size);
@@ -434,7 +619,8 @@ eth_dev_mtu_set(struct rte_eth_dev *dev, uint16_t mtu)
 	int ret;
 	int s;
 	unsigned int data_size = internals->req.tp_frame_size -
-				 TPACKET2_HDRLEN;
+				 (internals->tpver == TPACKET_V3 ?
+				  TPACKET3_HDRLEN : TPACKET2_HDRLEN);
 
 	if (mtu > data_size)
 		return -EINVAL;
@@ -539,6 +725,9 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
                        unsigned int framesize,
                        unsigned int framecnt,
 		       unsigned int qdisc_bypass,
+		       unsigned int tpacket_v3,
+		       unsigned int block_tmo,
+		       unsigned int rx_zero_copy,
                        struct pmd_internals **internals,
                        struct rte_eth_dev **eth_dev,
                        struct rte_kvargs *kvlist)
@@ -551,12 +740,13 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 	size_t ifnamelen;
 	unsigned k_idx;
 	struct sockaddr_ll sockaddr;
-	struct tpacket_req *req;
+	struct tpacket_req3 *req;
+	struct tpacket_req3 tx_req;
 	struct pkt_rx_queue *rx_queue;
 	struct pkt_tx_queue *tx_queue;
 	int rc, tpver, discard;
 	int qsockfd = -1;
-	unsigned int i, q, rdsize;
+	unsigned int i, q, rdsize, hdrlen;
 #if defined(PACKET_FANOUT)
 	int fanout_arg;
 #endif
@@ -594,6 +784,22 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 	req->tp_frame_size = framesize;
 	req->tp_frame_nr = framecnt;
 
+	if (tpacket_v3) {
+		tpver = TPACKET_V3;
+		hdrlen = TPACKET3_HDRLEN;
+		req->tp_retire_blk_tov = block_tmo;
+		req->tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+	} else {
+		tpver = TPACKET_V2;
+		hdrlen = TPACKET2_HDRLEN;
+	}
+	(*internals)->tpver = tpver;
+
+	/* the Tx ring of TPACKET_V3 has no block timeout nor features */
+	tx_req = *req;
+	tx_req.tp_retire_blk_tov = 0;
+	tx_req.tp_feature_req_word = 0;
+
 	ifnamelen = strlen(pair->value);
 	if (ifnamelen < sizeof(ifr.ifr_name)) {
 		memcpy(ifr.ifr_name, pair->value, ifnamelen);
@@ -646,7 +852,6 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 			return -1;
 		}
 
-		tpver = TPACKET_V2;
 		rc = setsockopt(qsockfd, SOL_PACKET, PACKET_VERSION,
 				&tpver, sizeof(tpver));
 		if (rc == -1) {
@@ -687,7 +892,8 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 			goto error;
 		}
 
-		rc = setsockopt(qsockfd, SOL_PACKET, PACKET_TX_RING, req, sizeof(*req));
+		rc = setsockopt(qsockfd, SOL_PACKET, PACKET_TX_RING, &tx_req,
+				sizeof(tx_req));
 		if (rc == -1) {
 			PMD_LOG(ERR,
 				"%s: could not set PACKET_TX_RING on AF_PACKET "
@@ -696,7 +902,8 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 		}
 
 		rx_queue = &((*internals)->rx_queue[q]);
-		rx_queue->framecount = req->tp_frame_nr;
+		rx_queue->framecount = tpacket_v3 ? req->tp_block_nr :
+			req->tp_frame_nr;
 
 		rx_queue->map = mmap(NULL, 2 * req->tp_block_size * req->tp_block_nr,
 				    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
@@ -714,17 +921,42 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 		rx_queue->rd = rte_zmalloc_socket(name, rdsize, 0, numa_node);
 		if (rx_queue->rd == NULL)
 			goto error;
-		for (i = 0; i < req->tp_frame_nr; ++i) {
-			rx_queue->rd[i].iov_base = rx_queue->map + (i * framesize);
-			rx_queue->rd[i].iov_len = req->tp_frame_size;
+		if (tpacket_v3) {
+			for (i = 0; i < req->tp_block_nr; ++i) {
+				rx_queue->rd[i].iov_base = rx_queue->map +
+					(i * blocksize);
+				rx_queue->rd[i].iov_len = req->tp_block_size;
+			}
+		} else {
+			for (i = 0; i < req->tp_frame_nr; ++i) {
+				rx_queue->rd[i].iov_base = rx_queue->map +
+					(i * framesize);
+				rx_queue->rd[i].iov_len = req->tp_frame_size;
+			}
 		}
 		rx_queue->sockfd = qsockfd;
 
+		if (rx_zero_copy) {
+			rx_queue->shinfo = rte_zmalloc_socket(name,
+				req->tp_block_nr * sizeof(*rx_queue->shinfo),
+				0, numa_node);
+			if (rx_queue->shinfo == NULL)
+				goto error;
+			for (i = 0; i < req->tp_block_nr; ++i) {
+				rx_queue->shinfo[i].free_cb =
+					eth_af_packet_block_free;
+				rx_queue->shinfo[i].fcb_opaque =
+					rx_queue->rd[i].iov_base;
+			}
+			rx_queue->zero_copy = 1;
+		}
+
 		tx_queue = &((*internals)->tx_queue[q]);
+		tx_queue->tpver = tpver;
 		tx_queue->framecount = req->tp_frame_nr;
-		tx_queue->frame_data_size = req->tp_frame_size;
-		tx_queue->frame_data_size -= TPACKET2_HDRLEN -
-			sizeof(struct sockaddr_ll);
+		tx_queue->frame_data_off = hdrlen - sizeof(struct sockaddr_ll);
+		tx_queue->frame_data_size = req->tp_frame_size -
+			tx_queue->frame_data_off;
 
 		tx_queue->map = rx_queue->map + req->tp_block_size * req->tp_block_nr;
 
@@ -791,6 +1023,7 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 		       2 * req->tp_block_size * req->tp_block_nr);
 
 		rte_free((*internals)->rx_queue[q].rd);
+		rte_free((*internals)->rx_queue[q].shinfo);
 		rte_free((*internals)->tx_queue[q].rd);
 		if (((*internals)->rx_queue[q].sockfd != 0) &&
 			((*internals)->rx_queue[q].sockfd != qsockfd))
@@ -817,6 +1050,9 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 	unsigned int framecount = DFLT_FRAME_COUNT;
 	unsigned int qpairs = 1;
 	unsigned int qdisc_bypass = 1;
+	unsigned int tpacket_v3 = 0;
+	unsigned int block_tmo = DFLT_BLOCK_TMO;
+	unsigned int rx_zero_copy = 0;
 
 	/* do some parameter checking */
 	if (*sockfd < 0)
@@ -878,6 +1114,37 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 			}
 			continue;
 		}
+		if (strstr(pair->key, ETH_AF_PACKET_TPACKET_V3_ARG) != NULL) {
+			tpacket_v3 = atoi(pair->value);
+			if (tpacket_v3 > 1) {
+				PMD_LOG(ERR,
+					"%s: invalid tpacket_v3 value",
+					name);
+				return -1;
+			}
+			continue;
+		}
+		if (strstr(pair->key, ETH_AF_PACKET_BLOCK_TMO_ARG) != NULL) {
+			block_tmo = atoi(pair->value);
+			continue;
+		}
+		if (strstr(pair->key, ETH_AF_PACKET_RX_ZERO_COPY_ARG) != NULL) {
+			rx_zero_copy = atoi(pair->value);
+			if (rx_zero_copy > 1) {
+				PMD_LOG(ERR,
+					"%s: invalid rx_zero_copy value",
+					name);
+				return -1;
+			}
+			continue;
+		}
+	}
+
+	if (rx_zero_copy && !tpacket_v3) {
+		PMD_LOG(ERR,
+			"%s: AF_PACKET Rx zero copy requires TPACKET_V3",
+			name);
+		return -1;
 	}
 
 	if (framesize > blocksize) {
@@ -899,16 +1166,24 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 	PMD_LOG(INFO, "%s:\tblock count %d", name, blockcount);
 	PMD_LOG(INFO, "%s:\tframe size %d", name, framesize);
 	PMD_LOG(INFO, "%s:\tframe count %d", name, framecount);
+	if (tpacket_v3) {
+		PMD_LOG(INFO, "%s:\tTPACKET_V3 block timeout %u ms", name,
+			block_tmo);
+		PMD_LOG(INFO, "%s:\tRx zero copy %s", name,
+			rx_zero_copy ? "on" : "off");
+	}
 
 	if (rte_pmd_init_internals(dev, *sockfd, qpairs,
 				   blocksize, blockcount,
 				   framesize, framecount,
 				   qdisc_bypass,
+				   tpacket_v3, block_tmo, rx_zero_copy,
 				   &internals, &eth_dev,
 				   kvlist) < 0)
 		return -1;
 
-	eth_dev->rx_pkt_burst = eth_af_packet_rx;
+	eth_dev->rx_pkt_burst = tpacket_v3 ? eth_af_packet_rx_v3 :
+		eth_af_packet_rx;
 	eth_dev->tx_pkt_burst = eth_af_packet_tx;
 
 	rte_eth_dev_probing_finish(eth_dev);
@@ -995,6 +1270,7 @@ rte_pmd_af_packet_remove(struct rte_vdev_device *dev)
 	internals = eth_dev->data->dev_private;
 	for (q = 0; q < internals->nb_queues; q++) {
 		rte_free(internals->rx_queue[q].rd);
+		rte_free(internals->rx_queue[q].shinfo);
 		rte_free(internals->tx_queue[q].rd);
 	}
 	free(internals->if_name);
@@ -1017,7 +1293,10 @@ RTE_PMD_REGISTER_PARAM_STRING(net_af_packet,
 	"blocksz=<int> "
 	"framesz=<int> "
 	"framecnt=<int> "
-	"qdisc_bypass=<0|1>");
+	"qdisc_bypass=<0|1> "
+	"tpacket_v3=<0|1> "
+	"block_tmo=<int> "
+	"rx_zero_copy=<0|1>");
 
 RTE_INIT(af_packet_init_log)
 {
@@ -32,8 +32,9 @@
 #include <rte_memory.h>
 #include <rte_memzone.h>
 #include <rte_mbuf.h>
+#include <rte_mbuf_pool_ops.h>
 #include <rte_malloc.h>
-#include <rte_ring.h>
+#include <rte_mempool.h>
 
 #ifndef SOL_XDP
 #define SOL_XDP 283
@@ -47,6 +48,10 @@
 #define PF_XDP AF_XDP
 #endif
 
+#ifndef XDP_PACKET_HEADROOM
+#define XDP_PACKET_HEADROOM 256
+#endif
+
 static int af_xdp_logtype;
 
 #define AF_XDP_LOG(level, fmt, args...)			\
@@ -55,21 +60,31 @@ static int af_xdp_logtype;
 
 #define ETH_AF_XDP_FRAME_SIZE		XSK_UMEM__DEFAULT_FRAME_SIZE
 #define ETH_AF_XDP_NUM_BUFFERS		4096
-#define ETH_AF_XDP_DATA_HEADROOM	0
+#define ETH_AF_XDP_MEMPOOL_CACHE	250
+/* keep one mempool object per UMEM frame */
+#define ETH_AF_XDP_MEMPOOL_FLAGS	MEMPOOL_F_NO_SPREAD
 #define ETH_AF_XDP_DFLT_NUM_DESCS	XSK_RING_CONS__DEFAULT_NUM_DESCS
-#define ETH_AF_XDP_DFLT_QUEUE_IDX	0
+#define ETH_AF_XDP_DFLT_START_QUEUE_IDX	0
+#define ETH_AF_XDP_DFLT_QUEUE_COUNT	1
 
 #define ETH_AF_XDP_RX_BATCH_SIZE	32
 #define ETH_AF_XDP_TX_BATCH_SIZE	32
 
 #define ETH_AF_XDP_MAX_QUEUE_PAIRS     16
 
+/*
+ * The UMEM memory is populated with the objects of an mbuf mempool, one
+ * per frame: the mempool object header, the mbuf, its headroom and the
+ * packet data. So the frames filled by the kernel are received as mbufs,
+ * and these mbufs can be sent back without copy.
+ */
 struct xsk_umem_info {
 	struct xsk_ring_prod fq;
 	struct xsk_ring_cons cq;
 	struct xsk_umem *umem;
-	struct rte_ring *buf_ring;
+	struct rte_mempool *mb_pool;
 	const struct rte_memzone *mz;
+	uint32_t mbuf_offset; /* offset of the mbuf in a frame */
 };
 
 struct rx_stats {
@@ -82,12 +97,12 @@ struct pkt_rx_queue {
 	struct xsk_ring_cons rx;
 	struct xsk_umem_info *umem;
 	struct xsk_socket *xsk;
-	struct rte_mempool *mb_pool;
 
 	struct rx_stats stats;
 
 	struct pkt_tx_queue *pair;
 	uint16_t queue_idx;
+	uint16_t xsk_queue_idx;
 };
 
 struct tx_stats {
@@ -108,10 +123,9 @@ struct pkt_tx_queue {
 struct pmd_internals {
 	int if_index;
 	char if_name[IFNAMSIZ];
-	uint16_t queue_idx;
+	uint16_t start_queue_idx;
+	uint16_t queue_cnt;
 	struct ether_addr eth_addr;
-	struct xsk_umem_info *umem;
-	struct rte_mempool *mb_pool_share;
 
 	struct pkt_rx_queue rx_queues[ETH_AF_XDP_MAX_QUEUE_PAIRS];
 	struct pkt_tx_queue tx_queues[ETH_AF_XDP_MAX_QUEUE_PAIRS];
@@ -119,10 +133,12 @@ struct pmd_internals {
 
 #define ETH_AF_XDP_IFACE_ARG			"iface"
 #define ETH_AF_XDP_QUEUE_IDX_ARG		"queue"
+#define ETH_AF_XDP_QUEUE_COUNT_ARG		"queue_count"
 
 static const char * const valid_arguments[] = {
 	ETH_AF_XDP_IFACE_ARG,
 	ETH_AF_XDP_QUEUE_IDX_ARG,
+	ETH_AF_XDP_QUEUE_COUNT_ARG,
 	NULL
 };
 
@@ -133,24 +149,40 @@ static const struct rte_eth_link pmd_link = {
 	.link_autoneg = ETH_LINK_AUTONEG
 };
 
+/* UMEM address of the frame holding an mbuf */
+static inline uint64_t
+umem_mbuf_to_addr(struct xsk_umem_info *umem, struct rte_mbuf *mbuf)
+{
+	return (uint64_t)((uintptr_t)mbuf - (uintptr_t)umem->mz->addr -
+			umem->mbuf_offset);
+}
+
+/* mbuf held by the frame of a UMEM address */
+static inline struct rte_mbuf *
+umem_addr_to_mbuf(struct xsk_umem_info *umem, uint64_t addr)
+{
+	addr &= ~((uint64_t)ETH_AF_XDP_FRAME_SIZE - 1);
+	return (struct rte_mbuf *)xsk_umem__get_data(umem->mz->addr,
+			addr + umem->mbuf_offset);
+}
+
 static inline int
 reserve_fill_queue(struct xsk_umem_info *umem, uint16_t reserve_size)
 {
 	struct xsk_ring_prod *fq = &umem->fq;
-	void *addrs[reserve_size];
+	struct rte_mbuf *mbufs[reserve_size];
 	uint32_t idx;
 	uint16_t i;
 
-	if (rte_ring_dequeue_bulk(umem->buf_ring, addrs, reserve_size, NULL)
-		    != reserve_size) {
+	if (rte_pktmbuf_alloc_bulk(umem->mb_pool, mbufs, reserve_size)) {
 		AF_XDP_LOG(DEBUG, "Failed to get enough buffers for fq.\n");
 		return -1;
 	}
 
 	if (unlikely(!xsk_ring_prod__reserve(fq, reserve_size, &idx))) {
 		AF_XDP_LOG(DEBUG, "Failed to reserve enough fq descs.\n");
-		rte_ring_enqueue_bulk(umem->buf_ring, addrs,
-				reserve_size, NULL);
+		rte_mempool_put_bulk(umem->mb_pool, (void **)mbufs,
+				reserve_size);
 		return -1;
 	}
 
@@ -158,7 +190,7 @@ reserve_fill_queue(struct xsk_umem_info *umem, uint16_t reserve_size)
 		__u64 *fq_addr;
 
 		fq_addr = xsk_ring_prod__fill_addr(fq, idx++);
-		*fq_addr = (uint64_t)addrs[i];
+		*fq_addr = umem_mbuf_to_addr(umem, mbufs[i]);
 	}
 
 	xsk_ring_prod__submit(fq, reserve_size);
@@ -175,25 +207,18 @@ eth_af_xdp_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	struct xsk_ring_prod *fq = &umem->fq;
 	uint32_t idx_rx = 0;
 	uint32_t free_thresh = fq->size >> 1;
-	struct rte_mbuf *mbufs[ETH_AF_XDP_RX_BATCH_SIZE];
-	unsigned long dropped = 0;
 	unsigned long rx_bytes = 0;
 	int rcvd, i;
 
 	nb_pkts = RTE_MIN(nb_pkts, ETH_AF_XDP_RX_BATCH_SIZE);
 
-	if (unlikely(rte_pktmbuf_alloc_bulk(rxq->mb_pool, mbufs, nb_pkts) != 0))
-		return 0;
-
 	rcvd = xsk_ring_cons__peek(rx, nb_pkts, &idx_rx);
 	if (rcvd == 0)
-		goto out;
-
-	if (xsk_prod_nb_free(fq, free_thresh) >= free_thresh)
-		(void)reserve_fill_queue(umem, ETH_AF_XDP_RX_BATCH_SIZE);
+		return 0;
 
 	for (i = 0; i < rcvd; i++) {
 		const struct xdp_desc *desc;
+		struct rte_mbuf *mbuf;
 		uint64_t addr;
 		uint32_t len;
 		void *pkt;
@@ -201,28 +226,27 @@ eth_af_xdp_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 		desc = xsk_ring_cons__rx_desc(rx, idx_rx++);
 		addr = desc->addr;
 		len = desc->len;
-		pkt = xsk_umem__get_data(rxq->umem->mz->addr, addr);
 
-		rte_memcpy(rte_pktmbuf_mtod(mbufs[i], void *), pkt, len);
-		rte_pktmbuf_pkt_len(mbufs[i]) = len;
-		rte_pktmbuf_data_len(mbufs[i]) = len;
+		/* the packet was written in the data room of the mbuf */
+		mbuf = umem_addr_to_mbuf(umem, addr);
+		pkt = xsk_umem__get_data(umem->mz->addr, addr);
+		mbuf->data_off = (uint16_t)((char *)pkt -
+				(char *)mbuf->buf_addr);
+		rte_pktmbuf_pkt_len(mbuf) = len;
+		rte_pktmbuf_data_len(mbuf) = len;
 		rx_bytes += len;
-		bufs[i] = mbufs[i];
-
-		rte_ring_enqueue(umem->buf_ring, (void *)addr);
+		bufs[i] = mbuf;
 	}
 
 	xsk_ring_cons__release(rx, rcvd);
 
+	if (xsk_prod_nb_free(fq, free_thresh) >= free_thresh)
+		(void)reserve_fill_queue(umem, ETH_AF_XDP_RX_BATCH_SIZE);
+
 	/* statistics */
-	rxq->stats.rx_pkts += (rcvd - dropped);
+	rxq->stats.rx_pkts += rcvd;
 	rxq->stats.rx_bytes += rx_bytes;
 
-out:
-	if (rcvd != nb_pkts)
-		rte_mempool_put_bulk(rxq->mb_pool, (void **)&mbufs[rcvd],
-				     nb_pkts - rcvd);
-
 	return rcvd;
 }
 
@@ -238,7 +262,7 @@ pull_umem_cq(struct xsk_umem_info *umem, int size)
 	for (i = 0; i < n; i++) {
 		uint64_t addr;
 		addr = *xsk_ring_cons__comp_addr(cq, idx_cq++);
-		rte_ring_enqueue(umem->buf_ring, (void *)addr);
+		rte_pktmbuf_free(umem_addr_to_mbuf(umem, addr));
 	}
 
 	xsk_ring_cons__release(cq, n);
@@ -262,60 +286,149 @@ kick_tx(struct pkt_tx_queue *txq)
 	pull_umem_cq(umem, ETH_AF_XDP_TX_BATCH_SIZE);
 }
 
+/* check if the packet is held by a single UMEM frame */
+static inline int
+umem_is_frame(struct xsk_umem_info *umem, struct rte_mbuf *mbuf)
+{
+	return mbuf->pool == umem->mb_pool && RTE_MBUF_DIRECT(mbuf) &&
+		mbuf->nb_segs == 1;
+}
+
+/*
+ * Get an mbuf of the UMEM holding the packet: the mbuf itself when it
+ * is one of the UMEM frames, or a copy of it. Return NULL when no mbuf
+ * is available, and the packet itself when it is too big for a frame.
+ */
+static inline struct rte_mbuf *
+umem_get_tx_mbuf(struct xsk_umem_info *umem, struct rte_mbuf *mbuf)
+{
+	struct rte_mbuf *local_mbuf;
+	void *data;
+
+	if (likely(umem_is_frame(umem, mbuf)))
+		return mbuf;
+
+	local_mbuf = rte_pktmbuf_alloc(umem->mb_pool);
+	if (unlikely(local_mbuf == NULL))
+		return NULL;
+
+	data = rte_pktmbuf_append(local_mbuf, mbuf->pkt_len);
+	if (unlikely(data == NULL)) {
+		rte_pktmbuf_free(local_mbuf);
+		return mbuf;
+	}
+
+	if (mbuf->nb_segs == 1)
+		rte_memcpy(data, rte_pktmbuf_mtod(mbuf, void *),
+			   mbuf->pkt_len);
+	else
+		rte_pktmbuf_read(mbuf, 0, mbuf->pkt_len, data);
+
+	return local_mbuf;
+}
+
 static uint16_t
 eth_af_xdp_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 {
 	struct pkt_tx_queue *txq = queue;
 	struct xsk_umem_info *umem = txq->pair->umem;
+	struct rte_mbuf *frames[ETH_AF_XDP_TX_BATCH_SIZE];
 	struct rte_mbuf *mbuf;
-	void *addrs[ETH_AF_XDP_TX_BATCH_SIZE];
 	unsigned long tx_bytes = 0;
-	int i;
+	uint16_t i, count;
 	uint32_t idx_tx;
 
 	nb_pkts = RTE_MIN(nb_pkts, ETH_AF_XDP_TX_BATCH_SIZE);
 
 	pull_umem_cq(umem, nb_pkts);
 
-	nb_pkts = rte_ring_dequeue_bulk(umem->buf_ring, addrs,
-					nb_pkts, NULL);
+	/* Find the UMEM frames to send, copying the other packets */
+	count = 0;
+	for (i = 0; i < nb_pkts; i++) {
+		frames[i] = umem_get_tx_mbuf(umem, bufs[i]);
+		if (frames[i] == NULL)
+			break;
+		if (unlikely(!umem_is_frame(umem, frames[i])))
+			continue;
+		count++;
+	}
+	nb_pkts = i;
 	if (nb_pkts == 0)
 		return 0;
 
-	if (xsk_ring_prod__reserve(&txq->tx, nb_pkts, &idx_tx) != nb_pkts) {
+	if (xsk_ring_prod__reserve(&txq->tx, count, &idx_tx) != count) {
 		kick_tx(txq);
-		rte_ring_enqueue_bulk(umem->buf_ring, addrs, nb_pkts, NULL);
+		for (i = 0; i < nb_pkts; i++)
+			if (frames[i] != bufs[i])
+				rte_pktmbuf_free(frames[i]);
 		return 0;
 	}
 
 	for (i = 0; i < nb_pkts; i++) {
 		struct xdp_desc *desc;
-		void *pkt;
 
-		desc = xsk_ring_prod__tx_desc(&txq->tx, idx_tx + i);
-		mbuf = bufs[i];
+		mbuf = frames[i];
+
+		/* drop the packets too big for a frame */
+		if (unlikely(!umem_is_frame(umem, mbuf))) {
+			txq->stats.err_pkts++;
+			rte_pktmbuf_free(mbuf);
+			continue;
+		}
 
-		desc->addr = (uint64_t)addrs[i];
+		desc = xsk_ring_prod__tx_desc(&txq->tx, idx_tx++);
+		desc->addr = (uint64_t)(rte_pktmbuf_mtod(mbuf, uintptr_t) -
+				(uintptr_t)umem->mz->addr);
 		desc->len = mbuf->pkt_len;
-		pkt = xsk_umem__get_data(umem->mz->addr,
-					 desc->addr);
-		rte_memcpy(pkt, rte_pktmbuf_mtod(mbuf, void *),
-			   desc->len);
 		tx_bytes += mbuf->pkt_len;
 
-		rte_pktmbuf_free(mbuf);
+		/* the frame is freed when its transmission completes */
+		if (mbuf != bufs[i])
+			rte_pktmbuf_free(bufs[i]);
 	}
 
-	xsk_ring_prod__submit(&txq->tx, nb_pkts);
+	xsk_ring_prod__submit(&txq->tx, count);
 
 	kick_tx(txq);
 
-	txq->stats.tx_pkts += nb_pkts;
+	txq->stats.tx_pkts += count;
 	txq->stats.tx_bytes += tx_bytes;
 
 	return nb_pkts;
 }
 
+/*
+ * Room before the packet data in a frame: mempool header, mbuf, headroom.
+ * The mbuf headroom is shortened if needed so that a full Ethernet frame
+ * still fits after the XDP headroom the kernel reserves in zero-copy mode,
+ * where it adds to the mbuf headroom.
+ */
+static uint32_t
+umem_frame_headroom(void)
+{
+	struct rte_mempool_objsz objsz;
+	int room;
+
+	rte_mempool_calc_obj_size(0, ETH_AF_XDP_MEMPOOL_FLAGS, &objsz);
+	room = ETH_AF_XDP_FRAME_SIZE - objsz.header_size -
+		objsz.trailer_size - sizeof(struct rte_mbuf) -
+		XDP_PACKET_HEADROOM - ETH_FRAME_LEN;
+	room = RTE_MAX(room, 0);
+	return objsz.header_size + sizeof(struct rte_mbuf) +
+		RTE_MIN(RTE_PKTMBUF_HEADROOM, room);
+}
+
+/* largest packet a frame can hold in both copy and zero-copy modes */
+static uint32_t
+umem_frame_data_room(void)
+{
+	struct rte_mempool_objsz objsz;
+
+	rte_mempool_calc_obj_size(0, ETH_AF_XDP_MEMPOOL_FLAGS, &objsz);
+	return ETH_AF_XDP_FRAME_SIZE - objsz.trailer_size -
+		umem_frame_headroom() - XDP_PACKET_HEADROOM;
+}
+
 static int
 eth_dev_start(struct rte_eth_dev *dev)
 {
@@ -349,11 +462,12 @@ eth_dev_info(struct rte_eth_dev *dev, struct rte_eth_dev_info *dev_info)
 	dev_info->if_index = internals->if_index;
 	dev_info->max_mac_addrs = 1;
 	dev_info->max_rx_pktlen = ETH_FRAME_LEN;
-	dev_info->max_rx_queues = 1;
-	dev_info->max_tx_queues = 1;
+	dev_info->max_rx_queues = internals->queue_cnt;
+	dev_info->max_tx_queues = internals->queue_cnt;
 
 	dev_info->min_mtu = ETHER_MIN_MTU;
-	dev_info->max_mtu = ETH_AF_XDP_FRAME_SIZE - ETH_AF_XDP_DATA_HEADROOM;
+	dev_info->max_mtu = RTE_MIN(umem_frame_data_room(),
+			dev_info->max_rx_pktlen) - ETHER_HDR_LEN;
 
 	dev_info->default_rxportconf.nb_queues = 1;
 	dev_info->default_txportconf.nb_queues = 1;
@@ -429,12 +543,12 @@ remove_xdp_program(struct pmd_internals *internals)
 static void
 xdp_umem_destroy(struct xsk_umem_info *umem)
 {
+	rte_mempool_free(umem->mb_pool);
+	umem->mb_pool = NULL;
+
 	rte_memzone_free(umem->mz);
 	umem->mz = NULL;
 
-	rte_ring_free(umem->buf_ring);
-	umem->buf_ring = NULL;
-
 	rte_free(umem);
 	umem = NULL;
 }
@@ -449,23 +563,22 @@ eth_dev_close(struct rte_eth_dev *dev)
 	AF_XDP_LOG(INFO, "Closing AF_XDP ethdev on numa socket %u\n",
 		rte_socket_id());
 
-	for (i = 0; i < ETH_AF_XDP_MAX_QUEUE_PAIRS; i++) {
+	for (i = 0; i < internals->queue_cnt; i++) {
 		rxq = &internals->rx_queues[i];
 		if (rxq->umem == NULL)
-			break;
+			continue;
 		xsk_socket__delete(rxq->xsk);
+		(void)xsk_umem__delete(rxq->umem->umem);
+		xdp_umem_destroy(rxq->umem);
+		rxq->umem = NULL;
 	}
 
-	(void)xsk_umem__delete(internals->umem->umem);
-
 	/*
 	 * MAC is not allocated dynamically, setting it to NULL would prevent
 	 * from releasing it in rte_eth_dev_release_port.
 	 */
 	dev->data->mac_addrs = NULL;
 
-	xdp_umem_destroy(internals->umem);
-
 	remove_xdp_program(internals);
 }
 
@@ -482,19 +595,23 @@ eth_link_update(struct rte_eth_dev *dev __rte_unused,
 }
 
 static struct
-xsk_umem_info *xdp_umem_configure(struct pmd_internals *internals)
+xsk_umem_info *xdp_umem_configure(struct pmd_internals *internals,
+				  struct pkt_rx_queue *rxq)
 {
 	struct xsk_umem_info *umem;
 	const struct rte_memzone *mz;
+	struct rte_pktmbuf_pool_private mbp_priv;
+	struct rte_mempool_objsz objsz;
+	struct rte_mempool *mp;
 	struct xsk_umem_config usr_config = {
 		.fill_size = ETH_AF_XDP_DFLT_NUM_DESCS,
 		.comp_size = ETH_AF_XDP_DFLT_NUM_DESCS,
 		.frame_size = ETH_AF_XDP_FRAME_SIZE,
-		.frame_headroom = ETH_AF_XDP_DATA_HEADROOM };
-	char ring_name[RTE_RING_NAMESIZE];
+		.frame_headroom = umem_frame_headroom() };
+	char pool_name[RTE_MEMPOOL_NAMESIZE];
 	char mz_name[RTE_MEMZONE_NAMESIZE];
+	uint32_t elt_size;
 	int ret;
-	uint64_t i;
 
 	umem = rte_zmalloc_socket("umem", sizeof(*umem), 0, rte_socket_id());
 	if (umem == NULL) {
@@ -502,32 +619,62 @@ xsk_umem_info *xdp_umem_configure(struct pmd_internals *internals)
 		return NULL;
 	}
 
-	snprintf(ring_name, sizeof(ring_name), "af_xdp_ring_%s_%u",
-		       internals->if_name, internals->queue_idx);
-	umem->buf_ring = rte_ring_create(ring_name,
-					 ETH_AF_XDP_NUM_BUFFERS,
-					 rte_socket_id(),
-					 0x0);
-	if (umem->buf_ring == NULL) {
-		AF_XDP_LOG(ERR, "Failed to create rte_ring\n");
+	/* Size the mempool objects to fill exactly one frame each */
+	rte_mempool_calc_obj_size(0, ETH_AF_XDP_MEMPOOL_FLAGS, &objsz);
+	elt_size = ETH_AF_XDP_FRAME_SIZE - objsz.header_size -
+		objsz.trailer_size;
+
+	snprintf(pool_name, sizeof(pool_name), "af_xdp_pool_%s_%u",
+		       internals->if_name, rxq->xsk_queue_idx);
+	mp = rte_mempool_create_empty(pool_name, ETH_AF_XDP_NUM_BUFFERS,
+			elt_size, ETH_AF_XDP_MEMPOOL_CACHE,
+			sizeof(struct rte_pktmbuf_pool_private),
+			rte_socket_id(), ETH_AF_XDP_MEMPOOL_FLAGS);
+	if (mp == NULL) {
+		AF_XDP_LOG(ERR, "Failed to create mempool\n");
+		goto err;
+	}
+	umem->mb_pool = mp;
+
+	if (mp->header_size + mp->elt_size + mp->trailer_size !=
+			ETH_AF_XDP_FRAME_SIZE) {
+		AF_XDP_LOG(ERR, "Mempool objects do not match umem frames\n");
+		goto err;
+	}
+
+	ret = rte_mempool_set_ops_byname(mp, rte_mbuf_best_mempool_ops(),
+			NULL);
+	if (ret != 0) {
+		AF_XDP_LOG(ERR, "Failed to set mempool ops\n");
 		goto err;
 	}
 
-	for (i = 0; i < ETH_AF_XDP_NUM_BUFFERS; i++)
-		rte_ring_enqueue(umem->buf_ring,
-				 (void *)(i * ETH_AF_XDP_FRAME_SIZE +
-					  ETH_AF_XDP_DATA_HEADROOM));
+	mbp_priv.mbuf_data_room_size = elt_size - sizeof(struct rte_mbuf);
+	mbp_priv.mbuf_priv_size = 0;
+	rte_pktmbuf_pool_init(mp, &mbp_priv);
 
 	snprintf(mz_name, sizeof(mz_name), "af_xdp_umem_%s_%u",
-		       internals->if_name, internals->queue_idx);
+		       internals->if_name, rxq->xsk_queue_idx);
 	mz = rte_memzone_reserve_aligned(mz_name,
 			ETH_AF_XDP_NUM_BUFFERS * ETH_AF_XDP_FRAME_SIZE,
 			rte_socket_id(), RTE_MEMZONE_IOVA_CONTIG,
-			getpagesize());
+			RTE_MAX(getpagesize(), ETH_AF_XDP_FRAME_SIZE));
 	if (mz == NULL) {
 		AF_XDP_LOG(ERR, "Failed to reserve memzone for af_xdp umem.\n");
 		goto err;
 	}
+	umem->mz = mz;
+
+	/* The objects are laid out contiguously, one per frame */
+	ret = rte_mempool_populate_iova(mp, mz->addr, mz->iova,
+			ETH_AF_XDP_NUM_BUFFERS * ETH_AF_XDP_FRAME_SIZE,
+			NULL, NULL);
+	if (ret != ETH_AF_XDP_NUM_BUFFERS) {
+		AF_XDP_LOG(ERR, "Failed to populate mempool\n");
+		goto err;
+	}
+	rte_mempool_obj_iter(mp, rte_pktmbuf_init, NULL);
+	umem->mbuf_offset = mp->header_size;
 
 	ret = xsk_umem__create(&umem->umem, mz->addr,
 			       ETH_AF_XDP_NUM_BUFFERS * ETH_AF_XDP_FRAME_SIZE,
@@ -538,7 +685,6 @@ xsk_umem_info *xdp_umem_configure(struct pmd_internals *internals)
 		AF_XDP_LOG(ERR, "Failed to create umem");
 		goto err;
 	}
-	umem->mz = mz;
 
 	return umem;
 
@@ -556,7 +702,7 @@ xsk_configure(struct pmd_internals *internals, struct pkt_rx_queue *rxq,
 	int ret = 0;
 	int reserve_size;
 
-	rxq->umem = xdp_umem_configure(internals);
+	rxq->umem = xdp_umem_configure(internals, rxq);
 	if (rxq->umem == NULL)
 		return -ENOMEM;
 
@@ -566,7 +712,7 @@ xsk_configure(struct pmd_internals *internals, struct pkt_rx_queue *rxq,
 	cfg.xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST;
 	cfg.bind_flags = 0;
 	ret = xsk_socket__create(&rxq->xsk, internals->if_name,
-			internals->queue_idx, rxq->umem->umem, &rxq->rx,
+			rxq->xsk_queue_idx, rxq->umem->umem, &rxq->rx,
 			&txq->tx, &cfg);
 	if (ret) {
 		AF_XDP_LOG(ERR, "Failed to create xsk socket.\n");
@@ -584,7 +730,9 @@ xsk_configure(struct pmd_internals *internals, struct pkt_rx_queue *rxq,
 	return 0;
 
 err:
+	(void)xsk_umem__delete(rxq->umem->umem);
 	xdp_umem_destroy(rxq->umem);
+	rxq->umem = NULL;
 
 	return ret;
 }
@@ -601,6 +749,7 @@ queue_reset(struct pmd_internals *internals, uint16_t queue_idx)
 	txq->pair = rxq;
 	rxq->queue_idx = queue_idx;
 	txq->queue_idx = queue_idx;
+	rxq->xsk_queue_idx = internals->start_queue_idx + queue_idx;
 }
 
 static int
@@ -609,38 +758,25 @@ eth_rx_queue_setup(struct rte_eth_dev *dev,
 		   uint16_t nb_rx_desc,
 		   unsigned int socket_id __rte_unused,
 		   const struct rte_eth_rxconf *rx_conf __rte_unused,
-		   struct rte_mempool *mb_pool)
+		   struct rte_mempool *mb_pool __rte_unused)
 {
 	struct pmd_internals *internals = dev->data->dev_private;
-	uint32_t buf_size, data_size;
 	struct pkt_rx_queue *rxq;
 	int ret;
 
 	rxq = &internals->rx_queues[rx_queue_id];
 	queue_reset(internals, rx_queue_id);
 
-	/* Now get the space available for data in the mbuf */
-	buf_size = rte_pktmbuf_data_room_size(mb_pool) -
-		RTE_PKTMBUF_HEADROOM;
-	data_size = ETH_AF_XDP_FRAME_SIZE - ETH_AF_XDP_DATA_HEADROOM;
-
-	if (data_size > buf_size) {
-		AF_XDP_LOG(ERR, "%s: %d bytes will not fit in mbuf (%d bytes)\n",
-			dev->device->name, data_size, buf_size);
-		ret = -ENOMEM;
-		goto err;
-	}
-
-	rxq->mb_pool = mb_pool;
-
+	/*
+	 * The packets are received in the mbufs of a mempool backing the
+	 * umem of the queue, rather than in mbufs of mb_pool.
+	 */
 	if (xsk_configure(internals, rxq, nb_rx_desc)) {
 		AF_XDP_LOG(ERR, "Failed to configure xdp socket\n");
 		ret = -EINVAL;
 		goto err;
 	}
 
-	internals->umem = rxq->umem;
-
 	dev->data->rx_queues[rx_queue_id] = rxq;
 	return 0;
 
@@ -777,7 +913,8 @@ parse_name_arg(const char *key __rte_unused,
 static int
 parse_parameters(struct rte_kvargs *kvlist,
 		 char *if_name,
-		 int *queue_idx)
+		 int *start_queue_idx,
+		 int *queue_cnt)
 {
 	int ret;
 
@@ -787,10 +924,22 @@ parse_parameters(struct rte_kvargs *kvlist,
 		goto free_kvlist;
 
 	ret = rte_kvargs_process(kvlist, ETH_AF_XDP_QUEUE_IDX_ARG,
-				 &parse_integer_arg, queue_idx);
+				 &parse_integer_arg, start_queue_idx);
 	if (ret < 0)
 		goto free_kvlist;
 
+	ret = rte_kvargs_process(kvlist, ETH_AF_XDP_QUEUE_COUNT_ARG,
+				 &parse_integer_arg, queue_cnt);
+	if (ret < 0)
+		goto free_kvlist;
+
+	if (*queue_cnt < 1 || *queue_cnt > ETH_AF_XDP_MAX_QUEUE_PAIRS) {
+		AF_XDP_LOG(ERR, "Queue count has to be between 1 and %d.\n",
+			   ETH_AF_XDP_MAX_QUEUE_PAIRS);
+		ret = -EINVAL;
+		goto free_kvlist;
+	}
+
 free_kvlist:
 	rte_kvargs_free(kvlist);
 	return ret;
@@ -829,7 +978,8 @@ get_iface_info(const char *if_name,
 static struct rte_eth_dev *
 init_internals(struct rte_vdev_device *dev,
 	       const char *if_name,
-	       int queue_idx)
+	       int start_queue_idx,
+	       int queue_cnt)
 {
 	const char *name = rte_vdev_device_name(dev);
 	const unsigned int numa_node = dev->device.numa_node;
@@ -842,7 +992,8 @@ init_internals(struct rte_vdev_device *dev,
 	if (internals == NULL)
 		return NULL;
 
-	internals->queue_idx = queue_idx;
+	internals->start_queue_idx = start_queue_idx;
+	internals->queue_cnt = queue_cnt;
 	strlcpy(internals->if_name, if_name, IFNAMSIZ);
 
 	for (i = 0; i < ETH_AF_XDP_MAX_QUEUE_PAIRS; i++) {
@@ -880,7 +1031,8 @@ rte_pmd_af_xdp_probe(struct rte_vdev_device *dev)
 {
 	struct rte_kvargs *kvlist;
 	char if_name[IFNAMSIZ] = {'\0'};
-	int xsk_queue_idx = ETH_AF_XDP_DFLT_QUEUE_IDX;
+	int xsk_start_queue_idx = ETH_AF_XDP_DFLT_START_QUEUE_IDX;
+	int xsk_queue_cnt = ETH_AF_XDP_DFLT_QUEUE_COUNT;
 	struct rte_eth_dev *eth_dev = NULL;
 	const char *name;
 
@@ -909,7 +1061,8 @@ rte_pmd_af_xdp_probe(struct rte_vdev_device *dev)
 	if (dev->device.numa_node == SOCKET_ID_ANY)
 		dev->device.numa_node = rte_socket_id();
 
-	if (parse_parameters(kvlist, if_name, &xsk_queue_idx) < 0) {
+	if (parse_parameters(kvlist, if_name, &xsk_start_queue_idx,
+			     &xsk_queue_cnt) < 0) {
 		AF_XDP_LOG(ERR, "Invalid kvargs value\n");
 		return -EINVAL;
 	}
@@ -919,7 +1072,8 @@ rte_pmd_af_xdp_probe(struct rte_vdev_device *dev)
 		return -EINVAL;
 	}
 
-	eth_dev = init_internals(dev, if_name, xsk_queue_idx);
+	eth_dev = init_internals(dev, if_name, xsk_start_queue_idx,
+				 xsk_queue_cnt);
 	if (eth_dev == NULL) {
 		AF_XDP_LOG(ERR, "Failed to init internals\n");
 		return -1;
@@ -961,7 +1115,8 @@ static struct rte_vdev_driver pmd_af_xdp_drv = {
 RTE_PMD_REGISTER_VDEV(net_af_xdp, pmd_af_xdp_drv);
 RTE_PMD_REGISTER_PARAM_STRING(net_af_xdp,
 			      "iface=<string> "
-			      "queue=<int> ");
+			      "queue=<int> "
+			      "queue_count=<int> ");
 
 RTE_INIT(af_xdp_init_log)
 {
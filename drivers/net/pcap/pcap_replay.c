@@ -0,0 +1,704 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_prefetch.h>
+#include <rte_thash.h>
+
+#include "pcap_replay.h"
+
+#define REPLAY_LOG(level, fmt, args...) \
+	rte_log(RTE_LOG_ ## level, eth_pcap_logtype, \
+		"%s(): " fmt "\n", __func__, ##args)
+
+/* pcap file format */
+#define PCAP_MAGIC_USEC		0xa1b2c3d4
+#define PCAP_MAGIC_NSEC		0xa1b23c4d
+#define PCAP_FILE_HDR_LEN	24
+#define PCAP_PKT_HDR_LEN	16
+
+/* pcapng file format */
+#define PCAPNG_SHB_TYPE		0x0A0D0D0A
+#define PCAPNG_IDB_TYPE		0x00000001
+#define PCAPNG_SPB_TYPE		0x00000003
+#define PCAPNG_EPB_TYPE		0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+#define PCAPNG_BLOCK_MIN_LEN	12
+#define PCAPNG_OPT_END		0
+#define PCAPNG_IF_TSRESOL	9
+#define PCAPNG_TSRESOL_DEFAULT	6
+#define PCAPNG_MAX_IFACES	64
+
+#define REPLAY_LINKTYPE_ETHERNET 1
+
+#define REPLAY_PREFETCH_OFFSET	4
+
+#define NSEC_PER_SEC		1000000000ULL
+
+extern int eth_pcap_logtype;
+
+/* default RSS key of most NICs */
+static const uint8_t replay_rss_key[40] = {
+	0x6D, 0x5A, 0x56, 0xDA, 0x25, 0x5B, 0x0E, 0xC2,
+	0x41, 0x67, 0x25, 0x3D, 0x43, 0xA3, 0x8F, 0xB0,
+	0xD0, 0xCA, 0x2B, 0xCB, 0xAE, 0x7B, 0x30, 0xB4,
+	0x77, 0xCB, 0x2D, 0xA3, 0x80, 0x30, 0xF2, 0x0C,
+	0x6A, 0x42, 0xB7, 0x3B, 0xBE, 0xAC, 0x01, 0xFA,
+};
+
+/* packet record found in the capture */
+struct replay_pkt {
+	const uint8_t *data;
+	uint32_t len;
+	uint64_t ts; /* nanoseconds */
+};
+
+typedef void (*replay_pkt_cb)(const struct replay_pkt *pkt, void *arg);
+
+struct replay_iface {
+	uint32_t snaplen;
+	uint8_t tsresol;
+	uint8_t ethernet;
+};
+
+/* state of the two passes over the capture */
+struct replay_load {
+	struct pcap_replay *rp;
+	uint64_t hz;
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint64_t nb_pkts;
+	uint32_t max_len;
+	uint32_t count[PCAP_REPLAY_MAX_QUEUES];
+	int fill;
+};
+
+static inline uint16_t
+replay_read16(const uint8_t *p, int swap)
+{
+	uint16_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return swap ? rte_bswap16(v) : v;
+}
+
+static inline uint32_t
+replay_read32(const uint8_t *p, int swap)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return swap ? rte_bswap32(v) : v;
+}
+
+static int64_t
+replay_parse_pcap(const uint8_t *buf, size_t size, replay_pkt_cb cb,
+		void *arg)
+{
+	struct replay_pkt pkt;
+	uint32_t magic, caplen;
+	uint64_t frac_mult;
+	int64_t nb_pkts;
+	size_t off;
+	int swap;
+
+	magic = replay_read32(buf, 0);
+	swap = (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC);
+	if (swap)
+		magic = rte_bswap32(magic);
+	frac_mult = (magic == PCAP_MAGIC_NSEC) ? 1 : 1000;
+
+	if ((replay_read32(buf + 20, swap) & 0xffff) !=
+			REPLAY_LINKTYPE_ETHERNET)
+		return -ENOTSUP;
+
+	nb_pkts = 0;
+	for (off = PCAP_FILE_HDR_LEN; size - off >= PCAP_PKT_HDR_LEN;
+			off += PCAP_PKT_HDR_LEN + caplen) {
+		caplen = replay_read32(buf + off + 8, swap);
+		if (caplen > size - off - PCAP_PKT_HDR_LEN)
+			break; /* truncated capture */
+
+		pkt.ts = replay_read32(buf + off, swap) * NSEC_PER_SEC +
+			replay_read32(buf + off + 4, swap) * frac_mult;
+		pkt.data = buf + off + PCAP_PKT_HDR_LEN;
+		pkt.len = caplen;
+		cb(&pkt, arg);
+		nb_pkts++;
+	}
+
+	return nb_pkts;
+}
+
+/* convert pcapng timestamp units to nanoseconds */
+static uint64_t
+replay_pcapng_ns(uint64_t ts, uint8_t tsresol)
+{
+	uint32_t exp = tsresol & 0x7f;
+	uint64_t pow10 = 1;
+
+	if (tsresol & 0x80) {
+		/* negative power of 2 */
+		if (exp > 32) {
+			if (exp >= 64)
+				return 0;
+			ts >>= exp - 32;
+			exp = 32;
+		}
+		return (ts >> exp) * NSEC_PER_SEC +
+			(((ts & ((1ULL << exp) - 1)) * NSEC_PER_SEC) >> exp);
+	}
+
+	/* negative power of 10 */
+	if (exp <= 9) {
+		while (exp++ < 9)
+			pow10 *= 10;
+		return ts * pow10;
+	}
+	if (exp > 19)
+		return 0;
+	while (exp-- > 9)
+		pow10 *= 10;
+	return ts / pow10;
+}
+
+static void
+replay_pcapng_idb(const uint8_t *body, uint32_t len, int swap,
+		struct replay_iface *iface)
+{
+	uint16_t code, optlen;
+	uint32_t off;
+
+	iface->ethernet = (replay_read16(body, swap) ==
+			REPLAY_LINKTYPE_ETHERNET);
+	iface->snaplen = replay_read32(body + 4, swap);
+	iface->tsresol = PCAPNG_TSRESOL_DEFAULT;
+
+	for (off = 8; len - off >= 4; off += 4 + RTE_ALIGN(optlen, 4)) {
+		code = replay_read16(body + off, swap);
+		optlen = replay_read16(body + off + 2, swap);
+		if (code == PCAPNG_OPT_END || optlen > len - off - 4)
+			break;
+		if (code == PCAPNG_IF_TSRESOL && optlen >= 1)
+			iface->tsresol = body[off + 4];
+	}
+}
+
+static int64_t
+replay_parse_pcapng(const uint8_t *buf, size_t size, replay_pkt_cb cb,
+		void *arg)
+{
+	struct replay_iface iface[PCAPNG_MAX_IFACES];
+	uint32_t type, blen, len, id, nb_ifaces;
+	struct replay_pkt pkt;
+	const uint8_t *body;
+	int64_t nb_pkts;
+	uint64_t ts;
+	size_t off;
+	int swap;
+
+	nb_pkts = 0;
+	nb_ifaces = 0;
+	swap = 0;
+	pkt.ts = 0;
+
+	for (off = 0; size - off >= PCAPNG_BLOCK_MIN_LEN; off += blen) {
+		type = replay_read32(buf + off, swap);
+
+		/* byte order may change with each section */
+		if (type == PCAPNG_SHB_TYPE) {
+			if (replay_read32(buf + off + 8, 0) ==
+					PCAPNG_BYTE_ORDER_MAGIC)
+				swap = 0;
+			else if (replay_read32(buf + off + 8, 1) ==
+					PCAPNG_BYTE_ORDER_MAGIC)
+				swap = 1;
+			else
+				return -EINVAL;
+			nb_ifaces = 0;
+		} else if (off == 0)
+			return -EINVAL;
+
+		blen = replay_read32(buf + off + 4, swap);
+		if (blen < PCAPNG_BLOCK_MIN_LEN || blen % 4 != 0 ||
+				blen > size - off)
+			break; /* truncated or corrupted capture */
+
+		body = buf + off + 8;
+		len = blen - PCAPNG_BLOCK_MIN_LEN;
+
+		switch (type) {
+		case PCAPNG_IDB_TYPE:
+			if (len < 8)
+				break;
+			if (nb_ifaces == RTE_DIM(iface))
+				return -ENOTSUP;
+			replay_pcapng_idb(body, len, swap, &iface[nb_ifaces++]);
+			break;
+		case PCAPNG_EPB_TYPE:
+			if (len < 20)
+				break;
+			id = replay_read32(body, swap);
+			if (id >= nb_ifaces || !iface[id].ethernet)
+				break;
+			pkt.len = replay_read32(body + 12, swap);
+			if (pkt.len > len - 20)
+				break;
+			ts = (uint64_t)replay_read32(body + 4, swap) << 32 |
+				replay_read32(body + 8, swap);
+			pkt.ts = replay_pcapng_ns(ts, iface[id].tsresol);
+			pkt.data = body + 20;
+			cb(&pkt, arg);
+			nb_pkts++;
+			break;
+		case PCAPNG_SPB_TYPE:
+			/* no timestamp, keep the one of the previous packet */
+			if (len < 4 || nb_ifaces == 0 || !iface[0].ethernet)
+				break;
+			pkt.len = RTE_MIN(replay_read32(body, swap), len - 4);
+			if (iface[0].snaplen != 0)
+				pkt.len = RTE_MIN(pkt.len, iface[0].snaplen);
+			pkt.data = body + 4;
+			cb(&pkt, arg);
+			nb_pkts++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return nb_pkts;
+}
+
+/* Toeplitz hash of the IP addresses and TCP/UDP ports, as done by NICs */
+static int
+replay_rss(const uint8_t *data, uint32_t len, uint32_t *rss)
+{
+	const struct ether_hdr *eth = (const struct ether_hdr *)data;
+	union rte_thash_tuple tuple;
+	const uint16_t *ports;
+	uint32_t off, l4_off, tuple_len;
+	uint16_t ether_type;
+	uint8_t proto;
+
+	off = sizeof(*eth);
+	if (len < off)
+		return 0;
+	ether_type = eth->ether_type;
+	if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_VLAN)) {
+		if (len < off + sizeof(struct vlan_hdr))
+			return 0;
+		ether_type = ((const struct vlan_hdr *)(data + off))->eth_proto;
+		off += sizeof(struct vlan_hdr);
+	}
+
+	if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv4)) {
+		const struct ipv4_hdr *ip;
+
+		if (len < off + sizeof(*ip))
+			return 0;
+		ip = (const struct ipv4_hdr *)(data + off);
+		tuple.v4.src_addr = rte_be_to_cpu_32(ip->src_addr);
+		tuple.v4.dst_addr = rte_be_to_cpu_32(ip->dst_addr);
+		tuple_len = RTE_THASH_V4_L3_LEN;
+		l4_off = off + (ip->version_ihl & IPV4_HDR_IHL_MASK) *
+			IPV4_IHL_MULTIPLIER;
+		proto = ip->next_proto_id;
+		/* fragments are only hashed on addresses */
+		if (ip->fragment_offset & rte_cpu_to_be_16(IPV4_HDR_MF_FLAG |
+				IPV4_HDR_OFFSET_MASK))
+			proto = 0;
+	} else if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_IPv6)) {
+		const struct ipv6_hdr *ip;
+
+		if (len < off + sizeof(*ip))
+			return 0;
+		ip = (const struct ipv6_hdr *)(data + off);
+		rte_thash_load_v6_addrs(ip, &tuple);
+		tuple_len = RTE_THASH_V6_L3_LEN;
+		l4_off = off + sizeof(*ip);
+		proto = ip->proto;
+	} else
+		return 0;
+
+	if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) &&
+			len >= l4_off + 2 * sizeof(uint16_t)) {
+		ports = (const uint16_t *)(data + l4_off);
+		if (tuple_len == RTE_THASH_V4_L3_LEN) {
+			tuple.v4.sport = rte_be_to_cpu_16(ports[0]);
+			tuple.v4.dport = rte_be_to_cpu_16(ports[1]);
+			tuple_len = RTE_THASH_V4_L4_LEN;
+		} else {
+			tuple.v6.sport = rte_be_to_cpu_16(ports[0]);
+			tuple.v6.dport = rte_be_to_cpu_16(ports[1]);
+			tuple_len = RTE_THASH_V6_L4_LEN;
+		}
+	}
+
+	*rss = rte_softrss((uint32_t *)&tuple, tuple_len, replay_rss_key);
+	return 1;
+}
+
+static uint64_t
+replay_ns_to_tsc(uint64_t ns, uint64_t hz)
+{
+	return ns / NSEC_PER_SEC * hz + ns % NSEC_PER_SEC * hz / NSEC_PER_SEC;
+}
+
+/*
+ * First pass counts the packets of each queue,
+ * second pass copies them into the preloaded mbufs.
+ */
+static void
+replay_load_pkt(const struct replay_pkt *pkt, void *arg)
+{
+	struct replay_load *ld = arg;
+	struct pcap_replay_queue *rq;
+	struct pcap_replay_slot *slot;
+	struct rte_mbuf *m;
+	uint32_t rss, len;
+	uint16_t qid;
+	int hashed;
+
+	if (ld->nb_pkts++ == 0)
+		ld->first_ts = pkt->ts;
+	ld->last_ts = RTE_MAX(ld->last_ts, pkt->ts);
+
+	rss = 0;
+	hashed = replay_rss(pkt->data, pkt->len, &rss);
+	qid = hashed ? rss % ld->rp->nb_queues : 0;
+
+	if (!ld->fill) {
+		ld->count[qid]++;
+		ld->max_len = RTE_MAX(ld->max_len, pkt->len);
+		return;
+	}
+
+	rq = &ld->rp->queue[qid];
+	if (rq->nb_slots == ld->count[qid])
+		return;
+
+	m = rte_pktmbuf_alloc(rq->pool);
+	if (m == NULL)
+		return;
+	len = RTE_MIN(pkt->len, (uint32_t)rte_pktmbuf_tailroom(m));
+	rte_memcpy(rte_pktmbuf_mtod(m, void *), pkt->data, len);
+
+	slot = &rq->slots[rq->nb_slots];
+	slot->mbuf = m;
+	slot->tsc = replay_ns_to_tsc(pkt->ts > ld->first_ts ?
+			pkt->ts - ld->first_ts : 0, ld->hz);
+	/* pacing needs the timestamps of a queue to be monotonic */
+	if (rq->nb_slots != 0)
+		slot->tsc = RTE_MAX(slot->tsc, slot[-1].tsc);
+	slot->rss = rss;
+	slot->len = len;
+	slot->hashed = hashed;
+	rq->nb_slots++;
+}
+
+static int64_t
+replay_parse(const char *path, replay_pkt_cb cb, void *arg)
+{
+	const uint8_t *buf;
+	struct stat st;
+	int64_t ret;
+	void *addr;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) < 0) {
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+	if ((size_t)st.st_size < PCAP_FILE_HDR_LEN) {
+		close(fd);
+		return -EINVAL;
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return -errno;
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+	buf = addr;
+	if (replay_read32(buf, 0) == PCAPNG_SHB_TYPE)
+		ret = replay_parse_pcapng(buf, st.st_size, cb, arg);
+	else if (replay_read32(buf, 0) == PCAP_MAGIC_USEC ||
+			replay_read32(buf, 0) == PCAP_MAGIC_NSEC ||
+			replay_read32(buf, 1) == PCAP_MAGIC_USEC ||
+			replay_read32(buf, 1) == PCAP_MAGIC_NSEC)
+		ret = replay_parse_pcap(buf, st.st_size, cb, arg);
+	else
+		ret = -EINVAL;
+
+	munmap(addr, st.st_size);
+	return ret;
+}
+
+static void
+replay_queue_init(struct pcap_replay_queue *rq, uint16_t port_id)
+{
+	struct rte_mbuf mb_def = { .buf_addr = 0 }; /* zeroed mbuf */
+	uintptr_t p;
+
+	/* one reference is kept by the queue, the other is lent */
+	mb_def.nb_segs = 1;
+	mb_def.data_off = RTE_PKTMBUF_HEADROOM;
+	mb_def.port = port_id;
+	rte_mbuf_refcnt_set(&mb_def, 2);
+
+	/* prevent compiler reordering: rearm_data covers previous fields */
+	rte_compiler_barrier();
+	p = (uintptr_t)&mb_def.rearm_data;
+	rq->rearm_data = *(uint64_t *)p;
+}
+
+/*
+ * Append copies 1 to nb_copies - 1 of the packets preloaded in the first
+ * nb_pass_slots slots, each in its own mbuf and delayed by one more pass.
+ */
+static int
+replay_queue_copy(struct pcap_replay_queue *rq, uint32_t nb_copies,
+		uint64_t period)
+{
+	const struct pcap_replay_slot *src;
+	struct pcap_replay_slot *slot;
+	struct rte_mbuf *m;
+	uint32_t c, j;
+
+	for (c = 1; c != nb_copies; c++) {
+		for (j = 0; j != rq->nb_pass_slots; j++) {
+			src = &rq->slots[j];
+			m = rte_pktmbuf_alloc(rq->pool);
+			if (m == NULL)
+				return -ENOMEM;
+			rte_memcpy(rte_pktmbuf_mtod(m, void *),
+				rte_pktmbuf_mtod(src->mbuf, void *), src->len);
+
+			slot = &rq->slots[rq->nb_slots];
+			*slot = *src;
+			slot->mbuf = m;
+			slot->tsc += c * period;
+			rq->nb_slots++;
+		}
+	}
+
+	return 0;
+}
+
+struct pcap_replay *
+pcap_replay_create(const char *path, uint16_t port_id, uint16_t nb_queues,
+		uint64_t nb_loops, uint32_t nb_copies, int pace, int socket_id)
+{
+	char name[RTE_MEMPOOL_NAMESIZE];
+	struct pcap_replay_queue *rq;
+	struct replay_load ld;
+	uint64_t period, nb_mbufs;
+	uint32_t room;
+	int64_t ret;
+	uint16_t i;
+
+	if (nb_queues == 0 || nb_queues > PCAP_REPLAY_MAX_QUEUES ||
+			nb_copies == 0)
+		return NULL;
+
+	memset(&ld, 0, sizeof(ld));
+	ld.hz = rte_get_timer_hz();
+	ld.rp = rte_zmalloc_socket(NULL, sizeof(*ld.rp), RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (ld.rp == NULL)
+		return NULL;
+	ld.rp->nb_queues = nb_queues;
+
+	ret = replay_parse(path, replay_load_pkt, &ld);
+	if (ret <= 0) {
+		REPLAY_LOG(ERR, "Couldn't load %s: %s", path,
+			ret == 0 ? "no Ethernet packet" : strerror(-ret));
+		goto error;
+	}
+
+	/* mbuf data room is limited to 16 bits */
+	room = RTE_MIN(ld.max_len + RTE_PKTMBUF_HEADROOM,
+			(uint32_t)UINT16_MAX);
+	if (ld.max_len + RTE_PKTMBUF_HEADROOM > room)
+		REPLAY_LOG(NOTICE, "Packets of %s truncated to %u bytes",
+			path, room - RTE_PKTMBUF_HEADROOM);
+
+	for (i = 0; i != nb_queues; i++) {
+		rq = &ld.rp->queue[i];
+		replay_queue_init(rq, port_id);
+		rq->nb_loops = nb_loops;
+		rq->pace = pace;
+		if (ld.count[i] == 0)
+			continue;
+
+		nb_mbufs = (uint64_t)ld.count[i] * nb_copies;
+		if (nb_mbufs > UINT32_MAX) {
+			REPLAY_LOG(ERR, "Too many copies of queue %u", i);
+			goto error;
+		}
+		rq->slots = rte_zmalloc_socket(NULL,
+				nb_mbufs * sizeof(rq->slots[0]),
+				RTE_CACHE_LINE_SIZE, socket_id);
+		snprintf(name, sizeof(name), "pcap_replay_%u_%u", port_id, i);
+		rq->pool = rte_pktmbuf_pool_create(name, nb_mbufs, 0, 0,
+				room, socket_id);
+		if (rq->slots == NULL || rq->pool == NULL) {
+			REPLAY_LOG(ERR, "Couldn't allocate %" PRIu64
+				" mbufs for queue %u", nb_mbufs, i);
+			goto error;
+		}
+	}
+
+	ld.fill = 1;
+	ld.nb_pkts = 0;
+	ld.last_ts = 0;
+	replay_parse(path, replay_load_pkt, &ld);
+
+	/* pass duration includes the mean gap before the first packet again */
+	period = ld.last_ts - ld.first_ts;
+	if (ld.nb_pkts > 1)
+		period += period / (ld.nb_pkts - 1);
+	period = replay_ns_to_tsc(period, ld.hz);
+
+	for (i = 0; i != nb_queues; i++) {
+		rq = &ld.rp->queue[i];
+		rq->period_tsc = period * nb_copies;
+		if (rq->nb_slots != ld.count[i]) {
+			REPLAY_LOG(ERR, "%s changed while loading", path);
+			goto error;
+		}
+		rq->nb_pass_slots = rq->nb_slots;
+		if (replay_queue_copy(rq, nb_copies, period) != 0) {
+			REPLAY_LOG(ERR, "Couldn't copy the packets of queue %u",
+				i);
+			goto error;
+		}
+		REPLAY_LOG(INFO, "Queue %u preloaded with %u packets",
+			i, rq->nb_slots);
+	}
+
+	return ld.rp;
+
+error:
+	pcap_replay_free(ld.rp);
+	return NULL;
+}
+
+void
+pcap_replay_free(struct pcap_replay *rp)
+{
+	struct pcap_replay_queue *rq;
+	uint32_t i, j;
+
+	if (rp == NULL)
+		return;
+
+	for (i = 0; i != rp->nb_queues; i++) {
+		rq = &rp->queue[i];
+		for (j = 0; j != rq->nb_slots; j++)
+			rte_pktmbuf_free(rq->slots[j].mbuf);
+		rte_mempool_free(rq->pool);
+		rte_free(rq->slots);
+	}
+	rte_free(rp);
+}
+
+void
+pcap_replay_start(struct pcap_replay *rp, uint64_t now)
+{
+	struct pcap_replay_queue *rq;
+	uint16_t i;
+
+	for (i = 0; i != rp->nb_queues; i++) {
+		rq = &rp->queue[i];
+		rq->next = 0;
+		rq->pass_end = rq->nb_pass_slots;
+		rq->loop = 0;
+		rq->base_tsc = now;
+	}
+}
+
+uint16_t
+pcap_replay_rx(struct pcap_replay_queue *rq, struct rte_mbuf **bufs,
+		uint16_t nb_pkts, uint64_t *bytes)
+{
+	const struct pcap_replay_slot *slot;
+	struct rte_mbuf *m;
+	uint64_t now, len;
+	uint32_t next;
+	uint16_t i;
+
+	if (unlikely(rq->nb_slots == 0))
+		return 0;
+
+	now = rq->pace ? rte_get_timer_cycles() : 0;
+	next = rq->next;
+	len = 0;
+
+	for (i = 0; i != nb_pkts; i++) {
+		if (unlikely(next == rq->pass_end)) {
+			if (rq->nb_loops != 0 && rq->loop + 1 >= rq->nb_loops)
+				break;
+			rq->loop++;
+			/* the slots hold several passes when copies are made */
+			if (next == rq->nb_slots) {
+				rq->base_tsc += rq->period_tsc;
+				next = 0;
+			}
+			rq->pass_end = next + rq->nb_pass_slots;
+		}
+
+		slot = &rq->slots[next];
+		if (rq->pace && rq->base_tsc + slot->tsc > now)
+			break;
+
+		m = slot->mbuf;
+		/* previous pass of this packet is still in flight */
+		if (unlikely(rte_mbuf_refcnt_read(m) != 1))
+			break;
+
+		if (next + REPLAY_PREFETCH_OFFSET < rq->nb_slots)
+			rte_prefetch0(slot[REPLAY_PREFETCH_OFFSET].mbuf);
+
+		*(uint64_t *)&m->rearm_data = rq->rearm_data;
+		m->ol_flags = slot->hashed ? PKT_RX_RSS_HASH : 0;
+		m->packet_type = 0;
+		m->pkt_len = slot->len;
+		m->data_len = slot->len;
+		m->vlan_tci = 0;
+		m->hash.rss = slot->rss;
+
+		bufs[i] = m;
+		len += slot->len;
+		next++;
+	}
+
+	rq->next = next;
+	*bytes += len;
+
+	return i;
+}
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef _PCAP_REPLAY_H_
+#define _PCAP_REPLAY_H_
+
+/**
+ * @file
+ * Offline replay of a capture file for the pcap PMD.
+ *
+ * The capture (pcap or pcapng) is mapped in memory and parsed without
+ * libpcap. Every packet is copied once into an mbuf of a per queue pool
+ * and the packets are spread over the queues by a Toeplitz hash of their
+ * IP 5-tuple, like RSS would do on a NIC. The RX path then hands out the
+ * preloaded mbufs, holding an extra reference on them, so that replaying
+ * does not copy packet data nor allocate any mbuf.
+ */
+
+#include <stdint.h>
+
+#include <rte_common.h>
+#include <rte_mbuf.h>
+
+#define PCAP_REPLAY_MAX_QUEUES 16
+
+/** Preloaded packet and the metadata restored on each pass. */
+struct pcap_replay_slot {
+	struct rte_mbuf *mbuf;
+	uint64_t tsc;      /**< offset from the capture start, in cycles */
+	uint32_t rss;      /**< Toeplitz hash of the packet */
+	uint16_t len;      /**< packet length */
+	uint16_t hashed;   /**< non zero if rss is valid */
+};
+
+struct pcap_replay_queue {
+	struct pcap_replay_slot *slots;
+	struct rte_mempool *pool;
+	uint32_t nb_slots;
+	uint32_t nb_pass_slots; /**< slots of one pass over the capture */
+	uint32_t next;       /**< next slot to deliver */
+	uint32_t pass_end;   /**< slot following the current pass */
+	uint64_t nb_loops;   /**< passes to replay, 0 for endless replay */
+	uint64_t loop;       /**< current pass */
+	uint64_t base_tsc;   /**< cycles at the start of the slots */
+	uint64_t period_tsc; /**< duration of all the slots, in cycles */
+	uint64_t rearm_data; /**< mbuf rearm_data template */
+	int pace;            /**< follow the capture timestamps */
+} __rte_cache_aligned;
+
+struct pcap_replay {
+	uint16_t nb_queues;
+	struct pcap_replay_queue queue[PCAP_REPLAY_MAX_QUEUES];
+};
+
+/**
+ * Load a capture file and preload its packets into per queue mbufs.
+ *
+ * @param path
+ *   Path of a pcap or pcapng file with Ethernet link type.
+ * @param port_id
+ *   Port the mbufs are delivered on.
+ * @param nb_queues
+ *   Number of queues to spread the packets over.
+ * @param nb_loops
+ *   Number of passes over the capture, 0 to replay it endlessly.
+ * @param nb_copies
+ *   Number of copies of the capture preloaded in distinct mbufs, so that a
+ *   packet can be received again while the previous copies are in flight.
+ * @param pace
+ *   If non zero, deliver packets according to their capture timestamps
+ *   instead of as fast as possible.
+ * @param socket_id
+ *   Socket to allocate memory from.
+ * @return
+ *   Replay context on success, NULL otherwise.
+ */
+struct pcap_replay *
+pcap_replay_create(const char *path, uint16_t port_id, uint16_t nb_queues,
+		uint64_t nb_loops, uint32_t nb_copies, int pace, int socket_id);
+
+/** Release the mbufs and memory of a replay context. */
+void
+pcap_replay_free(struct pcap_replay *rp);
+
+/** Rewind all the queues, the first pass starts at cycles @p now. */
+void
+pcap_replay_start(struct pcap_replay *rp, uint64_t now);
+
+/**
+ * Receive burst of preloaded packets.
+ *
+ * The packets are only lent to the caller: they must be treated as read
+ * only, as any change would be replayed by the following passes, and freed
+ * as usual. A slot is not delivered again while its mbuf is still in use,
+ * so a burst may be short when the application holds more packets than a
+ * queue owns.
+ *
+ * @return
+ *   Number of packets stored in @p bufs, their total length is added to
+ *   @p bytes.
+ */
+uint16_t
+pcap_replay_rx(struct pcap_replay_queue *rq, struct rte_mbuf **bufs,
+		uint16_t nb_pkts, uint64_t *bytes);
+
+#endif /* _PCAP_REPLAY_H_ */
@@ -4,6 +4,8 @@
  * All rights reserved.
  */
 
+#include <errno.h>
+#include <stdlib.h>
 #include <time.h>
 
 #include <net/if.h>
@@ -27,6 +29,8 @@
 #include <rte_bus_vdev.h>
 #include <rte_string_fns.h>
 
+#include "pcap_replay.h"
+
 #define RTE_ETH_PCAP_SNAPSHOT_LEN 65535
 #define RTE_ETH_PCAP_SNAPLEN ETHER_MAX_JUMBO_FRAME_LEN
 #define RTE_ETH_PCAP_PROMISC 1
@@ -39,10 +43,19 @@
 #define ETH_PCAP_TX_IFACE_ARG "tx_iface"
 #define ETH_PCAP_IFACE_ARG    "iface"
 #define ETH_PCAP_PHY_MAC_ARG  "phy_mac"
+#define ETH_PCAP_REPLAY_ARG   "replay_pcap"
+#define ETH_PCAP_REPLAY_QUEUES_ARG "replay_queues"
+#define ETH_PCAP_REPLAY_LOOP_ARG "replay_loop"
+#define ETH_PCAP_REPLAY_PACE_ARG "replay_pace"
+#define ETH_PCAP_REPLAY_COPIES_ARG "replay_copies"
 
 #define ETH_PCAP_ARG_MAXLEN	64
 
-#define RTE_PMD_PCAP_MAX_QUEUES 16
+#define RTE_PMD_PCAP_MAX_QUEUES PCAP_REPLAY_MAX_QUEUES
+
+#define ETH_PCAP_REPLAY_RSS_OFFLOADS (ETH_RSS_IPV4 | ETH_RSS_FRAG_IPV4 | \
+	ETH_RSS_NONFRAG_IPV4_TCP | ETH_RSS_NONFRAG_IPV4_UDP | ETH_RSS_IPV6 | \
+	ETH_RSS_NONFRAG_IPV6_TCP | ETH_RSS_NONFRAG_IPV6_UDP)
 
 static char errbuf[PCAP_ERRBUF_SIZE];
 static unsigned char tx_pcap_data[RTE_ETH_PCAP_SNAPLEN];
@@ -61,6 +74,7 @@ struct pcap_rx_queue {
 	uint16_t port_id;
 	uint16_t queue_id;
 	struct rte_mempool *mb_pool;
+	struct pcap_replay_queue *replay;
 	struct queue_stat rx_stat;
 	char name[PATH_MAX];
 	char type[ETH_PCAP_ARG_MAXLEN];
@@ -82,6 +96,7 @@ struct pmd_internals {
 	int if_index;
 	int single_iface;
 	int phy_mac;
+	struct pcap_replay *replay;
 };
 
 struct pmd_process_private {
@@ -99,6 +114,13 @@ struct pmd_devargs {
 		const char *type;
 	} queue[RTE_PMD_PCAP_MAX_QUEUES];
 	int phy_mac;
+	struct devargs_replay {
+		const char *path;
+		uint64_t nb_queues;
+		uint64_t nb_loops;
+		uint64_t pace;
+		uint64_t nb_copies;
+	} replay;
 };
 
 static const char *valid_arguments[] = {
@@ -109,6 +131,11 @@ static const char *valid_arguments[] = {
 	ETH_PCAP_TX_IFACE_ARG,
 	ETH_PCAP_IFACE_ARG,
 	ETH_PCAP_PHY_MAC_ARG,
+	ETH_PCAP_REPLAY_ARG,
+	ETH_PCAP_REPLAY_QUEUES_ARG,
+	ETH_PCAP_REPLAY_LOOP_ARG,
+	ETH_PCAP_REPLAY_PACE_ARG,
+	ETH_PCAP_REPLAY_COPIES_ARG,
 	NULL
 };
 
@@ -119,7 +146,7 @@ static struct rte_eth_link pmd_link = {
 		.link_autoneg = ETH_LINK_FIXED,
 };
 
-static int eth_pcap_logtype;
+int eth_pcap_logtype;
 
 #define PMD_LOG(level, fmt, args...) \
 	rte_log(RTE_LOG_ ## level, eth_pcap_logtype, \
@@ -243,6 +270,23 @@ eth_pcap_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_rx;
 }
 
+/*
+ * Callback to handle replaying the packets preloaded from a capture file.
+ */
+static uint16_t
+eth_pcap_rx_replay(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct pcap_rx_queue *pcap_q = queue;
+	uint64_t rx_bytes = 0;
+	uint16_t num_rx;
+
+	num_rx = pcap_replay_rx(pcap_q->replay, bufs, nb_pkts, &rx_bytes);
+	pcap_q->rx_stat.pkts += num_rx;
+	pcap_q->rx_stat.bytes += rx_bytes;
+
+	return num_rx;
+}
+
 static inline void
 calculate_timestamp(struct timeval *ts) {
 	uint64_t cycles;
@@ -487,6 +531,10 @@ eth_dev_start(struct rte_eth_dev *dev)
 		}
 	}
 
+	/* Rewind the preloaded capture, rx queues have no pcap then */
+	if (internals->replay != NULL)
+		pcap_replay_start(internals->replay, rte_get_timer_cycles());
+
 	/* If not open already, open rx pcaps */
 	for (i = 0; i < dev->data->nb_rx_queues; i++) {
 		rx = &internals->rx_queue[i];
@@ -582,6 +630,8 @@ eth_dev_info(struct rte_eth_dev *dev,
 	dev_info->max_rx_queues = dev->data->nb_rx_queues;
 	dev_info->max_tx_queues = dev->data->nb_tx_queues;
 	dev_info->min_rx_bufsize = 0;
+	if (internals->replay != NULL)
+		dev_info->flow_type_rss_offloads = ETH_PCAP_REPLAY_RSS_OFFLOADS;
 }
 
 static int
@@ -908,6 +958,81 @@ select_phy_mac(const char *key __rte_unused, const char *value,
 	return 0;
 }
 
+static int
+get_replay_path(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	const char **path = extra_args;
+
+	*path = value;
+	return 0;
+}
+
+static int
+get_replay_uint(const char *key, const char *value, void *extra_args)
+{
+	uint64_t *val = extra_args;
+	char *end;
+
+	errno = 0;
+	*val = strtoull(value, &end, 0);
+	if (errno != 0 || end == value || *end != '\0') {
+		PMD_LOG(ERR, "Invalid value %s for %s", value, key);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Parses the replay arguments. The capture itself is loaded once the port
+ * is allocated, each rx queue replays a share of its packets.
+ */
+static int
+open_replay(struct rte_kvargs *kvlist, struct pmd_devargs *pmd)
+{
+	struct devargs_replay *replay = &pmd->replay;
+	unsigned int i;
+
+	replay->nb_queues = 1;
+	replay->nb_loops = 0;
+	replay->pace = 0;
+	replay->nb_copies = 1;
+
+	if (rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_ARG,
+			&get_replay_path, &replay->path) < 0 ||
+			rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_QUEUES_ARG,
+			&get_replay_uint, &replay->nb_queues) < 0 ||
+			rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_LOOP_ARG,
+			&get_replay_uint, &replay->nb_loops) < 0 ||
+			rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_PACE_ARG,
+			&get_replay_uint, &replay->pace) < 0 ||
+			rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_COPIES_ARG,
+			&get_replay_uint, &replay->nb_copies) < 0)
+		return -1;
+
+	if (replay->nb_queues == 0 ||
+			replay->nb_queues > RTE_PMD_PCAP_MAX_QUEUES) {
+		PMD_LOG(ERR, "%s must be between 1 and %d",
+			ETH_PCAP_REPLAY_QUEUES_ARG, RTE_PMD_PCAP_MAX_QUEUES);
+		return -1;
+	}
+
+	if (replay->nb_copies == 0 || replay->nb_copies > UINT16_MAX) {
+		PMD_LOG(ERR, "%s must be between 1 and %d",
+			ETH_PCAP_REPLAY_COPIES_ARG, UINT16_MAX);
+		return -1;
+	}
+
+	for (i = 0; i < replay->nb_queues; i++) {
+		pmd->queue[i].name = replay->path;
+		pmd->queue[i].type = ETH_PCAP_REPLAY_ARG;
+	}
+	pmd->num_of_queue = replay->nb_queues;
+
+	return 0;
+}
+
 static struct rte_vdev_driver pmd_pcap_drv;
 
 static int
@@ -1132,7 +1257,29 @@ eth_from_pcaps(struct rte_vdev_device *vdev,
 		}
 	}
 
-	eth_dev->rx_pkt_burst = eth_pcap_rx;
+	if (rx_queues->replay.path != NULL) {
+		unsigned int i;
+
+		internals->replay = pcap_replay_create(rx_queues->replay.path,
+				eth_dev->data->port_id, nb_rx_queues,
+				rx_queues->replay.nb_loops,
+				rx_queues->replay.nb_copies,
+				rx_queues->replay.pace != 0,
+				vdev->device.numa_node);
+		if (internals->replay == NULL) {
+			rte_free(eth_dev->process_private);
+			eth_dev->process_private = NULL;
+			rte_eth_dev_release_port(eth_dev);
+			return -1;
+		}
+
+		for (i = 0; i < nb_rx_queues; i++)
+			internals->rx_queue[i].replay =
+				&internals->replay->queue[i];
+		eth_dev->rx_pkt_burst = eth_pcap_rx_replay;
+	} else {
+		eth_dev->rx_pkt_burst = eth_pcap_rx;
+	}
 
 	if (using_dumpers)
 		eth_dev->tx_pkt_burst = eth_pcap_tx_dumper;
@@ -1211,12 +1358,14 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 
 	/*
 	 * We check whether we want to open a RX stream from a real NIC or a
-	 * pcap file
+	 * pcap file, unless a capture file is replayed instead
 	 */
 	is_rx_pcap = rte_kvargs_count(kvlist, ETH_PCAP_RX_PCAP_ARG) ? 1 : 0;
 	pcaps.num_of_queue = 0;
 
-	if (is_rx_pcap) {
+	if (rte_kvargs_count(kvlist, ETH_PCAP_REPLAY_ARG) == 1) {
+		ret = open_replay(kvlist, &pcaps);
+	} else if (is_rx_pcap) {
 		ret = rte_kvargs_process(kvlist, ETH_PCAP_RX_PCAP_ARG,
 				&open_rx_pcap, &pcaps);
 	} else {
@@ -1275,7 +1424,10 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 		}
 
 		eth_dev->process_private = pp;
-		eth_dev->rx_pkt_burst = eth_pcap_rx;
+		if (internal->replay != NULL)
+			eth_dev->rx_pkt_burst = eth_pcap_rx_replay;
+		else
+			eth_dev->rx_pkt_burst = eth_pcap_rx;
 		if (is_tx_pcap)
 			eth_dev->tx_pkt_burst = eth_pcap_tx_dumper;
 		else
@@ -1316,6 +1468,10 @@ pmd_pcap_remove(struct rte_vdev_device *dev)
 		if (internals != NULL && internals->phy_mac == 0)
 			/* not dynamically allocated, must not be freed */
 			eth_dev->data->mac_addrs = NULL;
+		if (internals != NULL) {
+			pcap_replay_free(internals->replay);
+			internals->replay = NULL;
+		}
 	}
 
 	rte_free(eth_dev->process_private);
@@ -1338,7 +1494,12 @@ RTE_PMD_REGISTER_PARAM_STRING(net_pcap,
 	ETH_PCAP_RX_IFACE_IN_ARG "=<ifc> "
 	ETH_PCAP_TX_IFACE_ARG "=<ifc> "
 	ETH_PCAP_IFACE_ARG "=<ifc> "
-	ETH_PCAP_PHY_MAC_ARG "=<int>");
+	ETH_PCAP_PHY_MAC_ARG "=<int> "
+	ETH_PCAP_REPLAY_ARG "=<string> "
+	ETH_PCAP_REPLAY_QUEUES_ARG "=<int> "
+	ETH_PCAP_REPLAY_LOOP_ARG "=<int> "
+	ETH_PCAP_REPLAY_PACE_ARG "=<int> "
+	ETH_PCAP_REPLAY_COPIES_ARG "=<int>");
 
 RTE_INIT(eth_pcap_init_log)
 {
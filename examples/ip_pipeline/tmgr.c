@@ -110,6 +110,7 @@ tmgr_port_create(const char *name, struct tmgr_port_params *params)
 
 	p.pipe_profiles = pipe_profile;
 	p.n_pipe_profiles = n_pipe_profiles;
+	p.subport_queues = NULL;
 
 	s = rte_sched_port_config(&p);
 	if (s == NULL)
@@ -43,6 +43,8 @@ bpf_jit(struct rte_bpf *bpf)
 
 #ifdef RTE_ARCH_X86_64
 	rc = bpf_jit_x86(bpf);
+#elif defined(RTE_ARCH_ARM64)
+	rc = bpf_jit_arm64(bpf);
 #else
 	rc = -ENOTSUP;
 #endif
@@ -0,0 +1,368 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_log.h>
+#include <rte_debug.h>
+#include <rte_malloc.h>
+#include <rte_errno.h>
+
+#include "bpf_impl.h"
+
+/*
+ * Conversion of classic BPF (cBPF) programs into eBPF ones,
+ * following the same approach as the Linux kernel:
+ * - cBPF A and X registers are mapped into eBPF R0 and R7,
+ *   as R0 is the destination of BPF_ABS/BPF_IND loads, and R1-R5 are
+ *   clobbered by them;
+ * - R6 keeps the pointer to the mbuf, as expected by BPF_ABS/BPF_IND loads;
+ * - R8 is used as a temporary register;
+ * - cBPF scratch memory M[] is kept on the stack.
+ * Packet loads beyond the packet boundary end the program with 0 as the
+ * return value, the same way as in cBPF.
+ */
+
+#define CBPF_REG_A	EBPF_REG_0
+#define CBPF_REG_X	EBPF_REG_7
+#define CBPF_REG_CTX	EBPF_REG_6
+#define CBPF_REG_TMP	EBPF_REG_8
+
+/* first offset of the Linux specific ancillary loads */
+#define CBPF_ANC_OFS	((uint32_t)INT32_MAX + 1)
+
+struct cbpf_cvt {
+	struct ebpf_insn *ins; /* eBPF code, NULL to compute the size only */
+	uint32_t idx;          /* current eBPF instruction */
+	uint32_t *ofs;         /* eBPF index of each cBPF instruction */
+};
+
+static void
+emit(struct cbpf_cvt *cvt, uint8_t code, uint8_t dreg, uint8_t sreg,
+	int16_t off, int32_t imm)
+{
+	struct ebpf_insn *ins;
+
+	if (cvt->ins != NULL) {
+		ins = cvt->ins + cvt->idx;
+		ins->code = code;
+		ins->dst_reg = dreg;
+		ins->src_reg = sreg;
+		ins->off = off;
+		ins->imm = imm;
+	}
+	cvt->idx++;
+}
+
+/*
+ * relative offset from the next eBPF instruction
+ * to the start of the given cBPF one.
+ */
+static int16_t
+jmp_ofs(const struct cbpf_cvt *cvt, uint32_t tgt)
+{
+	if (cvt->ins == NULL)
+		return 0;
+	return cvt->ofs[tgt] - (cvt->idx + 1);
+}
+
+/* offset of M[k] on the stack */
+static int16_t
+mem_ofs(uint32_t k)
+{
+	return -(int32_t)((BPF_MEMWORDS - k) * sizeof(uint32_t));
+}
+
+static void
+emit_jcc(struct cbpf_cvt *cvt, const struct cbpf_insn *fp, uint32_t idx)
+{
+	uint8_t op, inv, src, sreg;
+	int32_t imm;
+
+	/* both targets are the next instruction */
+	if (fp->jt == 0 && fp->jf == 0)
+		return;
+
+	op = BPF_OP(fp->code);
+	src = BPF_SRC(fp->code);
+	sreg = (src == BPF_X) ? CBPF_REG_X : 0;
+	imm = 0;
+
+	if (src == BPF_K) {
+		/* eBPF immediates are sign extended, use TMP for big values */
+		if ((int32_t)fp->k < 0) {
+			emit(cvt, BPF_ALU | EBPF_MOV | BPF_K, CBPF_REG_TMP, 0,
+				0, fp->k);
+			src = BPF_X;
+			sreg = CBPF_REG_TMP;
+		} else
+			imm = fp->k;
+	}
+
+	switch (op) {
+	case BPF_JEQ:
+		inv = EBPF_JNE;
+		break;
+	case BPF_JGT:
+		inv = EBPF_JLE;
+		break;
+	case BPF_JGE:
+		inv = EBPF_JLT;
+		break;
+	default:
+		inv = 0;
+		break;
+	}
+
+	if (fp->jf == 0) {
+		emit(cvt, BPF_JMP | op | src, CBPF_REG_A, sreg,
+			jmp_ofs(cvt, idx + 1 + fp->jt), imm);
+	} else if (fp->jt == 0 && inv != 0) {
+		emit(cvt, BPF_JMP | inv | src, CBPF_REG_A, sreg,
+			jmp_ofs(cvt, idx + 1 + fp->jf), imm);
+	} else {
+		emit(cvt, BPF_JMP | op | src, CBPF_REG_A, sreg,
+			jmp_ofs(cvt, idx + 1 + fp->jt), imm);
+		emit(cvt, BPF_JMP | BPF_JA, 0, 0,
+			jmp_ofs(cvt, idx + 1 + fp->jf), 0);
+	}
+}
+
+/*
+ * Check cBPF instruction and convert it into eBPF ones.
+ */
+static int
+convert_insn(struct cbpf_cvt *cvt, const struct cbpf_insn *fp, uint32_t idx,
+	uint32_t nb_ins)
+{
+	uint8_t op, dreg;
+
+	switch (BPF_CLASS(fp->code)) {
+	case BPF_ALU:
+		op = BPF_OP(fp->code);
+		switch (op) {
+		case BPF_NEG:
+			emit(cvt, BPF_ALU | BPF_NEG, CBPF_REG_A, 0, 0, 0);
+			return 0;
+		case BPF_DIV:
+		case BPF_MOD:
+			if (BPF_SRC(fp->code) == BPF_K && fp->k == 0)
+				return -EINVAL;
+			break;
+		case BPF_LSH:
+		case BPF_RSH:
+			if (BPF_SRC(fp->code) == BPF_K && fp->k >= 32)
+				return -EINVAL;
+			break;
+		case BPF_ADD:
+		case BPF_SUB:
+		case BPF_MUL:
+		case BPF_OR:
+		case BPF_AND:
+		case BPF_XOR:
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (BPF_SRC(fp->code) == BPF_X)
+			emit(cvt, BPF_ALU | op | BPF_X, CBPF_REG_A, CBPF_REG_X,
+				0, 0);
+		else
+			emit(cvt, BPF_ALU | op | BPF_K, CBPF_REG_A, 0, 0,
+				fp->k);
+		return 0;
+
+	case BPF_LD:
+	case BPF_LDX:
+		dreg = (BPF_CLASS(fp->code) == BPF_LD) ?
+			CBPF_REG_A : CBPF_REG_X;
+		switch (BPF_MODE(fp->code)) {
+		case BPF_ABS:
+		case BPF_IND:
+			if (BPF_CLASS(fp->code) != BPF_LD ||
+					BPF_SIZE(fp->code) == EBPF_DW)
+				return -EINVAL;
+			if (fp->k >= CBPF_ANC_OFS)
+				return -ENOTSUP;
+			emit(cvt, fp->code, 0,
+				(BPF_MODE(fp->code) == BPF_IND) ?
+				CBPF_REG_X : 0, 0, fp->k);
+			return 0;
+		case BPF_MSH:
+			/* X = 4 * (P[k] & 0xf), keeping A in TMP */
+			if (BPF_CLASS(fp->code) != BPF_LDX ||
+					BPF_SIZE(fp->code) != BPF_B)
+				return -EINVAL;
+			if (fp->k >= CBPF_ANC_OFS)
+				return -ENOTSUP;
+			emit(cvt, EBPF_ALU64 | EBPF_MOV | BPF_X, CBPF_REG_TMP,
+				CBPF_REG_A, 0, 0);
+			emit(cvt, BPF_LD | BPF_ABS | BPF_B, 0, 0, 0, fp->k);
+			emit(cvt, BPF_ALU | BPF_AND | BPF_K, CBPF_REG_A, 0, 0,
+				0xf);
+			emit(cvt, BPF_ALU | BPF_LSH | BPF_K, CBPF_REG_A, 0, 0,
+				2);
+			emit(cvt, EBPF_ALU64 | EBPF_MOV | BPF_X, CBPF_REG_X,
+				CBPF_REG_A, 0, 0);
+			emit(cvt, EBPF_ALU64 | EBPF_MOV | BPF_X, CBPF_REG_A,
+				CBPF_REG_TMP, 0, 0);
+			return 0;
+		case BPF_IMM:
+			emit(cvt, BPF_ALU | EBPF_MOV | BPF_K, dreg, 0, 0,
+				fp->k);
+			return 0;
+		case BPF_MEM:
+			if (fp->k >= BPF_MEMWORDS)
+				return -EINVAL;
+			emit(cvt, BPF_LDX | BPF_MEM | BPF_W, dreg, EBPF_REG_10,
+				mem_ofs(fp->k), 0);
+			return 0;
+		case BPF_LEN:
+			if (BPF_SIZE(fp->code) != BPF_W)
+				return -EINVAL;
+			emit(cvt, BPF_LDX | BPF_MEM | BPF_W, dreg, CBPF_REG_CTX,
+				offsetof(struct rte_mbuf, pkt_len), 0);
+			return 0;
+		}
+		return -EINVAL;
+
+	case BPF_ST:
+	case BPF_STX:
+		if (fp->k >= BPF_MEMWORDS)
+			return -EINVAL;
+		emit(cvt, BPF_STX | BPF_MEM | BPF_W, EBPF_REG_10,
+			(BPF_CLASS(fp->code) == BPF_ST) ?
+			CBPF_REG_A : CBPF_REG_X, mem_ofs(fp->k), 0);
+		return 0;
+
+	case BPF_JMP:
+		op = BPF_OP(fp->code);
+		if (op == BPF_JA) {
+			if (fp->k >= nb_ins - idx - 1)
+				return -EINVAL;
+			emit(cvt, BPF_JMP | BPF_JA, 0, 0,
+				jmp_ofs(cvt, idx + 1 + fp->k), 0);
+			return 0;
+		}
+		if ((op != BPF_JEQ && op != BPF_JGT && op != BPF_JGE &&
+				op != BPF_JSET) ||
+				fp->jt >= nb_ins - idx - 1 ||
+				fp->jf >= nb_ins - idx - 1)
+			return -EINVAL;
+		emit_jcc(cvt, fp, idx);
+		return 0;
+
+	case BPF_RET:
+		if (BPF_RVAL(fp->code) == BPF_K)
+			emit(cvt, BPF_ALU | EBPF_MOV | BPF_K, CBPF_REG_A, 0, 0,
+				fp->k);
+		else if (BPF_RVAL(fp->code) != BPF_A)
+			return -EINVAL;
+		emit(cvt, BPF_JMP | EBPF_EXIT, 0, 0, 0, 0);
+		return 0;
+
+	case BPF_MISC:
+		if (BPF_MISCOP(fp->code) == BPF_TAX)
+			emit(cvt, BPF_ALU | EBPF_MOV | BPF_X, CBPF_REG_X,
+				CBPF_REG_A, 0, 0);
+		else if (BPF_MISCOP(fp->code) == BPF_TXA)
+			emit(cvt, BPF_ALU | EBPF_MOV | BPF_X, CBPF_REG_A,
+				CBPF_REG_X, 0, 0);
+		else
+			return -EINVAL;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Convert the whole cBPF program.
+ * When cvt->ins is NULL, only fill cvt->ofs[] with the eBPF index of
+ * each cBPF instruction, as needed to compute the jump offsets.
+ */
+static int
+convert(struct cbpf_cvt *cvt, const struct cbpf_insn *ins, uint32_t nb_ins)
+{
+	int32_t rc;
+	uint32_t i;
+
+	cvt->idx = 0;
+
+	/* A = 0, X = 0, R6 = mbuf */
+	emit(cvt, BPF_ALU | EBPF_MOV | BPF_K, CBPF_REG_A, 0, 0, 0);
+	emit(cvt, BPF_ALU | EBPF_MOV | BPF_K, CBPF_REG_X, 0, 0, 0);
+	emit(cvt, EBPF_ALU64 | EBPF_MOV | BPF_X, CBPF_REG_CTX, EBPF_REG_1,
+		0, 0);
+
+	for (i = 0; i != nb_ins; i++) {
+		cvt->ofs[i] = cvt->idx;
+		rc = convert_insn(cvt, ins + i, i, nb_ins);
+		if (rc != 0) {
+			RTE_BPF_LOG(ERR, "%s: invalid or unsupported cBPF "
+				"instruction at pc: %u, code: %#x, k: %#x;\n",
+				__func__, i, ins[i].code, ins[i].k);
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+__rte_experimental struct rte_bpf_prm *
+rte_bpf_convert(const struct cbpf_insn *ins, uint32_t nb_ins)
+{
+	int32_t rc;
+	uint32_t *ofs;
+	struct cbpf_cvt cvt;
+	struct rte_bpf_prm *prm;
+
+	if (ins == NULL || nb_ins == 0 || nb_ins > BPF_MAXINSNS ||
+			BPF_CLASS(ins[nb_ins - 1].code) != BPF_RET) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	ofs = malloc(nb_ins * sizeof(ofs[0]));
+	if (ofs == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	/* first pass: get the eBPF program size and instruction offsets */
+	memset(&cvt, 0, sizeof(cvt));
+	cvt.ofs = ofs;
+	rc = convert(&cvt, ins, nb_ins);
+	if (rc != 0) {
+		free(ofs);
+		rte_errno = -rc;
+		return NULL;
+	}
+
+	prm = rte_zmalloc("bpf_convert",
+		sizeof(*prm) + cvt.idx * sizeof(struct ebpf_insn), 0);
+	if (prm == NULL) {
+		free(ofs);
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	/* second pass: generate the eBPF program */
+	cvt.ins = (struct ebpf_insn *)(prm + 1);
+	convert(&cvt, ins, nb_ins);
+	free(ofs);
+
+	prm->ins = cvt.ins;
+	prm->nb_ins = cvt.idx;
+	prm->prog_arg.type = RTE_BPF_ARG_PTR_MBUF;
+	prm->prog_arg.size = sizeof(struct rte_mbuf);
+
+	return prm;
+}
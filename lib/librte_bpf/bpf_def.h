@@ -102,6 +102,32 @@ extern "C" {
 #define EBPF_TO_LE	0x00  /* convert to little-endian */
 #define EBPF_TO_BE	0x08  /* convert to big-endian */
 
+/* cBPF only: return value source for BPF_RET */
+#define BPF_RVAL(code)	((code) & 0x18)
+#define	BPF_A		0x10
+
+/* cBPF only: operations for BPF_MISC */
+#define BPF_MISCOP(code) ((code) & 0xf8)
+#define	BPF_TAX		0x00
+#define	BPF_TXA		0x80
+
+/* cBPF only: number of 32-bit words in the scratch memory */
+#define	BPF_MEMWORDS	16
+
+/* cBPF only: maximum number of instructions in the program */
+#define	BPF_MAXINSNS	4096
+
+/*
+ * cBPF instruction format,
+ * same as struct bpf_insn in libpcap and struct sock_filter in Linux.
+ */
+struct cbpf_insn {
+	uint16_t code;
+	uint8_t jt;
+	uint8_t jf;
+	uint32_t k;
+};
+
 /*
  * eBPF registers
  */
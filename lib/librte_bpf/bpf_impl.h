@@ -25,8 +25,13 @@ extern int bpf_validate(struct rte_bpf *bpf);
 
 extern int bpf_jit(struct rte_bpf *bpf);
 
+extern int bpf_map_xfunc_check(const struct rte_bpf_xsym *xsym,
+	const uint64_t *handle);
+
 #ifdef RTE_ARCH_X86_64
 extern int bpf_jit_x86(struct rte_bpf *);
+#elif defined(RTE_ARCH_ARM64)
+extern int bpf_jit_arm64(struct rte_bpf *);
 #endif
 
 extern int rte_bpf_logtype;
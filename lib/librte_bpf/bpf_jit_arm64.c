@@ -0,0 +1,1260 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdarg.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_log.h>
+#include <rte_debug.h>
+#include <rte_memory.h>
+#include <rte_eal.h>
+#include <rte_byteorder.h>
+
+#include "bpf_impl.h"
+
+#define GET_BPF_OP(op)	(BPF_OP(op) >> 4)
+
+enum {
+	X0 = 0,   /* scratch, 1st arg, return value */
+	X1 = 1,   /* scratch, 2nd arg */
+	X2 = 2,   /* scratch, 3rd arg */
+	X3 = 3,   /* scratch, 4th arg */
+	X4 = 4,   /* scratch, 5th arg */
+	X7 = 7,   /* scratch */
+	X9 = 9,   /* scratch */
+	X10 = 10, /* scratch */
+	X11 = 11, /* scratch */
+	X19 = 19, /* callee saved */
+	X20 = 20, /* callee saved */
+	X21 = 21, /* callee saved */
+	X22 = 22, /* callee saved */
+	X23 = 23, /* callee saved */
+	X24 = 24, /* callee saved */
+	X25 = 25, /* callee saved */
+	X26 = 26, /* callee saved */
+	X27 = 27, /* callee saved */
+	X28 = 28, /* callee saved */
+	FP = 29,  /* frame pointer */
+	LR = 30,  /* link register */
+	SP = 31,  /* stack pointer, as base or add/sub operand */
+	XZR = 31, /* zero register, as any other operand */
+};
+
+/* condition codes */
+enum {
+	A64_EQ = 0x0,
+	A64_NE = 0x1,
+	A64_HS = 0x2,
+	A64_LO = 0x3,
+	A64_HI = 0x8,
+	A64_LS = 0x9,
+	A64_GE = 0xA,
+	A64_LT = 0xB,
+	A64_GT = 0xC,
+	A64_LE = 0xD,
+};
+
+/*
+ * eBPF to arm64 register mappings.
+ * R1-R5 match the arguments of the AAPCS64 calling convention,
+ * so external functions can be called directly.
+ */
+static const uint32_t ebpf2a64[] = {
+	[EBPF_REG_0] = X7,
+	[EBPF_REG_1] = X0,
+	[EBPF_REG_2] = X1,
+	[EBPF_REG_3] = X2,
+	[EBPF_REG_4] = X3,
+	[EBPF_REG_5] = X4,
+	[EBPF_REG_6] = X19,
+	[EBPF_REG_7] = X20,
+	[EBPF_REG_8] = X21,
+	[EBPF_REG_9] = X22,
+	[EBPF_REG_10] = X25,
+};
+
+/*
+ * x9, x10 and x11 are used as a scratch temporary registers.
+ */
+enum {
+	REG_TMP0 = X9,
+	REG_TMP1 = X10,
+	REG_TMP2 = X11,
+};
+
+/*
+ * callee saved registers list, saved in pairs.
+ */
+static const uint32_t save_regs[][2] = {
+	{X19, X20},
+	{X21, X22},
+	{X25, X26},
+};
+
+/*
+ * callee saved registers not used by eBPF code,
+ * the burst entry keeps the loop state in them.
+ */
+enum {
+	REG_BURST_CTX = X23,  /* next context pointer */
+	REG_BURST_RC = X24,   /* next return value pointer */
+	REG_BURST_LEFT = X27, /* number of contexts left */
+	REG_BURST_NUM = X28,  /* total number of contexts */
+};
+
+static const uint32_t burst_regs[][2] = {
+	{REG_BURST_CTX, REG_BURST_RC},
+	{REG_BURST_LEFT, REG_BURST_NUM},
+};
+
+/*
+ * generated entry points: per context one and burst one.
+ */
+enum {
+	JIT_FUNC,
+	JIT_BURST,
+	JIT_NUM,
+};
+
+struct bpf_jit_state {
+	uint32_t idx;
+	size_t sz;      /* code size in instructions */
+	struct {
+		uint32_t num;
+		int32_t off;
+	} exit;
+	struct {
+		uint32_t on;   /* generate burst entry */
+		int32_t loop;  /* start of the loop */
+		int32_t end;   /* end of the loop */
+	} burst;
+	uint32_t stack_sz;
+	uint32_t reguse;
+	int32_t *off;
+	uint32_t *ins;
+};
+
+#define	INUSE(v, r)	(((v) >> (r)) & 1)
+#define	USED(v, r)	((v) |= 1 << (r))
+
+/*
+ * maximum distance for the conditional branches, in instructions.
+ */
+#define	MAX_JCC_DIST	(1 << 18)
+
+/*
+ * arm64 load/store size field for given BPF size.
+ */
+static uint32_t
+ldst_size(uint32_t opsz)
+{
+	if (opsz == BPF_B)
+		return 0;
+	else if (opsz == BPF_H)
+		return 1;
+	else if (opsz == BPF_W)
+		return 2;
+	return 3;
+}
+
+static uint32_t
+is64(uint32_t op)
+{
+	return (BPF_CLASS(op) == EBPF_ALU64 || BPF_CLASS(op) == BPF_JMP);
+}
+
+static void
+emit_insn(struct bpf_jit_state *st, uint32_t ins)
+{
+	if (st->ins != NULL)
+		st->ins[st->sz] = ins;
+	st->sz++;
+}
+
+/*
+ * emit mov <sreg>, <dreg>
+ */
+static void
+emit_mov_reg(struct bpf_jit_state *st, uint32_t sf, uint32_t sreg,
+	uint32_t dreg)
+{
+	/* if operands are 32-bit, then it can be used to clear upper 32-bit */
+	if (sreg != dreg || sf == 0)
+		emit_insn(st, 0x2A0003E0 | sf << 31 | sreg << 16 | dreg);
+}
+
+/*
+ * emit add <sreg>, <imm12>, <dreg>, with SP allowed as operand.
+ */
+static void
+emit_add_sp(struct bpf_jit_state *st, uint32_t sreg, uint32_t dreg,
+	uint32_t imm)
+{
+	emit_insn(st, 0x91000000 | imm << 10 | sreg << 5 | dreg);
+}
+
+/*
+ * emit sub <sreg>, <imm12>, <dreg>, with SP allowed as operand.
+ */
+static void
+emit_sub_sp(struct bpf_jit_state *st, uint32_t sreg, uint32_t dreg,
+	uint32_t imm)
+{
+	emit_insn(st, 0xD1000000 | imm << 10 | sreg << 5 | dreg);
+}
+
+/*
+ * emit shortest movz/movn + movk sequence to load <val> into <dreg>.
+ */
+static void
+emit_mov_imm(struct bpf_jit_state *st, uint32_t sf, uint32_t dreg,
+	uint64_t val)
+{
+	uint32_t i, n, nf, nz, skip, first;
+	uint16_t v;
+
+	const uint32_t movn = 0x12800000;
+	const uint32_t movz = 0x52800000;
+	const uint32_t movk = 0x72800000;
+
+	n = (sf != 0) ? 4 : 2;
+	if (sf == 0)
+		val = (uint32_t)val;
+
+	nf = 0;
+	nz = 0;
+	for (i = 0; i != n; i++) {
+		v = val >> (i * 16);
+		nf += (v == UINT16_MAX);
+		nz += (v == 0);
+	}
+
+	/* start with movn, if most of the halfwords are all ones */
+	skip = (nf > nz) ? UINT16_MAX : 0;
+
+	first = 1;
+	for (i = 0; i != n; i++) {
+		v = val >> (i * 16);
+		if (v == skip)
+			continue;
+		if (first != 0) {
+			if (skip != 0)
+				emit_insn(st, movn | sf << 31 | i << 21 |
+					(uint16_t)~v << 5 | dreg);
+			else
+				emit_insn(st, movz | sf << 31 | i << 21 |
+					v << 5 | dreg);
+			first = 0;
+		} else
+			emit_insn(st, movk | sf << 31 | i << 21 | v << 5 |
+				dreg);
+	}
+
+	/* value is either zero or all ones */
+	if (first != 0)
+		emit_insn(st, ((skip != 0) ? movn : movz) | sf << 31 | dreg);
+}
+
+/*
+ * emit one of:
+ *   add <sreg>, <dreg>
+ *   sub <sreg>, <dreg>
+ *   and <sreg>, <dreg>
+ *   orr <sreg>, <dreg>
+ *   eor <sreg>, <dreg>
+ *   lslv <sreg>, <dreg>
+ *   lsrv <sreg>, <dreg>
+ *   asrv <sreg>, <dreg>
+ *   mul <sreg>, <dreg>
+ */
+static void
+emit_alu_reg(struct bpf_jit_state *st, uint32_t op, uint32_t sreg,
+	uint32_t dreg)
+{
+	uint32_t bop;
+
+	static const uint32_t ops[] = {
+		[GET_BPF_OP(BPF_ADD)] = 0x0B000000,
+		[GET_BPF_OP(BPF_SUB)] = 0x4B000000,
+		[GET_BPF_OP(BPF_AND)] = 0x0A000000,
+		[GET_BPF_OP(BPF_OR)] = 0x2A000000,
+		[GET_BPF_OP(BPF_XOR)] = 0x4A000000,
+		[GET_BPF_OP(BPF_LSH)] = 0x1AC02000,
+		[GET_BPF_OP(BPF_RSH)] = 0x1AC02400,
+		[GET_BPF_OP(EBPF_ARSH)] = 0x1AC02800,
+		[GET_BPF_OP(BPF_MUL)] = 0x1B007C00,
+	};
+
+	bop = GET_BPF_OP(op);
+	emit_insn(st, ops[bop] | is64(op) << 31 | sreg << 16 | dreg << 5 |
+		dreg);
+}
+
+/*
+ * emit one of:
+ *   add <imm>, <dreg>
+ *   sub <imm>, <dreg>
+ *   and <imm>, <dreg>
+ *   orr <imm>, <dreg>
+ *   eor <imm>, <dreg>
+ *   mul <imm>, <dreg>
+ * note that only add/sub can encode the immediate value directly,
+ * for all others it is loaded into the scratch register first.
+ */
+static void
+emit_alu_imm(struct bpf_jit_state *st, uint32_t op, uint32_t dreg, int32_t imm)
+{
+	uint32_t bop, sf, sub;
+
+	sf = is64(op);
+	bop = BPF_OP(op);
+
+	if ((bop == BPF_ADD || bop == BPF_SUB) && imm > -4096 && imm < 4096) {
+		sub = (bop == BPF_SUB);
+		if (imm < 0) {
+			sub ^= 1;
+			imm = -imm;
+		}
+		emit_insn(st, 0x11000000 | sf << 31 | sub << 30 | imm << 10 |
+			dreg << 5 | dreg);
+		return;
+	}
+
+	emit_mov_imm(st, sf, REG_TMP0, (int64_t)imm);
+	emit_alu_reg(st, op, REG_TMP0, dreg);
+}
+
+/*
+ * emit one of:
+ *   lsl <imm>, <dreg>
+ *   lsr <imm>, <dreg>
+ *   asr <imm>, <dreg>
+ */
+static void
+emit_shift_imm(struct bpf_jit_state *st, uint32_t op, uint32_t dreg,
+	uint32_t imm)
+{
+	uint32_t bits, bop, immr, imms, ops, sf;
+
+	const uint32_t ubfm = 0x53000000;
+	const uint32_t sbfm = 0x13000000;
+
+	sf = is64(op);
+	bop = BPF_OP(op);
+	bits = (sf != 0) ? 64 : 32;
+	imm &= bits - 1;
+
+	if (bop == BPF_LSH) {
+		ops = ubfm;
+		immr = (bits - imm) & (bits - 1);
+		imms = bits - 1 - imm;
+	} else {
+		ops = (bop == EBPF_ARSH) ? sbfm : ubfm;
+		immr = imm;
+		imms = bits - 1;
+	}
+
+	emit_insn(st, ops | sf << 31 | sf << 22 | immr << 16 | imms << 10 |
+		dreg << 5 | dreg);
+}
+
+/*
+ * emit neg <dreg>
+ */
+static void
+emit_neg(struct bpf_jit_state *st, uint32_t op, uint32_t dreg)
+{
+	emit_insn(st, 0x4B0003E0 | is64(op) << 31 | dreg << 16 | dreg);
+}
+
+/*
+ * emit uxth <dreg>
+ */
+static void
+emit_zext16(struct bpf_jit_state *st, uint32_t dreg)
+{
+	emit_insn(st, 0x53003C00 | dreg << 5 | dreg);
+}
+
+/*
+ * emit one of:
+ *   rev16 <dreg> + uxth <dreg>
+ *   rev <dreg> (32-bit)
+ *   rev <dreg> (64-bit)
+ */
+static void
+emit_be2le(struct bpf_jit_state *st, uint32_t dreg, uint32_t imm)
+{
+	if (imm == 16) {
+		emit_insn(st, 0x5AC00400 | dreg << 5 | dreg);
+		emit_zext16(st, dreg);
+	} else if (imm == 32)
+		emit_insn(st, 0x5AC00800 | dreg << 5 | dreg);
+	else
+		emit_insn(st, 0xDAC00C00 | dreg << 5 | dreg);
+}
+
+/*
+ * In general it is NOP for arm64.
+ * Just clear the upper bits.
+ */
+static void
+emit_le2be(struct bpf_jit_state *st, uint32_t dreg, uint32_t imm)
+{
+	if (imm == 16)
+		emit_zext16(st, dreg);
+	else if (imm == 32)
+		emit_mov_reg(st, 0, dreg, dreg);
+}
+
+/*
+ * emit one of:
+ *   ldr <ofs>(<sreg>), <dreg>
+ *   str <sreg>, <ofs>(<dreg>)
+ * picks scaled 12-bit, unscaled 9-bit or register offset encoding.
+ */
+static void
+emit_ldst(struct bpf_jit_state *st, uint32_t ld, uint32_t opsz, uint32_t rt,
+	uint32_t rn, int32_t ofs)
+{
+	uint32_t opc, scale;
+
+	scale = ldst_size(opsz);
+	opc = (ld != 0) ? 1 : 0;
+
+	if (ofs >= 0 && (ofs & ((1 << scale) - 1)) == 0 &&
+			(ofs >> scale) < 4096)
+		emit_insn(st, 0x39000000 | scale << 30 | opc << 22 |
+			(ofs >> scale) << 10 | rn << 5 | rt);
+	else if (ofs >= -256 && ofs < 256)
+		emit_insn(st, 0x38000000 | scale << 30 | opc << 22 |
+			(ofs & 0x1FF) << 12 | rn << 5 | rt);
+	else {
+		emit_mov_imm(st, 1, REG_TMP0, (int64_t)ofs);
+		emit_insn(st, 0x38206800 | scale << 30 | opc << 22 |
+			REG_TMP0 << 16 | rn << 5 | rt);
+	}
+}
+
+static void
+emit_ld_reg(struct bpf_jit_state *st, uint32_t op, uint32_t sreg, uint32_t dreg,
+	int32_t ofs)
+{
+	emit_ldst(st, 1, BPF_SIZE(op), dreg, sreg, ofs);
+}
+
+static void
+emit_st_reg(struct bpf_jit_state *st, uint32_t op, uint32_t sreg, uint32_t dreg,
+	int32_t ofs)
+{
+	emit_ldst(st, 0, BPF_SIZE(op), sreg, dreg, ofs);
+}
+
+static void
+emit_st_imm(struct bpf_jit_state *st, uint32_t op, uint32_t dreg, int32_t imm,
+	int32_t ofs)
+{
+	emit_mov_imm(st, 1, REG_TMP1, (int64_t)imm);
+	emit_ldst(st, 0, BPF_SIZE(op), REG_TMP1, dreg, ofs);
+}
+
+/*
+ * emit atomic add %<sreg>, <ofs>(%<dreg>):
+ *   add <dreg>, <ofs>, tmp0
+ * 1:
+ *   ldxr (tmp0), tmp1
+ *   add <sreg>, tmp1
+ *   stxr tmp1, (tmp0), tmp2
+ *   cbnz tmp2, 1b
+ */
+static void
+emit_st_xadd(struct bpf_jit_state *st, uint32_t op, uint32_t sreg,
+	uint32_t dreg, int32_t ofs)
+{
+	uint32_t scale, sf;
+
+	scale = ldst_size(BPF_SIZE(op));
+	sf = (scale == 3);
+
+	emit_mov_imm(st, 1, REG_TMP0, (int64_t)ofs);
+	emit_insn(st, 0x8B000000 | dreg << 16 | REG_TMP0 << 5 | REG_TMP0);
+
+	emit_insn(st, 0x085F7C00 | scale << 30 | REG_TMP0 << 5 | REG_TMP1);
+	emit_insn(st, 0x0B000000 | sf << 31 | sreg << 16 | REG_TMP1 << 5 |
+		REG_TMP1);
+	emit_insn(st, 0x08007C00 | scale << 30 | REG_TMP2 << 16 |
+		REG_TMP0 << 5 | REG_TMP1);
+	emit_insn(st, 0x35000000 | (-3 & 0x7FFFF) << 5 | REG_TMP2);
+}
+
+/*
+ * emit b <ofs>
+ * where 'ofs' is the target offset for the native code.
+ */
+static void
+emit_abs_jmp(struct bpf_jit_state *st, int32_t ofs)
+{
+	int32_t joff;
+
+	joff = ofs - st->sz;
+	emit_insn(st, 0x14000000 | (joff & 0x3FFFFFF));
+}
+
+/*
+ * emit b <ofs>
+ * where 'ofs' is the target offset for the BPF bytecode.
+ */
+static void
+emit_jmp(struct bpf_jit_state *st, int32_t ofs)
+{
+	emit_abs_jmp(st, st->off[st->idx + ofs]);
+}
+
+/*
+ * emit b.<cond> <ofs>
+ * where 'ofs' is the target offset for the native code.
+ */
+static void
+emit_abs_jcc(struct bpf_jit_state *st, uint32_t op, int32_t ofs)
+{
+	int32_t joff;
+
+	static const uint8_t cond[] = {
+		[GET_BPF_OP(BPF_JEQ)] = A64_EQ,
+		[GET_BPF_OP(EBPF_JNE)] = A64_NE,
+		[GET_BPF_OP(BPF_JGT)] = A64_HI,
+		[GET_BPF_OP(EBPF_JLT)] = A64_LO,
+		[GET_BPF_OP(BPF_JGE)] = A64_HS,
+		[GET_BPF_OP(EBPF_JLE)] = A64_LS,
+		[GET_BPF_OP(EBPF_JSGT)] = A64_GT,
+		[GET_BPF_OP(EBPF_JSLT)] = A64_LT,
+		[GET_BPF_OP(EBPF_JSGE)] = A64_GE,
+		[GET_BPF_OP(EBPF_JSLE)] = A64_LE,
+		[GET_BPF_OP(BPF_JSET)] = A64_NE,
+	};
+
+	joff = ofs - st->sz;
+	emit_insn(st, 0x54000000 | (joff & 0x7FFFF) << 5 |
+		cond[GET_BPF_OP(op)]);
+}
+
+/*
+ * emit b.<cond> <ofs>
+ * where 'ofs' is the target offset for the BPF bytecode.
+ */
+static void
+emit_jcc(struct bpf_jit_state *st, uint32_t op, int32_t ofs)
+{
+	emit_abs_jcc(st, op, st->off[st->idx + ofs]);
+}
+
+/*
+ * emit cbz/cbnz <reg>, <ofs>
+ * where 'ofs' is the target offset for the native code.
+ */
+static void
+emit_abs_cbz(struct bpf_jit_state *st, uint32_t nz, uint32_t sf, uint32_t reg,
+	int32_t ofs)
+{
+	int32_t joff;
+
+	joff = ofs - st->sz;
+	emit_insn(st, 0x34000000 | sf << 31 | nz << 24 |
+		(joff & 0x7FFFF) << 5 | reg);
+}
+
+/*
+ * emit one of:
+ *   cmp <sreg>, <dreg>
+ *   tst <sreg>, <dreg>
+ */
+static void
+emit_cmp_reg(struct bpf_jit_state *st, uint32_t op, uint32_t sreg,
+	uint32_t dreg)
+{
+	uint32_t ops;
+
+	ops = (BPF_OP(op) == BPF_JSET) ? 0xEA00001F : 0xEB00001F;
+	emit_insn(st, ops | sreg << 16 | dreg << 5);
+}
+
+static void
+emit_jcc_reg(struct bpf_jit_state *st, uint32_t op, uint32_t sreg,
+	uint32_t dreg, int32_t ofs)
+{
+	emit_cmp_reg(st, op, sreg, dreg);
+	emit_jcc(st, op, ofs);
+}
+
+/*
+ * emit one of:
+ *   cmp <imm>, <dreg>
+ *   cmn <-imm>, <dreg>
+ *   tst <imm>, <dreg>
+ */
+static void
+emit_jcc_imm(struct bpf_jit_state *st, uint32_t op, uint32_t dreg,
+	int32_t imm, int32_t ofs)
+{
+	if (BPF_OP(op) != BPF_JSET && imm >= 0 && imm < 4096)
+		emit_insn(st, 0xF100001F | imm << 10 | dreg << 5);
+	else if (BPF_OP(op) != BPF_JSET && imm < 0 && imm > -4096)
+		emit_insn(st, 0xB100001F | -imm << 10 | dreg << 5);
+	else {
+		emit_mov_imm(st, 1, REG_TMP0, (int64_t)imm);
+		emit_cmp_reg(st, op, REG_TMP0, dreg);
+	}
+
+	emit_jcc(st, op, ofs);
+}
+
+/*
+ * emit:
+ *   mov <imm64>, tmp0
+ *   blr tmp0
+ *   mov x0, <R0>
+ */
+static void
+emit_call(struct bpf_jit_state *st, uintptr_t trg)
+{
+	USED(st->reguse, LR);
+
+	emit_mov_imm(st, 1, REG_TMP0, trg);
+	emit_insn(st, 0xD63F0000 | REG_TMP0 << 5);
+	emit_mov_reg(st, 1, X0, ebpf2a64[EBPF_REG_0]);
+}
+
+/*
+ * emit:
+ * for divisor in register, exit with zero return value if it is zero:
+ *   cbnz <sreg>, 1f
+ *   mov 0, <R0>
+ *   b <exit>
+ * 1:
+ * for divisor as immediate value:
+ *   mov <imm>, tmp1
+ * udiv <sreg>, <dreg>, tmp0
+ * either:
+ *   mov tmp0, <dreg>
+ * OR
+ *   msub tmp0, <sreg>, <dreg>, <dreg>
+ */
+static void
+emit_div(struct bpf_jit_state *st, uint32_t op, uint32_t sreg, uint32_t dreg,
+	int32_t imm)
+{
+	uint32_t sf;
+
+	sf = is64(op);
+
+	if (BPF_SRC(op) == BPF_X) {
+		emit_abs_cbz(st, 1, sf, sreg, st->sz + 3);
+		emit_mov_imm(st, 1, ebpf2a64[EBPF_REG_0], 0);
+		emit_abs_jmp(st, st->exit.off);
+	} else {
+		sreg = REG_TMP1;
+		emit_mov_imm(st, sf, sreg, (int64_t)imm);
+	}
+
+	/* udiv <dreg>, <sreg>, tmp0 */
+	emit_insn(st, 0x1AC00800 | sf << 31 | sreg << 16 | dreg << 5 |
+		REG_TMP0);
+
+	if (BPF_OP(op) == BPF_DIV)
+		emit_mov_reg(st, sf, REG_TMP0, dreg);
+	else
+		/* msub tmp0, <sreg>, <dreg>, <dreg> */
+		emit_insn(st, 0x1B008000 | sf << 31 | sreg << 16 | dreg << 10 |
+			REG_TMP0 << 5 | dreg);
+}
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'fast_path':
+ * calculate load offset and check is it inside first packet segment.
+ */
+static void
+emit_ldmb_fast_path(struct bpf_jit_state *st, uint32_t mode, uint32_t sreg,
+	uint32_t sz, int32_t imm, const int32_t ofs[])
+{
+	const uint32_t r0 = ebpf2a64[EBPF_REG_0];
+	const uint32_t r2 = ebpf2a64[EBPF_REG_2];
+	const uint32_t r3 = ebpf2a64[EBPF_REG_3];
+	const uint32_t r6 = ebpf2a64[EBPF_REG_6];
+
+	/* R2 = (uint32_t)(imm + <sreg>) */
+	if (mode == BPF_IND) {
+		emit_mov_imm(st, 0, REG_TMP0, (uint32_t)imm);
+		emit_insn(st, 0x0B000000 | sreg << 16 | REG_TMP0 << 5 | r2);
+	} else
+		emit_mov_imm(st, 0, r2, (uint32_t)imm);
+
+	/* R3 = mbuf->data_len - R2 */
+	emit_ldst(st, 1, BPF_H, r3, r6, offsetof(struct rte_mbuf, data_len));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_SUB | BPF_X, r2, r3);
+
+	/* JSLT R3, <sz> <slow_path> */
+	emit_insn(st, 0xF100001F | sz << 10 | r3 << 5);
+	emit_abs_jcc(st, BPF_JMP | EBPF_JSLT | BPF_K, ofs[1]);
+
+	/* R0 = mbuf->buf_addr + mbuf->data_off + R2 */
+	emit_ldst(st, 1, BPF_H, r3, r6, offsetof(struct rte_mbuf, data_off));
+	emit_ldst(st, 1, EBPF_DW, r0, r6, offsetof(struct rte_mbuf, buf_addr));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, r3, r0);
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, r2, r0);
+
+	/* JMP <fin_part> */
+	emit_abs_jmp(st, ofs[2]);
+}
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'slow_path':
+ * call __rte_pktmbuf_read() with the buffer at the bottom of the stack,
+ * exit with zero return value if it fails.
+ */
+static void
+emit_ldmb_slow_path(struct bpf_jit_state *st, uint32_t sz)
+{
+	const uint32_t r0 = ebpf2a64[EBPF_REG_0];
+
+	/* R1 = mbuf, R3 = len, R4 = buf */
+	emit_mov_reg(st, 1, ebpf2a64[EBPF_REG_6], ebpf2a64[EBPF_REG_1]);
+	emit_mov_imm(st, 1, ebpf2a64[EBPF_REG_3], sz);
+	emit_add_sp(st, SP, ebpf2a64[EBPF_REG_4], 0);
+
+	emit_call(st, (uintptr_t)__rte_pktmbuf_read);
+
+	/* JEQ R0, 0 <exit> */
+	emit_abs_cbz(st, 0, 1, r0, st->exit.off);
+}
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'final part':
+ * load the value and convert it from network byte order.
+ */
+static void
+emit_ldmb_fin(struct bpf_jit_state *st, uint32_t opsz, uint32_t sz)
+{
+	const uint32_t r0 = ebpf2a64[EBPF_REG_0];
+
+	emit_ldst(st, 1, opsz, r0, r0, 0);
+	if (sz != sizeof(uint8_t))
+		emit_be2le(st, r0, sz * CHAR_BIT);
+}
+
+/*
+ * emit code for BPF_ABS/BPF_IND load instructions:
+ * the value is loaded from the first segment inline,
+ * __rte_pktmbuf_read() is called only for data beyond it.
+ */
+static void
+emit_ld_mbuf(struct bpf_jit_state *st, uint32_t op, uint32_t sreg, int32_t imm)
+{
+	uint32_t i, mode, opsz, sz;
+	int32_t ofs[3];
+
+	mode = BPF_MODE(op);
+	opsz = BPF_SIZE(op);
+	sz = bpf_size(opsz);
+
+	USED(st->reguse, ebpf2a64[EBPF_REG_6]);
+
+	/* dry run first to calculate jump offsets */
+	for (i = 0; i != RTE_DIM(ofs); i++)
+		ofs[i] = st->sz;
+
+	emit_ldmb_fast_path(st, mode, sreg, sz, imm, ofs);
+	ofs[1] = st->sz;
+	emit_ldmb_slow_path(st, sz);
+	ofs[2] = st->sz;
+	emit_ldmb_fin(st, opsz, sz);
+
+	/* reset dry-run code and do a proper run */
+	st->sz = ofs[0];
+	emit_ldmb_fast_path(st, mode, sreg, sz, imm, ofs);
+	emit_ldmb_slow_path(st, sz);
+	emit_ldmb_fin(st, opsz, sz);
+}
+
+static void
+emit_prolog(struct bpf_jit_state *st)
+{
+	uint32_t i;
+
+	if (INUSE(st->reguse, LR) != 0) {
+		/* stp fp, lr, [sp, #-16]! ; mov fp, sp */
+		emit_insn(st, 0xA9BF0000 | LR << 10 | SP << 5 | FP);
+		emit_add_sp(st, SP, FP, 0);
+	}
+
+	for (i = 0; i != RTE_DIM(save_regs); i++) {
+		if (INUSE(st->reguse, save_regs[i][0]) != 0 ||
+				INUSE(st->reguse, save_regs[i][1]) != 0)
+			/* stp <r1>, <r2>, [sp, #-16]! */
+			emit_insn(st, 0xA9BF0000 | save_regs[i][1] << 10 |
+				SP << 5 | save_regs[i][0]);
+	}
+
+	if (INUSE(st->reguse, ebpf2a64[EBPF_REG_10]) != 0)
+		emit_add_sp(st, SP, ebpf2a64[EBPF_REG_10], 0);
+
+	if (st->stack_sz != 0)
+		emit_sub_sp(st, SP, SP, st->stack_sz);
+}
+
+/*
+ * emit prfm pldl1keep, (<reg>)
+ */
+static void
+emit_prefetch(struct bpf_jit_state *st, uint32_t reg)
+{
+	emit_insn(st, 0xF9800000 | reg << 5);
+}
+
+/*
+ * burst entry: uint32_t (*)(void *ctx[], uint64_t rc[], uint32_t num).
+ * save all callee saved registers and the arguments, then start the loop:
+ * load ctx[i] into R1 and prefetch the next context.
+ */
+static void
+emit_burst_prolog(struct bpf_jit_state *st)
+{
+	uint32_t i;
+
+	/* stp fp, lr, [sp, #-16]! ; mov fp, sp */
+	emit_insn(st, 0xA9BF0000 | LR << 10 | SP << 5 | FP);
+	emit_add_sp(st, SP, FP, 0);
+
+	/* stp <r1>, <r2>, [sp, #-16]! */
+	for (i = 0; i != RTE_DIM(save_regs); i++)
+		emit_insn(st, 0xA9BF0000 | save_regs[i][1] << 10 |
+			SP << 5 | save_regs[i][0]);
+	for (i = 0; i != RTE_DIM(burst_regs); i++)
+		emit_insn(st, 0xA9BF0000 | burst_regs[i][1] << 10 |
+			SP << 5 | burst_regs[i][0]);
+
+	emit_mov_reg(st, 1, X0, REG_BURST_CTX);
+	emit_mov_reg(st, 1, X1, REG_BURST_RC);
+	emit_mov_reg(st, 0, X2, REG_BURST_LEFT);
+	emit_mov_reg(st, 0, X2, REG_BURST_NUM);
+
+	emit_add_sp(st, SP, ebpf2a64[EBPF_REG_10], 0);
+	if (st->stack_sz != 0)
+		emit_sub_sp(st, SP, SP, st->stack_sz);
+
+	/* if (num == 0) goto end */
+	emit_abs_cbz(st, 0, 1, REG_BURST_LEFT, st->burst.end);
+
+	/* loop: R1 = *ctx++ */
+	st->burst.loop = st->sz;
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, REG_BURST_CTX,
+		ebpf2a64[EBPF_REG_1], 0);
+	emit_alu_imm(st, EBPF_ALU64 | BPF_ADD | BPF_K, REG_BURST_CTX,
+		sizeof(uint64_t));
+
+	/* if (--left != 0) prefetch(*ctx) */
+	emit_alu_imm(st, EBPF_ALU64 | BPF_SUB | BPF_K, REG_BURST_LEFT, 1);
+	emit_abs_cbz(st, 0, 1, REG_BURST_LEFT, st->sz + 3);
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, REG_BURST_CTX, REG_TMP0,
+		0);
+	emit_prefetch(st, REG_TMP0);
+}
+
+/*
+ * end of the burst loop body: store R0 into *rc++ and
+ * continue with the next context, or restore registers and
+ * return the number of processed contexts.
+ */
+static void
+emit_burst_epilog(struct bpf_jit_state *st)
+{
+	uint32_t i;
+
+	emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, ebpf2a64[EBPF_REG_0],
+		REG_BURST_RC, 0);
+	emit_alu_imm(st, EBPF_ALU64 | BPF_ADD | BPF_K, REG_BURST_RC,
+		sizeof(uint64_t));
+	emit_abs_cbz(st, 1, 1, REG_BURST_LEFT, st->burst.loop);
+
+	/* end: return num */
+	st->burst.end = st->sz;
+	emit_mov_reg(st, 0, REG_BURST_NUM, X0);
+
+	if (st->stack_sz != 0)
+		emit_add_sp(st, SP, SP, st->stack_sz);
+
+	/* ldp <r1>, <r2>, [sp], #16 */
+	for (i = RTE_DIM(burst_regs); i-- != 0; )
+		emit_insn(st, 0xA8C10000 | burst_regs[i][1] << 10 |
+			SP << 5 | burst_regs[i][0]);
+	for (i = RTE_DIM(save_regs); i-- != 0; )
+		emit_insn(st, 0xA8C10000 | save_regs[i][1] << 10 |
+			SP << 5 | save_regs[i][0]);
+
+	/* ldp fp, lr, [sp], #16 */
+	emit_insn(st, 0xA8C10000 | LR << 10 | SP << 5 | FP);
+
+	/* ret */
+	emit_insn(st, 0xD65F03C0);
+}
+
+static void
+emit_epilog(struct bpf_jit_state *st)
+{
+	uint32_t i;
+
+	/* if we already have an epilog generate a jump to it */
+	if (st->exit.num++ != 0) {
+		emit_abs_jmp(st, st->exit.off);
+		return;
+	}
+
+	/* store offset of epilog block */
+	st->exit.off = st->sz;
+
+	if (st->burst.on != 0) {
+		emit_burst_epilog(st);
+		return;
+	}
+
+	if (st->stack_sz != 0)
+		emit_add_sp(st, SP, SP, st->stack_sz);
+
+	for (i = RTE_DIM(save_regs); i-- != 0; ) {
+		if (INUSE(st->reguse, save_regs[i][0]) != 0 ||
+				INUSE(st->reguse, save_regs[i][1]) != 0)
+			/* ldp <r1>, <r2>, [sp], #16 */
+			emit_insn(st, 0xA8C10000 | save_regs[i][1] << 10 |
+				SP << 5 | save_regs[i][0]);
+	}
+
+	if (INUSE(st->reguse, LR) != 0)
+		/* ldp fp, lr, [sp], #16 */
+		emit_insn(st, 0xA8C10000 | LR << 10 | SP << 5 | FP);
+
+	emit_mov_reg(st, 1, ebpf2a64[EBPF_REG_0], X0);
+
+	/* ret */
+	emit_insn(st, 0xD65F03C0);
+}
+
+/*
+ * walk through bpf code and translate them arm64 one.
+ */
+static int
+emit(struct bpf_jit_state *st, const struct rte_bpf *bpf)
+{
+	uint32_t i, dr, op, sr;
+	const struct ebpf_insn *ins;
+
+	/* reset state fields */
+	st->sz = 0;
+	st->exit.num = 0;
+
+	if (st->burst.on != 0)
+		emit_burst_prolog(st);
+	else
+		emit_prolog(st);
+
+	for (i = 0; i != bpf->prm.nb_ins; i++) {
+
+		st->idx = i;
+		st->off[i] = st->sz;
+
+		ins = bpf->prm.ins + i;
+
+		dr = ebpf2a64[ins->dst_reg];
+		sr = ebpf2a64[ins->src_reg];
+		op = ins->code;
+
+		USED(st->reguse, dr);
+		USED(st->reguse, sr);
+
+		switch (op) {
+		/* 32 bit ALU IMM operations */
+		case (BPF_ALU | BPF_ADD | BPF_K):
+		case (BPF_ALU | BPF_SUB | BPF_K):
+		case (BPF_ALU | BPF_AND | BPF_K):
+		case (BPF_ALU | BPF_OR | BPF_K):
+		case (BPF_ALU | BPF_XOR | BPF_K):
+			emit_alu_imm(st, op, dr, ins->imm);
+			break;
+		case (BPF_ALU | BPF_LSH | BPF_K):
+		case (BPF_ALU | BPF_RSH | BPF_K):
+			emit_shift_imm(st, op, dr, ins->imm);
+			break;
+		case (BPF_ALU | EBPF_MOV | BPF_K):
+			emit_mov_imm(st, 0, dr, (uint32_t)ins->imm);
+			break;
+		/* 32 bit ALU REG operations */
+		case (BPF_ALU | BPF_ADD | BPF_X):
+		case (BPF_ALU | BPF_SUB | BPF_X):
+		case (BPF_ALU | BPF_AND | BPF_X):
+		case (BPF_ALU | BPF_OR | BPF_X):
+		case (BPF_ALU | BPF_XOR | BPF_X):
+		case (BPF_ALU | BPF_LSH | BPF_X):
+		case (BPF_ALU | BPF_RSH | BPF_X):
+			emit_alu_reg(st, op, sr, dr);
+			break;
+		case (BPF_ALU | EBPF_MOV | BPF_X):
+			emit_mov_reg(st, 0, sr, dr);
+			break;
+		case (BPF_ALU | BPF_NEG):
+			emit_neg(st, op, dr);
+			break;
+		case (BPF_ALU | EBPF_END | EBPF_TO_BE):
+			emit_be2le(st, dr, ins->imm);
+			break;
+		case (BPF_ALU | EBPF_END | EBPF_TO_LE):
+			emit_le2be(st, dr, ins->imm);
+			break;
+		/* 64 bit ALU IMM operations */
+		case (EBPF_ALU64 | BPF_ADD | BPF_K):
+		case (EBPF_ALU64 | BPF_SUB | BPF_K):
+		case (EBPF_ALU64 | BPF_AND | BPF_K):
+		case (EBPF_ALU64 | BPF_OR | BPF_K):
+		case (EBPF_ALU64 | BPF_XOR | BPF_K):
+			emit_alu_imm(st, op, dr, ins->imm);
+			break;
+		case (EBPF_ALU64 | BPF_LSH | BPF_K):
+		case (EBPF_ALU64 | BPF_RSH | BPF_K):
+		case (EBPF_ALU64 | EBPF_ARSH | BPF_K):
+			emit_shift_imm(st, op, dr, ins->imm);
+			break;
+		case (EBPF_ALU64 | EBPF_MOV | BPF_K):
+			emit_mov_imm(st, 1, dr, (int64_t)ins->imm);
+			break;
+		/* 64 bit ALU REG operations */
+		case (EBPF_ALU64 | BPF_ADD | BPF_X):
+		case (EBPF_ALU64 | BPF_SUB | BPF_X):
+		case (EBPF_ALU64 | BPF_AND | BPF_X):
+		case (EBPF_ALU64 | BPF_OR | BPF_X):
+		case (EBPF_ALU64 | BPF_XOR | BPF_X):
+		case (EBPF_ALU64 | BPF_LSH | BPF_X):
+		case (EBPF_ALU64 | BPF_RSH | BPF_X):
+		case (EBPF_ALU64 | EBPF_ARSH | BPF_X):
+			emit_alu_reg(st, op, sr, dr);
+			break;
+		case (EBPF_ALU64 | EBPF_MOV | BPF_X):
+			emit_mov_reg(st, 1, sr, dr);
+			break;
+		case (EBPF_ALU64 | BPF_NEG):
+			emit_neg(st, op, dr);
+			break;
+		/* multiply instructions */
+		case (BPF_ALU | BPF_MUL | BPF_K):
+		case (EBPF_ALU64 | BPF_MUL | BPF_K):
+			emit_alu_imm(st, op, dr, ins->imm);
+			break;
+		case (BPF_ALU | BPF_MUL | BPF_X):
+		case (EBPF_ALU64 | BPF_MUL | BPF_X):
+			emit_alu_reg(st, op, sr, dr);
+			break;
+		/* divide instructions */
+		case (BPF_ALU | BPF_DIV | BPF_K):
+		case (BPF_ALU | BPF_MOD | BPF_K):
+		case (BPF_ALU | BPF_DIV | BPF_X):
+		case (BPF_ALU | BPF_MOD | BPF_X):
+		case (EBPF_ALU64 | BPF_DIV | BPF_K):
+		case (EBPF_ALU64 | BPF_MOD | BPF_K):
+		case (EBPF_ALU64 | BPF_DIV | BPF_X):
+		case (EBPF_ALU64 | BPF_MOD | BPF_X):
+			emit_div(st, op, sr, dr, ins->imm);
+			break;
+		/* load instructions */
+		case (BPF_LDX | BPF_MEM | BPF_B):
+		case (BPF_LDX | BPF_MEM | BPF_H):
+		case (BPF_LDX | BPF_MEM | BPF_W):
+		case (BPF_LDX | BPF_MEM | EBPF_DW):
+			emit_ld_reg(st, op, sr, dr, ins->off);
+			break;
+		/* load 64 bit immediate value */
+		case (BPF_LD | BPF_IMM | EBPF_DW):
+			emit_mov_imm(st, 1, dr, (uint32_t)ins[0].imm |
+				(uint64_t)(uint32_t)ins[1].imm << 32);
+			i++;
+			break;
+		/* load absolute/indirect instructions */
+		case (BPF_LD | BPF_ABS | BPF_B):
+		case (BPF_LD | BPF_ABS | BPF_H):
+		case (BPF_LD | BPF_ABS | BPF_W):
+		case (BPF_LD | BPF_IND | BPF_B):
+		case (BPF_LD | BPF_IND | BPF_H):
+		case (BPF_LD | BPF_IND | BPF_W):
+			emit_ld_mbuf(st, op, sr, ins->imm);
+			break;
+		/* store instructions */
+		case (BPF_STX | BPF_MEM | BPF_B):
+		case (BPF_STX | BPF_MEM | BPF_H):
+		case (BPF_STX | BPF_MEM | BPF_W):
+		case (BPF_STX | BPF_MEM | EBPF_DW):
+			emit_st_reg(st, op, sr, dr, ins->off);
+			break;
+		case (BPF_ST | BPF_MEM | BPF_B):
+		case (BPF_ST | BPF_MEM | BPF_H):
+		case (BPF_ST | BPF_MEM | BPF_W):
+		case (BPF_ST | BPF_MEM | EBPF_DW):
+			emit_st_imm(st, op, dr, ins->imm, ins->off);
+			break;
+		/* atomic add instructions */
+		case (BPF_STX | EBPF_XADD | BPF_W):
+		case (BPF_STX | EBPF_XADD | EBPF_DW):
+			emit_st_xadd(st, op, sr, dr, ins->off);
+			break;
+		/* jump instructions */
+		case (BPF_JMP | BPF_JA):
+			emit_jmp(st, ins->off + 1);
+			break;
+		/* jump IMM instructions */
+		case (BPF_JMP | BPF_JEQ | BPF_K):
+		case (BPF_JMP | EBPF_JNE | BPF_K):
+		case (BPF_JMP | BPF_JGT | BPF_K):
+		case (BPF_JMP | EBPF_JLT | BPF_K):
+		case (BPF_JMP | BPF_JGE | BPF_K):
+		case (BPF_JMP | EBPF_JLE | BPF_K):
+		case (BPF_JMP | EBPF_JSGT | BPF_K):
+		case (BPF_JMP | EBPF_JSLT | BPF_K):
+		case (BPF_JMP | EBPF_JSGE | BPF_K):
+		case (BPF_JMP | EBPF_JSLE | BPF_K):
+		case (BPF_JMP | BPF_JSET | BPF_K):
+			emit_jcc_imm(st, op, dr, ins->imm, ins->off + 1);
+			break;
+		/* jump REG instructions */
+		case (BPF_JMP | BPF_JEQ | BPF_X):
+		case (BPF_JMP | EBPF_JNE | BPF_X):
+		case (BPF_JMP | BPF_JGT | BPF_X):
+		case (BPF_JMP | EBPF_JLT | BPF_X):
+		case (BPF_JMP | BPF_JGE | BPF_X):
+		case (BPF_JMP | EBPF_JLE | BPF_X):
+		case (BPF_JMP | EBPF_JSGT | BPF_X):
+		case (BPF_JMP | EBPF_JSLT | BPF_X):
+		case (BPF_JMP | EBPF_JSGE | BPF_X):
+		case (BPF_JMP | EBPF_JSLE | BPF_X):
+		case (BPF_JMP | BPF_JSET | BPF_X):
+			emit_jcc_reg(st, op, sr, dr, ins->off + 1);
+			break;
+		/* call instructions */
+		case (BPF_JMP | EBPF_CALL):
+			emit_call(st,
+				(uintptr_t)bpf->prm.xsym[ins->imm].func.val);
+			break;
+		/* return instruction */
+		case (BPF_JMP | EBPF_EXIT):
+			emit_epilog(st);
+			break;
+		default:
+			RTE_BPF_LOG(ERR,
+				"%s(%p): invalid opcode %#x at pc: %u;\n",
+				__func__, bpf, ins->code, i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * dry runs, used to calculate total code size, registers in use
+ * and valid jump offsets. Stop when code size doesn't change.
+ */
+static int
+emit_dry_run(struct bpf_jit_state *st, const struct rte_bpf *bpf)
+{
+	int32_t rc;
+	uint32_t i;
+	size_t sz;
+
+	st->off = malloc(bpf->prm.nb_ins * sizeof(st->off[0]));
+	if (st->off == NULL)
+		return -ENOMEM;
+
+	/* keep stack pointer 16B aligned, as required by AAPCS64 */
+	st->stack_sz = RTE_ALIGN_CEIL(bpf->stack_sz, 16);
+
+	/* fill with fake offsets */
+	st->exit.off = 0;
+	st->burst.end = 0;
+	for (i = 0; i != bpf->prm.nb_ins; i++)
+		st->off[i] = 0;
+
+	do {
+		sz = st->sz;
+		rc = emit(st, bpf);
+	} while (rc == 0 && sz != st->sz);
+
+	/* all branch targets have to be within the reach of b.cond */
+	if (rc == 0 && st->sz >= MAX_JCC_DIST)
+		rc = -ERANGE;
+
+	return rc;
+}
+
+/*
+ * produce a native ISA version of the given BPF code:
+ * per context entry point, followed by the burst one.
+ */
+int
+bpf_jit_arm64(struct rte_bpf *bpf)
+{
+	int32_t rc;
+	uint32_t i;
+	size_t ofs, sz;
+	uint32_t *ins;
+	struct bpf_jit_state st[JIT_NUM];
+
+	/* init state */
+	memset(st, 0, sizeof(st));
+	st[JIT_BURST].burst.on = 1;
+
+	rc = 0;
+	for (i = 0; i != RTE_DIM(st) && rc == 0; i++)
+		rc = emit_dry_run(st + i, bpf);
+
+	/* burst entry starts at the next cache line */
+	ofs = RTE_ALIGN_CEIL(st[JIT_FUNC].sz * sizeof(ins[0]),
+		RTE_CACHE_LINE_SIZE);
+	sz = ofs + st[JIT_BURST].sz * sizeof(ins[0]);
+	ins = NULL;
+
+	if (rc == 0) {
+
+		/* allocate memory needed */
+		ins = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ins == MAP_FAILED) {
+			ins = NULL;
+			rc = -ENOMEM;
+		} else {
+			/* generate code */
+			st[JIT_FUNC].ins = ins;
+			st[JIT_BURST].ins = ins + ofs / sizeof(ins[0]);
+			for (i = 0; i != RTE_DIM(st) && rc == 0; i++)
+				rc = emit(st + i, bpf);
+		}
+	}
+
+	if (rc == 0) {
+		__builtin___clear_cache((char *)ins, (char *)ins + sz);
+		if (mprotect(ins, sz, PROT_READ | PROT_EXEC) != 0)
+			rc = -ENOMEM;
+	}
+
+	if (rc != 0) {
+		if (ins != NULL)
+			munmap(ins, sz);
+	} else {
+		bpf->jit.func = (void *)ins;
+		bpf->jit.burst = (void *)((uintptr_t)ins + ofs);
+		bpf->jit.sz = sz;
+	}
+
+	for (i = 0; i != RTE_DIM(st); i++)
+		free(st[i].off);
+	return rc;
+}
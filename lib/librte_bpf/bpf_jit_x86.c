@@ -87,12 +87,39 @@ enum {
 	REG_TMP1 = R10,
 };
 
+/*
+ * r12 is not used by eBPF code, the burst entry keeps
+ * the offset of the current context in it.
+ */
+#define REG_BURST_IDX	R12
+
 /*
  * callee saved registers list.
  * keep RBP as the last one.
  */
 static const uint32_t save_regs[] = {RBX, R12, R13, R14, R15, RBP};
 
+/*
+ * burst entry frame (in 64-bit slots above %rbp):
+ * callee saved registers, followed by the arguments
+ * that have to survive the loop iterations.
+ */
+enum {
+	BURST_SLOT_CTX = RTE_DIM(save_regs),
+	BURST_SLOT_RC,
+	BURST_SLOT_NUM,
+	BURST_SLOT_MAX,
+};
+
+/*
+ * generated entry points: per context one and burst one.
+ */
+enum {
+	JIT_FUNC,
+	JIT_BURST,
+	JIT_NUM,
+};
+
 struct bpf_jit_state {
 	uint32_t idx;
 	size_t sz;
@@ -100,6 +127,15 @@ struct bpf_jit_state {
 		uint32_t num;
 		int32_t off;
 	} exit;
+	struct {
+		uint32_t on;   /* generate burst entry */
+		int32_t loop;  /* start of the loop */
+		int32_t next;  /* end of the prefetch block */
+		int32_t end;   /* end of the loop */
+	} burst;
+	struct {
+		uint32_t stack_ofs;
+	} ldmb;
 	uint32_t reguse;
 	int32_t *off;
 	uint8_t *ins;
@@ -1024,6 +1060,140 @@ emit_div(struct bpf_jit_state *st, uint32_t op, uint32_t sreg, uint32_t dreg,
 		emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, REG_TMP1, RDX);
 }
 
+/*
+ * code blocks generated for BPF_ABS/BPF_IND load instructions.
+ */
+enum {
+	LDMB_FSP_OFS, /* fast-path */
+	LDMB_SLP_OFS, /* slow-path */
+	LDMB_FIN_OFS, /* final part */
+	LDMB_OFS_NUM
+};
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'fast_path':
+ * calculate load offset and check is it inside first packet segment.
+ */
+static void
+emit_ldmb_fast_path(struct bpf_jit_state *st, uint32_t mode, uint32_t sreg,
+	uint32_t sz, uint32_t imm, const int32_t ofs[LDMB_OFS_NUM])
+{
+	const uint32_t r0 = ebpf2x86[EBPF_REG_0];
+	const uint32_t r2 = ebpf2x86[EBPF_REG_2];
+	const uint32_t r3 = ebpf2x86[EBPF_REG_3];
+	const uint32_t r6 = ebpf2x86[EBPF_REG_6];
+
+	/* R2 = (uint32_t)(imm + <sreg>) */
+	if (mode == BPF_IND && sreg == r2)
+		emit_alu_imm(st, BPF_ALU | BPF_ADD | BPF_K, r2, imm);
+	else {
+		emit_mov_imm(st, BPF_ALU | EBPF_MOV | BPF_K, r2, imm);
+		if (mode == BPF_IND)
+			emit_alu_reg(st, BPF_ALU | BPF_ADD | BPF_X, sreg, r2);
+	}
+
+	/* R3 = mbuf->data_len - R2 */
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | BPF_H, r6, r3,
+		offsetof(struct rte_mbuf, data_len));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_SUB | BPF_X, r2, r3);
+
+	/* JSLT R3, <sz> <slow_path> */
+	emit_cmp_imm(st, EBPF_ALU64, r3, sz);
+	emit_abs_jcc(st, BPF_JMP | EBPF_JSLT | BPF_K, ofs[LDMB_SLP_OFS]);
+
+	/* R0 = mbuf->buf_addr + mbuf->data_off + R2 */
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | BPF_H, r6, r3,
+		offsetof(struct rte_mbuf, data_off));
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, r6, r0,
+		offsetof(struct rte_mbuf, buf_addr));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, r3, r0);
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, r2, r0);
+
+	/* JMP <fin_part> */
+	emit_abs_jmp(st, ofs[LDMB_FIN_OFS]);
+}
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'slow_path':
+ * call __rte_pktmbuf_read() with the buffer at the bottom of the stack,
+ * exit with zero return value if it fails.
+ */
+static void
+emit_ldmb_slow_path(struct bpf_jit_state *st, uint32_t sz)
+{
+	const uint32_t r0 = ebpf2x86[EBPF_REG_0];
+	const uint32_t r4 = ebpf2x86[EBPF_REG_4];
+
+	/* R1 = mbuf, R3 = len, R4 = buf */
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, ebpf2x86[EBPF_REG_6],
+		ebpf2x86[EBPF_REG_1]);
+	emit_mov_imm(st, EBPF_ALU64 | EBPF_MOV | BPF_K, ebpf2x86[EBPF_REG_3],
+		sz);
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, RBP, r4);
+	emit_alu_imm(st, EBPF_ALU64 | BPF_SUB | BPF_K, r4, st->ldmb.stack_ofs);
+
+	emit_call(st, (uintptr_t)__rte_pktmbuf_read);
+
+	/* JEQ R0, 0 <exit> */
+	emit_tst_reg(st, EBPF_ALU64, r0, r0);
+	emit_abs_jcc(st, BPF_JMP | BPF_JEQ | BPF_K, st->exit.off);
+}
+
+/*
+ * helper function, used by emit_ld_mbuf().
+ * generates code for 'final part':
+ * load the value and convert it from network byte order.
+ */
+static void
+emit_ldmb_fin(struct bpf_jit_state *st, uint32_t opsz, uint32_t sz)
+{
+	const uint32_t r0 = ebpf2x86[EBPF_REG_0];
+
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | opsz, r0, r0, 0);
+	if (sz != sizeof(uint8_t))
+		emit_be2le(st, r0, sz * CHAR_BIT);
+}
+
+/*
+ * emit code for BPF_ABS/BPF_IND load instructions:
+ * the value is loaded from the first segment inline,
+ * __rte_pktmbuf_read() is called only for data beyond it.
+ */
+static void
+emit_ld_mbuf(struct bpf_jit_state *st, uint32_t op, uint32_t sreg,
+	uint32_t imm)
+{
+	uint32_t i, mode, opsz, sz;
+	int32_t ofs[LDMB_OFS_NUM];
+
+	mode = BPF_MODE(op);
+	opsz = BPF_SIZE(op);
+	sz = bpf_size(opsz);
+
+	/* fill with fake offsets */
+	for (i = 0; i != RTE_DIM(ofs); i++)
+		ofs[i] = st->sz + INT8_MAX;
+
+	/* dry run first to calculate jump offsets */
+	ofs[LDMB_FSP_OFS] = st->sz;
+	emit_ldmb_fast_path(st, mode, sreg, sz, imm, ofs);
+	ofs[LDMB_SLP_OFS] = st->sz;
+	emit_ldmb_slow_path(st, sz);
+	ofs[LDMB_FIN_OFS] = st->sz;
+	emit_ldmb_fin(st, opsz, sz);
+
+	/* short jumps are used within the block */
+	RTE_VERIFY(ofs[LDMB_FIN_OFS] - ofs[LDMB_FSP_OFS] <= INT8_MAX);
+
+	/* reset dry-run code and do a proper run */
+	st->sz = ofs[LDMB_FSP_OFS];
+	emit_ldmb_fast_path(st, mode, sreg, sz, imm, ofs);
+	emit_ldmb_slow_path(st, sz);
+	emit_ldmb_fin(st, opsz, sz);
+}
+
 static void
 emit_prolog(struct bpf_jit_state *st, int32_t stack_size)
 {
@@ -1057,6 +1227,82 @@ emit_prolog(struct bpf_jit_state *st, int32_t stack_size)
 	}
 }
 
+/*
+ * emit prefetcht0 (%<reg>)
+ */
+static void
+emit_prefetch(struct bpf_jit_state *st, uint32_t reg)
+{
+	const uint8_t ops[] = {0x0F, 0x18};
+	const uint8_t mods = 1;
+
+	emit_rex(st, BPF_ALU, 0, reg);
+	emit_bytes(st, ops, sizeof(ops));
+	emit_modregrm(st, MOD_IDISP8, mods, reg);
+	if (reg == RSP || reg == R12)
+		emit_sib(st, SIB_SCALE_1, reg, reg);
+	emit_imm(st, 0, sizeof(uint8_t));
+}
+
+/*
+ * burst entry: uint32_t (*)(void *ctx[], uint64_t rc[], uint32_t num).
+ * save all callee saved registers and the arguments, then start the loop:
+ * load ctx[i] into R1 and prefetch the next context.
+ */
+static void
+emit_burst_prolog(struct bpf_jit_state *st, int32_t stack_size)
+{
+	uint32_t i;
+	const uint32_t r1 = ebpf2x86[EBPF_REG_1];
+
+	emit_alu_imm(st, EBPF_ALU64 | BPF_SUB | BPF_K, RSP,
+		BURST_SLOT_MAX * sizeof(uint64_t));
+
+	for (i = 0; i != RTE_DIM(save_regs); i++)
+		emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, save_regs[i], RSP,
+			i * sizeof(uint64_t));
+
+	/* num is kept as the byte offset past the last context */
+	emit_mov_reg(st, BPF_ALU | EBPF_MOV | BPF_X, RDX, RDX);
+	emit_shift_imm(st, EBPF_ALU64 | BPF_LSH | BPF_K, RDX, 3);
+
+	emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, RDI, RSP,
+		BURST_SLOT_CTX * sizeof(uint64_t));
+	emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, RSI, RSP,
+		BURST_SLOT_RC * sizeof(uint64_t));
+	emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, RDX, RSP,
+		BURST_SLOT_NUM * sizeof(uint64_t));
+
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, RSP, RBP);
+	emit_alu_imm(st, EBPF_ALU64 | BPF_SUB | BPF_K, RSP, stack_size);
+
+	/* i = 0; if (num == 0) goto end */
+	emit_mov_imm(st, EBPF_ALU64 | EBPF_MOV | BPF_K, REG_BURST_IDX, 0);
+	emit_tst_reg(st, EBPF_ALU64, RDX, RDX);
+	emit_abs_jcc(st, BPF_JMP | BPF_JEQ | BPF_K, st->burst.end);
+
+	/* loop: R1 = ctx[i] */
+	st->burst.loop = st->sz;
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RBP, RAX,
+		BURST_SLOT_CTX * sizeof(uint64_t));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, REG_BURST_IDX, RAX);
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RAX, r1, 0);
+
+	/* if (i + 1 < num) prefetch(ctx[i + 1]) */
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, REG_BURST_IDX,
+		REG_TMP0);
+	emit_alu_imm(st, EBPF_ALU64 | BPF_ADD | BPF_K, REG_TMP0,
+		sizeof(uint64_t));
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RBP, REG_TMP1,
+		BURST_SLOT_NUM * sizeof(uint64_t));
+	emit_cmp_reg(st, EBPF_ALU64, REG_TMP1, REG_TMP0);
+	emit_abs_jcc(st, BPF_JMP | BPF_JGE | BPF_X, st->burst.next);
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RAX, REG_TMP0,
+		sizeof(uint64_t));
+	emit_prefetch(st, REG_TMP0);
+	st->burst.next = st->sz;
+}
+
 /*
  * emit ret
  */
@@ -1068,6 +1314,45 @@ emit_ret(struct bpf_jit_state *st)
 	emit_bytes(st, &ops, sizeof(ops));
 }
 
+/*
+ * end of the burst loop body: store R0 into rc[i] and
+ * continue with the next context, or restore registers and
+ * return the number of processed contexts.
+ */
+static void
+emit_burst_epilog(struct bpf_jit_state *st)
+{
+	uint32_t i;
+
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RBP, REG_TMP0,
+		BURST_SLOT_RC * sizeof(uint64_t));
+	emit_alu_reg(st, EBPF_ALU64 | BPF_ADD | BPF_X, REG_BURST_IDX,
+		REG_TMP0);
+	emit_st_reg(st, BPF_STX | BPF_MEM | EBPF_DW, RAX, REG_TMP0, 0);
+
+	/* if (++i < num) goto loop */
+	emit_alu_imm(st, EBPF_ALU64 | BPF_ADD | BPF_K, REG_BURST_IDX,
+		sizeof(uint64_t));
+	emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RBP, REG_TMP1,
+		BURST_SLOT_NUM * sizeof(uint64_t));
+	emit_cmp_reg(st, EBPF_ALU64, REG_TMP1, REG_BURST_IDX);
+	emit_abs_jcc(st, BPF_JMP | EBPF_JLT | BPF_X, st->burst.loop);
+
+	/* end: return i */
+	st->burst.end = st->sz;
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, REG_BURST_IDX, RAX);
+	emit_shift_imm(st, EBPF_ALU64 | BPF_RSH | BPF_K, RAX, 3);
+
+	emit_mov_reg(st, EBPF_ALU64 | EBPF_MOV | BPF_X, RBP, RSP);
+	for (i = 0; i != RTE_DIM(save_regs); i++)
+		emit_ld_reg(st, BPF_LDX | BPF_MEM | EBPF_DW, RSP, save_regs[i],
+			i * sizeof(uint64_t));
+	emit_alu_imm(st, EBPF_ALU64 | BPF_ADD | BPF_K, RSP,
+		BURST_SLOT_MAX * sizeof(uint64_t));
+
+	emit_ret(st);
+}
+
 static void
 emit_epilog(struct bpf_jit_state *st)
 {
@@ -1083,6 +1368,11 @@ emit_epilog(struct bpf_jit_state *st)
 	/* store offset of epilog block */
 	st->exit.off = st->sz;
 
+	if (st->burst.on != 0) {
+		emit_burst_epilog(st);
+		return;
+	}
+
 	spil = 0;
 	for (i = 0; i != RTE_DIM(save_regs); i++)
 		spil += INUSE(st->reguse, save_regs[i]);
@@ -1121,8 +1411,12 @@ emit(struct bpf_jit_state *st, const struct rte_bpf *bpf)
 	/* reset state fields */
 	st->sz = 0;
 	st->exit.num = 0;
+	st->ldmb.stack_ofs = bpf->stack_sz;
 
-	emit_prolog(st, bpf->stack_sz);
+	if (st->burst.on != 0)
+		emit_burst_prolog(st, bpf->stack_sz);
+	else
+		emit_prolog(st, bpf->stack_sz);
 
 	for (i = 0; i != bpf->prm.nb_ins; i++) {
 
@@ -1240,6 +1534,15 @@ emit(struct bpf_jit_state *st, const struct rte_bpf *bpf)
 			emit_ld_imm64(st, dr, ins[0].imm, ins[1].imm);
 			i++;
 			break;
+		/* load absolute/indirect instructions */
+		case (BPF_LD | BPF_ABS | BPF_B):
+		case (BPF_LD | BPF_ABS | BPF_H):
+		case (BPF_LD | BPF_ABS | BPF_W):
+		case (BPF_LD | BPF_IND | BPF_B):
+		case (BPF_LD | BPF_IND | BPF_H):
+		case (BPF_LD | BPF_IND | BPF_W):
+			emit_ld_mbuf(st, op, sr, ins->imm);
+			break;
 		/* store instructions */
 		case (BPF_STX | BPF_MEM | BPF_B):
 		case (BPF_STX | BPF_MEM | BPF_H):
@@ -1311,58 +1614,91 @@ emit(struct bpf_jit_state *st, const struct rte_bpf *bpf)
 }
 
 /*
- * produce a native ISA version of the given BPF code.
+ * dry runs, used to calculate total code size and valid jump offsets.
+ * stop when we get minimal possible size
  */
-int
-bpf_jit_x86(struct rte_bpf *bpf)
+static int
+emit_dry_run(struct bpf_jit_state *st, const struct rte_bpf *bpf)
 {
 	int32_t rc;
 	uint32_t i;
 	size_t sz;
-	struct bpf_jit_state st;
 
-	/* init state */
-	memset(&st, 0, sizeof(st));
-	st.off = malloc(bpf->prm.nb_ins * sizeof(st.off[0]));
-	if (st.off == NULL)
+	st->off = malloc(bpf->prm.nb_ins * sizeof(st->off[0]));
+	if (st->off == NULL)
 		return -ENOMEM;
 
 	/* fill with fake offsets */
-	st.exit.off = INT32_MAX;
+	st->exit.off = INT32_MAX;
+	st->burst.next = INT32_MAX;
+	st->burst.end = INT32_MAX;
 	for (i = 0; i != bpf->prm.nb_ins; i++)
-		st.off[i] = INT32_MAX;
+		st->off[i] = INT32_MAX;
 
-	/*
-	 * dry runs, used to calculate total code size and valid jump offsets.
-	 * stop when we get minimal possible size
-	 */
 	do {
-		sz = st.sz;
-		rc = emit(&st, bpf);
-	} while (rc == 0 && sz != st.sz);
+		sz = st->sz;
+		rc = emit(st, bpf);
+	} while (rc == 0 && sz != st->sz);
+
+	return rc;
+}
+
+/*
+ * produce a native ISA version of the given BPF code:
+ * per context entry point, followed by the burst one.
+ */
+int
+bpf_jit_x86(struct rte_bpf *bpf)
+{
+	int32_t rc;
+	uint32_t i;
+	size_t ofs, sz;
+	uint8_t *ins;
+	struct bpf_jit_state st[JIT_NUM];
+
+	/* init state */
+	memset(st, 0, sizeof(st));
+	st[JIT_BURST].burst.on = 1;
+
+	rc = 0;
+	for (i = 0; i != RTE_DIM(st) && rc == 0; i++)
+		rc = emit_dry_run(st + i, bpf);
+
+	/* burst entry starts at the next cache line */
+	ofs = RTE_ALIGN_CEIL(st[JIT_FUNC].sz, RTE_CACHE_LINE_SIZE);
+	sz = ofs + st[JIT_BURST].sz;
+	ins = NULL;
 
 	if (rc == 0) {
 
 		/* allocate memory needed */
-		st.ins = mmap(NULL, st.sz, PROT_READ | PROT_WRITE,
+		ins = mmap(NULL, sz, PROT_READ | PROT_WRITE,
 			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-		if (st.ins == MAP_FAILED)
+		if (ins == MAP_FAILED) {
+			ins = NULL;
 			rc = -ENOMEM;
-		else
+		} else {
 			/* generate code */
-			rc = emit(&st, bpf);
+			st[JIT_FUNC].ins = ins;
+			st[JIT_BURST].ins = ins + ofs;
+			for (i = 0; i != RTE_DIM(st) && rc == 0; i++)
+				rc = emit(st + i, bpf);
+		}
 	}
 
-	if (rc == 0 && mprotect(st.ins, st.sz, PROT_READ | PROT_EXEC) != 0)
+	if (rc == 0 && mprotect(ins, sz, PROT_READ | PROT_EXEC) != 0)
 		rc = -ENOMEM;
 
-	if (rc != 0)
-		munmap(st.ins, st.sz);
-	else {
-		bpf->jit.func = (void *)st.ins;
-		bpf->jit.sz = st.sz;
+	if (rc != 0) {
+		if (ins != NULL)
+			munmap(ins, sz);
+	} else {
+		bpf->jit.func = (void *)ins;
+		bpf->jit.burst = (void *)(ins + ofs);
+		bpf->jit.sz = sz;
 	}
 
-	free(st.off);
+	for (i = 0; i != RTE_DIM(st); i++)
+		free(st[i].off);
 	return rc;
 }
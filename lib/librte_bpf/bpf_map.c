@@ -0,0 +1,523 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include <rte_common.h>
+#include <rte_log.h>
+#include <rte_debug.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_errno.h>
+#include <rte_string_fns.h>
+#include <rte_hash.h>
+
+#include "bpf_impl.h"
+
+/*
+ * BPF maps.
+ * Array elements are stored contiguously, each element rounded up to
+ * 8 bytes, so 64-bit values are naturally aligned.
+ * Lcore arrays keep one such array per lcore, each one cache line aligned.
+ * Hash map keys are stored in rte_hash, and values in an array indexed by
+ * the key position returned by rte_hash.
+ */
+
+enum {
+	BPF_MAP_XSYM_VAR,
+	BPF_MAP_XSYM_LOOKUP,
+	BPF_MAP_XSYM_UPDATE,
+	BPF_MAP_XSYM_DELETE,
+};
+
+#define BPF_MAP_XNAME_SIZE	(RTE_BPF_MAP_NAMESIZE + sizeof("_lookup"))
+
+/* minimum number of entries of rte_hash: one bucket */
+#define BPF_MAP_HASH_MIN_ENTRIES	8U
+
+struct rte_bpf_map {
+	void *(*lookup)(const struct rte_bpf_map *, const void *, uint32_t);
+	int (*update)(struct rte_bpf_map *, const void *, const void *,
+		uint64_t, uint32_t);
+	int (*delete)(struct rte_bpf_map *, const void *);
+	uint8_t *data;         /* values */
+	size_t elm_sz;         /* size of one value in data */
+	size_t lcore_sz;       /* size of the values of one lcore */
+	struct rte_hash *hash; /* keys, for hash maps */
+	struct rte_bpf_map_prm prm;
+	char name[RTE_BPF_MAP_NAMESIZE];
+	char xname[RTE_BPF_MAP_XSYM_NUM][BPF_MAP_XNAME_SIZE];
+	struct rte_bpf_xsym xsym[RTE_BPF_MAP_XSYM_NUM];
+};
+
+static void *
+array_lookup(const struct rte_bpf_map *map, const void *key, uint32_t lcore)
+{
+	uint32_t idx;
+
+	RTE_SET_USED(lcore);
+
+	idx = *(const uint32_t *)key;
+	if (idx >= map->prm.max_entries)
+		return NULL;
+
+	return map->data + idx * map->elm_sz;
+}
+
+static int
+array_update(struct rte_bpf_map *map, const void *key, const void *value,
+	uint64_t flags, uint32_t lcore)
+{
+	void *p;
+
+	if (flags == RTE_BPF_MAP_NOEXIST)
+		return -EEXIST;
+
+	p = map->lookup(map, key, lcore);
+	if (p == NULL)
+		return -E2BIG;
+
+	memcpy(p, value, map->prm.value_size);
+	return 0;
+}
+
+static int
+array_delete(struct rte_bpf_map *map, const void *key)
+{
+	RTE_SET_USED(map);
+	RTE_SET_USED(key);
+	return -EINVAL;
+}
+
+static void *
+lcore_array_lookup(const struct rte_bpf_map *map, const void *key,
+	uint32_t lcore)
+{
+	uint32_t idx;
+
+	idx = *(const uint32_t *)key;
+	if (idx >= map->prm.max_entries || lcore >= RTE_MAX_LCORE)
+		return NULL;
+
+	return map->data + lcore * map->lcore_sz + idx * map->elm_sz;
+}
+
+static int
+lcore_array_update(struct rte_bpf_map *map, const void *key,
+	const void *value, uint64_t flags, uint32_t lcore)
+{
+	uint32_t i;
+
+	/* from non-EAL thread: update the value for all lcores */
+	if (lcore != LCORE_ID_ANY)
+		return array_update(map, key, value, flags, lcore);
+
+	if (flags == RTE_BPF_MAP_NOEXIST)
+		return -EEXIST;
+
+	if (*(const uint32_t *)key >= map->prm.max_entries)
+		return -E2BIG;
+
+	for (i = 0; i != RTE_MAX_LCORE; i++)
+		memcpy(map->lookup(map, key, i), value, map->prm.value_size);
+	return 0;
+}
+
+static void *
+hash_lookup(const struct rte_bpf_map *map, const void *key, uint32_t lcore)
+{
+	int32_t pos;
+
+	RTE_SET_USED(lcore);
+
+	pos = rte_hash_lookup(map->hash, key);
+	if (pos < 0)
+		return NULL;
+
+	return map->data + pos * map->elm_sz;
+}
+
+static int
+hash_update(struct rte_bpf_map *map, const void *key, const void *value,
+	uint64_t flags, uint32_t lcore)
+{
+	int32_t pos;
+
+	RTE_SET_USED(lcore);
+
+	if (flags != RTE_BPF_MAP_ANY) {
+		pos = rte_hash_lookup(map->hash, key);
+		if (flags == RTE_BPF_MAP_NOEXIST && pos >= 0)
+			return -EEXIST;
+		if (flags == RTE_BPF_MAP_EXIST && pos < 0)
+			return -ENOENT;
+	}
+
+	pos = rte_hash_add_key(map->hash, key);
+	if (pos < 0)
+		return pos;
+
+	memcpy(map->data + pos * map->elm_sz, value, map->prm.value_size);
+	return 0;
+}
+
+static int
+hash_delete(struct rte_bpf_map *map, const void *key)
+{
+	int32_t pos;
+
+	pos = rte_hash_del_key(map->hash, key);
+	return (pos < 0) ? pos : 0;
+}
+
+/*
+ * Functions called by BPF programs, both interpreted and JIT-ed,
+ * through the external symbols returned by rte_bpf_map_xsym().
+ */
+static uint64_t
+bpf_map_xlookup(uint64_t map, uint64_t key, uint64_t a3, uint64_t a4,
+	uint64_t a5)
+{
+	const struct rte_bpf_map *mp;
+
+	RTE_SET_USED(a3);
+	RTE_SET_USED(a4);
+	RTE_SET_USED(a5);
+
+	mp = (const struct rte_bpf_map *)(uintptr_t)map;
+	return (uintptr_t)mp->lookup(mp, (const void *)(uintptr_t)key,
+		rte_lcore_id());
+}
+
+static uint64_t
+bpf_map_xupdate(uint64_t map, uint64_t key, uint64_t value, uint64_t flags,
+	uint64_t a5)
+{
+	struct rte_bpf_map *mp;
+
+	RTE_SET_USED(a5);
+
+	mp = (struct rte_bpf_map *)(uintptr_t)map;
+	if (flags > RTE_BPF_MAP_EXIST)
+		return (int64_t)-EINVAL;
+
+	return (int64_t)mp->update(mp, (const void *)(uintptr_t)key,
+		(const void *)(uintptr_t)value, flags, rte_lcore_id());
+}
+
+static uint64_t
+bpf_map_xdelete(uint64_t map, uint64_t key, uint64_t a3, uint64_t a4,
+	uint64_t a5)
+{
+	struct rte_bpf_map *mp;
+
+	RTE_SET_USED(a3);
+	RTE_SET_USED(a4);
+	RTE_SET_USED(a5);
+
+	mp = (struct rte_bpf_map *)(uintptr_t)map;
+	return (int64_t)mp->delete(mp, (const void *)(uintptr_t)key);
+}
+
+/*
+ * Check the map handle passed by a BPF program to a map function,
+ * which dereferences it: it has to be the map the function symbol was
+ * filled for, the symbol names being stored in the map.
+ */
+int
+bpf_map_xfunc_check(const struct rte_bpf_xsym *xsym, const uint64_t *handle)
+{
+	uint32_t i;
+	uint64_t name;
+
+	if (xsym->func.val == bpf_map_xlookup)
+		i = BPF_MAP_XSYM_LOOKUP;
+	else if (xsym->func.val == bpf_map_xupdate)
+		i = BPF_MAP_XSYM_UPDATE;
+	else if (xsym->func.val == bpf_map_xdelete)
+		i = BPF_MAP_XSYM_DELETE;
+	else
+		return 0;
+
+	if (handle == NULL)
+		return -EINVAL;
+
+	name = *handle + offsetof(struct rte_bpf_map, xname) +
+		i * BPF_MAP_XNAME_SIZE;
+	return ((uintptr_t)xsym->name == name) ? 0 : -EINVAL;
+}
+
+/*
+ * Setup external symbols to access the map from BPF programs:
+ * the map itself as a variable, and the functions to access it.
+ */
+static void
+bpf_map_xsym_init(struct rte_bpf_map *map)
+{
+	static const char * const sfx[RTE_BPF_MAP_XSYM_NUM] = {
+		[BPF_MAP_XSYM_VAR] = "",
+		[BPF_MAP_XSYM_LOOKUP] = "_lookup",
+		[BPF_MAP_XSYM_UPDATE] = "_update",
+		[BPF_MAP_XSYM_DELETE] = "_delete",
+	};
+	/* opaque to the programs, which can only pass it to the functions */
+	const struct rte_bpf_arg arg_map = {
+		.type = RTE_BPF_ARG_RAW,
+		.size = sizeof(uint64_t),
+	};
+	const struct rte_bpf_arg arg_key = {
+		.type = RTE_BPF_ARG_PTR,
+		.size = map->prm.key_size,
+	};
+	const struct rte_bpf_arg arg_value = {
+		.type = RTE_BPF_ARG_PTR,
+		.size = map->prm.value_size,
+	};
+	const struct rte_bpf_arg arg_raw = {
+		.type = RTE_BPF_ARG_RAW,
+		.size = sizeof(uint64_t),
+	};
+	struct rte_bpf_xsym *xs;
+	uint32_t i;
+
+	for (i = 0; i != RTE_DIM(sfx); i++) {
+		snprintf(map->xname[i], sizeof(map->xname[i]), "%s%s",
+			map->name, sfx[i]);
+		map->xsym[i].name = map->xname[i];
+	}
+
+	xs = map->xsym + BPF_MAP_XSYM_VAR;
+	xs->type = RTE_BPF_XTYPE_VAR;
+	xs->var.val = map;
+	xs->var.desc = arg_map;
+
+	xs = map->xsym + BPF_MAP_XSYM_LOOKUP;
+	xs->type = RTE_BPF_XTYPE_FUNC;
+	xs->func.val = bpf_map_xlookup;
+	xs->func.nb_args = 2;
+	xs->func.args[0] = arg_map;
+	xs->func.args[1] = arg_key;
+	xs->func.ret = arg_value;
+
+	xs = map->xsym + BPF_MAP_XSYM_UPDATE;
+	xs->type = RTE_BPF_XTYPE_FUNC;
+	xs->func.val = bpf_map_xupdate;
+	xs->func.nb_args = 4;
+	xs->func.args[0] = arg_map;
+	xs->func.args[1] = arg_key;
+	xs->func.args[2] = arg_value;
+	xs->func.args[3] = arg_raw;
+	xs->func.ret = arg_raw;
+
+	xs = map->xsym + BPF_MAP_XSYM_DELETE;
+	xs->type = RTE_BPF_XTYPE_FUNC;
+	xs->func.val = bpf_map_xdelete;
+	xs->func.nb_args = 2;
+	xs->func.args[0] = arg_map;
+	xs->func.args[1] = arg_key;
+	xs->func.ret = arg_raw;
+}
+
+static int
+bpf_map_hash_create(struct rte_bpf_map *map)
+{
+	char name[RTE_HASH_NAMESIZE];
+	struct rte_hash_parameters hprm;
+
+	snprintf(name, sizeof(name), "bpf_%s", map->name);
+
+	memset(&hprm, 0, sizeof(hprm));
+	hprm.name = name;
+	hprm.entries = RTE_MAX(map->prm.max_entries,
+		BPF_MAP_HASH_MIN_ENTRIES);
+	hprm.key_len = map->prm.key_size;
+	hprm.socket_id = map->prm.socket_id;
+	hprm.extra_flag = RTE_HASH_EXTRA_FLAGS_EXT_TABLE;
+	if ((map->prm.flags & RTE_BPF_MAP_F_MT_SAFE) != 0)
+		hprm.extra_flag |= RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY;
+
+	map->hash = rte_hash_create(&hprm);
+	if (map->hash == NULL)
+		return -rte_errno;
+
+	/* one value per key position in the hash table */
+	map->prm.max_entries = hprm.entries;
+	return 0;
+}
+
+static int
+bpf_map_check_prm(const struct rte_bpf_map_prm *prm)
+{
+	if (prm == NULL || prm->name == NULL ||
+			strnlen(prm->name, RTE_BPF_MAP_NAMESIZE) ==
+			RTE_BPF_MAP_NAMESIZE ||
+			prm->type >= RTE_BPF_MAP_TYPE_NUM ||
+			prm->key_size == 0 || prm->value_size == 0 ||
+			prm->max_entries == 0 ||
+			(prm->flags & ~RTE_BPF_MAP_F_MT_SAFE) != 0)
+		return -EINVAL;
+
+	if (prm->type != RTE_BPF_MAP_TYPE_HASH &&
+			prm->key_size != sizeof(uint32_t))
+		return -EINVAL;
+
+	return 0;
+}
+
+__rte_experimental struct rte_bpf_map *
+rte_bpf_map_create(const struct rte_bpf_map_prm *prm)
+{
+	int32_t rc;
+	size_t sz;
+	struct rte_bpf_map *map;
+
+	rc = bpf_map_check_prm(prm);
+	if (rc != 0) {
+		rte_errno = -rc;
+		return NULL;
+	}
+
+	map = rte_zmalloc_socket("bpf_map", sizeof(*map), RTE_CACHE_LINE_SIZE,
+		prm->socket_id);
+	if (map == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	map->prm = *prm;
+	strlcpy(map->name, prm->name, sizeof(map->name));
+	map->prm.name = map->name;
+	map->elm_sz = RTE_ALIGN_CEIL(prm->value_size, sizeof(uint64_t));
+
+	rc = 0;
+	switch (prm->type) {
+	case RTE_BPF_MAP_TYPE_ARRAY:
+		map->lookup = array_lookup;
+		map->update = array_update;
+		map->delete = array_delete;
+		sz = map->elm_sz * prm->max_entries;
+		break;
+	case RTE_BPF_MAP_TYPE_LCORE_ARRAY:
+		map->lookup = lcore_array_lookup;
+		map->update = lcore_array_update;
+		map->delete = array_delete;
+		map->lcore_sz = RTE_ALIGN_CEIL(map->elm_sz * prm->max_entries,
+			RTE_CACHE_LINE_SIZE);
+		sz = map->lcore_sz * RTE_MAX_LCORE;
+		break;
+	case RTE_BPF_MAP_TYPE_HASH:
+	default:
+		map->lookup = hash_lookup;
+		map->update = hash_update;
+		map->delete = hash_delete;
+		rc = bpf_map_hash_create(map);
+		sz = map->elm_sz * map->prm.max_entries;
+		break;
+	}
+
+	if (rc == 0) {
+		map->data = rte_zmalloc_socket("bpf_map_data", sz,
+			RTE_CACHE_LINE_SIZE, prm->socket_id);
+		if (map->data == NULL)
+			rc = -ENOMEM;
+	}
+
+	if (rc != 0) {
+		RTE_BPF_LOG(ERR, "%s(%s) failed, error code: %d;\n",
+			__func__, prm->name, rc);
+		rte_bpf_map_free(map);
+		rte_errno = -rc;
+		return NULL;
+	}
+
+	bpf_map_xsym_init(map);
+	return map;
+}
+
+__rte_experimental void
+rte_bpf_map_free(struct rte_bpf_map *map)
+{
+	if (map == NULL)
+		return;
+
+	rte_hash_free(map->hash);
+	rte_free(map->data);
+	rte_free(map);
+}
+
+__rte_experimental void *
+rte_bpf_map_lookup(const struct rte_bpf_map *map, const void *key)
+{
+	if (map == NULL || key == NULL)
+		return NULL;
+
+	return map->lookup(map, key, rte_lcore_id());
+}
+
+__rte_experimental void *
+rte_bpf_map_lookup_lcore(const struct rte_bpf_map *map, const void *key,
+	uint32_t lcore_id)
+{
+	if (map == NULL || key == NULL)
+		return NULL;
+
+	return map->lookup(map, key, lcore_id);
+}
+
+__rte_experimental int
+rte_bpf_map_update(struct rte_bpf_map *map, const void *key,
+	const void *value, uint64_t flags)
+{
+	if (map == NULL || key == NULL || value == NULL ||
+			flags > RTE_BPF_MAP_EXIST)
+		return -EINVAL;
+
+	return map->update(map, key, value, flags, rte_lcore_id());
+}
+
+__rte_experimental int
+rte_bpf_map_delete(struct rte_bpf_map *map, const void *key)
+{
+	if (map == NULL || key == NULL)
+		return -EINVAL;
+
+	return map->delete(map, key);
+}
+
+__rte_experimental int32_t
+rte_bpf_map_iterate(const struct rte_bpf_map *map, const void **key,
+	void **value, uint32_t *next)
+{
+	int32_t pos;
+	void *data;
+
+	if (map == NULL || key == NULL || value == NULL || next == NULL ||
+			map->hash == NULL)
+		return -EINVAL;
+
+	pos = rte_hash_iterate(map->hash, key, &data, next);
+	if (pos < 0)
+		return pos;
+
+	*value = map->data + pos * map->elm_sz;
+	return pos;
+}
+
+__rte_experimental int
+rte_bpf_map_xsym(const struct rte_bpf_map *map, struct rte_bpf_xsym xsym[],
+	uint32_t num)
+{
+	if (map == NULL || xsym == NULL)
+		return -EINVAL;
+
+	if (num < RTE_DIM(map->xsym))
+		return -ENOSPC;
+
+	memcpy(xsym, map->xsym, sizeof(map->xsym));
+	return RTE_DIM(map->xsym);
+}
@@ -222,15 +222,22 @@ pkt_filter_jit(const struct rte_bpf_jit *jit, struct rte_mbuf *mb[],
 	uint32_t num, uint32_t drop)
 {
 	uint32_t i, n;
-	void *dp;
+	void *dp[num];
 	uint64_t rc[num];
 
+	for (i = 0; i != num; i++)
+		dp[i] = rte_pktmbuf_mtod(mb[i], void *);
+
+	if (jit->burst != NULL)
+		jit->burst(dp, rc, num);
+	else {
+		for (i = 0; i != num; i++)
+			rc[i] = jit->func(dp[i]);
+	}
+
 	n = 0;
-	for (i = 0; i != num; i++) {
-		dp = rte_pktmbuf_mtod(mb[i], void *);
-		rc[i] = jit->func(dp);
+	for (i = 0; i != num; i++)
 		n += (rc[i] == 0);
-	}
 
 	if (n != 0)
 		num = apply_filter(mb, rc, num, drop);
@@ -255,11 +262,16 @@ pkt_filter_mb_jit(const struct rte_bpf_jit *jit, struct rte_mbuf *mb[],
 	uint32_t i, n;
 	uint64_t rc[num];
 
+	if (jit->burst != NULL)
+		jit->burst((void **)mb, rc, num);
+	else {
+		for (i = 0; i != num; i++)
+			rc[i] = jit->func(mb[i]);
+	}
+
 	n = 0;
-	for (i = 0; i != num; i++) {
-		rc[i] = jit->func(mb[i]);
+	for (i = 0; i != num; i++)
 		n += (rc[i] == 0);
-	}
 
 	if (n != 0)
 		num = apply_filter(mb, rc, num, drop);
@@ -502,8 +514,12 @@ rte_bpf_eth_tx_unload(uint16_t port, uint16_t queue)
 	rte_spinlock_unlock(&cbh->lock);
 }
 
+/*
+ * Load BPF program from the ELF file if fname is not NULL,
+ * or from prm otherwise, and install it for given port/queue.
+ */
 static int
-bpf_eth_elf_load(struct bpf_eth_cbh *cbh, uint16_t port, uint16_t queue,
+bpf_eth_load(struct bpf_eth_cbh *cbh, uint16_t port, uint16_t queue,
 	const struct rte_bpf_prm *prm, const char *fname, const char *sname,
 	uint32_t flags)
 {
@@ -532,7 +548,10 @@ bpf_eth_elf_load(struct bpf_eth_cbh *cbh, uint16_t port, uint16_t queue,
 		return -EINVAL;
 	}
 
-	bpf = rte_bpf_elf_load(prm, fname, sname);
+	if (fname != NULL)
+		bpf = rte_bpf_elf_load(prm, fname, sname);
+	else
+		bpf = rte_bpf_load(prm);
 	if (bpf == NULL)
 		return -rte_errno;
 
@@ -582,7 +601,7 @@ rte_bpf_eth_rx_elf_load(uint16_t port, uint16_t queue,
 
 	cbh = &rx_cbh;
 	rte_spinlock_lock(&cbh->lock);
-	rc = bpf_eth_elf_load(cbh, port, queue, prm, fname, sname, flags);
+	rc = bpf_eth_load(cbh, port, queue, prm, fname, sname, flags);
 	rte_spinlock_unlock(&cbh->lock);
 
 	return rc;
@@ -598,7 +617,37 @@ rte_bpf_eth_tx_elf_load(uint16_t port, uint16_t queue,
 
 	cbh = &tx_cbh;
 	rte_spinlock_lock(&cbh->lock);
-	rc = bpf_eth_elf_load(cbh, port, queue, prm, fname, sname, flags);
+	rc = bpf_eth_load(cbh, port, queue, prm, fname, sname, flags);
+	rte_spinlock_unlock(&cbh->lock);
+
+	return rc;
+}
+
+__rte_experimental int
+rte_bpf_eth_rx_load(uint16_t port, uint16_t queue,
+	const struct rte_bpf_prm *prm, uint32_t flags)
+{
+	int32_t rc;
+	struct bpf_eth_cbh *cbh;
+
+	cbh = &rx_cbh;
+	rte_spinlock_lock(&cbh->lock);
+	rc = bpf_eth_load(cbh, port, queue, prm, NULL, NULL, flags);
+	rte_spinlock_unlock(&cbh->lock);
+
+	return rc;
+}
+
+__rte_experimental int
+rte_bpf_eth_tx_load(uint16_t port, uint16_t queue,
+	const struct rte_bpf_prm *prm, uint32_t flags)
+{
+	int32_t rc;
+	struct bpf_eth_cbh *cbh;
+
+	cbh = &tx_cbh;
+	rte_spinlock_lock(&cbh->lock);
+	rc = bpf_eth_load(cbh, port, queue, prm, NULL, NULL, flags);
 	rte_spinlock_unlock(&cbh->lock);
 
 	return rc;
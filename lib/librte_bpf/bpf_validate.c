@@ -15,6 +15,12 @@
 
 #include "bpf_impl.h"
 
+/*
+ * Flag added to the type of a pointer returned by an external function,
+ * which may be NULL: it cannot be dereferenced until compared with 0.
+ */
+#define	BPF_ARG_PTR_MAYBE_NULL	0x100
+
 struct bpf_reg_val {
 	struct rte_bpf_arg v;
 	uint64_t mask;
@@ -68,6 +74,7 @@ struct bpf_verifier {
 	uint64_t stack_sz;
 	uint32_t nb_nodes;
 	uint32_t nb_jcc_nodes;
+	uint32_t nb_ldmb_nodes;
 	uint32_t node_colour[MAX_NODE_COLOUR];
 	uint32_t edge_type[MAX_EDGE_TYPE];
 	struct bpf_eval_state *evst;
@@ -191,7 +198,9 @@ eval_ld_imm64(struct bpf_verifier *bvf, const struct ebpf_insn *ins)
 		if (bvf->prm->xsym[i].type == RTE_BPF_XTYPE_VAR &&
 				(uintptr_t)bvf->prm->xsym[i].var.val == val) {
 			rd->v = bvf->prm->xsym[i].var.desc;
-			eval_fill_imm64(rd, UINT64_MAX, 0);
+			/* the value of a raw variable is its address */
+			eval_fill_imm64(rd, UINT64_MAX,
+				(rd->v.type == RTE_BPF_ARG_RAW) ? val : 0);
 			break;
 		}
 	}
@@ -699,6 +708,9 @@ eval_ptr(struct bpf_verifier *bvf, struct bpf_reg_val *rm, uint32_t opsz,
 	if (RTE_BPF_ARG_PTR_TYPE(rm->v.type) == 0)
 		return "destination is not a pointer";
 
+	if ((rm->v.type & BPF_ARG_PTR_MAYBE_NULL) != 0)
+		return "possible NULL pointer dereference";
+
 	if (rm->mask != UINT64_MAX)
 		return "pointer truncation";
 
@@ -950,6 +962,13 @@ eval_call(struct bpf_verifier *bvf, const struct ebpf_insn *ins)
 			bvf->evst->rv + EBPF_REG_1 + i);
 	}
 
+	/* map functions dereference the map handle, which must be constant */
+	rv = bvf->evst->rv + EBPF_REG_1;
+	if (err == NULL && bpf_map_xfunc_check(xsym,
+			(rv->v.type == RTE_BPF_ARG_RAW && rv->u.min == rv->u.max) ?
+			&rv->u.min : NULL) != 0)
+		err = "invalid map handle";
+
 	/* R1-R5 argument/scratch registers */
 	for (i = EBPF_REG_1; i != EBPF_REG_6; i++)
 		bvf->evst->rv[i].v.type = RTE_BPF_ARG_UNDEF;
@@ -958,14 +977,53 @@ eval_call(struct bpf_verifier *bvf, const struct ebpf_insn *ins)
 
 	rv = bvf->evst->rv + EBPF_REG_0;
 	rv->v = xsym->func.ret;
-	msk = (rv->v.type == RTE_BPF_ARG_RAW) ?
-		RTE_LEN2MASK(rv->v.size * CHAR_BIT, uint64_t) : UINTPTR_MAX;
-	eval_max_bound(rv, msk);
-	rv->mask = msk;
+	if (rv->v.type == RTE_BPF_ARG_RAW) {
+		msk = RTE_LEN2MASK(rv->v.size * CHAR_BIT, uint64_t);
+		eval_max_bound(rv, msk);
+		rv->mask = msk;
+	} else {
+		/*
+		 * returned pointer refers to the start of the object,
+		 * or is NULL until the program checks it.
+		 */
+		rv->v.type |= BPF_ARG_PTR_MAYBE_NULL;
+		eval_fill_imm64(rv, UINTPTR_MAX, 0);
+	}
 
 	return err;
 }
 
+/*
+ * BPF_ABS/BPF_IND load from the packet data:
+ * R6 is an implicit input that must contain pointer to the mbuf,
+ * R0 is an implicit output, R1-R5 are scratch registers.
+ */
+static const char *
+eval_ld_mbuf(struct bpf_verifier *bvf, const struct ebpf_insn *ins)
+{
+	uint32_t i;
+	const char *err;
+	struct bpf_reg_val *rv;
+
+	if (bvf->evst->rv[EBPF_REG_6].v.type != RTE_BPF_ARG_PTR_MBUF)
+		return "invalid type for implicit mbuf register";
+
+	if (BPF_MODE(ins->code) == BPF_IND) {
+		err = eval_defined(NULL, bvf->evst->rv + ins->src_reg);
+		if (err != NULL)
+			return err;
+	}
+
+	for (i = EBPF_REG_1; i != EBPF_REG_6; i++)
+		bvf->evst->rv[i].v.type = RTE_BPF_ARG_UNDEF;
+
+	rv = bvf->evst->rv + EBPF_REG_0;
+	rv->v.size = bpf_size(BPF_SIZE(ins->code));
+	eval_fill_max_bound(rv, RTE_LEN2MASK(rv->v.size * CHAR_BIT, uint64_t));
+
+	return NULL;
+}
+
 static void
 eval_jeq_jne(struct bpf_reg_val *trd, struct bpf_reg_val *trs)
 {
@@ -994,6 +1052,26 @@ eval_jeq_jne(struct bpf_reg_val *trd, struct bpf_reg_val *trs)
 	}
 }
 
+/*
+ * Comparing a pointer which may be NULL with 0 tells on each branch
+ * whether it is NULL or a valid pointer.
+ */
+static void
+eval_jeq_jne_null(struct bpf_reg_val *nrd, struct bpf_reg_val *vrd)
+{
+	eval_fill_imm(nrd, UINT64_MAX, 0);
+	vrd->v.type &= ~BPF_ARG_PTR_MAYBE_NULL;
+}
+
+static int
+eval_is_null_check(const struct bpf_reg_val *rd, const struct bpf_reg_val *rs)
+{
+	return (rd->v.type & BPF_ARG_PTR_MAYBE_NULL) != 0 &&
+		rd->u.min == 0 && rd->u.max == 0 &&
+		rs->v.type == RTE_BPF_ARG_RAW &&
+		rs->u.min == 0 && rs->u.max == 0;
+}
+
 static void
 eval_jgt_jle(struct bpf_reg_val *trd, struct bpf_reg_val *trs,
 	struct bpf_reg_val *frd, struct bpf_reg_val *frs)
@@ -1057,7 +1135,13 @@ eval_jcc(struct bpf_verifier *bvf, const struct ebpf_insn *ins)
 
 	op = BPF_OP(ins->code);
 
-	if (op == BPF_JEQ)
+	if ((op == BPF_JEQ || op == EBPF_JNE) &&
+			eval_is_null_check(trd, trs)) {
+		if (op == BPF_JEQ)
+			eval_jeq_jne_null(trd, frd);
+		else
+			eval_jeq_jne_null(frd, trd);
+	} else if (op == BPF_JEQ)
 		eval_jeq_jne(trd, trs);
 	else if (op == EBPF_JNE)
 		eval_jeq_jne(frd, frs);
@@ -1423,6 +1507,44 @@ static const struct bpf_ins_check ins_chk[UINT8_MAX] = {
 		.imm = { .min = 0, .max = UINT32_MAX},
 		.eval = eval_ld_imm64,
 	},
+	/* load absolute instructions */
+	[(BPF_LD | BPF_ABS | BPF_B)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ZERO_REG},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = INT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
+	[(BPF_LD | BPF_ABS | BPF_H)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ZERO_REG},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = INT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
+	[(BPF_LD | BPF_ABS | BPF_W)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ZERO_REG},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = INT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
+	/* load indirect instructions */
+	[(BPF_LD | BPF_IND | BPF_B)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ALL_REGS},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = UINT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
+	[(BPF_LD | BPF_IND | BPF_H)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ALL_REGS},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = UINT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
+	[(BPF_LD | BPF_IND | BPF_W)] = {
+		.mask = {. dreg = ZERO_REG, .sreg = ALL_REGS},
+		.off = { .min = 0, .max = 0},
+		.imm = { .min = 0, .max = UINT32_MAX},
+		.eval = eval_ld_mbuf,
+	},
 	/* store REG instructions */
 	[(BPF_STX | BPF_MEM | BPF_B)] = {
 		.mask = { .dreg = ALL_REGS, .sreg = ALL_REGS},
@@ -1941,6 +2063,16 @@ validate(struct bpf_verifier *bvf)
 			rc |= add_edge(bvf, node, i + 2);
 			i++;
 			break;
+		/* load from the packet data */
+		case (BPF_LD | BPF_ABS | BPF_B):
+		case (BPF_LD | BPF_ABS | BPF_H):
+		case (BPF_LD | BPF_ABS | BPF_W):
+		case (BPF_LD | BPF_IND | BPF_B):
+		case (BPF_LD | BPF_IND | BPF_H):
+		case (BPF_LD | BPF_IND | BPF_W):
+			rc |= add_edge(bvf, node, i + 1);
+			bvf->nb_ldmb_nodes++;
+			break;
 		default:
 			rc |= add_edge(bvf, node, i + 1);
 			break;
@@ -2241,8 +2373,17 @@ bpf_validate(struct rte_bpf *bpf)
 	free(bvf.in);
 
 	/* copy collected info */
-	if (rc == 0)
+	if (rc == 0) {
 		bpf->stack_sz = bvf.stack_sz;
 
+		/*
+		 * JIT-ed BPF_ABS/BPF_IND loads need a scratch buffer at the
+		 * bottom of the stack for the data spanning mbuf segments.
+		 */
+		if (bvf.nb_ldmb_nodes != 0)
+			bpf->stack_sz = RTE_ALIGN_CEIL(bpf->stack_sz,
+				sizeof(uint64_t)) + sizeof(uint64_t);
+	}
+
 	return rc;
 }
@@ -103,6 +103,13 @@ struct rte_bpf_prm {
 struct rte_bpf_jit {
 	uint64_t (*func)(void *); /**< JIT-ed native code */
 	size_t sz;                /**< size of JIT-ed code */
+	/**
+	 * JIT-ed native code looping over a set of input contexts,
+	 * with the same semantics as rte_bpf_exec_burst(), NULL if not
+	 * available. It avoids the call overhead for each context
+	 * and prefetches the next context while processing the current one.
+	 */
+	uint32_t (*burst)(void *ctx[], uint64_t rc[], uint32_t num);
 };
 
 struct rte_bpf;
@@ -196,6 +203,241 @@ rte_bpf_exec_burst(const struct rte_bpf *bpf, void *ctx[], uint64_t rc[],
 int __rte_experimental
 rte_bpf_get_jit(const struct rte_bpf *bpf, struct rte_bpf_jit *jit);
 
+/**
+ * Convert a classic BPF (cBPF) program, as generated by pcap_compile()
+ * for the DLT_EN10MB link type, into an eBPF one.
+ * The eBPF program expects a pointer to rte_mbuf as input argument,
+ * and returns the cBPF program return value: 0 if the packet doesn't match
+ * the filter.
+ * The cBPF ancillary loads (Linux specific negative offsets) are not
+ * supported.
+ *
+ * @param ins
+ *   Array of cBPF instructions, e.g. bf_insns of a libpcap bpf_program.
+ * @param nb_ins
+ *   Number of instructions in ins.
+ * @return
+ *   Parameters to load the eBPF program with rte_bpf_load(),
+ *   allocated with rte_malloc() and freed with rte_free(),
+ *   or NULL on error, with error code set in rte_errno.
+ *   Possible rte_errno errors include:
+ *   - EINVAL - invalid cBPF program
+ *   - ENOTSUP - unsupported cBPF instruction
+ *   - ENOMEM - can't reserve enough memory
+ */
+struct rte_bpf_prm * __rte_experimental
+rte_bpf_convert(const struct cbpf_insn *ins, uint32_t nb_ins);
+
+/**
+ * Possible types of BPF maps.
+ */
+enum rte_bpf_map_type {
+	RTE_BPF_MAP_TYPE_ARRAY,       /**< array indexed by 32-bit key */
+	RTE_BPF_MAP_TYPE_HASH,        /**< hash table based on rte_hash */
+	RTE_BPF_MAP_TYPE_LCORE_ARRAY, /**< array with a copy per lcore */
+	RTE_BPF_MAP_TYPE_NUM
+};
+
+/** Maximum length of a map name, including the terminating '\0'. */
+#define RTE_BPF_MAP_NAMESIZE	32
+
+/**
+ * Hash map updates and lookups may run on several threads in parallel.
+ * Without this flag, the hash map can be updated by one thread only,
+ * while no other thread reads it.
+ */
+#define RTE_BPF_MAP_F_MT_SAFE	0x1
+
+/**
+ * Flags for map updates.
+ */
+enum {
+	RTE_BPF_MAP_ANY,     /**< create new element or update existing */
+	RTE_BPF_MAP_NOEXIST, /**< create new element only */
+	RTE_BPF_MAP_EXIST,   /**< update existing element only */
+};
+
+/**
+ * Input parameters for creating a BPF map.
+ */
+struct rte_bpf_map_prm {
+	const char *name;           /**< map and external symbols name */
+	enum rte_bpf_map_type type; /**< map type */
+	uint32_t key_size;   /**< key size, sizeof(uint32_t) for arrays */
+	uint32_t value_size; /**< value size */
+	uint32_t max_entries; /**< maximum number of elements */
+	uint32_t flags;      /**< RTE_BPF_MAP_F_* flags */
+	int socket_id;       /**< NUMA socket to allocate memory on */
+};
+
+/**
+ * Number of external symbols describing a map, see rte_bpf_map_xsym().
+ */
+#define RTE_BPF_MAP_XSYM_NUM	4
+
+struct rte_bpf_map;
+
+/**
+ * Create a BPF map: a key/value store shared between BPF programs and
+ * the application.
+ * All the values of array maps exist and are initialised with zeros.
+ *
+ * @param prm
+ *   Parameters of the map.
+ * @return
+ *   Map handle, or NULL on error, with error code set in rte_errno.
+ *   Possible rte_errno errors include:
+ *   - EINVAL - invalid parameter passed to function
+ *   - EEXIST - a hash map with the same name already exists
+ *   - ENOMEM - can't reserve enough memory
+ */
+struct rte_bpf_map * __rte_experimental
+rte_bpf_map_create(const struct rte_bpf_map_prm *prm);
+
+/**
+ * Free a BPF map.
+ * BPF programs using the map must be destroyed first.
+ *
+ * @param map
+ *   Map handle, may be NULL.
+ */
+void __rte_experimental
+rte_bpf_map_free(struct rte_bpf_map *map);
+
+/**
+ * Lookup an element in a BPF map.
+ * For lcore arrays, the value of the calling lcore is returned.
+ *
+ * @param map
+ *   Map handle.
+ * @param key
+ *   Pointer to the key.
+ * @return
+ *   Pointer to the value of the element, that can be updated in place,
+ *   or NULL if the key is not found.
+ */
+void * __rte_experimental
+rte_bpf_map_lookup(const struct rte_bpf_map *map, const void *key);
+
+/**
+ * Lookup an element in a BPF map, for a given lcore.
+ * For lcore arrays, the value of the given lcore is returned, typically to
+ * aggregate the values of all lcores. For other maps, it is the same as
+ * rte_bpf_map_lookup().
+ *
+ * @param map
+ *   Map handle.
+ * @param key
+ *   Pointer to the key.
+ * @param lcore_id
+ *   The lcore.
+ * @return
+ *   Pointer to the value of the element, or NULL if the key is not found.
+ */
+void * __rte_experimental
+rte_bpf_map_lookup_lcore(const struct rte_bpf_map *map, const void *key,
+	uint32_t lcore_id);
+
+/**
+ * Create or update an element in a BPF map.
+ * For lcore arrays, the value of the calling lcore is updated,
+ * or the values of all lcores when called from a non-EAL thread.
+ *
+ * @param map
+ *   Map handle.
+ * @param key
+ *   Pointer to the key.
+ * @param value
+ *   Pointer to the value.
+ * @param flags
+ *   RTE_BPF_MAP_ANY, RTE_BPF_MAP_NOEXIST or RTE_BPF_MAP_EXIST.
+ * @return
+ *   - Zero on success.
+ *   - -EINVAL if the parameters are invalid.
+ *   - -EEXIST if the element exists and flags is RTE_BPF_MAP_NOEXIST.
+ *   - -ENOENT if the element doesn't exist and flags is RTE_BPF_MAP_EXIST.
+ *   - -E2BIG if the index is out of the bounds of an array.
+ *   - -ENOSPC if a hash map is full.
+ */
+int __rte_experimental
+rte_bpf_map_update(struct rte_bpf_map *map, const void *key,
+	const void *value, uint64_t flags);
+
+/**
+ * Delete an element from a hash map.
+ *
+ * @param map
+ *   Map handle.
+ * @param key
+ *   Pointer to the key.
+ * @return
+ *   - Zero on success.
+ *   - -EINVAL if the parameters are invalid or the map is an array.
+ *   - -ENOENT if the key is not found.
+ */
+int __rte_experimental
+rte_bpf_map_delete(struct rte_bpf_map *map, const void *key);
+
+/**
+ * Iterate through the elements of a hash map.
+ *
+ * @param map
+ *   Map handle.
+ * @param key
+ *   Output containing the pointer to the key.
+ * @param value
+ *   Output containing the pointer to the value.
+ * @param next
+ *   Pointer to iterator, should be 0 to start iterating the map.
+ * @return
+ *   Position of the element in the map if successful,
+ *   -EINVAL if the parameters are invalid or the map is not a hash map,
+ *   -ENOENT if the end of the map is reached.
+ */
+int32_t __rte_experimental
+rte_bpf_map_iterate(const struct rte_bpf_map *map, const void **key,
+	void **value, uint32_t *next);
+
+/**
+ * Fill the external symbols giving access to a map, to be added to the
+ * xsym array of the parameters of the BPF programs using the map,
+ * in this order:
+ * - a variable named as the map, the address of which is the map handle;
+ * - functions named as the map with the "_lookup", "_update" and "_delete"
+ *   suffixes, with the same arguments as rte_bpf_map_lookup(),
+ *   rte_bpf_map_update() and rte_bpf_map_delete(), the map handle
+ *   being the first one.
+ * The map handle is an opaque value for the programs: they cannot access
+ * the map through it, and must pass the handle of the same map to its
+ * functions.
+ * For example, a program written in C accesses a hash map named "flows" as:
+ * @code
+ * extern char flows[];
+ * extern void *flows_lookup(void *map, const void *key);
+ * ...
+ * uint64_t *cnt = flows_lookup(flows, &key);
+ * if (cnt != NULL)
+ *     __sync_fetch_and_add(cnt, 1);
+ * @endcode
+ * The returned pointer has to be checked against NULL by the program: the
+ * verifier rejects the programs dereferencing it before comparing it with 0,
+ * as for any pointer returned by an external function.
+ * The names are valid as long as the map exists.
+ *
+ * @param map
+ *   Map handle.
+ * @param xsym
+ *   Array of external symbols to fill.
+ * @param num
+ *   Number of elements in xsym, at least RTE_BPF_MAP_XSYM_NUM.
+ * @return
+ *   Number of external symbols filled (RTE_BPF_MAP_XSYM_NUM) on success,
+ *   -EINVAL if the parameters are invalid, -ENOSPC if num is too small.
+ */
+int __rte_experimental
+rte_bpf_map_xsym(const struct rte_bpf_map *map, struct rte_bpf_xsym xsym[],
+	uint32_t num);
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,6 +17,8 @@
 extern "C" {
 #endif
 
+#include <rte_compat.h>
+
 /* Type of distribution (burst/single) */
 enum rte_distributor_alg_type {
 	RTE_DIST_ALG_BURST = 0,
@@ -234,6 +236,180 @@ int
 rte_distributor_poll_pkt(struct rte_distributor *d,
 		unsigned int worker_id, struct rte_mbuf **mbufs);
 
+/*  *** Scalable distributor ***  */
+/*
+ * The scalable distributor lets several distributor lcores feed a large
+ * number of workers. The distributor lcores share a flow affinity table,
+ * indexed by the tag of the packets, which pins a flow to a worker as long
+ * as some of its packets are being processed. The packets are handed to
+ * the workers through single producer/single consumer rings, one ring per
+ * distributor lcore and worker, so that no cache line is shared between
+ * the distributor lcores.
+ *
+ * The packets of a flow given to one distributor lcore are processed in
+ * order. No ordering is guaranteed between the packets of a flow given to
+ * different distributor lcores.
+ */
+
+struct rte_distributor_scalable;
+
+/** Maximum number of packets processed per call by a scalable worker */
+#define RTE_DISTRIB_SCALABLE_MAX_BURST 64
+
+/** Maximum number of distributor lcores of a scalable distributor */
+#define RTE_DISTRIB_SCALABLE_MAX_DISTRIBUTORS 64
+
+/** Maximum number of workers of a scalable distributor */
+#define RTE_DISTRIB_SCALABLE_MAX_WORKERS 1024
+
+/** Parameters used to create a scalable distributor */
+struct rte_distributor_scalable_params {
+	const char *name;               /**< Name of the distributor. */
+	int socket_id;                  /**< NUMA socket for the memory. */
+	unsigned int num_distributors;  /**< Number of distributor lcores. */
+	unsigned int num_workers;       /**< Number of worker lcores. */
+	unsigned int ring_size;         /**< Size of the ring between a
+					  * distributor lcore and a worker,
+					  * a power of 2.
+					  */
+	unsigned int flow_table_size;   /**< Entries of the flow affinity
+					  * table, a power of 2.
+					  */
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a scalable distributor.
+ *
+ * @param params
+ *   The parameters of the distributor.
+ * @return
+ *   The newly created distributor, or NULL on error with rte_errno set:
+ *    - EINVAL - invalid parameters
+ *    - ENOMEM - no available memory
+ */
+struct rte_distributor_scalable * __rte_experimental
+rte_distributor_scalable_create(
+		const struct rte_distributor_scalable_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Free a scalable distributor. The distributor and worker lcores must
+ * have stopped using it.
+ *
+ * @param d
+ *   The distributor to be freed, or NULL.
+ */
+void __rte_experimental
+rte_distributor_scalable_free(struct rte_distributor_scalable *d);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Distribute a set of packets to the workers, from a distributor lcore.
+ * The packets whose flow is being processed by a worker go to this
+ * worker, the packets of the other flows go to the least loaded of two
+ * candidate workers.
+ *
+ * The distribution stops when the ring of a worker is full. The packets
+ * which were not distributed are then moved at the beginning of the mbufs
+ * array, in their original order, to be passed again in the next call.
+ *
+ * Each distributor lcore must use its own distributor id.
+ *
+ * @param d
+ *   The distributor instance to be used.
+ * @param dist_id
+ *   The id of the distributor lcore, less than num_distributors.
+ * @param mbufs
+ *   The packets to be distributed, with their flow tag in hash.usr.
+ * @param num_mbufs
+ *   The number of packets in the mbufs array.
+ * @return
+ *   The number of distributed packets.
+ */
+unsigned int __rte_experimental
+rte_distributor_scalable_process(struct rte_distributor_scalable *d,
+		unsigned int dist_id, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get a set of packets returned by the workers, from a distributor lcore.
+ *
+ * @param d
+ *   The distributor instance to be used.
+ * @param dist_id
+ *   The id of the distributor lcore, less than num_distributors.
+ * @param mbufs
+ *   The mbufs pointer array to be filled in.
+ * @param max_mbufs
+ *   The size of the mbufs array.
+ * @return
+ *   The number of packets returned in the mbufs array.
+ */
+unsigned int __rte_experimental
+rte_distributor_scalable_returned_pkts(struct rte_distributor_scalable *d,
+		unsigned int dist_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get new packets to process, from a worker lcore. The packets given by
+ * the previous call of this worker are assumed to have been processed, so
+ * their flows may now move to another worker. This function does not wait
+ * for packets.
+ *
+ * @param d
+ *   The distributor instance to be used.
+ * @param worker_id
+ *   The id of the worker, less than num_workers.
+ * @param pkts
+ *   The mbufs pointer array to be filled in.
+ * @param max_pkts
+ *   The size of the pkts array, up to RTE_DISTRIB_SCALABLE_MAX_BURST.
+ * @return
+ *   The number of packets in the pkts array.
+ */
+unsigned int __rte_experimental
+rte_distributor_scalable_get_pkt(struct rte_distributor_scalable *d,
+		unsigned int worker_id, struct rte_mbuf **pkts,
+		unsigned int max_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Return processed packets to the distributor lcores, from a worker lcore.
+ * Returning the packets is optional, the worker may as well send or free
+ * them.
+ *
+ * @param d
+ *   The distributor instance to be used.
+ * @param worker_id
+ *   The id of the worker, less than num_workers.
+ * @param oldpkts
+ *   The packets to be returned.
+ * @param num
+ *   The number of packets in the oldpkts array.
+ * @return
+ *   The number of packets returned, which is less than num when the
+ *   return ring of the worker is full.
+ */
+unsigned int __rte_experimental
+rte_distributor_scalable_return_pkt(struct rte_distributor_scalable *d,
+		unsigned int worker_id, struct rte_mbuf **oldpkts,
+		unsigned int num);
+
 #ifdef __cplusplus
 }
 #endif
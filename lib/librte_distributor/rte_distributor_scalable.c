@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <string.h>
+#include <rte_common.h>
+#include <rte_atomic.h>
+#include <rte_errno.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+#include <rte_string_fns.h>
+
+#include "rte_distributor_private.h"
+#include "rte_distributor.h"
+
+/*
+ * An entry of the flow affinity table holds the worker of the flow in its
+ * upper 16 bits, and the number of packets of the flow in flight in its
+ * lower 16 bits. The worker is only valid while packets are in flight.
+ */
+#define FLOW_WORKER_SHIFT 16
+#define FLOW_COUNT_MASK 0xffff
+
+/* State of a distributor lcore */
+struct dist_scalable_dist {
+	unsigned int next_worker;   /**< Next worker for new flows */
+	unsigned int next_return;   /**< Next return ring to poll */
+} __rte_cache_aligned;
+
+/* State of a worker lcore */
+struct dist_scalable_worker {
+	unsigned int next_ring;     /**< Next distributor ring to poll */
+	unsigned int nb_inflight;   /**< Packets given by the last call */
+	uint32_t inflight[RTE_DISTRIB_SCALABLE_MAX_BURST];
+				    /**< Flow entries of these packets */
+} __rte_cache_aligned;
+
+struct rte_distributor_scalable {
+	char name[RTE_DISTRIBUTOR_NAMESIZE];
+	unsigned int num_distributors;
+	unsigned int num_workers;
+	uint32_t flow_mask;
+
+	rte_atomic32_t *flows;        /**< Flow affinity table */
+	struct rte_ring **rings;      /**< Rings to the workers, indexed by
+				        * dist_id * num_workers + worker_id
+				        */
+	struct rte_ring **ret_rings;  /**< Rings from the workers */
+	struct dist_scalable_dist *dists;
+	struct dist_scalable_worker *workers;
+};
+
+static inline uint32_t
+flow_index(const struct rte_distributor_scalable *d,
+		const struct rte_mbuf *m)
+{
+	uint32_t h = m->hash.usr * 0x9e3779b1;
+
+	return (h ^ (h >> 16)) & d->flow_mask;
+}
+
+static inline struct rte_ring *
+worker_ring(const struct rte_distributor_scalable *d, unsigned int dist_id,
+		unsigned int worker_id)
+{
+	return d->rings[dist_id * d->num_workers + worker_id];
+}
+
+/*
+ * Choose a worker for a new flow: the least loaded of the next worker in
+ * round robin and of a worker given by the flow index.
+ */
+static inline unsigned int
+pick_worker(struct rte_distributor_scalable *d, unsigned int dist_id,
+		uint32_t idx)
+{
+	struct dist_scalable_dist *ds = &d->dists[dist_id];
+	unsigned int w1, w2;
+
+	w1 = ds->next_worker;
+	if (++ds->next_worker == d->num_workers)
+		ds->next_worker = 0;
+	w2 = idx % d->num_workers;
+
+	if (rte_ring_count(worker_ring(d, dist_id, w2)) <
+			rte_ring_count(worker_ring(d, dist_id, w1)))
+		return w2;
+	return w1;
+}
+
+/* Count a packet of a flow in flight, and get the worker of the flow */
+static inline unsigned int
+flow_acquire(struct rte_distributor_scalable *d, unsigned int dist_id,
+		uint32_t idx)
+{
+	volatile uint32_t *entry = (volatile uint32_t *)&d->flows[idx].cnt;
+	uint32_t old, new;
+	unsigned int wkr;
+
+	do {
+		old = *entry;
+		if ((old & FLOW_COUNT_MASK) == 0)
+			wkr = pick_worker(d, dist_id, idx);
+		else
+			wkr = old >> FLOW_WORKER_SHIFT;
+		new = (wkr << FLOW_WORKER_SHIFT) |
+			((old & FLOW_COUNT_MASK) + 1);
+	} while (rte_atomic32_cmpset(entry, old, new) == 0);
+
+	return wkr;
+}
+
+/* A packet of a flow is not in flight anymore */
+static inline void
+flow_release(struct rte_distributor_scalable *d, uint32_t idx)
+{
+	rte_atomic32_dec(&d->flows[idx]);
+}
+
+/*
+ * Distribute up to RTE_DISTRIB_SCALABLE_MAX_BURST packets. The packets are
+ * sorted per worker, keeping their order, so that each ring gets a single
+ * burst. When a ring is full, the packets left for this worker include all
+ * the following packets of their flows, so they can be given back to the
+ * caller without breaking the order of the flows.
+ */
+static unsigned int
+dist_scalable_burst(struct rte_distributor_scalable *d, unsigned int dist_id,
+		struct rte_mbuf **mbufs, unsigned int num)
+{
+	unsigned int start[d->num_workers + 1];
+	struct rte_mbuf *sorted[RTE_DISTRIB_SCALABLE_MAX_BURST];
+	uint32_t idx[RTE_DISTRIB_SCALABLE_MAX_BURST];
+	uint16_t wkr[RTE_DISTRIB_SCALABLE_MAX_BURST];
+	uint8_t pos[RTE_DISTRIB_SCALABLE_MAX_BURST];
+	uint8_t failed[RTE_DISTRIB_SCALABLE_MAX_BURST];
+	unsigned int i, j, w, n, nb_fail;
+
+	memset(start, 0, sizeof(start));
+	for (i = 0; i < num; i++) {
+		idx[i] = flow_index(d, mbufs[i]);
+		wkr[i] = flow_acquire(d, dist_id, idx[i]);
+		start[wkr[i] + 1]++;
+		failed[i] = 0;
+	}
+
+	for (w = 0; w < d->num_workers; w++)
+		start[w + 1] += start[w];
+	for (i = 0; i < num; i++) {
+		j = start[wkr[i]]++;
+		sorted[j] = mbufs[i];
+		pos[j] = i;
+	}
+
+	/* start[w] is now the end of the packets of worker w */
+	j = 0;
+	for (w = 0; w < d->num_workers; w++) {
+		if (start[w] == j)
+			continue;
+		n = rte_ring_sp_enqueue_burst(worker_ring(d, dist_id, w),
+				(void **)&sorted[j], start[w] - j, NULL);
+		for (j += n; j < start[w]; j++) {
+			failed[pos[j]] = 1;
+			flow_release(d, idx[pos[j]]);
+		}
+	}
+
+	nb_fail = 0;
+	for (i = 0; i < num; i++)
+		if (failed[i])
+			mbufs[nb_fail++] = mbufs[i];
+
+	return num - nb_fail;
+}
+
+unsigned int __rte_experimental
+rte_distributor_scalable_process(struct rte_distributor_scalable *d,
+		unsigned int dist_id, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs)
+{
+	unsigned int i, n, sent, nb_fail, nb_done = 0;
+
+	for (i = 0; i < num_mbufs; i += n) {
+		n = RTE_MIN(num_mbufs - i,
+				(unsigned int)RTE_DISTRIB_SCALABLE_MAX_BURST);
+		sent = dist_scalable_burst(d, dist_id, &mbufs[i], n);
+		nb_done += sent;
+		if (unlikely(sent != n)) {
+			/* stop there, not to reorder the flows */
+			nb_fail = n - sent;
+			memmove(&mbufs[0], &mbufs[i],
+					nb_fail * sizeof(mbufs[0]));
+			memmove(&mbufs[nb_fail], &mbufs[i + n],
+					(num_mbufs - i - n) * sizeof(mbufs[0]));
+			break;
+		}
+	}
+
+	return nb_done;
+}
+
+unsigned int __rte_experimental
+rte_distributor_scalable_returned_pkts(struct rte_distributor_scalable *d,
+		unsigned int dist_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	struct dist_scalable_dist *ds = &d->dists[dist_id];
+	unsigned int i, w, n = 0;
+
+	w = ds->next_return;
+	for (i = 0; i < d->num_workers && n < max_mbufs; i++) {
+		n += rte_ring_mc_dequeue_burst(d->ret_rings[w],
+				(void **)&mbufs[n], max_mbufs - n, NULL);
+		if (++w == d->num_workers)
+			w = 0;
+	}
+	ds->next_return = w;
+
+	return n;
+}
+
+unsigned int __rte_experimental
+rte_distributor_scalable_get_pkt(struct rte_distributor_scalable *d,
+		unsigned int worker_id, struct rte_mbuf **pkts,
+		unsigned int max_pkts)
+{
+	struct dist_scalable_worker *wk = &d->workers[worker_id];
+	unsigned int i, r, n = 0;
+
+	/* the packets of the last call are done */
+	for (i = 0; i < wk->nb_inflight; i++)
+		flow_release(d, wk->inflight[i]);
+
+	max_pkts = RTE_MIN(max_pkts,
+			(unsigned int)RTE_DISTRIB_SCALABLE_MAX_BURST);
+	r = wk->next_ring;
+	for (i = 0; i < d->num_distributors && n < max_pkts; i++) {
+		n += rte_ring_sc_dequeue_burst(worker_ring(d, r, worker_id),
+				(void **)&pkts[n], max_pkts - n, NULL);
+		if (++r == d->num_distributors)
+			r = 0;
+	}
+	wk->next_ring = r;
+
+	/* the tag may be changed while processing, save the flows */
+	for (i = 0; i < n; i++)
+		wk->inflight[i] = flow_index(d, pkts[i]);
+	wk->nb_inflight = n;
+
+	return n;
+}
+
+unsigned int __rte_experimental
+rte_distributor_scalable_return_pkt(struct rte_distributor_scalable *d,
+		unsigned int worker_id, struct rte_mbuf **oldpkts,
+		unsigned int num)
+{
+	return rte_ring_sp_enqueue_burst(d->ret_rings[worker_id],
+			(void **)oldpkts, num, NULL);
+}
+
+static struct rte_ring *
+dist_scalable_ring_create(unsigned int count, int socket_id,
+		unsigned int flags)
+{
+	struct rte_ring *r;
+	ssize_t size;
+
+	size = rte_ring_get_memsize(count);
+	if (size < 0)
+		return NULL;
+
+	r = rte_zmalloc_socket(NULL, size, RTE_CACHE_LINE_SIZE, socket_id);
+	if (r == NULL)
+		return NULL;
+
+	/* the rings are private, they are not added to the ring list */
+	if (rte_ring_init(r, "dist_scalable", count, flags) != 0) {
+		rte_free(r);
+		return NULL;
+	}
+	return r;
+}
+
+static void
+dist_scalable_destroy(struct rte_distributor_scalable *d)
+{
+	unsigned int i;
+
+	if (d->rings != NULL)
+		for (i = 0; i < d->num_distributors * d->num_workers; i++)
+			rte_free(d->rings[i]);
+	if (d->ret_rings != NULL)
+		for (i = 0; i < d->num_workers; i++)
+			rte_free(d->ret_rings[i]);
+	rte_free(d->rings);
+	rte_free(d->ret_rings);
+	rte_free(d->flows);
+	rte_free(d->dists);
+	rte_free(d->workers);
+	rte_free(d);
+}
+
+struct rte_distributor_scalable * __rte_experimental
+rte_distributor_scalable_create(
+		const struct rte_distributor_scalable_params *params)
+{
+	struct rte_distributor_scalable *d;
+	unsigned int i, nb_rings, ret_size;
+	int socket_id;
+
+	if (params == NULL || params->name == NULL ||
+			params->num_distributors == 0 ||
+			params->num_distributors >
+				RTE_DISTRIB_SCALABLE_MAX_DISTRIBUTORS ||
+			params->num_workers == 0 ||
+			params->num_workers > RTE_DISTRIB_SCALABLE_MAX_WORKERS ||
+			!rte_is_power_of_2(params->ring_size) ||
+			!rte_is_power_of_2(params->flow_table_size)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	/* the packets of a flow in flight must fit in an entry */
+	if ((uint64_t)params->ring_size * params->num_distributors +
+			RTE_DISTRIB_SCALABLE_MAX_BURST > FLOW_COUNT_MASK) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	socket_id = params->socket_id;
+	d = rte_zmalloc_socket(params->name, sizeof(*d), RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (d == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	strlcpy(d->name, params->name, sizeof(d->name));
+	d->num_distributors = params->num_distributors;
+	d->num_workers = params->num_workers;
+	d->flow_mask = params->flow_table_size - 1;
+
+	nb_rings = d->num_distributors * d->num_workers;
+	d->flows = rte_zmalloc_socket(params->name,
+			params->flow_table_size * sizeof(d->flows[0]),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	d->rings = rte_zmalloc_socket(params->name,
+			nb_rings * sizeof(d->rings[0]), 0, socket_id);
+	d->ret_rings = rte_zmalloc_socket(params->name,
+			d->num_workers * sizeof(d->ret_rings[0]), 0,
+			socket_id);
+	d->dists = rte_zmalloc_socket(params->name,
+			d->num_distributors * sizeof(d->dists[0]),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	d->workers = rte_zmalloc_socket(params->name,
+			d->num_workers * sizeof(d->workers[0]),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (d->flows == NULL || d->rings == NULL || d->ret_rings == NULL ||
+			d->dists == NULL || d->workers == NULL)
+		goto nomem;
+
+	for (i = 0; i < nb_rings; i++) {
+		d->rings[i] = dist_scalable_ring_create(params->ring_size,
+				socket_id, RING_F_SP_ENQ | RING_F_SC_DEQ);
+		if (d->rings[i] == NULL)
+			goto nomem;
+	}
+
+	/* any distributor lcore may get the packets of a worker */
+	ret_size = rte_align32pow2(params->ring_size *
+			d->num_distributors);
+	for (i = 0; i < d->num_workers; i++) {
+		d->ret_rings[i] = dist_scalable_ring_create(ret_size,
+				socket_id, RING_F_SP_ENQ);
+		if (d->ret_rings[i] == NULL)
+			goto nomem;
+	}
+
+	return d;
+
+nomem:
+	dist_scalable_destroy(d);
+	rte_errno = ENOMEM;
+	return NULL;
+}
+
+void __rte_experimental
+rte_distributor_scalable_free(struct rte_distributor_scalable *d)
+{
+	if (d == NULL)
+		return;
+
+	dist_scalable_destroy(d);
+}
@@ -18,6 +18,7 @@
 #include <rte_branch_prediction.h>
 #include <rte_memcpy.h>
 #include <rte_ring.h>
+#include <rte_spinlock.h>
 #include <rte_jhash.h>
 #include <rte_hash_crc.h>
 
@@ -77,6 +78,7 @@ enum efd_lookup_internal_function {
 	EFD_LOOKUP_SCALAR = 0,
 	EFD_LOOKUP_AVX2,
 	EFD_LOOKUP_NEON,
+	EFD_LOOKUP_AVX512,
 	EFD_LOOKUP_NUM
 };
 
@@ -247,6 +249,8 @@ struct rte_efd_table {
 	enum efd_lookup_internal_function lookup_fn;
 	/**< Indicates which lookup function to use. */
 
+	uint32_t flags; /**< RTE_EFD_F_* flags given at creation. */
+
 	struct efd_online_chunk *chunks[RTE_MAX_NUMA_NODES];
 	/**< Dynamic array of size num_chunks of chunk records. */
 
@@ -257,6 +261,11 @@ struct rte_efd_table {
 	/**< Ring that stores all indexes of the free slots in the key table */
 
 	uint8_t *keys; /**< Dynamic array of size max_num_rules of keys */
+
+	rte_spinlock_t *chunk_locks;
+	/**< Dynamic array of size num_chunks of locks, used by multi-writer
+	 * tables to serialize the updates of each chunk.
+	 */
 };
 
 /**
@@ -494,6 +503,15 @@ efd_search_hash(struct rte_efd_table * const table,
 struct rte_efd_table *
 rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 		uint8_t online_cpu_socket_bitmask, uint8_t offline_cpu_socket)
+{
+	return rte_efd_create_flags(name, max_num_rules, key_len,
+			online_cpu_socket_bitmask, offline_cpu_socket, 0);
+}
+
+struct rte_efd_table * __rte_experimental
+rte_efd_create_flags(const char *name, uint32_t max_num_rules,
+		uint32_t key_len, uint8_t online_cpu_socket_bitmask,
+		uint8_t offline_cpu_socket, uint32_t flags)
 {
 	struct rte_efd_table *table = NULL;
 	uint8_t *key_array = NULL;
@@ -579,6 +597,7 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 	table->num_chunks = num_chunks;
 	table->num_chunks_shift = num_chunks_shift;
 	table->key_len = key_len;
+	table->flags = flags;
 
 	/* key_array */
 	key_array = rte_zmalloc_socket(NULL,
@@ -644,6 +663,12 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 	 * For less than 4 bits, scalar function performs better
 	 * than vectorised version
 	 */
+#if defined(RTE_MACHINE_CPUFLAG_AVX512F)
+	if (RTE_EFD_VALUE_NUM_BITS > 3 &&
+			rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F))
+		table->lookup_fn = EFD_LOOKUP_AVX512;
+	else
+#endif
 	if (RTE_EFD_VALUE_NUM_BITS > 3 && rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2))
 		table->lookup_fn = EFD_LOOKUP_AVX2;
 	else
@@ -683,6 +708,20 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 			(float) offline_table_size / (1024.0F * 1024.0F),
 			offline_cpu_socket);
 
+	if (flags & RTE_EFD_F_MULTI_WRITER) {
+		table->chunk_locks = rte_malloc_socket(NULL,
+				num_chunks * sizeof(rte_spinlock_t),
+				RTE_CACHE_LINE_SIZE, offline_cpu_socket);
+		if (table->chunk_locks == NULL) {
+			RTE_LOG(ERR, EFD, "Allocating EFD chunk locks on "
+					"socket %u failed\n",
+					offline_cpu_socket);
+			goto error_unlock_exit;
+		}
+		for (i = 0; i < num_chunks; i++)
+			rte_spinlock_init(&table->chunk_locks[i]);
+	}
+
 	te->data = (void *) table;
 	TAILQ_INSERT_TAIL(efd_list, te, next);
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -765,6 +804,7 @@ rte_efd_free(struct rte_efd_table *table)
 	rte_ring_free(table->free_slots);
 	rte_free(table->offline_chunks);
 	rte_free(table->keys);
+	rte_free(table->chunk_locks);
 	rte_free(table);
 }
 
@@ -906,6 +946,38 @@ revert_groups(struct efd_offline_group_rules *previous_group,
 	current_group->num_rules -= bin_size;
 }
 
+/*
+ * Update the number of rules of the table, which is shared by all the
+ * chunks of a multi-writer table
+ */
+static inline void
+efd_add_num_rules(struct rte_efd_table * const table, const int32_t n)
+{
+	if (table->flags & RTE_EFD_F_MULTI_WRITER)
+		__atomic_add_fetch(&table->num_rules, n, __ATOMIC_RELAXED);
+	else
+		table->num_rules += n;
+}
+
+/*
+ * Take the lock of a chunk before modifying it, for multi-writer tables
+ */
+static inline void
+efd_chunk_lock(const struct rte_efd_table * const table,
+		const uint32_t chunk_id)
+{
+	if (table->flags & RTE_EFD_F_MULTI_WRITER)
+		rte_spinlock_lock(&table->chunk_locks[chunk_id]);
+}
+
+static inline void
+efd_chunk_unlock(const struct rte_efd_table * const table,
+		const uint32_t chunk_id)
+{
+	if (table->flags & RTE_EFD_F_MULTI_WRITER)
+		rte_spinlock_unlock(&table->chunk_locks[chunk_id]);
+}
+
 /**
  * Computes an updated table entry where the supplied key points to a new host.
  * If no entry exists, one is inserted.
@@ -922,11 +994,11 @@ revert_groups(struct efd_offline_group_rules *previous_group,
  * @param value
  *   Value to associate with key
  * @param chunk_id
- *   Chunk ID of the chunk that was modified
+ *   Chunk ID of the key, computed by efd_compute_ids
  * @param group_id
  *   Group ID of the group that was modified
  * @param bin_id
- *   Bin ID that was modified
+ *   Bin ID of the key, computed by efd_compute_ids
  * @param new_bin_choice
  *   Newly chosen permutation which this bin will use
  * @param entry
@@ -953,8 +1025,8 @@ revert_groups(struct efd_offline_group_rules *previous_group,
 static inline int
 efd_compute_update(struct rte_efd_table * const table,
 		const unsigned int socket_id, const void *key,
-		const efd_value_t value, uint32_t * const chunk_id,
-		uint32_t * const group_id, uint32_t * const bin_id,
+		const efd_value_t value, const uint32_t * const chunk_id,
+		uint32_t * const group_id, const uint32_t * const bin_id,
 		uint8_t * const new_bin_choice,
 		struct efd_online_group_entry * const entry)
 {
@@ -965,8 +1037,6 @@ efd_compute_update(struct rte_efd_table * const table,
 	int status = EXIT_SUCCESS;
 	unsigned int found = 0;
 
-	efd_compute_ids(table, key, chunk_id, bin_id);
-
 	struct efd_offline_chunk_rules * const chunk =
 			&table->offline_chunks[*chunk_id];
 	struct efd_offline_group_rules *new_group;
@@ -1028,7 +1098,11 @@ efd_compute_update(struct rte_efd_table * const table,
 			status = RTE_EFD_UPDATE_WARN_GROUP_FULL;
 		}
 
-		if (rte_ring_sc_dequeue(table->free_slots, &slot_id) != 0)
+		if (table->flags & RTE_EFD_F_MULTI_WRITER)
+			ret = rte_ring_mc_dequeue(table->free_slots, &slot_id);
+		else
+			ret = rte_ring_sc_dequeue(table->free_slots, &slot_id);
+		if (ret != 0)
 			return RTE_EFD_UPDATE_FAILED;
 
 		new_k = RTE_PTR_ADD(table->keys, (uintptr_t) slot_id *
@@ -1041,7 +1115,7 @@ efd_compute_update(struct rte_efd_table * const table,
 		current_group->value[current_group->num_rules] = value;
 		current_group->bin_id[current_group->num_rules] = *bin_id;
 		current_group->num_rules++;
-		table->num_rules++;
+		efd_add_num_rules(table, 1);
 		bin_size++;
 	} else {
 		uint32_t last = current_group->num_rules - 1;
@@ -1146,7 +1220,7 @@ efd_compute_update(struct rte_efd_table * const table,
 
 	if (!found) {
 		current_group->num_rules--;
-		table->num_rules--;
+		efd_add_num_rules(table, -1);
 	} else
 		current_group->value[current_group->num_rules - 1] =
 			key_changed_previous_value;
@@ -1160,19 +1234,28 @@ rte_efd_update(struct rte_efd_table * const table, const unsigned int socket_id,
 	uint32_t chunk_id = 0, group_id = 0, bin_id = 0;
 	uint8_t new_bin_choice = 0;
 	struct efd_online_group_entry entry;
+	int status;
 
-	int status = efd_compute_update(table, socket_id, key, value,
+	efd_compute_ids(table, key, &chunk_id, &bin_id);
+	efd_chunk_lock(table, chunk_id);
+
+	status = efd_compute_update(table, socket_id, key, value,
 			&chunk_id, &group_id, &bin_id,
 			&new_bin_choice, &entry);
 
-	if (status == RTE_EFD_UPDATE_NO_CHANGE)
+	if (status == RTE_EFD_UPDATE_NO_CHANGE) {
+		efd_chunk_unlock(table, chunk_id);
 		return EXIT_SUCCESS;
+	}
 
-	if (status == RTE_EFD_UPDATE_FAILED)
+	if (status == RTE_EFD_UPDATE_FAILED) {
+		efd_chunk_unlock(table, chunk_id);
 		return status;
+	}
 
 	efd_apply_update(table, socket_id, chunk_id, group_id, bin_id,
 			new_bin_choice, &entry);
+	efd_chunk_unlock(table, chunk_id);
 	return status;
 }
 
@@ -1185,6 +1268,7 @@ rte_efd_delete(struct rte_efd_table * const table, const unsigned int socket_id,
 	uint8_t not_found = 1;
 
 	efd_compute_ids(table, key, &chunk_id, &bin_id);
+	efd_chunk_lock(table, chunk_id);
 
 	struct efd_offline_chunk_rules * const chunk =
 			&table->offline_chunks[chunk_id];
@@ -1209,8 +1293,14 @@ rte_efd_delete(struct rte_efd_table * const table, const unsigned int socket_id,
 					*prev_value = current_group->value[i];
 
 				not_found = 0;
-				rte_ring_sp_enqueue(table->free_slots,
-					(void *)((uintptr_t)current_group->key_idx[i]));
+				if (table->flags & RTE_EFD_F_MULTI_WRITER)
+					rte_ring_mp_enqueue(table->free_slots,
+						(void *)((uintptr_t)
+						current_group->key_idx[i]));
+				else
+					rte_ring_sp_enqueue(table->free_slots,
+						(void *)((uintptr_t)
+						current_group->key_idx[i]));
 			}
 		} else {
 			/*
@@ -1226,10 +1316,11 @@ rte_efd_delete(struct rte_efd_table * const table, const unsigned int socket_id,
 	}
 
 	if (not_found == 0) {
-		table->num_rules--;
+		efd_add_num_rules(table, -1);
 		current_group->num_rules--;
 	}
 
+	efd_chunk_unlock(table, chunk_id);
 	return not_found;
 }
 
@@ -1264,7 +1355,7 @@ efd_lookup_internal(const struct efd_online_group_entry * const group,
 
 	switch (lookup_fn) {
 
-#if defined(RTE_ARCH_X86) && defined(CC_SUPPORT_AVX2)
+#if defined(RTE_ARCH_X86) && defined(RTE_MACHINE_CPUFLAG_AVX2)
 	case EFD_LOOKUP_AVX2:
 		return efd_lookup_internal_avx2(group->hash_idx,
 					group->lookup_table,
@@ -1272,6 +1363,14 @@ efd_lookup_internal(const struct efd_online_group_entry * const group,
 					hash_val_b);
 		break;
 #endif
+#if defined(RTE_ARCH_X86) && defined(RTE_MACHINE_CPUFLAG_AVX512F)
+	case EFD_LOOKUP_AVX512:
+		return efd_lookup_internal_avx512(group->hash_idx,
+					group->lookup_table,
+					hash_val_a,
+					hash_val_b);
+		break;
+#endif
 #if defined(RTE_ARCH_ARM64)
 	case EFD_LOOKUP_NEON:
 		return efd_lookup_internal_neon(group->hash_idx,
@@ -1292,6 +1391,56 @@ efd_lookup_internal(const struct efd_online_group_entry * const group,
 	return value;
 }
 
+/*
+ * Looks up the values of several keys, whose groups are already known.
+ * When the value of a key fills no more than half of a vector, the values
+ * of two keys are computed at once.
+ */
+static inline void
+efd_lookup_internal_bulk(const struct efd_online_group_entry * const *groups,
+		const uint32_t *hash_val_a, const uint32_t *hash_val_b,
+		const int num_keys, efd_value_t * const value_list,
+		enum efd_lookup_internal_function lookup_fn)
+{
+	int i = 0;
+
+	switch (lookup_fn) {
+
+#if defined(RTE_ARCH_X86) && defined(RTE_MACHINE_CPUFLAG_AVX2) && \
+	RTE_EFD_VALUE_NUM_BITS <= 4
+	case EFD_LOOKUP_AVX2:
+		for (; i + 1 < num_keys; i += 2)
+			efd_lookup_internal_avx2_x2(groups[i]->hash_idx,
+					groups[i]->lookup_table,
+					hash_val_a[i], hash_val_b[i],
+					groups[i + 1]->hash_idx,
+					groups[i + 1]->lookup_table,
+					hash_val_a[i + 1], hash_val_b[i + 1],
+					&value_list[i], &value_list[i + 1]);
+		break;
+#endif
+#if defined(RTE_ARCH_X86) && defined(RTE_MACHINE_CPUFLAG_AVX512F) && \
+	RTE_EFD_VALUE_NUM_BITS <= 8
+	case EFD_LOOKUP_AVX512:
+		for (; i + 1 < num_keys; i += 2)
+			efd_lookup_internal_avx512_x2(groups[i]->hash_idx,
+					groups[i]->lookup_table,
+					hash_val_a[i], hash_val_b[i],
+					groups[i + 1]->hash_idx,
+					groups[i + 1]->lookup_table,
+					hash_val_a[i + 1], hash_val_b[i + 1],
+					&value_list[i], &value_list[i + 1]);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	for (; i < num_keys; i++)
+		value_list[i] = efd_lookup_internal(groups[i],
+				hash_val_a[i], hash_val_b[i], lookup_fn);
+}
+
 efd_value_t
 rte_efd_lookup(const struct rte_efd_table * const table,
 		const unsigned int socket_id, const void *key)
@@ -1322,7 +1471,9 @@ void rte_efd_lookup_bulk(const struct rte_efd_table * const table,
 	uint32_t bin_id_list[RTE_EFD_BURST_MAX];
 	uint8_t bin_choice_list[RTE_EFD_BURST_MAX];
 	uint32_t group_id_list[RTE_EFD_BURST_MAX];
-	struct efd_online_group_entry *group;
+	uint32_t hash_val_a_list[RTE_EFD_BURST_MAX];
+	uint32_t hash_val_b_list[RTE_EFD_BURST_MAX];
+	const struct efd_online_group_entry *group_list[RTE_EFD_BURST_MAX];
 
 	struct efd_online_chunk *chunks = table->chunks[socket_id];
 
@@ -1337,15 +1488,17 @@ void rte_efd_lookup_bulk(const struct rte_efd_table * const table,
 				chunk_id_list[i], bin_id_list[i]);
 		group_id_list[i] =
 				efd_bin_to_group[bin_choice_list[i]][bin_id_list[i]];
-		group = &chunks[chunk_id_list[i]].groups[group_id_list[i]];
-		rte_prefetch0(group);
+		group_list[i] =
+				&chunks[chunk_id_list[i]].groups[group_id_list[i]];
+		rte_prefetch0(group_list[i]);
 	}
 
+	/* Compute the hashes while the groups are being fetched */
 	for (i = 0; i < num_keys; i++) {
-		group = &chunks[chunk_id_list[i]].groups[group_id_list[i]];
-		value_list[i] = efd_lookup_internal(group,
-				EFD_HASHFUNCA(key_list[i], table),
-				EFD_HASHFUNCB(key_list[i], table),
-				table->lookup_fn);
+		hash_val_a_list[i] = EFD_HASHFUNCA(key_list[i], table);
+		hash_val_b_list[i] = EFD_HASHFUNCB(key_list[i], table);
 	}
+
+	efd_lookup_internal_bulk(group_list, hash_val_a_list, hash_val_b_list,
+			num_keys, value_list, table->lookup_fn);
 }
@@ -13,6 +13,8 @@
 
 #include <stdint.h>
 
+#include <rte_compat.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -102,6 +104,12 @@ extern "C" {
 /** Maximum number of characters in efd name.*/
 #define RTE_EFD_NAMESIZE			32
 
+/**
+ * Flag to allow calling rte_efd_update() and rte_efd_delete() from several
+ * threads concurrently.
+ */
+#define RTE_EFD_F_MULTI_WRITER			0x1
+
 #if (RTE_EFD_VALUE_NUM_BITS > 0 && RTE_EFD_VALUE_NUM_BITS <= 8)
 typedef uint8_t efd_value_t;
 #elif (RTE_EFD_VALUE_NUM_BITS > 8 && RTE_EFD_VALUE_NUM_BITS <= 16)
@@ -141,6 +149,41 @@ struct rte_efd_table *
 rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 	uint8_t online_cpu_socket_bitmask, uint8_t offline_cpu_socket);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Creates an EFD table like rte_efd_create(), with additional flags.
+ *
+ * With RTE_EFD_F_MULTI_WRITER, every chunk of the table is protected by its
+ * own lock, taken by rte_efd_update() and rte_efd_delete(). Updates of keys
+ * belonging to different chunks, including the search of a new perfect hash
+ * for their group, then run in parallel on several threads.
+ *
+ * @param name
+ *   EFD table name
+ * @param max_num_rules
+ *   Minimum number of rules the table should be sized to hold.
+ *   Will be rounded up to the next smallest valid table size
+ * @param key_len
+ *   Length of the key
+ * @param online_cpu_socket_bitmask
+ *   Bitmask specifying which sockets should get a copy of the online table.
+ *   LSB = socket 0, etc.
+ * @param offline_cpu_socket
+ *   Identifies the socket where the offline table will be allocated
+ *   (and most efficiently accessed in the case of updates/insertions)
+ * @param flags
+ *   RTE_EFD_F_* flags
+ *
+ * @return
+ *   EFD table, or NULL if table allocation failed or the bitmask is invalid
+ */
+struct rte_efd_table * __rte_experimental
+rte_efd_create_flags(const char *name, uint32_t max_num_rules,
+	uint32_t key_len, uint8_t online_cpu_socket_bitmask,
+	uint8_t offline_cpu_socket, uint32_t flags);
+
 /**
  * Releases the resources from an EFD table
  *
@@ -172,7 +215,8 @@ rte_efd_find_existing(const char *name);
  * The update is then immediately applied to the provided table and
  * all socket-local copies of the chunks are updated.
  * This operation is not multi-thread safe
- * and should only be called one from thread.
+ * and should only be called one from thread,
+ * unless the table was created with RTE_EFD_F_MULTI_WRITER.
  *
  * @param table
  *   EFD table to reference
@@ -203,7 +247,8 @@ rte_efd_update(struct rte_efd_table *table, unsigned int socket_id,
 /**
  * Removes any value currently associated with the specified key from the table
  * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * and should only be called from one thread,
+ * unless the table was created with RTE_EFD_F_MULTI_WRITER.
  *
  * @param table
  *   EFD table to reference
@@ -55,3 +55,136 @@ efd_lookup_internal_avx2(const efd_hashfunc_t *group_hash_idx,
 #endif
 
 }
+
+#if defined(RTE_MACHINE_CPUFLAG_AVX2) && RTE_EFD_VALUE_NUM_BITS <= 4
+/*
+ * Look up two keys at once, one in each 128-bit lane, when their values
+ * have no more than 4 bits.
+ */
+static inline void
+efd_lookup_internal_avx2_x2(const efd_hashfunc_t *group_hash_idx_0,
+		const efd_lookuptbl_t *group_lookup_table_0,
+		const uint32_t hash_val_a_0, const uint32_t hash_val_b_0,
+		const efd_hashfunc_t *group_hash_idx_1,
+		const efd_lookuptbl_t *group_lookup_table_1,
+		const uint32_t hash_val_a_1, const uint32_t hash_val_b_1,
+		efd_value_t *value_0, efd_value_t *value_1)
+{
+	const uint32_t value_mask = (1 << RTE_EFD_VALUE_NUM_BITS) - 1;
+	__m256i vhash_val_a = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_set1_epi32(hash_val_a_0)),
+			_mm_set1_epi32(hash_val_a_1), 1);
+	__m256i vhash_val_b = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_set1_epi32(hash_val_b_0)),
+			_mm_set1_epi32(hash_val_b_1), 1);
+	__m256i vhash_idx = _mm256_cvtepu16_epi32(_mm_unpacklo_epi64(
+			_mm_loadl_epi64((__m128i const *)group_hash_idx_0),
+			_mm_loadl_epi64((__m128i const *)group_hash_idx_1)));
+	__m256i vlookup_table = _mm256_cvtepu16_epi32(_mm_unpacklo_epi64(
+			_mm_loadl_epi64((__m128i const *)group_lookup_table_0),
+			_mm_loadl_epi64((__m128i const *)group_lookup_table_1)));
+	__m256i vhash = _mm256_add_epi32(vhash_val_a,
+			_mm256_mullo_epi32(vhash_idx, vhash_val_b));
+	__m256i vbucket_idx = _mm256_srli_epi32(vhash, EFD_LOOKUPTBL_SHIFT);
+	__m256i vresult = _mm256_srlv_epi32(vlookup_table, vbucket_idx);
+	uint32_t bits = _mm256_movemask_ps(
+			(__m256) _mm256_slli_epi32(vresult, 31));
+
+	*value_0 = bits & value_mask;
+	*value_1 = (bits >> 4) & value_mask;
+}
+#endif
+
+#ifdef RTE_MACHINE_CPUFLAG_AVX512F
+/*
+ * Zero extend to 32 bits the 16 entries of a group array starting at p,
+ * or only 8 of them when no more are left, so that the tables are not read
+ * further than by the AVX2 lookup.
+ */
+static inline __m512i
+efd_load_epu16_avx512(const uint16_t *p, uint32_t left)
+{
+	if (left > 8)
+		return _mm512_cvtepu16_epi32(
+				_mm256_loadu_si256((__m256i const *)p));
+
+	return _mm512_cvtepu16_epi32(_mm256_inserti128_si256(
+			_mm256_setzero_si256(),
+			_mm_loadu_si128((__m128i const *)p), 0));
+}
+
+static inline efd_value_t
+efd_lookup_internal_avx512(const efd_hashfunc_t *group_hash_idx,
+		const efd_lookuptbl_t *group_lookup_table,
+		const uint32_t hash_val_a, const uint32_t hash_val_b)
+{
+	efd_value_t value = 0;
+	uint32_t i = 0;
+	__m512i vhash_val_a = _mm512_set1_epi32(hash_val_a);
+	__m512i vhash_val_b = _mm512_set1_epi32(hash_val_b);
+	__m512i vone = _mm512_set1_epi32(1);
+
+	for (; i < RTE_EFD_VALUE_NUM_BITS; i += 16) {
+		__m512i vhash_idx = efd_load_epu16_avx512(
+				&group_hash_idx[i], RTE_EFD_VALUE_NUM_BITS - i);
+		__m512i vlookup_table = efd_load_epu16_avx512(
+				&group_lookup_table[i],
+				RTE_EFD_VALUE_NUM_BITS - i);
+		__m512i vhash = _mm512_add_epi32(vhash_val_a,
+				_mm512_mullo_epi32(vhash_idx, vhash_val_b));
+		__m512i vbucket_idx = _mm512_srli_epi32(vhash,
+				EFD_LOOKUPTBL_SHIFT);
+		__m512i vresult = _mm512_srlv_epi32(vlookup_table,
+				vbucket_idx);
+		uint32_t bits = _mm512_test_epi32_mask(vresult, vone);
+
+		if (RTE_EFD_VALUE_NUM_BITS - i < 16)
+			bits &= (1 << (RTE_EFD_VALUE_NUM_BITS - i)) - 1;
+		value |= (efd_value_t)bits << i;
+	}
+
+	return value;
+}
+#endif
+
+#if defined(RTE_MACHINE_CPUFLAG_AVX512F) && RTE_EFD_VALUE_NUM_BITS <= 8
+/*
+ * Look up two keys at once, one in each 256-bit half, when their values
+ * have no more than 8 bits.
+ */
+static inline void
+efd_lookup_internal_avx512_x2(const efd_hashfunc_t *group_hash_idx_0,
+		const efd_lookuptbl_t *group_lookup_table_0,
+		const uint32_t hash_val_a_0, const uint32_t hash_val_b_0,
+		const efd_hashfunc_t *group_hash_idx_1,
+		const efd_lookuptbl_t *group_lookup_table_1,
+		const uint32_t hash_val_a_1, const uint32_t hash_val_b_1,
+		efd_value_t *value_0, efd_value_t *value_1)
+{
+	const uint32_t value_mask = (1 << RTE_EFD_VALUE_NUM_BITS) - 1;
+	__m512i vhash_val_a = _mm512_inserti64x4(
+			_mm512_set1_epi32(hash_val_a_0),
+			_mm256_set1_epi32(hash_val_a_1), 1);
+	__m512i vhash_val_b = _mm512_inserti64x4(
+			_mm512_set1_epi32(hash_val_b_0),
+			_mm256_set1_epi32(hash_val_b_1), 1);
+	__m512i vhash_idx = _mm512_cvtepu16_epi32(_mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(
+				(__m128i const *)group_hash_idx_0)),
+			_mm_loadu_si128((__m128i const *)group_hash_idx_1), 1));
+	__m512i vlookup_table = _mm512_cvtepu16_epi32(_mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(
+				(__m128i const *)group_lookup_table_0)),
+			_mm_loadu_si128((__m128i const *)group_lookup_table_1),
+			1));
+	__m512i vhash = _mm512_add_epi32(vhash_val_a,
+			_mm512_mullo_epi32(vhash_idx, vhash_val_b));
+	__m512i vbucket_idx = _mm512_srli_epi32(vhash, EFD_LOOKUPTBL_SHIFT);
+	__m512i vresult = _mm512_srlv_epi32(vlookup_table, vbucket_idx);
+	uint32_t bits = _mm512_test_epi32_mask(vresult,
+			_mm512_set1_epi32(1));
+
+	*value_0 = bits & value_mask;
+	*value_1 = (bits >> 8) & value_mask;
+}
+#endif
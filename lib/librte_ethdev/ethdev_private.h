@@ -31,6 +31,9 @@ int rte_eth_devargs_parse_list(char *str, rte_eth_devargs_callback_t callback,
 	void *data);
 int rte_eth_devargs_parse_representor_ports(char *str, void *data);
 
+/* Non-zero if removed rx/tx callbacks are freed by the library. */
+int eth_callback_freed_by_rcu(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,7 +2,13 @@
  * Copyright(c) 2010-2018 Intel Corporation
  */
 
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_malloc.h>
+
 #include "ethdev_profile.h"
+#include "ethdev_private.h"
 
 /**
  * This conditional block enables Ethernet device profiling with
@@ -60,3 +66,304 @@ __rte_eth_dev_profile_init(__rte_unused uint16_t port_id,
 #endif
 	return 0;
 }
+
+/*
+ * Built-in burst profiling, enabled at runtime per port and reported
+ * through xstats.
+ *
+ * Burst sizes are counted in power of two buckets: 0, 1, 2-3, 4-7, 8-15,
+ * 16-31, 32-63 and 64 or more packets.
+ */
+#define ETH_PROFILE_BURST_BUCKETS 8
+
+struct eth_profile_queue {
+	const struct rte_eth_rxtx_callback *cb;
+	uint64_t polls;
+	uint64_t empty_polls;
+	uint64_t pkts;
+	uint64_t cycles;
+	uint64_t burst[ETH_PROFILE_BURST_BUCKETS];
+} __rte_cache_aligned;
+
+struct eth_profile {
+	uint16_t nb_rxq;
+	uint16_t nb_txq;
+	/* RX queues first, then TX queues */
+	struct eth_profile_queue q[];
+};
+
+static struct eth_profile *eth_profiles[RTE_MAX_ETHPORTS];
+
+static const char * const eth_profile_burst_names[] = {
+	"burst_0", "burst_1", "burst_2_3", "burst_4_7",
+	"burst_8_15", "burst_16_31", "burst_32_63", "burst_64_plus",
+};
+
+static const char * const eth_profile_stat_names[] = {
+	"polls", "empty_polls", "empty_poll_pct", "pkts",
+#ifdef RTE_ETHDEV_PROFILE_CYCLES
+	"cycles", "cycles_per_poll",
+#endif
+};
+
+#define ETH_PROFILE_NB_QUEUE_STATS (RTE_DIM(eth_profile_stat_names) + \
+		ETH_PROFILE_BURST_BUCKETS)
+
+static inline void
+eth_profile_burst(struct eth_profile_queue *q, uint16_t nb_pkts)
+{
+	unsigned int bucket;
+
+	q->polls++;
+	if (nb_pkts == 0) {
+		q->empty_polls++;
+		bucket = 0;
+	} else {
+		bucket = 32 - __builtin_clz(nb_pkts);
+		if (bucket >= ETH_PROFILE_BURST_BUCKETS)
+			bucket = ETH_PROFILE_BURST_BUCKETS - 1;
+	}
+	q->pkts += nb_pkts;
+	q->burst[bucket]++;
+}
+
+static uint16_t
+eth_profile_rx_cb(__rte_unused uint16_t port_id,
+	__rte_unused uint16_t queue_id, __rte_unused struct rte_mbuf *pkts[],
+	uint16_t nb_pkts, __rte_unused uint16_t max_pkts, void *user_param)
+{
+	eth_profile_burst(user_param, nb_pkts);
+	return nb_pkts;
+}
+
+static uint16_t
+eth_profile_tx_cb(__rte_unused uint16_t port_id,
+	__rte_unused uint16_t queue_id, __rte_unused struct rte_mbuf *pkts[],
+	uint16_t nb_pkts, void *user_param)
+{
+	eth_profile_burst(user_param, nb_pkts);
+	return nb_pkts;
+}
+
+static int
+eth_profile_remove_callbacks(uint16_t port_id, struct eth_profile *prof)
+{
+	struct eth_profile_queue *q;
+	uint16_t qid;
+	int ret;
+
+	for (qid = 0; qid < prof->nb_rxq + prof->nb_txq; qid++) {
+		q = &prof->q[qid];
+		if (q->cb == NULL)
+			continue;
+		if (qid < prof->nb_rxq)
+			ret = rte_eth_remove_rx_callback(port_id, qid, q->cb);
+		else
+			ret = rte_eth_remove_tx_callback(port_id,
+				qid - prof->nb_rxq, q->cb);
+		if (ret != 0)
+			return ret;
+		if (!eth_callback_freed_by_rcu())
+			rte_free((void *)(uintptr_t)q->cb);
+		q->cb = NULL;
+	}
+
+	/*
+	 * The counters may still be in use until removed callbacks are freed.
+	 * This waits without holding any lock, the caller must not be a QSBR
+	 * reader, as documented for rte_eth_dev_profile_disable().
+	 */
+	rte_eth_callback_reclaim(1);
+	return 0;
+}
+
+int __rte_experimental
+rte_eth_dev_profile_enable(uint16_t port_id)
+{
+	struct rte_eth_dev *dev;
+	struct eth_profile *prof;
+	uint16_t nb_rxq, nb_txq;
+	uint16_t qid;
+	int ret;
+
+	RTE_ETH_VALID_PORTID_OR_ERR_RET(port_id, -ENODEV);
+	dev = &rte_eth_devices[port_id];
+
+	if (eth_profiles[port_id] != NULL)
+		return -EBUSY;
+
+	nb_rxq = dev->data->nb_rx_queues;
+	nb_txq = dev->data->nb_tx_queues;
+	prof = rte_zmalloc_socket("ethdev_profile", sizeof(*prof) +
+			(nb_rxq + nb_txq) * sizeof(struct eth_profile_queue),
+			RTE_CACHE_LINE_SIZE, dev->data->numa_node);
+	if (prof == NULL)
+		return -ENOMEM;
+	prof->nb_rxq = nb_rxq;
+	prof->nb_txq = nb_txq;
+
+	for (qid = 0; qid < nb_rxq; qid++) {
+		prof->q[qid].cb = rte_eth_add_rx_callback(port_id, qid,
+				eth_profile_rx_cb, &prof->q[qid]);
+		if (prof->q[qid].cb == NULL)
+			goto fail;
+	}
+	for (qid = 0; qid < nb_txq; qid++) {
+		prof->q[nb_rxq + qid].cb = rte_eth_add_tx_callback(port_id,
+				qid, eth_profile_tx_cb, &prof->q[nb_rxq + qid]);
+		if (prof->q[nb_rxq + qid].cb == NULL)
+			goto fail;
+	}
+
+	eth_profiles[port_id] = prof;
+	return 0;
+
+fail:
+	ret = -rte_errno;
+	if (eth_profile_remove_callbacks(port_id, prof) != 0) {
+		/* callbacks left in place, let rte_eth_dev_profile_disable()
+		 * finish the cleanup
+		 */
+		eth_profiles[port_id] = prof;
+		return ret;
+	}
+	rte_free(prof);
+	return ret;
+}
+
+int __rte_experimental
+rte_eth_dev_profile_disable(uint16_t port_id)
+{
+	struct eth_profile *prof;
+	int ret;
+
+	RTE_ETH_VALID_PORTID_OR_ERR_RET(port_id, -ENODEV);
+
+	prof = eth_profiles[port_id];
+	if (prof == NULL)
+		return -EINVAL;
+
+	eth_profiles[port_id] = NULL;
+	ret = eth_profile_remove_callbacks(port_id, prof);
+	if (ret != 0) {
+		eth_profiles[port_id] = prof;
+		return ret;
+	}
+	rte_free(prof);
+	return 0;
+}
+
+void __rte_experimental
+__rte_eth_profile_rx_cycles(uint16_t port_id, uint16_t queue_id,
+	uint64_t cycles)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+
+	if (prof != NULL && queue_id < prof->nb_rxq)
+		prof->q[queue_id].cycles += cycles;
+}
+
+void __rte_experimental
+__rte_eth_profile_tx_cycles(uint16_t port_id, uint16_t queue_id,
+	uint64_t cycles)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+
+	if (prof != NULL && queue_id < prof->nb_txq)
+		prof->q[prof->nb_rxq + queue_id].cycles += cycles;
+}
+
+int
+eth_dev_profile_xstats_count(uint16_t port_id)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+
+	if (prof == NULL)
+		return 0;
+	return (prof->nb_rxq + prof->nb_txq) * ETH_PROFILE_NB_QUEUE_STATS;
+}
+
+int
+eth_dev_profile_xstats_get_names(uint16_t port_id,
+	struct rte_eth_xstat_name *xstats_names)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+	const char *dir;
+	unsigned int i, count = 0;
+	uint16_t qid, q;
+
+	if (prof == NULL)
+		return 0;
+
+	for (qid = 0; qid < prof->nb_rxq + prof->nb_txq; qid++) {
+		if (qid < prof->nb_rxq) {
+			dir = "rx";
+			q = qid;
+		} else {
+			dir = "tx";
+			q = qid - prof->nb_rxq;
+		}
+		for (i = 0; i < RTE_DIM(eth_profile_stat_names); i++)
+			snprintf(xstats_names[count++].name,
+				sizeof(xstats_names[0].name),
+				"%s_q%u_profile_%s", dir, q,
+				eth_profile_stat_names[i]);
+		for (i = 0; i < ETH_PROFILE_BURST_BUCKETS; i++)
+			snprintf(xstats_names[count++].name,
+				sizeof(xstats_names[0].name),
+				"%s_q%u_profile_%s", dir, q,
+				eth_profile_burst_names[i]);
+	}
+	return count;
+}
+
+int
+eth_dev_profile_xstats_get(uint16_t port_id, struct rte_eth_xstat *xstats)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+	struct eth_profile_queue *q;
+	unsigned int i, count = 0;
+	uint64_t polls;
+	uint16_t qid;
+
+	if (prof == NULL)
+		return 0;
+
+	for (qid = 0; qid < prof->nb_rxq + prof->nb_txq; qid++) {
+		q = &prof->q[qid];
+		/* counters are updated concurrently, use one snapshot */
+		polls = q->polls;
+		xstats[count++].value = polls;
+		xstats[count++].value = q->empty_polls;
+		xstats[count++].value = polls ?
+			q->empty_polls * 100 / polls : 0;
+		xstats[count++].value = q->pkts;
+#ifdef RTE_ETHDEV_PROFILE_CYCLES
+		xstats[count++].value = q->cycles;
+		xstats[count++].value = polls ? q->cycles / polls : 0;
+#endif
+		for (i = 0; i < ETH_PROFILE_BURST_BUCKETS; i++)
+			xstats[count++].value = q->burst[i];
+	}
+	return count;
+}
+
+void
+eth_dev_profile_xstats_reset(uint16_t port_id)
+{
+	struct eth_profile *prof = eth_profiles[port_id];
+	struct eth_profile_queue *q;
+	uint16_t qid;
+
+	if (prof == NULL)
+		return;
+
+	for (qid = 0; qid < prof->nb_rxq + prof->nb_txq; qid++) {
+		q = &prof->q[qid];
+		q->polls = 0;
+		q->empty_polls = 0;
+		q->pkts = 0;
+		q->cycles = 0;
+		memset(q->burst, 0, sizeof(q->burst));
+	}
+}
@@ -24,4 +24,36 @@
 int
 __rte_eth_dev_profile_init(uint16_t port_id, struct rte_eth_dev *dev);
 
+/**
+ * Number of extended statistics reported by the burst profiling of a port,
+ * zero when profiling is not enabled with rte_eth_dev_profile_enable().
+ */
+int
+eth_dev_profile_xstats_count(uint16_t port_id);
+
+/**
+ * Fill the names of the burst profiling extended statistics.
+ *
+ * @return
+ *  Number of entries filled, as given by eth_dev_profile_xstats_count().
+ */
+int
+eth_dev_profile_xstats_get_names(uint16_t port_id,
+	struct rte_eth_xstat_name *xstats_names);
+
+/**
+ * Fill the values of the burst profiling extended statistics.
+ *
+ * @return
+ *  Number of entries filled, as given by eth_dev_profile_xstats_count().
+ */
+int
+eth_dev_profile_xstats_get(uint16_t port_id, struct rte_eth_xstat *xstats);
+
+/**
+ * Reset the burst profiling counters of a port.
+ */
+void
+eth_dev_profile_xstats_reset(uint16_t port_id);
+
 #endif
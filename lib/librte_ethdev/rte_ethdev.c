@@ -37,6 +37,7 @@
 #include <rte_string_fns.h>
 #include <rte_kvargs.h>
 #include <rte_class.h>
+#include <rte_rcu_qsbr.h>
 
 #include "rte_ether.h"
 #include "rte_ethdev.h"
@@ -58,6 +59,22 @@ static rte_spinlock_t rte_eth_rx_cb_lock = RTE_SPINLOCK_INITIALIZER;
 /* spinlock for add/remove tx callbacks */
 static rte_spinlock_t rte_eth_tx_cb_lock = RTE_SPINLOCK_INITIALIZER;
 
+/* Removed rx/tx callback waiting for readers to go through a quiescent state */
+struct rte_eth_cb_defer {
+	TAILQ_ENTRY(rte_eth_cb_defer) next;
+	struct rte_eth_rxtx_callback *cb;
+	uint64_t token;
+};
+
+/* Removed rx/tx callbacks, oldest first, and the QSBR variable freeing them */
+TAILQ_HEAD(rte_eth_cb_defer_head, rte_eth_cb_defer);
+static struct rte_eth_cb_defer_head rte_eth_cb_defer_list =
+	TAILQ_HEAD_INITIALIZER(rte_eth_cb_defer_list);
+static struct rte_rcu_qsbr *rte_eth_cb_qsbr;
+
+/* spinlock for the deferred free of rx/tx callbacks */
+static rte_spinlock_t rte_eth_cb_defer_lock = RTE_SPINLOCK_INITIALIZER;
+
 /* spinlock for shared data allocation */
 static rte_spinlock_t rte_eth_shared_data_lock = RTE_SPINLOCK_INITIALIZER;
 
@@ -2003,6 +2020,7 @@ get_xstats_basic_count(struct rte_eth_dev *dev)
 	count = RTE_NB_STATS;
 	count += nb_rxqs * RTE_NB_RXQ_STATS;
 	count += nb_txqs * RTE_NB_TXQ_STATS;
+	count += eth_dev_profile_xstats_count(dev->data->port_id);
 
 	return count;
 }
@@ -2114,6 +2132,8 @@ rte_eth_basic_stats_get_names(struct rte_eth_dev *dev,
 			cnt_used_entries++;
 		}
 	}
+	cnt_used_entries += eth_dev_profile_xstats_get_names(
+		dev->data->port_id, xstats_names + cnt_used_entries);
 	return cnt_used_entries;
 }
 
@@ -2312,6 +2332,9 @@ rte_eth_basic_stats_get(uint16_t port_id, struct rte_eth_xstat *xstats)
 			xstats[count++].value = val;
 		}
 	}
+
+	/* burst profiling stats */
+	count += eth_dev_profile_xstats_get(port_id, xstats + count);
 	return count;
 }
 
@@ -2415,19 +2438,14 @@ rte_eth_xstats_get(uint16_t port_id, struct rte_eth_xstat *xstats,
 	struct rte_eth_dev *dev;
 	unsigned int count = 0, i;
 	signed int xcount = 0;
-	uint16_t nb_rxqs, nb_txqs;
 	int ret;
 
 	RTE_ETH_VALID_PORTID_OR_ERR_RET(port_id, -EINVAL);
 
 	dev = &rte_eth_devices[port_id];
 
-	nb_rxqs = RTE_MIN(dev->data->nb_rx_queues, RTE_ETHDEV_QUEUE_STAT_CNTRS);
-	nb_txqs = RTE_MIN(dev->data->nb_tx_queues, RTE_ETHDEV_QUEUE_STAT_CNTRS);
-
 	/* Return generic statistics */
-	count = RTE_NB_STATS + (nb_rxqs * RTE_NB_RXQ_STATS) +
-		(nb_txqs * RTE_NB_TXQ_STATS);
+	count = get_xstats_basic_count(dev);
 
 	/* implemented by the driver */
 	if (dev->dev_ops->xstats_get != NULL) {
@@ -2469,6 +2487,8 @@ rte_eth_xstats_reset(uint16_t port_id)
 	RTE_ETH_VALID_PORTID_OR_RET(port_id);
 	dev = &rte_eth_devices[port_id];
 
+	eth_dev_profile_xstats_reset(port_id);
+
 	/* implemented by the driver */
 	if (dev->dev_ops->xstats_reset != NULL) {
 		(*dev->dev_ops->xstats_reset)(dev);
@@ -3827,6 +3847,137 @@ rte_eth_dev_filter_ctrl(uint16_t port_id, enum rte_filter_type filter_type,
 							     filter_op, arg));
 }
 
+uint16_t
+rte_eth_call_rx_callbacks(uint16_t port_id, uint16_t queue_id,
+	struct rte_mbuf **rx_pkts, uint16_t nb_rx, uint16_t nb_pkts,
+	struct rte_eth_rxtx_callback *cb)
+{
+	do {
+		nb_rx = cb->fn.rx(port_id, queue_id, rx_pkts, nb_rx,
+				nb_pkts, cb->param);
+		cb = cb->next;
+	} while (cb != NULL);
+
+	return nb_rx;
+}
+
+uint16_t
+rte_eth_call_tx_callbacks(uint16_t port_id, uint16_t queue_id,
+	struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+	struct rte_eth_rxtx_callback *cb)
+{
+	do {
+		nb_pkts = cb->fn.tx(port_id, queue_id, tx_pkts, nb_pkts,
+				cb->param);
+		cb = cb->next;
+	} while (cb != NULL);
+
+	return nb_pkts;
+}
+
+/*
+ * Free the removed callbacks that no reader can be running anymore.
+ * Must be called with rte_eth_cb_defer_lock held, so it never waits for
+ * the readers. Returns the number of callbacks left.
+ */
+static int
+eth_cb_reclaim_locked(void)
+{
+	struct rte_eth_cb_defer *d;
+	int pending = 0;
+
+	/* tokens are increasing, stop at the first one still in use */
+	while ((d = TAILQ_FIRST(&rte_eth_cb_defer_list)) != NULL) {
+		if (rte_rcu_qsbr_check(rte_eth_cb_qsbr, d->token, false) != 1)
+			break;
+		TAILQ_REMOVE(&rte_eth_cb_defer_list, d, next);
+		rte_free(d->cb);
+		rte_free(d);
+	}
+
+	TAILQ_FOREACH(d, &rte_eth_cb_defer_list, next)
+		pending++;
+	return pending;
+}
+
+/*
+ * Free a callback just unlinked from its list, if the library owns it.
+ * The defer node is allocated by the caller before unlinking the callback,
+ * so that the removal never has to wait for the readers.
+ */
+static void
+eth_cb_free_deferred(struct rte_eth_rxtx_callback *cb,
+	struct rte_eth_cb_defer *d)
+{
+	rte_spinlock_lock(&rte_eth_cb_defer_lock);
+	if (rte_eth_cb_qsbr == NULL) {
+		/* freed by the application */
+		rte_spinlock_unlock(&rte_eth_cb_defer_lock);
+		rte_free(d);
+		return;
+	}
+
+	d->cb = cb;
+	d->token = rte_rcu_qsbr_start(rte_eth_cb_qsbr);
+	TAILQ_INSERT_TAIL(&rte_eth_cb_defer_list, d, next);
+	eth_cb_reclaim_locked();
+	rte_spinlock_unlock(&rte_eth_cb_defer_lock);
+}
+
+int __rte_experimental
+rte_eth_callback_rcu_qsbr_set(struct rte_rcu_qsbr *v)
+{
+	int ret = 0;
+
+	rte_spinlock_lock(&rte_eth_cb_defer_lock);
+	if (v != rte_eth_cb_qsbr && !TAILQ_EMPTY(&rte_eth_cb_defer_list))
+		ret = -EBUSY;
+	else
+		rte_eth_cb_qsbr = v;
+	rte_spinlock_unlock(&rte_eth_cb_defer_lock);
+
+	return ret;
+}
+
+int
+eth_callback_freed_by_rcu(void)
+{
+	return rte_eth_cb_qsbr != NULL;
+}
+
+int __rte_experimental
+rte_eth_callback_reclaim(int wait)
+{
+	struct rte_eth_cb_defer *d;
+	struct rte_rcu_qsbr *v = NULL;
+	uint64_t token = 0;
+	int pending;
+
+	rte_spinlock_lock(&rte_eth_cb_defer_lock);
+	pending = eth_cb_reclaim_locked();
+	d = TAILQ_LAST(&rte_eth_cb_defer_list, rte_eth_cb_defer_head);
+	if (wait != 0 && d != NULL) {
+		v = rte_eth_cb_qsbr;
+		token = d->token;
+	}
+	rte_spinlock_unlock(&rte_eth_cb_defer_lock);
+
+	if (v == NULL)
+		return pending;
+
+	/*
+	 * Wait outside of the lock: the QSBR variable cannot be changed
+	 * while callbacks are pending, and the last token covers them all.
+	 */
+	rte_rcu_qsbr_check(v, token, true);
+
+	rte_spinlock_lock(&rte_eth_cb_defer_lock);
+	pending = eth_cb_reclaim_locked();
+	rte_spinlock_unlock(&rte_eth_cb_defer_lock);
+
+	return pending;
+}
+
 const struct rte_eth_rxtx_callback *
 rte_eth_add_rx_callback(uint16_t port_id, uint16_t queue_id,
 		rte_rx_callback_fn fn, void *user_param)
@@ -3856,6 +4007,8 @@ rte_eth_add_rx_callback(uint16_t port_id, uint16_t queue_id,
 	struct rte_eth_rxtx_callback *tail =
 		rte_eth_devices[port_id].post_rx_burst_cbs[queue_id];
 
+	/* Make the callback visible to readers only once initialized */
+	rte_smp_wmb();
 	if (!tail) {
 		rte_eth_devices[port_id].post_rx_burst_cbs[queue_id] = cb;
 
@@ -3934,6 +4087,8 @@ rte_eth_add_tx_callback(uint16_t port_id, uint16_t queue_id,
 	struct rte_eth_rxtx_callback *tail =
 		rte_eth_devices[port_id].pre_tx_burst_cbs[queue_id];
 
+	/* Make the callback visible to readers only once initialized */
+	rte_smp_wmb();
 	if (!tail) {
 		rte_eth_devices[port_id].pre_tx_burst_cbs[queue_id] = cb;
 
@@ -3963,8 +4118,14 @@ rte_eth_remove_rx_callback(uint16_t port_id, uint16_t queue_id,
 	struct rte_eth_dev *dev = &rte_eth_devices[port_id];
 	struct rte_eth_rxtx_callback *cb;
 	struct rte_eth_rxtx_callback **prev_cb;
+	struct rte_eth_cb_defer *d;
 	int ret = -EINVAL;
 
+	/* allocated first, so that a removed callback can always be deferred */
+	d = rte_malloc(NULL, sizeof(*d), 0);
+	if (d == NULL)
+		return -ENOMEM;
+
 	rte_spinlock_lock(&rte_eth_rx_cb_lock);
 	prev_cb = &dev->post_rx_burst_cbs[queue_id];
 	for (; *prev_cb != NULL; prev_cb = &cb->next) {
@@ -3978,6 +4139,11 @@ rte_eth_remove_rx_callback(uint16_t port_id, uint16_t queue_id,
 	}
 	rte_spinlock_unlock(&rte_eth_rx_cb_lock);
 
+	if (ret == 0)
+		eth_cb_free_deferred(cb, d);
+	else
+		rte_free(d);
+
 	return ret;
 }
 
@@ -3998,6 +4164,12 @@ rte_eth_remove_tx_callback(uint16_t port_id, uint16_t queue_id,
 	int ret = -EINVAL;
 	struct rte_eth_rxtx_callback *cb;
 	struct rte_eth_rxtx_callback **prev_cb;
+	struct rte_eth_cb_defer *d;
+
+	/* allocated first, so that a removed callback can always be deferred */
+	d = rte_malloc(NULL, sizeof(*d), 0);
+	if (d == NULL)
+		return -ENOMEM;
 
 	rte_spinlock_lock(&rte_eth_tx_cb_lock);
 	prev_cb = &dev->pre_tx_burst_cbs[queue_id];
@@ -4012,6 +4184,11 @@ rte_eth_remove_tx_callback(uint16_t port_id, uint16_t queue_id,
 	}
 	rte_spinlock_unlock(&rte_eth_tx_cb_lock);
 
+	if (ret == 0)
+		eth_cb_free_deferred(cb, d);
+	else
+		rte_free(d);
+
 	return ret;
 }
 
@@ -2266,6 +2266,62 @@ int rte_eth_xstats_get_id_by_name(uint16_t port_id, const char *xstat_name,
  */
 void rte_eth_xstats_reset(uint16_t port_id);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Enable profiling of the RX and TX bursts of an Ethernet device.
+ *
+ * For each queue configured when this function is called, the number of
+ * bursts, of empty bursts and of packets, and a histogram of burst sizes in
+ * power of two buckets are counted. For RX the burst size is the number of
+ * packets received, for TX it is the number of packets given to
+ * rte_eth_tx_burst(). If DPDK is built with CONFIG_RTE_ETHDEV_PROFILE_CYCLES,
+ * the TSC cycles spent in the driver burst functions are counted as well,
+ * for the bursts called from code built with ALLOW_EXPERIMENTAL_API.
+ *
+ * The counters are reported as extended statistics named
+ * "rx_q<n>_profile_<stat>" and "tx_q<n>_profile_<stat>", following the
+ * generic statistics, and are reset by rte_eth_xstats_reset().
+ *
+ * Profiling is implemented with RX/TX callbacks, so it requires
+ * CONFIG_RTE_ETHDEV_RXTX_CALLBACKS and costs nothing when not enabled.
+ *
+ * @param port_id
+ *   The port identifier of the Ethernet device.
+ * @return
+ *   - 0: Success.
+ *   - -ENODEV: *port_id* is invalid.
+ *   - -EBUSY: profiling is already enabled on this port.
+ *   - -ENOTSUP: RX/TX callbacks are not supported.
+ *   - -ENOMEM: memory allocation failure.
+ */
+int __rte_experimental
+rte_eth_dev_profile_enable(uint16_t port_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Disable profiling of the RX and TX bursts of an Ethernet device and free
+ * its counters. No lcore may be polling the queues of the port when this
+ * function is called, and it must be called before the queues are
+ * reconfigured. If a QSBR variable was given with
+ * rte_eth_callback_rcu_qsbr_set(), this function waits for the readers to
+ * release the callbacks, so the calling thread must not be online on it.
+ *
+ * @param port_id
+ *   The port identifier of the Ethernet device.
+ * @return
+ *   - 0: Success.
+ *   - -ENODEV: *port_id* is invalid.
+ *   - -EINVAL: profiling is not enabled on this port.
+ *   - -ENOMEM: a callback could not be removed, profiling is left enabled
+ *     and the call can be retried.
+ */
+int __rte_experimental
+rte_eth_dev_profile_disable(uint16_t port_id);
+
 /**
  *  Set a mapping for the specified transmit queue to the specified per-queue
  *  statistics counter.
@@ -3440,8 +3496,15 @@ rte_eth_add_tx_callback(uint16_t port_id, uint16_t queue_id,
  * queue using rte_eth_add_rx_callback().
  *
  * Note: the callback is removed from the callback list but it isn't freed
- * since the it may still be in use. The memory for the callback can be
- * subsequently freed back by the application by calling rte_free():
+ * since the it may still be in use.
+ *
+ * If a QSBR variable was given with rte_eth_callback_rcu_qsbr_set(), the
+ * callback is freed by the library once all the threads reporting to that
+ * variable have gone through a quiescent state, and the application must
+ * not free it. rte_eth_callback_reclaim() can be used to wait for this.
+ *
+ * Otherwise the memory for the callback can be subsequently freed back by
+ * the application by calling rte_free():
  *
  * - Immediately - if the port is stopped, or the user knows that no
  *   callbacks are in flight e.g. if called from the thread doing RX/TX
@@ -3462,6 +3525,8 @@ rte_eth_add_tx_callback(uint16_t port_id, uint16_t queue_id,
  *   - -ENOTSUP: Callback support is not available.
  *   - -EINVAL:  The port_id or the queue_id is out of range, or the callback
  *               is NULL or not found for the port/queue.
+ *   - -ENOMEM:  The callback could not be queued for its deferred free, it
+ *               was left in place.
  */
 int rte_eth_remove_rx_callback(uint16_t port_id, uint16_t queue_id,
 		const struct rte_eth_rxtx_callback *user_cb);
@@ -3473,8 +3538,15 @@ int rte_eth_remove_rx_callback(uint16_t port_id, uint16_t queue_id,
  * queue using rte_eth_add_tx_callback().
  *
  * Note: the callback is removed from the callback list but it isn't freed
- * since the it may still be in use. The memory for the callback can be
- * subsequently freed back by the application by calling rte_free():
+ * since the it may still be in use.
+ *
+ * If a QSBR variable was given with rte_eth_callback_rcu_qsbr_set(), the
+ * callback is freed by the library once all the threads reporting to that
+ * variable have gone through a quiescent state, and the application must
+ * not free it. rte_eth_callback_reclaim() can be used to wait for this.
+ *
+ * Otherwise the memory for the callback can be subsequently freed back by
+ * the application by calling rte_free():
  *
  * - Immediately - if the port is stopped, or the user knows that no
  *   callbacks are in flight e.g. if called from the thread doing RX/TX
@@ -3495,10 +3567,58 @@ int rte_eth_remove_rx_callback(uint16_t port_id, uint16_t queue_id,
  *   - -ENOTSUP: Callback support is not available.
  *   - -EINVAL:  The port_id or the queue_id is out of range, or the callback
  *               is NULL or not found for the port/queue.
+ *   - -ENOMEM:  The callback could not be queued for its deferred free, it
+ *               was left in place.
  */
 int rte_eth_remove_tx_callback(uint16_t port_id, uint16_t queue_id,
 		const struct rte_eth_rxtx_callback *user_cb);
 
+struct rte_rcu_qsbr;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Set the QSBR variable used to free removed RX/TX callbacks.
+ *
+ * The threads calling rte_eth_rx_burst() and rte_eth_tx_burst() on queues
+ * with callbacks must be registered with *v* and report quiescent states
+ * outside of these calls, see rte_rcu_qsbr_quiescent(). Callbacks can then
+ * be removed at any time while traffic is running: the library frees them
+ * once no thread can be running them anymore.
+ *
+ * @param v
+ *   QSBR variable, or NULL to let the application free removed callbacks.
+ * @return
+ *   - 0: Success.
+ *   - -EBUSY: removed callbacks are still waiting to be freed with the
+ *     previous QSBR variable, see rte_eth_callback_reclaim().
+ */
+int __rte_experimental
+rte_eth_callback_rcu_qsbr_set(struct rte_rcu_qsbr *v);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Free the removed RX/TX callbacks which are no longer in use.
+ *
+ * This is also done by each callback removal, so it is only needed to wait
+ * until a removed callback has been freed, for example before freeing the
+ * parameter the callback was using.
+ *
+ * Waiting is done without holding any lock, but a thread reporting to the
+ * QSBR variable would wait for itself: it must not call this function with
+ * *wait* set unless it is offline, see rte_rcu_qsbr_thread_offline().
+ *
+ * @param wait
+ *   If non-zero, block until all removed callbacks are freed.
+ * @return
+ *   The number of removed callbacks still waiting to be freed.
+ */
+int __rte_experimental
+rte_eth_callback_reclaim(int wait);
+
 /**
  * Retrieve information about given port's RX queue.
  *
@@ -3929,6 +4049,54 @@ rte_eth_dev_get_sec_ctx(uint16_t port_id);
 
 #include <rte_ethdev_core.h>
 
+/*
+ * Cycle accounting calls experimental symbols, so it is only compiled in
+ * the burst functions of code allowed to use them, as profiling itself is
+ * enabled with an experimental API.
+ */
+#if defined(RTE_ETHDEV_PROFILE_CYCLES) && defined(ALLOW_EXPERIMENTAL_API)
+#define RTE_ETH_PROFILE_CYCLES_ENABLED
+#include <rte_cycles.h>
+#endif
+
+/**
+ * @internal
+ * Account the cycles spent in the driver RX burst function, when burst
+ * profiling is enabled on the port.
+ */
+void __rte_experimental
+__rte_eth_profile_rx_cycles(uint16_t port_id, uint16_t queue_id,
+	uint64_t cycles);
+
+/**
+ * @internal
+ * Account the cycles spent in the driver TX burst function, when burst
+ * profiling is enabled on the port.
+ */
+void __rte_experimental
+__rte_eth_profile_tx_cycles(uint16_t port_id, uint16_t queue_id,
+	uint64_t cycles);
+
+/**
+ * @internal
+ * Run the post-RX callbacks of a queue, from rte_eth_rx_burst(). They are
+ * kept out of line so that a queue without callbacks only costs a load and
+ * a branch at each call site.
+ */
+uint16_t
+rte_eth_call_rx_callbacks(uint16_t port_id, uint16_t queue_id,
+	struct rte_mbuf **rx_pkts, uint16_t nb_rx, uint16_t nb_pkts,
+	struct rte_eth_rxtx_callback *cb);
+
+/**
+ * @internal
+ * Run the pre-TX callbacks of a queue, from rte_eth_tx_burst().
+ */
+uint16_t
+rte_eth_call_tx_callbacks(uint16_t port_id, uint16_t queue_id,
+	struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+	struct rte_eth_rxtx_callback *cb);
+
 /**
  *
  * Retrieve a burst of input packets from a receive queue of an Ethernet
@@ -4017,6 +4185,9 @@ rte_eth_rx_burst(uint16_t port_id, uint16_t queue_id,
 {
 	struct rte_eth_dev *dev = &rte_eth_devices[port_id];
 	uint16_t nb_rx;
+#ifdef RTE_ETH_PROFILE_CYCLES_ENABLED
+	uint64_t start;
+#endif
 
 #ifdef RTE_LIBRTE_ETHDEV_DEBUG
 	RTE_ETH_VALID_PORTID_OR_ERR_RET(port_id, 0);
@@ -4026,20 +4197,24 @@ rte_eth_rx_burst(uint16_t port_id, uint16_t queue_id,
 		RTE_ETHDEV_LOG(ERR, "Invalid RX queue_id=%u\n", queue_id);
 		return 0;
 	}
+#endif
+#ifdef RTE_ETH_PROFILE_CYCLES_ENABLED
+	start = rte_rdtsc();
 #endif
 	nb_rx = (*dev->rx_pkt_burst)(dev->data->rx_queues[queue_id],
 				     rx_pkts, nb_pkts);
+#ifdef RTE_ETH_PROFILE_CYCLES_ENABLED
+	__rte_eth_profile_rx_cycles(port_id, queue_id, rte_rdtsc() - start);
+#endif
 
 #ifdef RTE_ETHDEV_RXTX_CALLBACKS
-	if (unlikely(dev->post_rx_burst_cbs[queue_id] != NULL)) {
+	{
 		struct rte_eth_rxtx_callback *cb =
 				dev->post_rx_burst_cbs[queue_id];
 
-		do {
-			nb_rx = cb->fn.rx(port_id, queue_id, rx_pkts, nb_rx,
-						nb_pkts, cb->param);
-			cb = cb->next;
-		} while (cb != NULL);
+		if (unlikely(cb != NULL))
+			nb_rx = rte_eth_call_rx_callbacks(port_id, queue_id,
+					rx_pkts, nb_rx, nb_pkts, cb);
 	}
 #endif
 
@@ -4297,16 +4472,21 @@ rte_eth_tx_burst(uint16_t port_id, uint16_t queue_id,
 #ifdef RTE_ETHDEV_RXTX_CALLBACKS
 	struct rte_eth_rxtx_callback *cb = dev->pre_tx_burst_cbs[queue_id];
 
-	if (unlikely(cb != NULL)) {
-		do {
-			nb_pkts = cb->fn.tx(port_id, queue_id, tx_pkts, nb_pkts,
-					cb->param);
-			cb = cb->next;
-		} while (cb != NULL);
-	}
+	if (unlikely(cb != NULL))
+		nb_pkts = rte_eth_call_tx_callbacks(port_id, queue_id,
+				tx_pkts, nb_pkts, cb);
 #endif
 
+#ifdef RTE_ETH_PROFILE_CYCLES_ENABLED
+	uint64_t start = rte_rdtsc();
+	uint16_t nb_tx = (*dev->tx_pkt_burst)(dev->data->tx_queues[queue_id],
+			tx_pkts, nb_pkts);
+
+	__rte_eth_profile_tx_cycles(port_id, queue_id, rte_rdtsc() - start);
+	return nb_tx;
+#else
 	return (*dev->tx_pkt_burst)(dev->data->tx_queues[queue_id], tx_pkts, nb_pkts);
+#endif
 }
 
 /**
@@ -16,7 +16,7 @@ gro_tcp4_tbl_create(uint16_t socket_id,
 {
 	struct gro_tcp4_tbl *tbl;
 	size_t size;
-	uint32_t entries_num, i;
+	uint32_t entries_num, hash_size, i;
 
 	entries_num = max_flow_num * max_item_per_flow;
 	entries_num = RTE_MIN(entries_num, GRO_TCP4_TBL_MAX_ITEM_NUM);
@@ -57,6 +57,22 @@ gro_tcp4_tbl_create(uint16_t socket_id,
 		tbl->flows[i].start_index = INVALID_ARRAY_INDEX;
 	tbl->max_flow_num = entries_num;
 
+	hash_size = GRO_TCP4_FLOW_HASH_SIZE(entries_num);
+	tbl->flow_hash = rte_malloc_socket(__func__,
+			sizeof(uint32_t) * hash_size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->flow_hash == NULL) {
+		rte_free(tbl->flows);
+		rte_free(tbl->items);
+		rte_free(tbl);
+		return NULL;
+	}
+	/* INVALID_ARRAY_INDEX indicates an empty hash slot */
+	for (i = 0; i < hash_size; i++)
+		tbl->flow_hash[i] = INVALID_ARRAY_INDEX;
+	tbl->flow_hash_mask = hash_size - 1;
+
 	return tbl;
 }
 
@@ -68,19 +84,27 @@ gro_tcp4_tbl_destroy(void *tbl)
 	if (tcp_tbl) {
 		rte_free(tcp_tbl->items);
 		rte_free(tcp_tbl->flows);
+		rte_free(tcp_tbl->flow_hash);
 	}
 	rte_free(tcp_tbl);
 }
 
+/*
+ * The search starts from the lowest index which may be empty, all the
+ * entries below it being in use, so that filling the table is linear.
+ */
 static inline uint32_t
 find_an_empty_item(struct gro_tcp4_tbl *tbl)
 {
 	uint32_t i;
 	uint32_t max_item_num = tbl->max_item_num;
 
-	for (i = 0; i < max_item_num; i++)
-		if (tbl->items[i].firstseg == NULL)
+	for (i = tbl->item_free_idx; i < max_item_num; i++)
+		if (tbl->items[i].firstseg == NULL) {
+			tbl->item_free_idx = i + 1;
 			return i;
+		}
+	tbl->item_free_idx = max_item_num;
 	return INVALID_ARRAY_INDEX;
 }
 
@@ -90,9 +114,12 @@ find_an_empty_flow(struct gro_tcp4_tbl *tbl)
 	uint32_t i;
 	uint32_t max_flow_num = tbl->max_flow_num;
 
-	for (i = 0; i < max_flow_num; i++)
-		if (tbl->flows[i].start_index == INVALID_ARRAY_INDEX)
+	for (i = tbl->flow_free_idx; i < max_flow_num; i++)
+		if (tbl->flows[i].start_index == INVALID_ARRAY_INDEX) {
+			tbl->flow_free_idx = i + 1;
 			return i;
+		}
+	tbl->flow_free_idx = max_flow_num;
 	return INVALID_ARRAY_INDEX;
 }
 
@@ -140,15 +167,72 @@ delete_item(struct gro_tcp4_tbl *tbl, uint32_t item_idx,
 	/* NULL indicates an empty item */
 	tbl->items[item_idx].firstseg = NULL;
 	tbl->item_num--;
+	if (item_idx < tbl->item_free_idx)
+		tbl->item_free_idx = item_idx;
 	if (prev_item_idx != INVALID_ARRAY_INDEX)
 		tbl->items[prev_item_idx].next_pkt_idx = next_idx;
 
 	return next_idx;
 }
 
+/*
+ * Look up the flow of a key in the flow hash table. If the flow isn't
+ * found, 'slot' is set to the empty slot which ends the probe sequence.
+ */
+static inline uint32_t
+find_flow(struct gro_tcp4_tbl *tbl,
+		struct tcp4_flow_key *key,
+		uint32_t hash,
+		uint32_t *slot)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t i, flow_idx;
+
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		flow_idx = tbl->flow_hash[i];
+		if (flow_idx == INVALID_ARRAY_INDEX)
+			break;
+		if (tbl->flows[flow_idx].hash == hash &&
+				is_same_tcp4_flow(tbl->flows[flow_idx].key,
+					*key))
+			return flow_idx;
+	}
+
+	*slot = i;
+	return INVALID_ARRAY_INDEX;
+}
+
+/*
+ * Remove a flow from the flow hash table, moving back the following
+ * entries of the probe sequence to fill the hole.
+ */
+static inline void
+delete_flow_hash(struct gro_tcp4_tbl *tbl, uint32_t flow_idx)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t i, j, k;
+
+	i = tbl->flows[flow_idx].hash & mask;
+	while (tbl->flow_hash[i] != flow_idx)
+		i = (i + 1) & mask;
+
+	for (j = (i + 1) & mask; tbl->flow_hash[j] != INVALID_ARRAY_INDEX;
+			j = (j + 1) & mask) {
+		/* Move the entry unless its home slot is in (i, j] */
+		k = tbl->flows[tbl->flow_hash[j]].hash & mask;
+		if (((j - k) & mask) >= ((j - i) & mask)) {
+			tbl->flow_hash[i] = tbl->flow_hash[j];
+			i = j;
+		}
+	}
+	tbl->flow_hash[i] = INVALID_ARRAY_INDEX;
+}
+
 static inline uint32_t
 insert_new_flow(struct gro_tcp4_tbl *tbl,
 		struct tcp4_flow_key *src,
+		uint32_t hash,
+		uint32_t slot,
 		uint32_t item_idx)
 {
 	struct tcp4_flow_key *dst;
@@ -169,6 +253,8 @@ insert_new_flow(struct gro_tcp4_tbl *tbl,
 	dst->dst_port = src->dst_port;
 
 	tbl->flows[flow_idx].start_index = item_idx;
+	tbl->flows[flow_idx].hash = hash;
+	tbl->flow_hash[slot] = flow_idx;
 	tbl->flow_num++;
 
 	return flow_idx;
@@ -204,9 +290,8 @@ gro_tcp4_reassemble(struct rte_mbuf *pkt,
 
 	struct tcp4_flow_key key;
 	uint32_t cur_idx, prev_idx, item_idx;
-	uint32_t i, max_flow_num, remaining_flow_num;
+	uint32_t i, hash, slot;
 	int cmp;
-	uint8_t find;
 
 	/*
 	 * Don't process the packet whose TCP header length is greater
@@ -252,30 +337,20 @@ gro_tcp4_reassemble(struct rte_mbuf *pkt,
 	key.recv_ack = tcp_hdr->recv_ack;
 
 	/* Search for a matched flow. */
-	max_flow_num = tbl->max_flow_num;
-	remaining_flow_num = tbl->flow_num;
-	find = 0;
-	for (i = 0; i < max_flow_num && remaining_flow_num; i++) {
-		if (tbl->flows[i].start_index != INVALID_ARRAY_INDEX) {
-			if (is_same_tcp4_flow(tbl->flows[i].key, key)) {
-				find = 1;
-				break;
-			}
-			remaining_flow_num--;
-		}
-	}
+	hash = gro_tcp4_flow_hash(&key);
+	i = find_flow(tbl, &key, hash, &slot);
 
 	/*
 	 * Fail to find a matched flow. Insert a new flow and store the
 	 * packet into the flow.
 	 */
-	if (find == 0) {
+	if (i == INVALID_ARRAY_INDEX) {
 		item_idx = insert_new_item(tbl, pkt, start_time,
 				INVALID_ARRAY_INDEX, sent_seq, ip_id,
 				is_atomic);
 		if (item_idx == INVALID_ARRAY_INDEX)
 			return -1;
-		if (insert_new_flow(tbl, &key, item_idx) ==
+		if (insert_new_flow(tbl, &key, hash, slot, item_idx) ==
 				INVALID_ARRAY_INDEX) {
 			/*
 			 * Fail to insert a new flow, so delete the
@@ -350,8 +425,12 @@ gro_tcp4_tbl_timeout_flush(struct gro_tcp4_tbl *tbl,
 				 */
 				j = delete_item(tbl, j, INVALID_ARRAY_INDEX);
 				tbl->flows[i].start_index = j;
-				if (j == INVALID_ARRAY_INDEX)
+				if (j == INVALID_ARRAY_INDEX) {
+					delete_flow_hash(tbl, i);
 					tbl->flow_num--;
+					if (i < tbl->flow_free_idx)
+						tbl->flow_free_idx = i;
+				}
 
 				if (unlikely(k == nb_out))
 					return k;
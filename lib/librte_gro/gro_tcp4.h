@@ -41,6 +41,8 @@ struct gro_tcp4_flow {
 	 * INVALID_ARRAY_INDEX indicates an empty flow.
 	 */
 	uint32_t start_index;
+	/* Hash of the flow 4-tuple */
+	uint32_t hash;
 };
 
 struct gro_tcp4_item {
@@ -81,6 +83,13 @@ struct gro_tcp4_tbl {
 	struct gro_tcp4_item *items;
 	/* flow array */
 	struct gro_tcp4_flow *flows;
+	/*
+	 * Open addressing hash table of flow indices, used to find the
+	 * flow of a packet. INVALID_ARRAY_INDEX indicates an empty slot.
+	 */
+	uint32_t *flow_hash;
+	/* hash table size minus 1, the size being a power of 2 */
+	uint32_t flow_hash_mask;
 	/* current item number */
 	uint32_t item_num;
 	/* current flow num */
@@ -89,8 +98,19 @@ struct gro_tcp4_tbl {
 	uint32_t max_item_num;
 	/* flow array size */
 	uint32_t max_flow_num;
+	/* lowest item index which may be empty */
+	uint32_t item_free_idx;
+	/* lowest flow index which may be empty */
+	uint32_t flow_free_idx;
 };
 
+/*
+ * The flow hash table has at least twice more slots than flows, to
+ * keep the probe sequences short.
+ */
+#define GRO_TCP4_FLOW_HASH_SIZE(max_flow_num) \
+	(rte_align32pow2(max_flow_num) * 2)
+
 /**
  * This function creates a TCP/IPv4 reassembly table.
  *
@@ -181,6 +201,27 @@ uint16_t gro_tcp4_tbl_timeout_flush(struct gro_tcp4_tbl *tbl,
  */
 uint32_t gro_tcp4_tbl_pkt_count(void *tbl);
 
+/*
+ * Calculate the hash of the 4-tuple of a TCP/IPv4 flow.
+ */
+static inline uint32_t
+gro_tcp4_flow_hash(const struct tcp4_flow_key *k)
+{
+	uint64_t h;
+
+	h = ((uint64_t)k->ip_src_addr << 32) | k->ip_dst_addr;
+	h ^= (((uint64_t)k->src_port << 16) | k->dst_port) *
+		0x9e3779b97f4a7c15ULL;
+	/* 64-bit finalizer of MurmurHash3 */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return (uint32_t)h;
+}
+
 /*
  * Check if two TCP/IPv4 packets belong to the same flow.
  */
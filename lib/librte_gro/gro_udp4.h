@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef _GRO_UDP4_H_
+#define _GRO_UDP4_H_
+
+#include <rte_ip.h>
+#include <rte_udp.h>
+
+#include "gro_tcp4.h"
+
+#define GRO_UDP4_TBL_MAX_ITEM_NUM (1024UL * 1024UL)
+
+/* The maximum number of datagrams merged into one packet */
+#define GRO_UDP_MAX_MERGE_NUM 64
+
+/* Header fields representing a UDP/IPv4 flow */
+struct udp4_flow_key {
+	struct ether_addr eth_saddr;
+	struct ether_addr eth_daddr;
+	uint32_t ip_src_addr;
+	uint32_t ip_dst_addr;
+
+	uint16_t src_port;
+	uint16_t dst_port;
+};
+
+struct gro_udp4_flow {
+	struct udp4_flow_key key;
+	/*
+	 * The index of the first packet in the flow.
+	 * INVALID_ARRAY_INDEX indicates an empty flow.
+	 */
+	uint32_t start_index;
+};
+
+struct gro_udp4_item {
+	/*
+	 * The first MBUF segment of the packet. If the value
+	 * is NULL, it means the item is empty.
+	 */
+	struct rte_mbuf *firstseg;
+	/* The last MBUF segment of the packet */
+	struct rte_mbuf *lastseg;
+	/*
+	 * The time when the first packet is inserted into the table.
+	 * This value won't be updated, even if the packet is merged
+	 * with other packets.
+	 */
+	uint64_t start_time;
+	/*
+	 * next_pkt_idx is used to chain the packets of the flow in
+	 * arrival order. Only the last one can be merged with.
+	 */
+	uint32_t next_pkt_idx;
+	/*
+	 * Payload length of the merged datagrams. All of them have this
+	 * length, except the last one which can be shorter.
+	 */
+	uint16_t seg_size;
+	/* the number of merged packets */
+	uint16_t nb_merged;
+	/* Indicate if a datagram shorter than seg_size was merged */
+	uint8_t is_closed;
+	/* Indicate if the DF bit is set (always set for IPv6) */
+	uint8_t is_atomic;
+};
+
+/*
+ * UDP/IPv4 reassembly table structure.
+ */
+struct gro_udp4_tbl {
+	/* item array */
+	struct gro_udp4_item *items;
+	/* flow array */
+	struct gro_udp4_flow *flows;
+	/* current item number */
+	uint32_t item_num;
+	/* current flow num */
+	uint32_t flow_num;
+	/* item array size */
+	uint32_t max_item_num;
+	/* flow array size */
+	uint32_t max_flow_num;
+};
+
+/**
+ * This function creates a UDP/IPv4 reassembly table.
+ *
+ * @param socket_id
+ *  Socket index for allocating the UDP/IPv4 reassemble table
+ * @param max_flow_num
+ *  The maximum number of flows in the UDP/IPv4 GRO table
+ * @param max_item_per_flow
+ *  The maximum number of packets per flow
+ *
+ * @return
+ *  - Return the table pointer on success.
+ *  - Return NULL on failure.
+ */
+void *gro_udp4_tbl_create(uint16_t socket_id,
+		uint16_t max_flow_num,
+		uint16_t max_item_per_flow);
+
+/**
+ * This function destroys a UDP/IPv4 reassembly table.
+ *
+ * @param tbl
+ *  Pointer pointing to the UDP/IPv4 reassembly table.
+ */
+void gro_udp4_tbl_destroy(void *tbl);
+
+/**
+ * This function merges a UDP/IPv4 packet with the previous datagrams of
+ * its flow, when they all have the same payload length. A shorter
+ * datagram ends the merged packet. It doesn't process IP fragments
+ * or packets without payload.
+ *
+ * The merged packet is flagged with PKT_RX_LRO and the payload length
+ * of the merged datagrams is saved in its tso_segsz field, so that the
+ * datagram boundaries can be restored by UDP segmentation. This function
+ * doesn't check if the packet has correct checksums and doesn't
+ * re-calculate checksums for the merged packet.
+ *
+ * @param pkt
+ *  Packet to reassemble
+ * @param tbl
+ *  Pointer pointing to the UDP/IPv4 reassembly table
+ * @start_time
+ *  The time when the packet is inserted into the table
+ *
+ * @return
+ *  - Return a positive value if the packet is merged.
+ *  - Return zero if the packet isn't merged but stored in the table.
+ *  - Return a negative value for invalid parameters or no available
+ *    space in the table.
+ */
+int32_t gro_udp4_reassemble(struct rte_mbuf *pkt,
+		struct gro_udp4_tbl *tbl,
+		uint64_t start_time);
+
+/**
+ * This function flushes timeout packets in a UDP/IPv4 reassembly table,
+ * and without updating checksums.
+ *
+ * @param tbl
+ *  UDP/IPv4 reassembly table pointer
+ * @param flush_timestamp
+ *  Flush packets which are inserted into the table before or at the
+ *  flush_timestamp.
+ * @param out
+ *  Pointer array used to keep flushed packets
+ * @param nb_out
+ *  The element number in 'out'. It also determines the maximum number of
+ *  packets that can be flushed finally.
+ *
+ * @return
+ *  The number of flushed packets
+ */
+uint16_t gro_udp4_tbl_timeout_flush(struct gro_udp4_tbl *tbl,
+		uint64_t flush_timestamp,
+		struct rte_mbuf **out,
+		uint16_t nb_out);
+
+/**
+ * This function returns the number of the packets in a UDP/IPv4
+ * reassembly table.
+ *
+ * @param tbl
+ *  UDP/IPv4 reassembly table pointer
+ *
+ * @return
+ *  The number of packets in the table
+ */
+uint32_t gro_udp4_tbl_pkt_count(void *tbl);
+
+/*
+ * Check if two UDP/IPv4 packets belong to the same flow.
+ */
+static inline int
+is_same_udp4_flow(const struct udp4_flow_key *k1,
+		const struct udp4_flow_key *k2)
+{
+	return (is_same_ether_addr(&k1->eth_saddr, &k2->eth_saddr) &&
+			is_same_ether_addr(&k1->eth_daddr, &k2->eth_daddr) &&
+			(k1->ip_src_addr == k2->ip_src_addr) &&
+			(k1->ip_dst_addr == k2->ip_dst_addr) &&
+			(k1->src_port == k2->src_port) &&
+			(k1->dst_port == k2->dst_port));
+}
+
+/*
+ * Check if a UDP packet can be appended to the datagrams of an item.
+ */
+static inline int
+check_udp_seg(struct gro_udp4_item *item,
+		uint16_t udp_dl,
+		uint8_t is_atomic)
+{
+	return (item->is_closed == 0) && (udp_dl <= item->seg_size) &&
+		(item->is_atomic == is_atomic) &&
+		(item->nb_merged < GRO_UDP_MAX_MERGE_NUM);
+}
+
+/*
+ * Append a UDP packet to the datagrams of an item without updating
+ * checksums. Return 0 if the merged packet would be longer than
+ * max_len, which includes the L2 header.
+ */
+static inline int
+merge_udp_packet(struct gro_udp4_item *item,
+		struct rte_mbuf *pkt,
+		uint16_t hdr_len,
+		uint16_t udp_dl,
+		uint32_t max_len)
+{
+	struct rte_mbuf *pkt_head = item->firstseg;
+
+	if (unlikely(pkt_head->pkt_len + udp_dl > max_len))
+		return 0;
+
+	/* remove the packet header for the appended packet */
+	rte_pktmbuf_adj(pkt, hdr_len);
+
+	/* chain the packet after the last datagram */
+	item->lastseg->next = pkt;
+	item->lastseg = rte_pktmbuf_lastseg(pkt);
+	item->nb_merged++;
+	if (udp_dl < item->seg_size)
+		item->is_closed = 1;
+
+	/* update MBUF metadata for the merged packet */
+	pkt_head->nb_segs += pkt->nb_segs;
+	pkt_head->pkt_len += pkt->pkt_len;
+
+	return 1;
+}
+#endif
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <errno.h>
+
+#include "gso_common.h"
+#include "gso_udp_seg.h"
+
+static void
+update_ip_udp_headers(struct rte_mbuf *pkt, uint8_t ipid_delta,
+		struct rte_mbuf **segs, uint16_t nb_segs)
+{
+	struct ipv4_hdr *ipv4_hdr;
+	uint16_t id = 0, i;
+	uint16_t l3_offset = pkt->l2_len;
+	uint16_t l4_offset = l3_offset + pkt->l3_len;
+	int is_ipv4 = (pkt->ol_flags & PKT_TX_IPV4) != 0;
+
+	if (is_ipv4) {
+		ipv4_hdr = rte_pktmbuf_mtod_offset(pkt, struct ipv4_hdr *,
+				l3_offset);
+		id = rte_be_to_cpu_16(ipv4_hdr->packet_id);
+	}
+
+	for (i = 0; i < nb_segs; i++) {
+		if (is_ipv4) {
+			update_ipv4_header(segs[i], l3_offset, id);
+			id += ipid_delta;
+		} else
+			update_ipv6_header(segs[i], l3_offset);
+		update_udp_header(segs[i], l4_offset);
+	}
+}
+
+int
+gso_udp_seg_segment(struct rte_mbuf *pkt,
+		uint16_t gso_size,
+		uint8_t ipid_delta,
+		struct rte_mempool *direct_pool,
+		struct rte_mempool *indirect_pool,
+		struct rte_mbuf **pkts_out,
+		uint16_t nb_pkts_out)
+{
+	struct ipv4_hdr *ipv4_hdr;
+	uint16_t pyld_unit_size, hdr_offset;
+	uint16_t frag_off;
+	int ret;
+
+	/* Don't process the fragmented packet */
+	if (pkt->ol_flags & PKT_TX_IPV4) {
+		ipv4_hdr = rte_pktmbuf_mtod_offset(pkt, struct ipv4_hdr *,
+				pkt->l2_len);
+		frag_off = rte_be_to_cpu_16(ipv4_hdr->fragment_offset);
+		if (unlikely(IS_FRAGMENTED(frag_off))) {
+			pkts_out[0] = pkt;
+			return 1;
+		}
+	}
+
+	/* Each output packet is a datagram with a copy of the UDP header */
+	hdr_offset = pkt->l2_len + pkt->l3_len + sizeof(struct udp_hdr);
+
+	/* Don't process the packet without data. */
+	if (unlikely(hdr_offset >= pkt->pkt_len)) {
+		pkts_out[0] = pkt;
+		return 1;
+	}
+
+	/* The IPv6 header may leave no room for payload */
+	if (unlikely(gso_size <= hdr_offset))
+		return -EINVAL;
+
+	/* Keep the datagram size of the application, if it fits */
+	pyld_unit_size = gso_size - hdr_offset;
+	if (pkt->tso_segsz != 0 && pkt->tso_segsz < pyld_unit_size)
+		pyld_unit_size = pkt->tso_segsz;
+
+	/* Segment the payload */
+	ret = gso_do_segment(pkt, hdr_offset, pyld_unit_size, direct_pool,
+			indirect_pool, pkts_out, nb_pkts_out);
+	if (ret > 1)
+		update_ip_udp_headers(pkt, ipid_delta, pkts_out, ret);
+
+	return ret;
+}
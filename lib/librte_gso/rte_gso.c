@@ -10,8 +10,10 @@
 #include "rte_gso.h"
 #include "gso_common.h"
 #include "gso_tcp4.h"
+#include "gso_tcp6.h"
 #include "gso_tunnel_tcp4.h"
 #include "gso_udp4.h"
+#include "gso_udp_seg.h"
 
 #define ILLEGAL_UDP_GSO_CTX(ctx) \
 	((((ctx)->gso_types & DEV_TX_OFFLOAD_UDP_TSO) == 0) || \
@@ -51,7 +53,7 @@ rte_gso_segment(struct rte_mbuf *pkt,
 	direct_pool = gso_ctx->direct_pool;
 	indirect_pool = gso_ctx->indirect_pool;
 	gso_size = gso_ctx->gso_size;
-	ipid_delta = (gso_ctx->flag != RTE_GSO_FLAG_IPID_FIXED);
+	ipid_delta = !(gso_ctx->flag & RTE_GSO_FLAG_IPID_FIXED);
 	ol_flags = pkt->ol_flags;
 
 	if ((IS_IPV4_VXLAN_TCP4(pkt->ol_flags) &&
@@ -71,8 +73,24 @@ rte_gso_segment(struct rte_mbuf *pkt,
 	} else if (IS_IPV4_UDP(pkt->ol_flags) &&
 			(gso_ctx->gso_types & DEV_TX_OFFLOAD_UDP_TSO)) {
 		pkt->ol_flags &= (~PKT_TX_UDP_SEG);
-		ret = gso_udp4_segment(pkt, gso_size, direct_pool,
+		if (gso_ctx->flag & RTE_GSO_FLAG_UDP_SEG)
+			ret = gso_udp_seg_segment(pkt, gso_size, ipid_delta,
+					direct_pool, indirect_pool,
+					pkts_out, nb_pkts_out);
+		else
+			ret = gso_udp4_segment(pkt, gso_size, direct_pool,
+					indirect_pool, pkts_out, nb_pkts_out);
+	} else if (IS_IPV6_TCP(pkt->ol_flags) &&
+			(gso_ctx->gso_types & DEV_TX_OFFLOAD_TCP_TSO)) {
+		pkt->ol_flags &= (~PKT_TX_TCP_SEG);
+		ret = gso_tcp6_segment(pkt, gso_size, direct_pool,
 				indirect_pool, pkts_out, nb_pkts_out);
+	} else if (IS_IPV6_UDP(pkt->ol_flags) &&
+			(gso_ctx->gso_types & DEV_TX_OFFLOAD_UDP_TSO)) {
+		pkt->ol_flags &= (~PKT_TX_UDP_SEG);
+		ret = gso_udp_seg_segment(pkt, gso_size, ipid_delta,
+				direct_pool, indirect_pool,
+				pkts_out, nb_pkts_out);
 	} else {
 		/* unsupported packet, skip */
 		pkts_out[0] = pkt;
@@ -30,6 +30,11 @@ extern "C" {
 /**< Use fixed IP ids for output GSO segments. Setting
  * 0 indicates using incremental IP ids.
  */
+#define RTE_GSO_FLAG_UDP_SEG (1ULL << 1)
+/**< Segment UDP/IPv4 packets into UDP datagrams, like the UDP_SEGMENT
+ * socket option of Linux, instead of IP fragments. UDP/IPv6 packets
+ * are always segmented into UDP datagrams.
+ */
 
 /**
  * GSO context structure.
@@ -55,7 +60,7 @@ struct rte_gso_ctx {
 	 * offloading capabilities (i.e. DEV_TX_OFFLOAD_*_TSO) for
 	 * gso_types.
 	 *
-	 * For example, if applications want to segment TCP/IPv4
+	 * For example, if applications want to segment TCP/IPv4 or TCP/IPv6
 	 * packets, set DEV_TX_OFFLOAD_TCP_TSO in gso_types.
 	 */
 	uint16_t gso_size;
@@ -78,8 +83,15 @@ struct rte_gso_ctx {
  * Before calling rte_gso_segment(), applications must set proper ol_flags
  * for the packet. The GSO library uses the same macros as that of TSO.
  * For example, set PKT_TX_TCP_SEG and PKT_TX_IPV4 in ol_flags to segment
- * a TCP/IPv4 packet. If rte_gso_segment() succeeds, the PKT_TX_TCP_SEG
- * flag is removed for all GSO segments and the input packet.
+ * a TCP/IPv4 packet, or PKT_TX_UDP_SEG and PKT_TX_IPV6 to segment a
+ * UDP/IPv6 packet. If rte_gso_segment() succeeds, the PKT_TX_TCP_SEG or
+ * PKT_TX_UDP_SEG flag is removed for all GSO segments and the input packet.
+ *
+ * When UDP packets are segmented into datagrams, the payload of each
+ * datagram is the tso_segsz of the input packet if it is set and the
+ * datagrams fit in gso_size, or the largest payload fitting in gso_size
+ * otherwise. As for the other packet types, packets not longer than
+ * gso_size are not segmented.
  *
  * Each of the newly-created GSO segments is organized as a two-segment
  * MBUF, where the first segment is a standard MBUF, which stores a copy
@@ -5,6 +5,8 @@
 #ifndef _IP_FRAG_COMMON_H_
 #define _IP_FRAG_COMMON_H_
 
+#include <rte_spinlock.h>
+
 #include "rte_ip_frag.h"
 
 /* logging macros. */
@@ -31,6 +33,18 @@
 #define	IP_FRAG_TBL_STAT_UPDATE(s, f, v)	do {} while (0)
 #endif /* IP_FRAG_TBL_STAT */
 
+/* shard of a shared fragmentation table */
+struct ip_frag_shard {
+	rte_spinlock_t lock;           /* protects the table of the shard */
+	struct rte_ip_frag_tbl *tbl;   /* fragmentation table of the shard */
+} __rte_cache_aligned;
+
+/* shared fragmentation table */
+struct rte_ip_frag_shared_tbl {
+	uint32_t nb_shards;            /* number of shards */
+	__extension__ struct ip_frag_shard shard[0]; /* table shards */
+};
+
 /* internal functions declarations */
 struct rte_mbuf * ip_frag_process(struct ip_frag_pkt *fp,
 		struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb,
@@ -48,6 +62,13 @@ struct ip_frag_pkt * ip_frag_lookup(struct rte_ip_frag_tbl *tbl,
 struct rte_mbuf *ipv4_frag_reassemble(struct ip_frag_pkt *fp);
 struct rte_mbuf *ipv6_frag_reassemble(struct ip_frag_pkt *fp);
 
+/* split the payload of a packet into fragments of indirect mbufs */
+int32_t ip_frag_split_payload(struct rte_mbuf *pkt_in, uint16_t in_hdr_len,
+	uint16_t first_hdr_len, uint16_t first_size,
+	uint16_t hdr_len, uint16_t frag_size,
+	struct rte_mbuf **pkts_out, uint16_t nb_pkts_out,
+	struct rte_mempool *pool_direct, struct rte_mempool *pool_indirect);
+
 
 
 /*
@@ -3,6 +3,7 @@
  */
 
 #include <stddef.h>
+#include <errno.h>
 
 #include <rte_jhash.h>
 #include <rte_hash_crc.h>
@@ -367,3 +368,143 @@ ip_frag_lookup(struct rte_ip_frag_tbl *tbl,
 	*stale = old;
 	return NULL;
 }
+
+/* count the indirect buffers, one per fragment and input segment */
+static inline uint32_t
+ip_frag_count_segs(struct rte_mbuf *pkt_in, uint16_t in_hdr_len,
+	uint16_t first_size, uint16_t frag_size)
+{
+	struct rte_mbuf *in_seg;
+	uint32_t nb_segs, in_seg_data_pos, len, frag_bytes_remaining;
+
+	nb_segs = 0;
+	in_seg = pkt_in;
+	in_seg_data_pos = in_hdr_len;
+	frag_bytes_remaining = first_size;
+	while (in_seg != NULL) {
+		len = RTE_MIN(frag_bytes_remaining,
+			in_seg->data_len - in_seg_data_pos);
+		if (len != 0) {
+			nb_segs++;
+			in_seg_data_pos += len;
+			frag_bytes_remaining -= len;
+			if (frag_bytes_remaining == 0)
+				frag_bytes_remaining = frag_size;
+		}
+		if (in_seg_data_pos == in_seg->data_len) {
+			in_seg = in_seg->next;
+			in_seg_data_pos = 0;
+		}
+	}
+
+	return nb_segs;
+}
+
+/* allocate the fragments in bulk and attach them to the payload */
+static int32_t
+ip_frag_attach_payload(struct rte_mbuf *pkt_in, uint16_t in_hdr_len,
+	uint16_t first_hdr_len, uint16_t first_size,
+	uint16_t hdr_len, uint16_t frag_size,
+	struct rte_mbuf **pkts_out, uint32_t nb_frags, uint32_t nb_segs,
+	struct rte_mempool *pool_direct, struct rte_mempool *pool_indirect)
+{
+	struct rte_mbuf *segs[nb_segs];
+	struct rte_mbuf *in_seg, *out_pkt, *out_seg, *out_seg_prev;
+	uint32_t i, k, in_seg_data_pos, len, frag_bytes_remaining;
+
+	if (unlikely(rte_pktmbuf_alloc_bulk(pool_direct, pkts_out,
+			nb_frags) != 0))
+		return -ENOMEM;
+	if (unlikely(rte_pktmbuf_alloc_bulk(pool_indirect, segs,
+			nb_segs) != 0)) {
+		for (i = 0; i != nb_frags; i++)
+			rte_pktmbuf_free(pkts_out[i]);
+		return -ENOMEM;
+	}
+
+	in_seg = pkt_in;
+	in_seg_data_pos = in_hdr_len;
+	k = 0;
+	for (i = 0; i != nb_frags; i++) {
+		out_pkt = pkts_out[i];
+
+		/* Reserve space for the IP header that will be built later */
+		out_pkt->data_len = (i == 0) ? first_hdr_len : hdr_len;
+		out_pkt->pkt_len = out_pkt->data_len;
+		frag_bytes_remaining = (i == 0) ? first_size : frag_size;
+
+		out_seg_prev = out_pkt;
+		while (frag_bytes_remaining != 0 && in_seg != NULL) {
+			len = RTE_MIN(frag_bytes_remaining,
+				in_seg->data_len - in_seg_data_pos);
+			if (len != 0) {
+				/* Prepare indirect buffer */
+				out_seg = segs[k++];
+				rte_pktmbuf_attach(out_seg, in_seg);
+				out_seg->data_off = in_seg->data_off +
+					in_seg_data_pos;
+				out_seg->data_len = (uint16_t)len;
+				out_seg->pkt_len = len;
+				out_seg_prev->next = out_seg;
+				out_seg_prev = out_seg;
+
+				out_pkt->pkt_len += len;
+				out_pkt->nb_segs += 1;
+				in_seg_data_pos += len;
+				frag_bytes_remaining -= len;
+			}
+
+			/* Current input segment done ? */
+			if (in_seg_data_pos == in_seg->data_len) {
+				in_seg = in_seg->next;
+				in_seg_data_pos = 0;
+			}
+		}
+	}
+
+	return nb_frags;
+}
+
+/*
+ * Split the payload of pkt_in, which follows its in_hdr_len bytes IP
+ * header, into fragments. The first fragment carries up to first_size
+ * bytes of payload and the following ones up to frag_size bytes.
+ * Each fragment is made of a direct mbuf, with room reserved for its IP
+ * header (first_hdr_len or hdr_len bytes), followed by indirect mbufs
+ * attached to the segments of pkt_in. All the mbufs of the packet are
+ * allocated in bulk.
+ * Returns the number of fragments stored in pkts_out, or (-1) * errno.
+ */
+int32_t
+ip_frag_split_payload(struct rte_mbuf *pkt_in, uint16_t in_hdr_len,
+	uint16_t first_hdr_len, uint16_t first_size,
+	uint16_t hdr_len, uint16_t frag_size,
+	struct rte_mbuf **pkts_out, uint16_t nb_pkts_out,
+	struct rte_mempool *pool_direct, struct rte_mempool *pool_indirect)
+{
+	uint32_t payload_len, nb_frags, nb_segs;
+
+	if (unlikely(first_size == 0 || frag_size == 0 ||
+			pkt_in->data_len < in_hdr_len))
+		return -EINVAL;
+
+	payload_len = pkt_in->pkt_len - in_hdr_len;
+	nb_frags = 1;
+	if (payload_len > first_size)
+		nb_frags += (payload_len - first_size + frag_size - 1) /
+			frag_size;
+
+	/* Check that pkts_out is big enough to hold all fragments */
+	if (unlikely(nb_frags > nb_pkts_out))
+		return -EINVAL;
+
+	if (pkt_in->nb_segs == 1)
+		nb_segs = nb_frags;
+	else
+		nb_segs = ip_frag_count_segs(pkt_in, in_hdr_len, first_size,
+			frag_size);
+
+	return ip_frag_attach_payload(pkt_in, in_hdr_len, first_hdr_len,
+		first_size, hdr_len, frag_size, pkts_out, nb_frags, nb_segs,
+		pool_direct, pool_indirect);
+}
@@ -196,6 +196,51 @@ rte_ipv6_fragment_packet(struct rte_mbuf *pkt_in,
 		struct rte_mempool *pool_direct,
 		struct rte_mempool *pool_indirect);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * This function implements the fragmentation of a burst of IPv6 packets.
+ *
+ * The packets which fit in the MTU are stored as they are in pkts_out.
+ * The other ones are replaced by their fragments, made of a direct mbuf
+ * holding the IP header followed by indirect mbufs attached to the input
+ * segments.
+ * The IP headers are built from a template prepared once per packet.
+ * The mbufs of each fragmented packet are allocated in bulk. The input
+ * packets are consumed: the fragmented ones are freed, while their data
+ * is kept until the fragments are freed.
+ *
+ * Processing stops at the first packet which cannot be handled (invalid MTU,
+ * not enough room in pkts_out or mbuf allocation failure), which is left
+ * to the caller along with the following ones.
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets.
+ * @param nb_pkts_out
+ *   Size of the pkts_out array.
+ * @param mtu_size
+ *   Size in bytes of the Maximum Transfer Unit (MTU) for the outgoing IPv6
+ *   datagrams. This value includes the size of the IPv6 header.
+ * @param pool_direct
+ *   MBUF pool used for allocating direct buffers for the output fragments.
+ * @param pool_indirect
+ *   MBUF pool used for allocating indirect buffers for the output fragments.
+ * @param nb_pkts_done
+ *   Number of input packets consumed.
+ * @return
+ *   Number of output packets placed in the pkts_out array.
+ */
+uint16_t __rte_experimental
+rte_ipv6_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t nb_pkts_out,
+		uint16_t mtu_size, struct rte_mempool *pool_direct,
+		struct rte_mempool *pool_indirect, uint16_t *nb_pkts_done);
+
 /**
  * This function implements reassembly of fragmented IPv6 packets.
  * Incoming mbuf should have its l2_len/l3_len fields setup correctly.
@@ -272,6 +317,54 @@ int32_t rte_ipv4_fragment_packet(struct rte_mbuf *pkt_in,
 			struct rte_mempool *pool_direct,
 			struct rte_mempool *pool_indirect);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * This function implements the fragmentation of a burst of IPv4 packets.
+ *
+ * The packets which fit in the MTU are stored as they are in pkts_out.
+ * The other ones are replaced by their fragments, made of a direct mbuf
+ * holding the IP header followed by indirect mbufs attached to the input
+ * segments.
+ * The options of the input header are only parsed once per packet, to
+ * build the header of the fragments following the first one, which only
+ * carry the options with the copied flag set.
+ * The mbufs of each fragmented packet are allocated in bulk. The input
+ * packets are consumed: the fragmented ones are freed, while their data
+ * is kept until the fragments are freed.
+ *
+ * Processing stops at the first packet which cannot be handled (Don't Fragment flag
+ * set,
+ * not enough room in pkts_out or mbuf allocation failure), which is left
+ * to the caller along with the following ones.
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets.
+ * @param nb_pkts_out
+ *   Size of the pkts_out array.
+ * @param mtu_size
+ *   Size in bytes of the Maximum Transfer Unit (MTU) for the outgoing IPv4
+ *   datagrams. This value includes the size of the IPv4 header.
+ * @param pool_direct
+ *   MBUF pool used for allocating direct buffers for the output fragments.
+ * @param pool_indirect
+ *   MBUF pool used for allocating indirect buffers for the output fragments.
+ * @param nb_pkts_done
+ *   Number of input packets consumed.
+ * @return
+ *   Number of output packets placed in the pkts_out array.
+ */
+uint16_t __rte_experimental
+rte_ipv4_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t nb_pkts_out,
+		uint16_t mtu_size, struct rte_mempool *pool_direct,
+		struct rte_mempool *pool_indirect, uint16_t *nb_pkts_done);
+
 /**
  * This function implements reassembly of fragmented IPv4 packets.
  * Incoming mbufs should have its l2_len/l3_len fields setup correctly.
@@ -351,6 +444,210 @@ void __rte_experimental
 rte_frag_table_del_expired_entries(struct rte_ip_frag_tbl *tbl,
 	struct rte_ip_frag_death_row *dr, uint64_t tms);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Reassemble a burst of IPv4 packets.
+ * Incoming mbufs should have their l2_len/l3_len fields setup correctly.
+ *
+ * The packets which are not fragmented are kept as they are. The fragments
+ * are processed as with rte_ipv4_frag_reassemble_packet(), and replaced
+ * by the reassembled packet when it is complete. As for the single packet
+ * function, the death row should be freed after each burst of at most
+ * IP_FRAG_DEATH_ROW_LEN packets.
+ *
+ * @param tbl
+ *   Table where to lookup/add the fragmented packets.
+ * @param dr
+ *   Death row to free buffers to
+ * @param pkts
+ *   Array of incoming mbufs with IPv4 packets. On return, it holds the
+ *   packets which are not fragmented and the reassembled packets, in
+ *   the order of the input packets.
+ * @param nb_pkts
+ *   Number of packets in the array.
+ * @param tms
+ *   Packets arrival timestamp.
+ * @return
+ *   Number of packets left in the array.
+ */
+uint16_t __rte_experimental
+rte_ipv4_frag_reassemble_bulk(struct rte_ip_frag_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf **pkts,
+	uint16_t nb_pkts, uint64_t tms);
+
+/**
+ * Shared fragmentation table, which can be used by several lcores at the
+ * same time. It is split in shards, each one being a fragmentation table
+ * with its own lock. The fragments of a packet always go to the same shard,
+ * selected from their addresses and IP id only, so they are reassembled
+ * even if they are received by different lcores.
+ */
+struct rte_ip_frag_shared_tbl;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Create a new shared IP fragmentation table.
+ *
+ * @param nb_shards
+ *   Number of shards of the table, i.e. of independent locks. It should
+ *   be at least a few times the number of lcores using the table.
+ * @param bucket_num
+ *   Number of buckets in the hash table, split among the shards.
+ * @param bucket_entries
+ *   Number of entries per bucket (e.g. hash associativity).
+ *   Should be power of two.
+ * @param max_entries
+ *   Maximum number of entries that could be stored in the table, split
+ *   among the shards.
+ *   The value should be less or equal then bucket_num * bucket_entries.
+ * @param max_cycles
+ *   Maximum TTL in cycles for each fragmented packet.
+ * @param socket_id
+ *   The *socket_id* argument is the socket identifier in the case of
+ *   NUMA. The value can be *SOCKET_ID_ANY* if there is no NUMA constraints.
+ * @return
+ *   The pointer to the new allocated shared fragmentation table, on success.
+ *   NULL on error.
+ */
+struct rte_ip_frag_shared_tbl * __rte_experimental
+rte_ip_frag_shared_table_create(uint32_t nb_shards, uint32_t bucket_num,
+	uint32_t bucket_entries, uint32_t max_entries, uint64_t max_cycles,
+	int socket_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Free allocated shared IP fragmentation table.
+ *
+ * @param tbl
+ *   Shared fragmentation table to free.
+ */
+void __rte_experimental
+rte_ip_frag_shared_table_destroy(struct rte_ip_frag_shared_tbl *tbl);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Thread safe version of rte_ipv4_frag_reassemble_packet(), using a shared
+ * fragmentation table. Each lcore should use its own death row.
+ *
+ * @param tbl
+ *   Shared table where to lookup/add the fragmented packet.
+ * @param dr
+ *   Death row to free buffers to
+ * @param mb
+ *   Incoming mbuf with IPv4 fragment.
+ * @param tms
+ *   Fragment arrival timestamp.
+ * @param ip_hdr
+ *   Pointer to the IPV4 header inside the fragment.
+ * @return
+ *   Pointer to mbuf for reassembled packet, or NULL if:
+ *   - an error occurred.
+ *   - not all fragments of the packet are collected yet.
+ */
+struct rte_mbuf * __rte_experimental
+rte_ipv4_frag_reassemble_packet_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb, uint64_t tms,
+	struct ipv4_hdr *ip_hdr);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Thread safe version of rte_ipv4_frag_reassemble_bulk(), using a shared
+ * fragmentation table. The lock of each shard is taken once for all the
+ * fragments of the burst which belong to it. Each lcore should use its own
+ * death row.
+ *
+ * @param tbl
+ *   Shared table where to lookup/add the fragmented packets.
+ * @param dr
+ *   Death row to free buffers to
+ * @param pkts
+ *   Array of incoming mbufs with IPv4 packets. On return, it holds the
+ *   packets which are not fragmented and the reassembled packets, in
+ *   the order of the input packets.
+ * @param nb_pkts
+ *   Number of packets in the array.
+ * @param tms
+ *   Packets arrival timestamp.
+ * @return
+ *   Number of packets left in the array.
+ */
+uint16_t __rte_experimental
+rte_ipv4_frag_reassemble_bulk_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf **pkts,
+	uint16_t nb_pkts, uint64_t tms);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Thread safe version of rte_ipv6_frag_reassemble_packet(), using a shared
+ * fragmentation table. Each lcore should use its own death row.
+ *
+ * @param tbl
+ *   Shared table where to lookup/add the fragmented packet.
+ * @param dr
+ *   Death row to free buffers to
+ * @param mb
+ *   Incoming mbuf with IPv6 fragment.
+ * @param tms
+ *   Fragment arrival timestamp.
+ * @param ip_hdr
+ *   Pointer to the IPv6 header.
+ * @param frag_hdr
+ *   Pointer to the IPv6 fragment extension header.
+ * @return
+ *   Pointer to mbuf for reassembled packet, or NULL if:
+ *   - an error occurred.
+ *   - not all fragments of the packet are collected yet.
+ */
+struct rte_mbuf * __rte_experimental
+rte_ipv6_frag_reassemble_packet_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb, uint64_t tms,
+	struct ipv6_hdr *ip_hdr, struct ipv6_extension_fragment *frag_hdr);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Delete expired fragments from a shared fragmentation table.
+ *
+ * @param tbl
+ *   Shared table to delete expired fragments from
+ * @param dr
+ *   Death row to free buffers to
+ * @param tms
+ *   Current timestamp
+ */
+void __rte_experimental
+rte_ip_frag_shared_table_del_expired_entries(
+	struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, uint64_t tms);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Dump shared fragmentation table statistics to file, for each shard.
+ *
+ * @param f
+ *   File to dump statistics to
+ * @param tbl
+ *   Shared fragmentation table to dump statistics from
+ */
+void __rte_experimental
+rte_ip_frag_shared_table_statistics_dump(FILE *f,
+	struct rte_ip_frag_shared_tbl *tbl);
+
 #ifdef __cplusplus
 }
 #endif
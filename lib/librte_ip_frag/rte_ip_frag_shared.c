@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <rte_jhash.h>
+#include <rte_log.h>
+
+#include "ip_frag_common.h"
+
+#define	IP_FRAG_SHARD_SEED	0x6d0f27bd
+
+/* shard marks of the packets of a burst */
+#define	IP_FRAG_SHARD_NONE	UINT32_MAX
+#define	IP_FRAG_SHARD_DONE	(UINT32_MAX - 1)
+
+#define	IP_FRAG_PREFETCH_OFFSET	4
+
+/*
+ * The shard only depends on the addresses and the IP id, so that all
+ * the fragments of a packet go to the same shard. The hash is different
+ * from the one used for the buckets, so all the buckets of each shard
+ * are used.
+ */
+static inline uint32_t
+ipv4_frag_shard(const struct rte_ip_frag_shared_tbl *tbl,
+	const struct ipv4_hdr *ip_hdr)
+{
+	uint32_t v;
+
+	v = rte_jhash_3words(ip_hdr->src_addr, ip_hdr->dst_addr,
+		ip_hdr->packet_id, IP_FRAG_SHARD_SEED);
+	return ((uint64_t)v * tbl->nb_shards) >> 32;
+}
+
+static inline uint32_t
+ipv6_frag_shard(const struct rte_ip_frag_shared_tbl *tbl,
+	const struct ipv6_hdr *ip_hdr,
+	const struct ipv6_extension_fragment *frag_hdr)
+{
+	uint32_t v;
+
+	/* source and destination addresses are contiguous */
+	v = rte_jhash(ip_hdr->src_addr, 2 * sizeof(ip_hdr->src_addr),
+		frag_hdr->id ^ IP_FRAG_SHARD_SEED);
+	return ((uint64_t)v * tbl->nb_shards) >> 32;
+}
+
+/* create shared fragmentation table */
+struct rte_ip_frag_shared_tbl * __rte_experimental
+rte_ip_frag_shared_table_create(uint32_t nb_shards, uint32_t bucket_num,
+	uint32_t bucket_entries, uint32_t max_entries, uint64_t max_cycles,
+	int socket_id)
+{
+	struct rte_ip_frag_shared_tbl *tbl;
+	uint32_t i, shard_buckets, shard_entries;
+	size_t sz;
+
+	if (nb_shards == 0 || bucket_num < nb_shards) {
+		RTE_LOG(ERR, USER1, "%s: invalid input parameter\n", __func__);
+		return NULL;
+	}
+
+	sz = sizeof(*tbl) + nb_shards * sizeof(tbl->shard[0]);
+	tbl = rte_zmalloc_socket(__func__, sz, RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl == NULL) {
+		RTE_LOG(ERR, USER1,
+			"%s: allocation of %zu bytes at socket %d failed\n",
+			__func__, sz, socket_id);
+		return NULL;
+	}
+	tbl->nb_shards = nb_shards;
+
+	shard_buckets = (bucket_num + nb_shards - 1) / nb_shards;
+	shard_entries = (max_entries + nb_shards - 1) / nb_shards;
+
+	for (i = 0; i != nb_shards; i++) {
+		rte_spinlock_init(&tbl->shard[i].lock);
+		tbl->shard[i].tbl = rte_ip_frag_table_create(shard_buckets,
+			bucket_entries, shard_entries, max_cycles, socket_id);
+		if (tbl->shard[i].tbl == NULL) {
+			rte_ip_frag_shared_table_destroy(tbl);
+			return NULL;
+		}
+	}
+
+	return tbl;
+}
+
+/* delete shared fragmentation table */
+void __rte_experimental
+rte_ip_frag_shared_table_destroy(struct rte_ip_frag_shared_tbl *tbl)
+{
+	uint32_t i;
+
+	if (tbl == NULL)
+		return;
+
+	for (i = 0; i != tbl->nb_shards; i++)
+		if (tbl->shard[i].tbl != NULL)
+			rte_ip_frag_table_destroy(tbl->shard[i].tbl);
+
+	rte_free(tbl);
+}
+
+struct rte_mbuf * __rte_experimental
+rte_ipv4_frag_reassemble_packet_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb, uint64_t tms,
+	struct ipv4_hdr *ip_hdr)
+{
+	struct ip_frag_shard *shard;
+
+	shard = &tbl->shard[ipv4_frag_shard(tbl, ip_hdr)];
+
+	rte_spinlock_lock(&shard->lock);
+	mb = rte_ipv4_frag_reassemble_packet(shard->tbl, dr, mb, tms, ip_hdr);
+	rte_spinlock_unlock(&shard->lock);
+
+	return mb;
+}
+
+uint16_t __rte_experimental
+rte_ipv4_frag_reassemble_bulk_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf **pkts,
+	uint16_t nb_pkts, uint64_t tms)
+{
+	uint32_t shard_idx[nb_pkts];
+	struct ip_frag_shard *shard;
+	struct ipv4_hdr *ip_hdr;
+	uint32_t s;
+	uint16_t i, j, n;
+
+	/* find the shard of each fragment. */
+	for (i = 0; i != nb_pkts; i++) {
+		if (i + IP_FRAG_PREFETCH_OFFSET < nb_pkts)
+			rte_prefetch0(rte_pktmbuf_mtod(
+				pkts[i + IP_FRAG_PREFETCH_OFFSET], void *));
+
+		ip_hdr = rte_pktmbuf_mtod_offset(pkts[i], struct ipv4_hdr *,
+			pkts[i]->l2_len);
+		if (rte_ipv4_frag_pkt_is_fragmented(ip_hdr))
+			shard_idx[i] = ipv4_frag_shard(tbl, ip_hdr);
+		else
+			shard_idx[i] = IP_FRAG_SHARD_NONE;
+	}
+
+	/* process all the fragments of a shard under a single lock. */
+	for (i = 0; i != nb_pkts; i++) {
+		s = shard_idx[i];
+		if (s == IP_FRAG_SHARD_NONE || s == IP_FRAG_SHARD_DONE)
+			continue;
+
+		shard = &tbl->shard[s];
+		rte_spinlock_lock(&shard->lock);
+		for (j = i; j != nb_pkts; j++) {
+			if (shard_idx[j] != s)
+				continue;
+
+			ip_hdr = rte_pktmbuf_mtod_offset(pkts[j],
+				struct ipv4_hdr *, pkts[j]->l2_len);
+			pkts[j] = rte_ipv4_frag_reassemble_packet(shard->tbl,
+				dr, pkts[j], tms, ip_hdr);
+			shard_idx[j] = IP_FRAG_SHARD_DONE;
+		}
+		rte_spinlock_unlock(&shard->lock);
+	}
+
+	/* keep the other packets and the reassembled ones, in order. */
+	n = 0;
+	for (i = 0; i != nb_pkts; i++)
+		if (pkts[i] != NULL)
+			pkts[n++] = pkts[i];
+
+	return n;
+}
+
+struct rte_mbuf * __rte_experimental
+rte_ipv6_frag_reassemble_packet_shared(struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb, uint64_t tms,
+	struct ipv6_hdr *ip_hdr, struct ipv6_extension_fragment *frag_hdr)
+{
+	struct ip_frag_shard *shard;
+
+	shard = &tbl->shard[ipv6_frag_shard(tbl, ip_hdr, frag_hdr)];
+
+	rte_spinlock_lock(&shard->lock);
+	mb = rte_ipv6_frag_reassemble_packet(shard->tbl, dr, mb, tms, ip_hdr,
+		frag_hdr);
+	rte_spinlock_unlock(&shard->lock);
+
+	return mb;
+}
+
+/* delete expired fragments of all the shards */
+void __rte_experimental
+rte_ip_frag_shared_table_del_expired_entries(
+	struct rte_ip_frag_shared_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, uint64_t tms)
+{
+	struct ip_frag_shard *shard;
+	uint32_t i;
+
+	for (i = 0; i != tbl->nb_shards; i++) {
+		shard = &tbl->shard[i];
+		rte_spinlock_lock(&shard->lock);
+		rte_frag_table_del_expired_entries(shard->tbl, dr, tms);
+		rte_spinlock_unlock(&shard->lock);
+	}
+}
+
+/* dump shared frag table statistics to file */
+void __rte_experimental
+rte_ip_frag_shared_table_statistics_dump(FILE *f,
+	struct rte_ip_frag_shared_tbl *tbl)
+{
+	struct ip_frag_shard *shard;
+	uint32_t i;
+
+	for (i = 0; i != tbl->nb_shards; i++) {
+		shard = &tbl->shard[i];
+		fprintf(f, "shard %u:\n", i);
+		rte_spinlock_lock(&shard->lock);
+		rte_ip_frag_table_statistics_dump(f, shard->tbl);
+		rte_spinlock_unlock(&shard->lock);
+	}
+}
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <errno.h>
+#include <string.h>
 
 #include <rte_memcpy.h>
 #include <rte_mempool.h>
@@ -21,6 +22,12 @@
 
 #define	IPV4_HDR_FO_ALIGN			(1 << IPV4_HDR_FO_SHIFT)
 
+/* IP options */
+#define	IPV4_HDR_MAX_LEN			60
+#define	IPV4_OPT_EOL				0
+#define	IPV4_OPT_NOP				1
+#define	IPV4_OPT_COPIED				0x80
+
 static inline void __fill_ipv4hdr_frag(struct ipv4_hdr *dst,
 		const struct ipv4_hdr *src, uint16_t len, uint16_t fofs,
 		uint16_t dofs, uint32_t mf)
@@ -183,3 +190,189 @@ rte_ipv4_fragment_packet(struct rte_mbuf *pkt_in,
 
 	return out_pkt_pos;
 }
+
+/*
+ * Build the header template of the fragments following the first one,
+ * which only carry the options with the copied flag set (RFC 791).
+ * Returns the length of the template header.
+ */
+static inline uint16_t
+__build_ipv4hdr_template(uint8_t *tmpl, const struct ipv4_hdr *in_hdr,
+	uint16_t in_hdr_len)
+{
+	const uint8_t *opt = (const uint8_t *)in_hdr;
+	uint16_t i, len, olen;
+
+	rte_memcpy(tmpl, in_hdr, sizeof(struct ipv4_hdr));
+	len = sizeof(struct ipv4_hdr);
+
+	i = sizeof(struct ipv4_hdr);
+	while (i < in_hdr_len && opt[i] != IPV4_OPT_EOL) {
+		if (opt[i] == IPV4_OPT_NOP) {
+			i++;
+			continue;
+		}
+		if (i + 1 >= in_hdr_len)
+			break;
+		olen = opt[i + 1];
+		if (olen < 2 || i + olen > in_hdr_len)
+			break;
+		if (opt[i] & IPV4_OPT_COPIED) {
+			memcpy(tmpl + len, opt + i, olen);
+			len += olen;
+		}
+		i += olen;
+	}
+
+	/* pad the options with EOL up to a 4 bytes boundary */
+	while (len % IPV4_IHL_MULTIPLIER != 0)
+		tmpl[len++] = IPV4_OPT_EOL;
+
+	((struct ipv4_hdr *)tmpl)->version_ihl = (uint8_t)
+		((in_hdr->version_ihl & ~IPV4_HDR_IHL_MASK) |
+		(len / IPV4_IHL_MULTIPLIER));
+	return len;
+}
+
+/*
+ * Fragment one IPv4 packet, building the headers from the input header
+ * for the first fragment and from the template for the other ones.
+ */
+static inline int32_t
+__ipv4_fragment_one(struct rte_mbuf *pkt_in, struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out, uint16_t mtu_size,
+	struct rte_mempool *pool_direct, struct rte_mempool *pool_indirect)
+{
+	uint8_t tmpl[IPV4_HDR_MAX_LEN];
+	const struct ipv4_hdr *in_hdr, *hdr;
+	struct ipv4_hdr *out_hdr;
+	struct rte_mbuf *out_pkt;
+	uint16_t in_hdr_len, tmpl_len, len, first_size, frag_size;
+	uint16_t flag_offset, fragment_offset;
+	int32_t i, nb_frags;
+
+	in_hdr = rte_pktmbuf_mtod(pkt_in, const struct ipv4_hdr *);
+	flag_offset = rte_be_to_cpu_16(in_hdr->fragment_offset);
+
+	/* If Don't Fragment flag is set */
+	if (unlikely((flag_offset & IPV4_HDR_DF_MASK) != 0))
+		return -ENOTSUP;
+
+	in_hdr_len = (in_hdr->version_ihl & IPV4_HDR_IHL_MASK) *
+		IPV4_IHL_MULTIPLIER;
+	if (unlikely(in_hdr_len < sizeof(struct ipv4_hdr) ||
+			in_hdr_len > mtu_size))
+		return -EINVAL;
+
+	/* options are only parsed once per packet */
+	if (in_hdr_len == sizeof(struct ipv4_hdr)) {
+		hdr = in_hdr;
+		tmpl_len = in_hdr_len;
+	} else {
+		tmpl_len = __build_ipv4hdr_template(tmpl, in_hdr, in_hdr_len);
+		hdr = (const struct ipv4_hdr *)tmpl;
+	}
+
+	/*
+	 * Ensure the IP payload length of all fragments is aligned to a
+	 * multiple of 8 bytes as per RFC791 section 2.3.
+	 */
+	first_size = RTE_ALIGN_FLOOR(mtu_size - in_hdr_len, IPV4_HDR_FO_ALIGN);
+	frag_size = RTE_ALIGN_FLOOR(mtu_size - tmpl_len, IPV4_HDR_FO_ALIGN);
+
+	nb_frags = ip_frag_split_payload(pkt_in, in_hdr_len, in_hdr_len,
+		first_size, tmpl_len, frag_size, pkts_out, nb_pkts_out,
+		pool_direct, pool_indirect);
+	if (unlikely(nb_frags < 0))
+		return nb_frags;
+
+	/* Build the IP headers */
+	fragment_offset = 0;
+	for (i = 0; i != nb_frags; i++) {
+		out_pkt = pkts_out[i];
+		len = (i == 0) ? in_hdr_len : tmpl_len;
+		out_hdr = rte_pktmbuf_mtod(out_pkt, struct ipv4_hdr *);
+
+		rte_memcpy(out_hdr, (i == 0) ? in_hdr : hdr, len);
+		out_hdr->fragment_offset = rte_cpu_to_be_16((uint16_t)
+			((flag_offset + (fragment_offset >> IPV4_HDR_FO_SHIFT)) |
+			((i != nb_frags - 1) << IPV4_HDR_MF_SHIFT)));
+		out_hdr->total_length = rte_cpu_to_be_16(out_pkt->pkt_len);
+		out_hdr->hdr_checksum = 0;
+
+		fragment_offset = (uint16_t)(fragment_offset +
+			out_pkt->pkt_len - len);
+
+		out_pkt->ol_flags |= PKT_TX_IP_CKSUM;
+		out_pkt->l3_len = len;
+	}
+
+	return nb_frags;
+}
+
+/**
+ * IPv4 burst fragmentation.
+ *
+ * This function implements the fragmentation of a burst of IPv4 packets,
+ * allocating the mbufs of each packet in bulk.
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets.
+ * @param nb_pkts_out
+ *   Size of the pkts_out array.
+ * @param mtu_size
+ *   Size in bytes of the Maximum Transfer Unit (MTU) for the outgoing IPv4
+ *   datagrams. This value includes the size of the IPv4 header.
+ * @param pool_direct
+ *   MBUF pool used for allocating direct buffers for the output fragments.
+ * @param pool_indirect
+ *   MBUF pool used for allocating indirect buffers for the output fragments.
+ * @param nb_pkts_done
+ *   Number of input packets processed.
+ * @return
+ *   Number of output packets placed in the pkts_out array.
+ */
+uint16_t __rte_experimental
+rte_ipv4_fragment_burst(struct rte_mbuf **pkts_in,
+	uint16_t nb_pkts_in,
+	struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out,
+	uint16_t mtu_size,
+	struct rte_mempool *pool_direct,
+	struct rte_mempool *pool_indirect,
+	uint16_t *nb_pkts_done)
+{
+	struct rte_mbuf *pkt_in;
+	uint16_t i, out_pkt_pos;
+	int32_t ret;
+
+	out_pkt_pos = 0;
+	for (i = 0; i != nb_pkts_in; i++) {
+		pkt_in = pkts_in[i];
+
+		/* The packet fits in the MTU, send it as is */
+		if (pkt_in->pkt_len <= mtu_size) {
+			if (unlikely(out_pkt_pos == nb_pkts_out))
+				break;
+			pkts_out[out_pkt_pos++] = pkt_in;
+			continue;
+		}
+
+		ret = __ipv4_fragment_one(pkt_in, pkts_out + out_pkt_pos,
+			nb_pkts_out - out_pkt_pos, mtu_size, pool_direct,
+			pool_indirect);
+		if (unlikely(ret < 0))
+			break;
+		out_pkt_pos += ret;
+
+		/* the fragments keep references to the data */
+		rte_pktmbuf_free(pkt_in);
+	}
+
+	*nb_pkts_done = i;
+	return out_pkt_pos;
+}
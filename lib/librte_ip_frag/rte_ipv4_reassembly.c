@@ -169,3 +169,37 @@ rte_ipv4_frag_reassemble_packet(struct rte_ip_frag_tbl *tbl,
 
 	return mb;
 }
+
+#define	IPV4_FRAG_PREFETCH_OFFSET	4
+
+uint16_t __rte_experimental
+rte_ipv4_frag_reassemble_bulk(struct rte_ip_frag_tbl *tbl,
+	struct rte_ip_frag_death_row *dr, struct rte_mbuf **pkts,
+	uint16_t nb_pkts, uint64_t tms)
+{
+	struct rte_mbuf *mb;
+	struct ipv4_hdr *ip_hdr;
+	uint16_t i, n;
+
+	n = 0;
+	for (i = 0; i != nb_pkts; i++) {
+		if (i + IPV4_FRAG_PREFETCH_OFFSET < nb_pkts)
+			rte_prefetch0(rte_pktmbuf_mtod(
+				pkts[i + IPV4_FRAG_PREFETCH_OFFSET], void *));
+
+		mb = pkts[i];
+		ip_hdr = rte_pktmbuf_mtod_offset(mb, struct ipv4_hdr *,
+			mb->l2_len);
+
+		/* keep the packets which are not fragmented. */
+		if (rte_ipv4_frag_pkt_is_fragmented(ip_hdr)) {
+			mb = rte_ipv4_frag_reassemble_packet(tbl, dr, mb, tms,
+				ip_hdr);
+			if (mb == NULL)
+				continue;
+		}
+		pkts[n++] = mb;
+	}
+
+	return n;
+}
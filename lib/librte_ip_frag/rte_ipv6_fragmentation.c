@@ -180,3 +180,125 @@ rte_ipv6_fragment_packet(struct rte_mbuf *pkt_in,
 
 	return out_pkt_pos;
 }
+
+/*
+ * Fragment one IPv6 packet, building the headers from a template made of
+ * the input header followed by a fragment extension header.
+ */
+static inline int32_t
+__ipv6_fragment_one(struct rte_mbuf *pkt_in, struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out, uint16_t mtu_size,
+	struct rte_mempool *pool_direct, struct rte_mempool *pool_indirect)
+{
+	struct {
+		struct ipv6_hdr ip;
+		struct ipv6_extension_fragment frag;
+	} __attribute__((__packed__)) tmpl;
+	struct ipv6_hdr *out_hdr;
+	struct ipv6_extension_fragment *fh;
+	struct rte_mbuf *out_pkt;
+	uint16_t fragment_offset, frag_size;
+	int32_t i, nb_frags;
+
+	/*
+	 * Ensure the IP payload length of all fragments (except the
+	 * the last fragment) are a multiple of 8 bytes per RFC2460.
+	 */
+	frag_size = RTE_ALIGN_FLOOR(mtu_size - sizeof(tmpl),
+				    RTE_IPV6_EHDR_FO_ALIGN);
+
+	nb_frags = ip_frag_split_payload(pkt_in, sizeof(struct ipv6_hdr),
+		sizeof(tmpl), frag_size, sizeof(tmpl), frag_size,
+		pkts_out, nb_pkts_out, pool_direct, pool_indirect);
+	if (unlikely(nb_frags < 0))
+		return nb_frags;
+
+	__fill_ipv6hdr_frag(&tmpl.ip,
+		rte_pktmbuf_mtod(pkt_in, struct ipv6_hdr *), 0, 0, 0);
+
+	/* Build the IP headers */
+	fragment_offset = 0;
+	for (i = 0; i != nb_frags; i++) {
+		out_pkt = pkts_out[i];
+		out_hdr = rte_pktmbuf_mtod(out_pkt, struct ipv6_hdr *);
+
+		rte_memcpy(out_hdr, &tmpl, sizeof(tmpl));
+		out_hdr->payload_len = rte_cpu_to_be_16(out_pkt->pkt_len -
+			sizeof(struct ipv6_hdr));
+		fh = (struct ipv6_extension_fragment *)(out_hdr + 1);
+		fh->frag_data = rte_cpu_to_be_16(RTE_IPV6_SET_FRAG_DATA(
+			fragment_offset, i != nb_frags - 1));
+
+		fragment_offset = (uint16_t)(fragment_offset +
+			out_pkt->pkt_len - sizeof(tmpl));
+	}
+
+	return nb_frags;
+}
+
+/**
+ * IPv6 burst fragmentation.
+ *
+ * This function implements the fragmentation of a burst of IPv6 packets,
+ * allocating the mbufs of each packet in bulk.
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets.
+ * @param nb_pkts_out
+ *   Size of the pkts_out array.
+ * @param mtu_size
+ *   Size in bytes of the Maximum Transfer Unit (MTU) for the outgoing IPv6
+ *   datagrams. This value includes the size of the IPv6 header.
+ * @param pool_direct
+ *   MBUF pool used for allocating direct buffers for the output fragments.
+ * @param pool_indirect
+ *   MBUF pool used for allocating indirect buffers for the output fragments.
+ * @param nb_pkts_done
+ *   Number of input packets processed.
+ * @return
+ *   Number of output packets placed in the pkts_out array.
+ */
+uint16_t __rte_experimental
+rte_ipv6_fragment_burst(struct rte_mbuf **pkts_in,
+	uint16_t nb_pkts_in,
+	struct rte_mbuf **pkts_out,
+	uint16_t nb_pkts_out,
+	uint16_t mtu_size,
+	struct rte_mempool *pool_direct,
+	struct rte_mempool *pool_indirect,
+	uint16_t *nb_pkts_done)
+{
+	struct rte_mbuf *pkt_in;
+	uint16_t i, out_pkt_pos;
+	int32_t ret;
+
+	out_pkt_pos = 0;
+	for (i = 0; i != nb_pkts_in; i++) {
+		pkt_in = pkts_in[i];
+
+		/* The packet fits in the MTU, send it as is */
+		if (pkt_in->pkt_len <= mtu_size) {
+			if (unlikely(out_pkt_pos == nb_pkts_out))
+				break;
+			pkts_out[out_pkt_pos++] = pkt_in;
+			continue;
+		}
+
+		ret = __ipv6_fragment_one(pkt_in, pkts_out + out_pkt_pos,
+			nb_pkts_out - out_pkt_pos, mtu_size, pool_direct,
+			pool_indirect);
+		if (unlikely(ret < 0))
+			break;
+		out_pkt_pos += ret;
+
+		/* the fragments keep references to the data */
+		rte_pktmbuf_free(pkt_in);
+	}
+
+	*nb_pkts_done = i;
+	return out_pkt_pos;
+}
@@ -10,11 +10,14 @@
  * The Membership Library is an extension and generalization of a traditional
  * filter (for example Bloom Filter and cuckoo filter) structure that has
  * multiple usages in a variety of workloads and applications. The library is
- * used to test if a key belongs to certain sets. Two types of such
- * "set-summary" structures are implemented: hash-table based (HT) and vector
- * bloom filter (vBF). For HT setsummary, two subtypes or modes are available,
- * cache and non-cache modes. The table below summarize some properties of
- * the different implementations.
+ * used to test if a key belongs to certain sets. Three types of such
+ * "set-summary" structures are implemented: hash-table based (HT), vector
+ * bloom filter (vBF) and cuckoo filter (CF). For HT setsummary, two subtypes
+ * or modes are available, cache and non-cache modes. The table below
+ * summarize some properties of the HT and vBF implementations. CF is like
+ * non-cache HT with smaller entries: it stores 8, 12 or 16-bit fingerprints
+ * in buckets of 4 entries, can delete, and a key added several times must
+ * be deleted as many times.
  *
  * @warning
  * @b EXPERIMENTAL: this API may change without prior notice
@@ -105,6 +108,7 @@ struct rte_member_parameters;
 enum rte_member_setsum_type {
 	RTE_MEMBER_TYPE_HT = 0,  /**< Hash table based set summary. */
 	RTE_MEMBER_TYPE_VBF,     /**< Vector of bloom filters. */
+	RTE_MEMBER_TYPE_CF,      /**< Cuckoo filter. */
 	RTE_MEMBER_NUM_TYPE
 };
 
@@ -129,6 +133,10 @@ struct rte_member_setsum {
 	enum rte_member_sig_compare_function sig_cmp_fn;
 	uint8_t cache;			/* If it is cache mode for ht based. */
 
+	/* Cuckoo filter, also using the bucket fields above. */
+	uint8_t fp_bits;		/* Number of bits of a fingerprint. */
+	uint8_t entry_bits;		/* Number of bits of an entry. */
+
 	/* Vector bloom filter. */
 	uint32_t num_set;		/* Number of set (bf) in vbf. */
 	uint32_t bits;			/* Number of bits in each bf. */
@@ -191,6 +199,17 @@ struct rte_member_parameters {
 	 */
 	uint8_t is_cache;
 
+	/**
+	 * fp_bits is only used for cuckoo filter setsummary.
+	 *
+	 * It is the size of the fingerprint stored for each key, which can be
+	 * 8, 12 or 16 bits. The false positive rate of the filter is in the
+	 * order of 8/2^fp_bits. Each entry also stores the set id, using
+	 * log2(num_set) bits, so an entry takes 8, 16 or 32 bits depending
+	 * on fp_bits and num_set.
+	 */
+	uint8_t fp_bits;
+
 	/**
 	 * For HT setsummary, num_keys equals to the number of entries of the
 	 * table. When the number of keys inserted in the HT setsummary
@@ -200,6 +219,10 @@ struct rte_member_parameters {
 	 * likely to become full before the number of inserted keys equal to the
 	 * total number of entries.
 	 *
+	 * For CF, num_keys is also the number of entries of the table. Since
+	 * it is a cuckoo filter with 4 entries per bucket, adding keys fails
+	 * with -ENOSPC at about 95% load.
+	 *
 	 * For vBF, num_keys equal to the expected number of keys that will
 	 * be inserted into the vBF. The implementation assumes the keys are
 	 * evenly distributed to each BF in vBF. This is used to calculate the
@@ -216,7 +239,11 @@ struct rte_member_parameters {
 	uint32_t key_len;
 
 	/**
-	 * num_set is only used for vBF, but not used for HT setsummary.
+	 * num_set is only used for vBF and CF, but not used for HT setsummary.
+	 *
+	 * For CF, num_set is the number of sets, set ids being in range
+	 * [1, num_set]. With num_set equal to 0 or 1, CF is a plain filter
+	 * storing fingerprints only.
 	 *
 	 * num_set is equal to the number of BFs in vBF. For current
 	 * implementation, it only supports 1,2,4,8,16,32 BFs in one vBF set
@@ -418,8 +445,8 @@ rte_member_lookup_multi_bulk(const struct rte_member_setsum *setsum,
  *   supports different set_id ranges. 0 cannot be used as set_id since
  *   RTE_MEMBER_NO_MATCH by default is set as 0.
  *   For HT mode, the set_id has range as [1, 0x7FFF], MSB is reserved.
- *   For vBF mode the set id is limited by the num_set parameter when create
- *   the set-summary.
+ *   For vBF and CF modes the set id is limited by the num_set parameter
+ *   when create the set-summary.
  * @return
  *   HT (cache mode) and vBF should never fail unless the set_id is not in the
  *   valid range. In such case -EINVAL is returned.
@@ -430,6 +457,7 @@ rte_member_lookup_multi_bulk(const struct rte_member_setsum *setsum,
  *   Return 0 for HT (cache mode) if the add does not cause
  *   eviction, return 1 otherwise. Return 0 for non-cache mode if success,
  *   -ENOSPC for full, and 1 if cuckoo eviction happens.
+ *   CF returns the same values as non-cache mode.
  *   Always returns 0 for vBF mode.
  */
 int
@@ -476,6 +504,9 @@ rte_member_reset(const struct rte_member_setsum *setsum);
  *   For HT mode, we need both key and its corresponding set_id to
  *   properly delete the key. Without set_id, we may delete other keys with the
  *   same signature.
+ *   For CF mode, one of the entries added for the key and set_id is
+ *   deleted. Deleting a key which was not added may delete the entry
+ *   of another key with the same fingerprint.
  * @return
  *   If no entry found to delete, an error code of -ENOENT could be returned.
  */
@@ -0,0 +1,508 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <string.h>
+
+#include <rte_errno.h>
+#include <rte_jhash.h>
+#include <rte_malloc.h>
+#include <rte_prefetch.h>
+#include <rte_random.h>
+#include <rte_log.h>
+
+#include "rte_member.h"
+#include "rte_member_cf.h"
+
+/*
+ * The cuckoo filter is an array of buckets of 4 entries. An entry holds
+ * the fingerprint of a key in its fp_bits lower bits and the set id minus
+ * one in the upper bits, an empty entry being 0. Entries are 8, 16 or 32
+ * bits wide, so a bucket is 4, 8 or 16 bytes.
+ *
+ * A bucket is accessed as one or two words of 32 or 64 bits, entry i being
+ * the lane i of the words. This allows to compare the 4 entries of a bucket
+ * with a few word-wide operations (SIMD within a register), whatever the
+ * architecture and the endianness.
+ */
+
+/* Number of entries in each bucket word */
+#define CF_WORD_LANES(w) (64 / (w) < RTE_MEMBER_CF_BUCKET_ENTRIES ? \
+		64 / (w) : RTE_MEMBER_CF_BUCKET_ENTRIES)
+
+static inline void *
+cf_bucket(const struct rte_member_setsum *ss, uint32_t bkt_idx)
+{
+	return (uint8_t *)ss->table + (size_t)bkt_idx * (ss->entry_bits >> 1);
+}
+
+static __rte_always_inline uint64_t
+cf_load_word(const void *bkt, unsigned int i, const unsigned int w)
+{
+	if (w == 8)
+		return *(const uint32_t *)bkt;
+	return ((const uint64_t *)bkt)[i];
+}
+
+static __rte_always_inline void
+cf_store_word(void *bkt, unsigned int i, uint64_t word, const unsigned int w)
+{
+	if (w == 8)
+		*(uint32_t *)bkt = (uint32_t)word;
+	else
+		((uint64_t *)bkt)[i] = word;
+}
+
+/*
+ * Return a bitmask of the entries of a bucket whose bits selected by mask
+ * are equal to val.
+ */
+static __rte_always_inline uint32_t
+cf_bucket_match(const void *bkt, uint32_t val, uint32_t mask,
+		const unsigned int w)
+{
+	/* The least significant bit of each lane */
+	const uint64_t lsb = UINT64_MAX / ((UINT64_C(1) << w) - 1);
+	/* All the bits of each lane but the most significant one */
+	const uint64_t low = lsb * ((UINT64_C(1) << (w - 1)) - 1);
+	const unsigned int lanes = CF_WORD_LANES(w);
+	uint32_t hits = 0;
+	uint64_t x;
+	unsigned int i, j;
+
+	for (i = 0; i < RTE_MEMBER_CF_BUCKET_ENTRIES / lanes; i++) {
+		x = (cf_load_word(bkt, i, w) ^ (lsb * val)) & (lsb * mask);
+		/* Set the most significant bit of the null lanes only */
+		x = ~(((x & low) + low) | x | low);
+		for (j = 0; j < lanes; j++)
+			hits |= ((x >> (j * w + w - 1)) & 1) << (i * lanes + j);
+	}
+	return hits;
+}
+
+static inline uint32_t
+cf_get_entry(const void *bkt, unsigned int idx, unsigned int w)
+{
+	const unsigned int lanes = CF_WORD_LANES(w);
+	const uint64_t lane_mask = (UINT64_C(1) << w) - 1;
+
+	return (cf_load_word(bkt, idx / lanes, w) >>
+			((idx % lanes) * w)) & lane_mask;
+}
+
+static inline void
+cf_set_entry(void *bkt, unsigned int idx, uint32_t entry, unsigned int w)
+{
+	const unsigned int lanes = CF_WORD_LANES(w);
+	const unsigned int shift = (idx % lanes) * w;
+	const uint64_t lane_mask = (UINT64_C(1) << w) - 1;
+	uint64_t word = cf_load_word(bkt, idx / lanes, w);
+
+	word &= ~(lane_mask << shift);
+	word |= (uint64_t)entry << shift;
+	cf_store_word(bkt, idx / lanes, word, w);
+}
+
+static inline uint32_t
+cf_fp_mask(const struct rte_member_setsum *ss)
+{
+	return (1U << ss->fp_bits) - 1;
+}
+
+static inline uint32_t
+cf_entry_mask(const struct rte_member_setsum *ss)
+{
+	return (uint32_t)((UINT64_C(1) << ss->entry_bits) - 1);
+}
+
+static inline member_set_t
+cf_entry_set(const struct rte_member_setsum *ss, uint32_t entry)
+{
+	return (entry >> ss->fp_bits) + 1;
+}
+
+/*
+ * The alternative bucket of an entry only depends on its bucket and its
+ * fingerprint, as in partial-key cuckoo hashing. The fingerprint is hashed
+ * so that small fingerprints can move entries anywhere in a big table.
+ */
+static inline uint32_t
+cf_alt_bucket(const struct rte_member_setsum *ss, uint32_t bkt_idx,
+		uint32_t fp)
+{
+	return (bkt_idx ^ (fp * 0x5bd1e995)) & ss->bucket_mask;
+}
+
+static inline void
+cf_get_index(const struct rte_member_setsum *ss, const void *key,
+		uint32_t *prim_bkt, uint32_t *sec_bkt, uint32_t *fp)
+{
+	/*
+	 * The bucket and the fingerprint are derived from two hashes of the
+	 * key, so that they stay independent even when the number of
+	 * buckets needs most of the bits of a hash value. The CRC hashes of
+	 * a key with two seeds only differ by a constant, so jhash is used
+	 * for the fingerprint.
+	 */
+	uint32_t bkt_hash = MEMBER_HASH_FUNC(key, ss->key_len,
+						ss->prim_hash_seed);
+	uint32_t fp_hash = rte_jhash(key, ss->key_len, ss->sec_hash_seed);
+
+	/* 0 is reserved for empty entries */
+	*fp = fp_hash & cf_fp_mask(ss);
+	*fp += (*fp == 0);
+	*prim_bkt = bkt_hash & ss->bucket_mask;
+	*sec_bkt = cf_alt_bucket(ss, *prim_bkt, *fp);
+}
+
+int
+rte_member_create_cf(struct rte_member_setsum *ss,
+		const struct rte_member_parameters *params)
+{
+	uint32_t num_entries = rte_align32pow2(params->num_keys);
+	uint32_t num_buckets, set_bits = 0, entry_bits;
+
+	/* A single set filter only stores the fingerprints */
+	if (ss->num_set == 0)
+		ss->num_set = 1;
+	if (ss->num_set > 1)
+		set_bits = 32 - __builtin_clz(ss->num_set - 1);
+	entry_bits = params->fp_bits + set_bits;
+	if (entry_bits <= 8)
+		entry_bits = 8;
+	else if (entry_bits <= 16)
+		entry_bits = 16;
+	else if (entry_bits <= 32)
+		entry_bits = 32;
+
+	if (num_entries > RTE_MEMBER_ENTRIES_MAX ||
+			num_entries < 2 * RTE_MEMBER_CF_BUCKET_ENTRIES ||
+			(params->fp_bits != 8 && params->fp_bits != 12 &&
+			 params->fp_bits != 16) ||
+			ss->num_set > UINT16_MAX || entry_bits > 32) {
+		rte_errno = EINVAL;
+		RTE_MEMBER_LOG(ERR,
+			"Membership CF create with invalid parameters\n");
+		return -EINVAL;
+	}
+
+	num_buckets = num_entries / RTE_MEMBER_CF_BUCKET_ENTRIES;
+	ss->table = rte_zmalloc_socket(NULL,
+			(size_t)num_buckets * (entry_bits >> 1),
+			RTE_CACHE_LINE_SIZE, ss->socket_id);
+	if (ss->table == NULL) {
+		RTE_MEMBER_LOG(ERR, "memory allocation failed for CF "
+						"setsummary\n");
+		return -ENOMEM;
+	}
+
+	ss->bucket_cnt = num_buckets;
+	ss->bucket_mask = num_buckets - 1;
+	ss->fp_bits = params->fp_bits;
+	ss->entry_bits = entry_bits;
+
+	RTE_MEMBER_LOG(DEBUG, "Cuckoo filter created, "
+			"the table has %u entries of %u bits, %u buckets\n",
+			num_entries, entry_bits, num_buckets);
+	return 0;
+}
+
+static __rte_always_inline int
+search_bucket_single_cf(const struct rte_member_setsum *ss, uint32_t bkt_idx,
+		uint32_t fp, member_set_t *set_id, const unsigned int w)
+{
+	const void *bkt = cf_bucket(ss, bkt_idx);
+	uint32_t hitmask = cf_bucket_match(bkt, fp, cf_fp_mask(ss), w);
+
+	if (hitmask == 0)
+		return 0;
+	*set_id = cf_entry_set(ss,
+			cf_get_entry(bkt, __builtin_ctz(hitmask), w));
+	return 1;
+}
+
+static __rte_always_inline void
+search_bucket_multi_cf(const struct rte_member_setsum *ss, uint32_t bkt_idx,
+		uint32_t fp, uint32_t *counter, uint32_t match_per_key,
+		member_set_t *set_id, const unsigned int w)
+{
+	const void *bkt = cf_bucket(ss, bkt_idx);
+	uint32_t hitmask = cf_bucket_match(bkt, fp, cf_fp_mask(ss), w);
+
+	while (hitmask && *counter < match_per_key) {
+		set_id[(*counter)++] = cf_entry_set(ss,
+				cf_get_entry(bkt, __builtin_ctz(hitmask), w));
+		hitmask &= hitmask - 1;
+	}
+}
+
+static __rte_always_inline int
+lookup_cf(const struct rte_member_setsum *ss, uint32_t prim_bkt,
+		uint32_t sec_bkt, uint32_t fp, member_set_t *set_id,
+		const unsigned int w)
+{
+	if (search_bucket_single_cf(ss, prim_bkt, fp, set_id, w) ||
+			search_bucket_single_cf(ss, sec_bkt, fp, set_id, w))
+		return 1;
+	*set_id = RTE_MEMBER_NO_MATCH;
+	return 0;
+}
+
+static __rte_always_inline uint32_t
+lookup_multi_cf(const struct rte_member_setsum *ss, uint32_t prim_bkt,
+		uint32_t sec_bkt, uint32_t fp, uint32_t match_per_key,
+		member_set_t *set_id, const unsigned int w)
+{
+	uint32_t num_matches = 0;
+
+	search_bucket_multi_cf(ss, prim_bkt, fp, &num_matches, match_per_key,
+			set_id, w);
+	if (sec_bkt != prim_bkt)
+		search_bucket_multi_cf(ss, sec_bkt, fp, &num_matches,
+				match_per_key, set_id, w);
+	return num_matches;
+}
+
+int
+rte_member_lookup_cf(const struct rte_member_setsum *ss,
+		const void *key, member_set_t *set_id)
+{
+	uint32_t prim_bkt, sec_bkt, fp;
+
+	cf_get_index(ss, key, &prim_bkt, &sec_bkt, &fp);
+
+	switch (ss->entry_bits) {
+	case 8:
+		return lookup_cf(ss, prim_bkt, sec_bkt, fp, set_id, 8);
+	case 16:
+		return lookup_cf(ss, prim_bkt, sec_bkt, fp, set_id, 16);
+	default:
+		return lookup_cf(ss, prim_bkt, sec_bkt, fp, set_id, 32);
+	}
+}
+
+static __rte_always_inline uint32_t
+lookup_bulk_cf(const struct rte_member_setsum *ss, uint32_t num_keys,
+		const uint32_t *prim_bkts, const uint32_t *sec_bkts,
+		const uint32_t *fps, member_set_t *set_ids,
+		const unsigned int w)
+{
+	uint32_t i, num_matches = 0;
+
+	for (i = 0; i < num_keys; i++)
+		num_matches += lookup_cf(ss, prim_bkts[i], sec_bkts[i],
+				fps[i], &set_ids[i], w);
+	return num_matches;
+}
+
+uint32_t
+rte_member_lookup_bulk_cf(const struct rte_member_setsum *ss,
+		const void **keys, uint32_t num_keys, member_set_t *set_ids)
+{
+	uint32_t i;
+	uint32_t fps[RTE_MEMBER_LOOKUP_BULK_MAX];
+	uint32_t prim_bkts[RTE_MEMBER_LOOKUP_BULK_MAX];
+	uint32_t sec_bkts[RTE_MEMBER_LOOKUP_BULK_MAX];
+
+	for (i = 0; i < num_keys; i++) {
+		cf_get_index(ss, keys[i], &prim_bkts[i], &sec_bkts[i],
+				&fps[i]);
+		rte_prefetch0(cf_bucket(ss, prim_bkts[i]));
+		rte_prefetch0(cf_bucket(ss, sec_bkts[i]));
+	}
+
+	switch (ss->entry_bits) {
+	case 8:
+		return lookup_bulk_cf(ss, num_keys, prim_bkts, sec_bkts, fps,
+				set_ids, 8);
+	case 16:
+		return lookup_bulk_cf(ss, num_keys, prim_bkts, sec_bkts, fps,
+				set_ids, 16);
+	default:
+		return lookup_bulk_cf(ss, num_keys, prim_bkts, sec_bkts, fps,
+				set_ids, 32);
+	}
+}
+
+uint32_t
+rte_member_lookup_multi_cf(const struct rte_member_setsum *ss,
+		const void *key, uint32_t match_per_key,
+		member_set_t *set_id)
+{
+	uint32_t prim_bkt, sec_bkt, fp;
+
+	cf_get_index(ss, key, &prim_bkt, &sec_bkt, &fp);
+
+	switch (ss->entry_bits) {
+	case 8:
+		return lookup_multi_cf(ss, prim_bkt, sec_bkt, fp,
+				match_per_key, set_id, 8);
+	case 16:
+		return lookup_multi_cf(ss, prim_bkt, sec_bkt, fp,
+				match_per_key, set_id, 16);
+	default:
+		return lookup_multi_cf(ss, prim_bkt, sec_bkt, fp,
+				match_per_key, set_id, 32);
+	}
+}
+
+static __rte_always_inline uint32_t
+lookup_multi_bulk_cf(const struct rte_member_setsum *ss, uint32_t num_keys,
+		const uint32_t *prim_bkts, const uint32_t *sec_bkts,
+		const uint32_t *fps, uint32_t match_per_key,
+		uint32_t *match_count, member_set_t *set_ids,
+		const unsigned int w)
+{
+	uint32_t i, num_matches = 0;
+
+	for (i = 0; i < num_keys; i++) {
+		match_count[i] = lookup_multi_cf(ss, prim_bkts[i],
+				sec_bkts[i], fps[i], match_per_key,
+				&set_ids[i * match_per_key], w);
+		if (match_count[i] != 0)
+			num_matches++;
+	}
+	return num_matches;
+}
+
+uint32_t
+rte_member_lookup_multi_bulk_cf(const struct rte_member_setsum *ss,
+		const void **keys, uint32_t num_keys, uint32_t match_per_key,
+		uint32_t *match_count,
+		member_set_t *set_ids)
+{
+	uint32_t i;
+	uint32_t fps[RTE_MEMBER_LOOKUP_BULK_MAX];
+	uint32_t prim_bkts[RTE_MEMBER_LOOKUP_BULK_MAX];
+	uint32_t sec_bkts[RTE_MEMBER_LOOKUP_BULK_MAX];
+
+	for (i = 0; i < num_keys; i++) {
+		cf_get_index(ss, keys[i], &prim_bkts[i], &sec_bkts[i],
+				&fps[i]);
+		rte_prefetch0(cf_bucket(ss, prim_bkts[i]));
+		rte_prefetch0(cf_bucket(ss, sec_bkts[i]));
+	}
+
+	switch (ss->entry_bits) {
+	case 8:
+		return lookup_multi_bulk_cf(ss, num_keys, prim_bkts, sec_bkts,
+				fps, match_per_key, match_count, set_ids, 8);
+	case 16:
+		return lookup_multi_bulk_cf(ss, num_keys, prim_bkts, sec_bkts,
+				fps, match_per_key, match_count, set_ids, 16);
+	default:
+		return lookup_multi_bulk_cf(ss, num_keys, prim_bkts, sec_bkts,
+				fps, match_per_key, match_count, set_ids, 32);
+	}
+}
+
+/* Insert an entry into a free slot of a bucket, return 1 on success */
+static inline int
+try_insert_cf(const struct rte_member_setsum *ss, uint32_t bkt_idx,
+		uint32_t entry)
+{
+	void *bkt = cf_bucket(ss, bkt_idx);
+	uint32_t freemask = cf_bucket_match(bkt, 0, cf_entry_mask(ss),
+			ss->entry_bits);
+
+	if (freemask == 0)
+		return 0;
+	cf_set_entry(bkt, __builtin_ctz(freemask), entry, ss->entry_bits);
+	return 1;
+}
+
+int
+rte_member_add_cf(const struct rte_member_setsum *ss,
+		const void *key, member_set_t set_id)
+{
+	struct {
+		uint32_t bkt_idx;
+		uint32_t slot;
+		uint32_t entry;
+	} kicked[RTE_MEMBER_CF_MAX_KICKS];
+	uint32_t prim_bkt, sec_bkt, fp, entry, victim, bkt_idx, slot;
+	unsigned int n;
+
+	if (set_id == RTE_MEMBER_NO_MATCH || set_id > ss->num_set)
+		return -EINVAL;
+
+	cf_get_index(ss, key, &prim_bkt, &sec_bkt, &fp);
+	entry = fp | ((uint32_t)(set_id - 1) << ss->fp_bits);
+
+	/*
+	 * As for non-cache HT mode, an entry is added even if the key is
+	 * already in the filter, so that a key added several times stays in
+	 * the filter until it is deleted as many times.
+	 */
+	if (try_insert_cf(ss, prim_bkt, entry) ||
+			try_insert_cf(ss, sec_bkt, entry))
+		return 0;
+
+	/*
+	 * Both buckets are full: kick random entries to their alternative
+	 * bucket until one of them finds a free slot. Kicked entries are
+	 * recorded to restore the table if the path is too long, so that
+	 * a failed insertion does not lose another key.
+	 */
+	bkt_idx = (rte_rand() & 1) ? prim_bkt : sec_bkt;
+	for (n = 0; n < RTE_MEMBER_CF_MAX_KICKS; n++) {
+		void *bkt = cf_bucket(ss, bkt_idx);
+
+		slot = rte_rand() & (RTE_MEMBER_CF_BUCKET_ENTRIES - 1);
+		victim = cf_get_entry(bkt, slot, ss->entry_bits);
+		cf_set_entry(bkt, slot, entry, ss->entry_bits);
+		kicked[n].bkt_idx = bkt_idx;
+		kicked[n].slot = slot;
+		kicked[n].entry = victim;
+
+		entry = victim;
+		bkt_idx = cf_alt_bucket(ss, bkt_idx, entry & cf_fp_mask(ss));
+		if (try_insert_cf(ss, bkt_idx, entry))
+			return 1;
+	}
+
+	while (n-- > 0)
+		cf_set_entry(cf_bucket(ss, kicked[n].bkt_idx), kicked[n].slot,
+				kicked[n].entry, ss->entry_bits);
+	return -ENOSPC;
+}
+
+void
+rte_member_free_cf(struct rte_member_setsum *ss)
+{
+	rte_free(ss->table);
+}
+
+int
+rte_member_delete_cf(const struct rte_member_setsum *ss, const void *key,
+		member_set_t set_id)
+{
+	uint32_t prim_bkt, sec_bkt, fp, entry, hitmask;
+	void *bkt;
+
+	if (set_id == RTE_MEMBER_NO_MATCH || set_id > ss->num_set)
+		return -EINVAL;
+
+	cf_get_index(ss, key, &prim_bkt, &sec_bkt, &fp);
+	entry = fp | ((uint32_t)(set_id - 1) << ss->fp_bits);
+
+	bkt = cf_bucket(ss, prim_bkt);
+	hitmask = cf_bucket_match(bkt, entry, cf_entry_mask(ss),
+			ss->entry_bits);
+	if (hitmask == 0) {
+		bkt = cf_bucket(ss, sec_bkt);
+		hitmask = cf_bucket_match(bkt, entry, cf_entry_mask(ss),
+				ss->entry_bits);
+	}
+	if (hitmask == 0)
+		return -ENOENT;
+
+	cf_set_entry(bkt, __builtin_ctz(hitmask), 0, ss->entry_bits);
+	return 0;
+}
+
+void
+rte_member_reset_cf(const struct rte_member_setsum *ss)
+{
+	memset(ss->table, 0, (size_t)ss->bucket_cnt * (ss->entry_bits >> 1));
+}
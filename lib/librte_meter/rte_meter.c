@@ -9,6 +9,11 @@
 #include <rte_common.h>
 #include <rte_log.h>
 #include <rte_cycles.h>
+#include <rte_prefetch.h>
+
+#if defined(RTE_ARCH_X86_64) && defined(RTE_MACHINE_CPUFLAG_AVX2)
+#include <x86intrin.h>
+#endif
 
 #include "rte_meter.h"
 
@@ -16,6 +21,10 @@
 #define RTE_METER_TB_PERIOD_MIN      100
 #endif
 
+#ifndef RTE_METER_BULK_PREFETCH
+#define RTE_METER_BULK_PREFETCH      4
+#endif
+
 static void
 rte_meter_get_tb_params(uint64_t hz, uint64_t rate, uint64_t *tb_period, uint64_t *tb_bytes_per_period)
 {
@@ -160,3 +169,432 @@ rte_meter_trtcm_rfc4115_config(
 
 	return 0;
 }
+
+/*
+ * Burst metering
+ *
+ ***/
+
+/* Number of packets at the start of the burst using the same meter and
+ * profile as the first one
+ */
+static inline uint32_t
+rte_meter_run_len(void * const *m, void * const *p, uint32_t n)
+{
+	uint32_t i = 1;
+
+#if defined(RTE_ARCH_X86_64) && defined(RTE_MACHINE_CPUFLAG_AVX2)
+	__m256i m0 = _mm256_set1_epi64x((int64_t)(uintptr_t)m[0]);
+	__m256i p0 = _mm256_set1_epi64x((int64_t)(uintptr_t)p[0]);
+
+	for ( ; i + 4 <= n; i += 4) {
+		__m256i eq = _mm256_and_si256(
+			_mm256_cmpeq_epi64(m0,
+				_mm256_loadu_si256((const __m256i *)&m[i])),
+			_mm256_cmpeq_epi64(p0,
+				_mm256_loadu_si256((const __m256i *)&p[i])));
+		uint32_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+
+		if (mask != 0xF)
+			return i + __builtin_ctz(~mask);
+	}
+#endif
+
+	for ( ; i < n; i++)
+		if ((m[i] != m[0]) || (p[i] != p[0]))
+			break;
+
+	return i;
+}
+
+/* Prefetch the meters of the packets up to a few positions after pos */
+static inline uint32_t
+rte_meter_prefetch(void * const *m, uint32_t pf, uint32_t pos, uint32_t n)
+{
+	uint32_t end = RTE_MIN(n, pos + RTE_METER_BULK_PREFETCH);
+
+	for ( ; pf < end; pf++)
+		rte_prefetch0(m[pf]);
+
+	return pf;
+}
+
+/* Total length of a sequence of packets */
+static inline uint64_t
+rte_meter_len_sum(const uint32_t *pkt_len, uint32_t n)
+{
+	uint64_t sum = 0;
+	uint32_t i = 0;
+
+#if defined(RTE_ARCH_X86_64) && defined(RTE_MACHINE_CPUFLAG_AVX2)
+	if (n >= 8) {
+		__m256i acc = _mm256_setzero_si256();
+		__m128i acc128;
+
+		for ( ; i + 4 <= n; i += 4)
+			acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(
+				_mm_loadu_si128((const __m128i *)&pkt_len[i])));
+
+		acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc),
+			_mm256_extracti128_si256(acc, 1));
+		sum = (uint64_t)_mm_cvtsi128_si64(acc128) +
+			(uint64_t)_mm_extract_epi64(acc128, 1);
+	}
+#endif
+
+	for ( ; i < n; i++)
+		sum += pkt_len[i];
+
+	return sum;
+}
+
+/* Non-zero when all the packets of a sequence are green on input */
+static inline int
+rte_meter_all_green(const enum rte_color *pkt_color, uint32_t n)
+{
+	uint32_t i, c = 0;
+
+	if (pkt_color == NULL)
+		return 1;
+
+	for (i = 0; i < n; i++)
+		c |= pkt_color[i];
+
+	return c == RTE_COLOR_GREEN;
+}
+
+static inline void
+rte_meter_srtcm_update(struct rte_meter_srtcm *m,
+	struct rte_meter_srtcm_profile *p,
+	uint64_t time)
+{
+	uint64_t time_diff, n_periods, tc, te;
+
+	time_diff = time - m->time;
+	n_periods = time_diff / p->cir_period;
+	m->time += n_periods * p->cir_period;
+
+	/* Put the tokens overflowing from tc into te bucket */
+	tc = m->tc + n_periods * p->cir_bytes_per_period;
+	te = m->te;
+	if (tc > p->cbs) {
+		te += (tc - p->cbs);
+		if (te > p->ebs)
+			te = p->ebs;
+		tc = p->cbs;
+	}
+
+	m->tc = tc;
+	m->te = te;
+}
+
+static inline enum rte_color
+rte_meter_srtcm_color(struct rte_meter_srtcm *m,
+	uint32_t pkt_len,
+	enum rte_color pkt_color)
+{
+	if ((pkt_color == RTE_COLOR_GREEN) && (m->tc >= pkt_len)) {
+		m->tc -= pkt_len;
+		return RTE_COLOR_GREEN;
+	}
+
+	if ((pkt_color != RTE_COLOR_RED) && (m->te >= pkt_len)) {
+		m->te -= pkt_len;
+		return RTE_COLOR_YELLOW;
+	}
+
+	return RTE_COLOR_RED;
+}
+
+static inline void
+rte_meter_srtcm_check_bulk(struct rte_meter_srtcm **m,
+	struct rte_meter_srtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	uint32_t i, j, n_run, pf;
+
+	pf = rte_meter_prefetch((void * const *)m, 0, 0, n_pkts);
+
+	for (i = 0; i < n_pkts; i += n_run) {
+		struct rte_meter_srtcm *mi = m[i];
+		uint64_t len;
+
+		n_run = rte_meter_run_len((void * const *)&m[i],
+			(void * const *)&p[i], n_pkts - i);
+		pf = rte_meter_prefetch((void * const *)m, pf, i + n_run, n_pkts);
+
+		rte_meter_srtcm_update(mi, p[i], time);
+
+		/* Whole sequence green */
+		if (n_run > 1) {
+			len = rte_meter_len_sum(&pkt_len[i], n_run);
+			if ((len <= mi->tc) &&
+			    rte_meter_all_green(pkt_color_in ?
+					&pkt_color_in[i] : NULL, n_run)) {
+				mi->tc -= len;
+				for (j = i; j < i + n_run; j++)
+					pkt_color_out[j] = RTE_COLOR_GREEN;
+				continue;
+			}
+		}
+
+		for (j = i; j < i + n_run; j++)
+			pkt_color_out[j] = rte_meter_srtcm_color(mi, pkt_len[j],
+				pkt_color_in ? pkt_color_in[j] : RTE_COLOR_GREEN);
+	}
+}
+
+void __rte_experimental
+rte_meter_srtcm_color_blind_check_bulk(struct rte_meter_srtcm **m,
+	struct rte_meter_srtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_srtcm_check_bulk(m, p, time, pkt_len, NULL, pkt_color_out,
+		n_pkts);
+}
+
+void __rte_experimental
+rte_meter_srtcm_color_aware_check_bulk(struct rte_meter_srtcm **m,
+	struct rte_meter_srtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_srtcm_check_bulk(m, p, time, pkt_len, pkt_color_in,
+		pkt_color_out, n_pkts);
+}
+
+static inline void
+rte_meter_trtcm_update(struct rte_meter_trtcm *m,
+	struct rte_meter_trtcm_profile *p,
+	uint64_t time)
+{
+	uint64_t time_diff_tc, time_diff_tp, n_periods_tc, n_periods_tp, tc, tp;
+
+	time_diff_tc = time - m->time_tc;
+	time_diff_tp = time - m->time_tp;
+	n_periods_tc = time_diff_tc / p->cir_period;
+	n_periods_tp = time_diff_tp / p->pir_period;
+	m->time_tc += n_periods_tc * p->cir_period;
+	m->time_tp += n_periods_tp * p->pir_period;
+
+	tc = m->tc + n_periods_tc * p->cir_bytes_per_period;
+	if (tc > p->cbs)
+		tc = p->cbs;
+
+	tp = m->tp + n_periods_tp * p->pir_bytes_per_period;
+	if (tp > p->pbs)
+		tp = p->pbs;
+
+	m->tc = tc;
+	m->tp = tp;
+}
+
+static inline enum rte_color
+rte_meter_trtcm_color(struct rte_meter_trtcm *m,
+	uint32_t pkt_len,
+	enum rte_color pkt_color)
+{
+	if ((pkt_color == RTE_COLOR_RED) || (m->tp < pkt_len))
+		return RTE_COLOR_RED;
+
+	if ((pkt_color == RTE_COLOR_YELLOW) || (m->tc < pkt_len)) {
+		m->tp -= pkt_len;
+		return RTE_COLOR_YELLOW;
+	}
+
+	m->tc -= pkt_len;
+	m->tp -= pkt_len;
+	return RTE_COLOR_GREEN;
+}
+
+static inline void
+rte_meter_trtcm_check_bulk(struct rte_meter_trtcm **m,
+	struct rte_meter_trtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	uint32_t i, j, n_run, pf;
+
+	pf = rte_meter_prefetch((void * const *)m, 0, 0, n_pkts);
+
+	for (i = 0; i < n_pkts; i += n_run) {
+		struct rte_meter_trtcm *mi = m[i];
+		uint64_t len;
+
+		n_run = rte_meter_run_len((void * const *)&m[i],
+			(void * const *)&p[i], n_pkts - i);
+		pf = rte_meter_prefetch((void * const *)m, pf, i + n_run, n_pkts);
+
+		rte_meter_trtcm_update(mi, p[i], time);
+
+		/* Whole sequence green */
+		if (n_run > 1) {
+			len = rte_meter_len_sum(&pkt_len[i], n_run);
+			if ((len <= mi->tc) && (len <= mi->tp) &&
+			    rte_meter_all_green(pkt_color_in ?
+					&pkt_color_in[i] : NULL, n_run)) {
+				mi->tc -= len;
+				mi->tp -= len;
+				for (j = i; j < i + n_run; j++)
+					pkt_color_out[j] = RTE_COLOR_GREEN;
+				continue;
+			}
+		}
+
+		for (j = i; j < i + n_run; j++)
+			pkt_color_out[j] = rte_meter_trtcm_color(mi, pkt_len[j],
+				pkt_color_in ? pkt_color_in[j] : RTE_COLOR_GREEN);
+	}
+}
+
+void __rte_experimental
+rte_meter_trtcm_color_blind_check_bulk(struct rte_meter_trtcm **m,
+	struct rte_meter_trtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_trtcm_check_bulk(m, p, time, pkt_len, NULL, pkt_color_out,
+		n_pkts);
+}
+
+void __rte_experimental
+rte_meter_trtcm_color_aware_check_bulk(struct rte_meter_trtcm **m,
+	struct rte_meter_trtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_trtcm_check_bulk(m, p, time, pkt_len, pkt_color_in,
+		pkt_color_out, n_pkts);
+}
+
+static inline void
+rte_meter_trtcm_rfc4115_update(struct rte_meter_trtcm_rfc4115 *m,
+	struct rte_meter_trtcm_rfc4115_profile *p,
+	uint64_t time)
+{
+	uint64_t time_diff_tc, time_diff_te, n_periods_tc, n_periods_te, tc, te;
+
+	time_diff_tc = time - m->time_tc;
+	time_diff_te = time - m->time_te;
+	n_periods_tc = time_diff_tc / p->cir_period;
+	n_periods_te = time_diff_te / p->eir_period;
+	m->time_tc += n_periods_tc * p->cir_period;
+	m->time_te += n_periods_te * p->eir_period;
+
+	tc = m->tc + n_periods_tc * p->cir_bytes_per_period;
+	if (tc > p->cbs)
+		tc = p->cbs;
+
+	te = m->te + n_periods_te * p->eir_bytes_per_period;
+	if (te > p->ebs)
+		te = p->ebs;
+
+	m->tc = tc;
+	m->te = te;
+}
+
+static inline enum rte_color
+rte_meter_trtcm_rfc4115_color(struct rte_meter_trtcm_rfc4115 *m,
+	uint32_t pkt_len,
+	enum rte_color pkt_color)
+{
+	if ((pkt_color == RTE_COLOR_GREEN) && (m->tc >= pkt_len)) {
+		m->tc -= pkt_len;
+		return RTE_COLOR_GREEN;
+	}
+
+	if ((pkt_color != RTE_COLOR_RED) && (m->te >= pkt_len)) {
+		m->te -= pkt_len;
+		return RTE_COLOR_YELLOW;
+	}
+
+	return RTE_COLOR_RED;
+}
+
+static inline void
+rte_meter_trtcm_rfc4115_check_bulk(struct rte_meter_trtcm_rfc4115 **m,
+	struct rte_meter_trtcm_rfc4115_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	uint32_t i, j, n_run, pf;
+
+	pf = rte_meter_prefetch((void * const *)m, 0, 0, n_pkts);
+
+	for (i = 0; i < n_pkts; i += n_run) {
+		struct rte_meter_trtcm_rfc4115 *mi = m[i];
+		uint64_t len;
+
+		n_run = rte_meter_run_len((void * const *)&m[i],
+			(void * const *)&p[i], n_pkts - i);
+		pf = rte_meter_prefetch((void * const *)m, pf, i + n_run, n_pkts);
+
+		rte_meter_trtcm_rfc4115_update(mi, p[i], time);
+
+		/* Whole sequence green */
+		if (n_run > 1) {
+			len = rte_meter_len_sum(&pkt_len[i], n_run);
+			if ((len <= mi->tc) &&
+			    rte_meter_all_green(pkt_color_in ?
+					&pkt_color_in[i] : NULL, n_run)) {
+				mi->tc -= len;
+				for (j = i; j < i + n_run; j++)
+					pkt_color_out[j] = RTE_COLOR_GREEN;
+				continue;
+			}
+		}
+
+		for (j = i; j < i + n_run; j++)
+			pkt_color_out[j] = rte_meter_trtcm_rfc4115_color(mi,
+				pkt_len[j], pkt_color_in ?
+					pkt_color_in[j] : RTE_COLOR_GREEN);
+	}
+}
+
+void __rte_experimental
+rte_meter_trtcm_rfc4115_color_blind_check_bulk(
+	struct rte_meter_trtcm_rfc4115 **m,
+	struct rte_meter_trtcm_rfc4115_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_trtcm_rfc4115_check_bulk(m, p, time, pkt_len, NULL,
+		pkt_color_out, n_pkts);
+}
+
+void __rte_experimental
+rte_meter_trtcm_rfc4115_color_aware_check_bulk(
+	struct rte_meter_trtcm_rfc4115 **m,
+	struct rte_meter_trtcm_rfc4115_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts)
+{
+	rte_meter_trtcm_rfc4115_check_bulk(m, p, time, pkt_len, pkt_color_in,
+		pkt_color_out, n_pkts);
+}
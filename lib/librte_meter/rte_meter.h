@@ -327,6 +327,207 @@ rte_meter_trtcm_rfc4115_color_aware_check(
 	uint32_t pkt_len,
 	enum rte_color pkt_color);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * srTCM color blind traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_srtcm_color_blind_check() for each packet
+ * of the burst in turn with the same time stamp. The token buckets of a flow
+ * are only updated once for a sequence of consecutive packets of this flow.
+ *
+ * @param m
+ *    Array of handles to the srTCM instance of each packet
+ * @param p
+ *    Array of srTCM profiles of each packet, as specified at srTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_srtcm_color_blind_check_bulk(struct rte_meter_srtcm **m,
+	struct rte_meter_srtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * srTCM color aware traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_srtcm_color_aware_check() for each packet
+ * of the burst in turn with the same time stamp.
+ *
+ * @param m
+ *    Array of handles to the srTCM instance of each packet
+ * @param p
+ *    Array of srTCM profiles of each packet, as specified at srTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_in
+ *    Array of input colors of the packets
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored, can be the same
+ *    as pkt_color_in
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_srtcm_color_aware_check_bulk(struct rte_meter_srtcm **m,
+	struct rte_meter_srtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * trTCM color blind traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_trtcm_color_blind_check() for each packet
+ * of the burst in turn with the same time stamp.
+ *
+ * @param m
+ *    Array of handles to the trTCM instance of each packet
+ * @param p
+ *    Array of trTCM profiles of each packet, as specified at trTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_trtcm_color_blind_check_bulk(struct rte_meter_trtcm **m,
+	struct rte_meter_trtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * trTCM color aware traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_trtcm_color_aware_check() for each packet
+ * of the burst in turn with the same time stamp.
+ *
+ * @param m
+ *    Array of handles to the trTCM instance of each packet
+ * @param p
+ *    Array of trTCM profiles of each packet, as specified at trTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_in
+ *    Array of input colors of the packets
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored, can be the same
+ *    as pkt_color_in
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_trtcm_color_aware_check_bulk(struct rte_meter_trtcm **m,
+	struct rte_meter_trtcm_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * trTCM RFC4115 color blind traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_trtcm_rfc4115_color_blind_check() for each
+ * packet of the burst in turn with the same time stamp.
+ *
+ * @param m
+ *    Array of handles to the trTCM instance of each packet
+ * @param p
+ *    Array of trTCM profiles of each packet, as specified at trTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_trtcm_rfc4115_color_blind_check_bulk(
+	struct rte_meter_trtcm_rfc4115 **m,
+	struct rte_meter_trtcm_rfc4115_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * trTCM RFC4115 color aware traffic metering for a burst of packets
+ *
+ * Equivalent to calling rte_meter_trtcm_rfc4115_color_aware_check() for each
+ * packet of the burst in turn with the same time stamp.
+ *
+ * @param m
+ *    Array of handles to the trTCM instance of each packet
+ * @param p
+ *    Array of trTCM profiles of each packet, as specified at trTCM object
+ *    creation time
+ * @param time
+ *    Current CPU time stamp (measured in CPU cycles)
+ * @param pkt_len
+ *    Array of IP packet lengths (measured in bytes)
+ * @param pkt_color_in
+ *    Array of input colors of the packets
+ * @param pkt_color_out
+ *    Array where the color assigned to each packet is stored, can be the same
+ *    as pkt_color_in
+ * @param n_pkts
+ *    Number of packets in the burst
+ */
+void __rte_experimental
+rte_meter_trtcm_rfc4115_color_aware_check_bulk(
+	struct rte_meter_trtcm_rfc4115 **m,
+	struct rte_meter_trtcm_rfc4115_profile **p,
+	uint64_t time,
+	const uint32_t *pkt_len,
+	const enum rte_color *pkt_color_in,
+	enum rte_color *pkt_color_out,
+	uint32_t n_pkts);
+
 /*
  * Inline implementation of run-time methods
  *
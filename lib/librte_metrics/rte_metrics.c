@@ -5,16 +5,24 @@
 #include <string.h>
 #include <sys/queue.h>
 
+#include <rte_atomic.h>
+#include <rte_branch_prediction.h>
 #include <rte_common.h>
+#include <rte_cycles.h>
 #include <rte_string_fns.h>
 #include <rte_malloc.h>
 #include <rte_metrics.h>
 #include <rte_lcore.h>
 #include <rte_memzone.h>
+#include <rte_pause.h>
 #include <rte_spinlock.h>
 
 #define RTE_METRICS_MAX_METRICS 256
 #define RTE_METRICS_MEMZONE_NAME "RTE_METRICS"
+#define RTE_METRICS_SHARD_MZ_FMT "RTE_METRICS_LC_%u"
+
+/* Slot used for RTE_METRICS_GLOBAL in per-lcore shards */
+#define RTE_METRICS_GLOBAL_IDX RTE_MAX_ETHPORTS
 
 /**
  * Internal stats metadata and value entry.
@@ -28,6 +36,10 @@ struct rte_metrics_meta_s {
 	uint64_t value[RTE_MAX_ETHPORTS];
 	/** Used for global metrics */
 	uint64_t global_value;
+	/** TSC at which value was last updated through the locked path */
+	uint64_t stamp[RTE_MAX_ETHPORTS];
+	/** TSC at which global_value was last updated */
+	uint64_t global_stamp;
 	/** Index of next root element (zero for none) */
 	uint16_t idx_next_set;
 	/** Index of next metric in set (zero for none) */
@@ -53,8 +65,117 @@ struct rte_metrics_data_s {
 	struct rte_metrics_meta_s metadata[RTE_METRICS_MAX_METRICS];
 	/** Metric data access lock */
 	rte_spinlock_t lock;
+	/** Non-zero for each lcore which has a shard memzone */
+	volatile uint8_t shard_used[RTE_MAX_LCORE];
 };
 
+/**
+ * Value written by an lcore, with the TSC at which it was written.
+ *
+ * @internal
+ */
+struct rte_metrics_value_s {
+	uint64_t value;
+	uint64_t stamp;
+};
+
+/**
+ * Per-lcore shard of metric values.
+ *
+ * @internal
+ * Each EAL thread of the primary process owns one shard, which only it
+ * writes, so updates need neither the lock nor atomic operations. The
+ * sequence count lets readers detect a concurrent update and retry.
+ * Readers merge shards by keeping, for each value, the most recent write.
+ */
+struct rte_metrics_shard_s {
+	/** Odd while an update is in progress */
+	volatile uint32_t seq;
+	/** Values indexed by key, then by port (RTE_METRICS_GLOBAL_IDX last) */
+	struct rte_metrics_value_s
+		value[RTE_METRICS_MAX_METRICS][RTE_MAX_ETHPORTS + 1];
+} __rte_cache_aligned;
+
+/* Process-local cache of the shared memzones, which are never freed */
+static struct rte_metrics_data_s *metrics_data;
+static struct rte_metrics_shard_s *metrics_shards[RTE_MAX_LCORE];
+static uint8_t metrics_shard_failed[RTE_MAX_LCORE];
+
+static struct rte_metrics_data_s *
+metrics_data_get(void)
+{
+	const struct rte_memzone *memzone;
+
+	if (likely(metrics_data != NULL))
+		return metrics_data;
+
+	memzone = rte_memzone_lookup(RTE_METRICS_MEMZONE_NAME);
+	if (memzone == NULL)
+		return NULL;
+	metrics_data = memzone->addr;
+	return metrics_data;
+}
+
+/* Shard of an lcore for reading, or NULL if that lcore never wrote one */
+static struct rte_metrics_shard_s *
+metrics_shard_lookup(struct rte_metrics_data_s *stats, unsigned int lcore_id)
+{
+	const struct rte_memzone *memzone;
+	char name[RTE_MEMZONE_NAMESIZE];
+
+	if (metrics_shards[lcore_id] != NULL)
+		return metrics_shards[lcore_id];
+	if (!stats->shard_used[lcore_id])
+		return NULL;
+
+	snprintf(name, sizeof(name), RTE_METRICS_SHARD_MZ_FMT, lcore_id);
+	memzone = rte_memzone_lookup(name);
+	if (memzone == NULL)
+		return NULL;
+	metrics_shards[lcore_id] = memzone->addr;
+	return metrics_shards[lcore_id];
+}
+
+/*
+ * Shard owned by the calling thread for writing, reserved on first use.
+ * Returns NULL for non-EAL threads and secondary processes, whose lcore
+ * ids are not unique writers, in which case the locked path is used.
+ */
+static struct rte_metrics_shard_s *
+metrics_shard_get(struct rte_metrics_data_s *stats)
+{
+	const struct rte_memzone *memzone;
+	char name[RTE_MEMZONE_NAMESIZE];
+	unsigned int lcore_id;
+
+	lcore_id = rte_lcore_id();
+	if (unlikely(lcore_id >= RTE_MAX_LCORE))
+		return NULL;
+	if (likely(metrics_shards[lcore_id] != NULL))
+		return metrics_shards[lcore_id];
+	if (metrics_shard_failed[lcore_id] ||
+			rte_eal_process_type() != RTE_PROC_PRIMARY)
+		return NULL;
+
+	snprintf(name, sizeof(name), RTE_METRICS_SHARD_MZ_FMT, lcore_id);
+	memzone = rte_memzone_lookup(name);
+	if (memzone == NULL) {
+		memzone = rte_memzone_reserve(name,
+			sizeof(struct rte_metrics_shard_s),
+			rte_lcore_to_socket_id(lcore_id), 0);
+		if (memzone == NULL) {
+			metrics_shard_failed[lcore_id] = 1;
+			return NULL;
+		}
+		memset(memzone->addr, 0, sizeof(struct rte_metrics_shard_s));
+	}
+
+	rte_smp_wmb();
+	stats->shard_used[lcore_id] = 1;
+	metrics_shards[lcore_id] = memzone->addr;
+	return metrics_shards[lcore_id];
+}
+
 void
 rte_metrics_init(int socket_id)
 {
@@ -74,6 +195,7 @@ rte_metrics_init(int socket_id)
 	stats = memzone->addr;
 	memset(stats, 0, sizeof(struct rte_metrics_data_s));
 	rte_spinlock_init(&stats->lock);
+	metrics_data = stats;
 }
 
 int
@@ -89,7 +211,6 @@ rte_metrics_reg_names(const char * const *names, uint16_t cnt_names)
 {
 	struct rte_metrics_meta_s *entry = NULL;
 	struct rte_metrics_data_s *stats;
-	const struct rte_memzone *memzone;
 	uint16_t idx_name;
 	uint16_t idx_base;
 
@@ -100,10 +221,9 @@ rte_metrics_reg_names(const char * const *names, uint16_t cnt_names)
 		if (names[idx_name] == NULL)
 			return -EINVAL;
 
-	memzone = rte_memzone_lookup(RTE_METRICS_MEMZONE_NAME);
-	if (memzone == NULL)
+	stats = metrics_data_get();
+	if (stats == NULL)
 		return -EIO;
-	stats = memzone->addr;
 
 	if (stats->cnt_stats + cnt_names >= RTE_METRICS_MAX_METRICS)
 		return -ENOMEM;
@@ -119,10 +239,13 @@ rte_metrics_reg_names(const char * const *names, uint16_t cnt_names)
 		entry = &stats->metadata[idx_name + stats->cnt_stats];
 		strlcpy(entry->name, names[idx_name], RTE_METRICS_MAX_NAME_LEN);
 		memset(entry->value, 0, sizeof(entry->value));
+		memset(entry->stamp, 0, sizeof(entry->stamp));
 		entry->idx_next_stat = idx_name + stats->cnt_stats + 1;
 	}
 	entry->idx_next_stat = 0;
 	entry->idx_next_set = 0;
+	/* Lock-free updaters must see the new entries before the count */
+	rte_smp_wmb();
 	stats->cnt_stats += cnt_names;
 
 	rte_spinlock_unlock(&stats->lock);
@@ -142,12 +265,16 @@ rte_metrics_update_values(int port_id,
 	const uint64_t *values,
 	uint32_t count)
 {
+	struct rte_metrics_value_s *slot;
 	struct rte_metrics_meta_s *entry;
+	struct rte_metrics_shard_s *shard;
 	struct rte_metrics_data_s *stats;
-	const struct rte_memzone *memzone;
 	uint16_t idx_metric;
 	uint16_t idx_value;
+	uint16_t idx_port;
+	uint16_t cnt_stats;
 	uint16_t cnt_setsize;
+	uint64_t stamp;
 
 	if (port_id != RTE_METRICS_GLOBAL &&
 			(port_id < 0 || port_id >= RTE_MAX_ETHPORTS))
@@ -156,20 +283,26 @@ rte_metrics_update_values(int port_id,
 	if (values == NULL)
 		return -EINVAL;
 
-	memzone = rte_memzone_lookup(RTE_METRICS_MEMZONE_NAME);
-	if (memzone == NULL)
+	stats = metrics_data_get();
+	if (stats == NULL)
 		return -EIO;
-	stats = memzone->addr;
 
-	rte_spinlock_lock(&stats->lock);
+	shard = metrics_shard_get(stats);
+	if (shard == NULL)
+		rte_spinlock_lock(&stats->lock);
+
+	/* Entries below cnt_stats are never modified once published */
+	cnt_stats = stats->cnt_stats;
+	rte_smp_rmb();
 
-	if (key >= stats->cnt_stats) {
-		rte_spinlock_unlock(&stats->lock);
+	if (key >= cnt_stats) {
+		if (shard == NULL)
+			rte_spinlock_unlock(&stats->lock);
 		return -EINVAL;
 	}
 	idx_metric = key;
 	cnt_setsize = 1;
-	while (idx_metric < stats->cnt_stats) {
+	while (idx_metric < cnt_stats) {
 		entry = &stats->metadata[idx_metric];
 		if (entry->idx_next_stat == 0)
 			break;
@@ -178,21 +311,41 @@ rte_metrics_update_values(int port_id,
 	}
 	/* Check update does not cross set border */
 	if (count > cnt_setsize) {
-		rte_spinlock_unlock(&stats->lock);
+		if (shard == NULL)
+			rte_spinlock_unlock(&stats->lock);
 		return -ERANGE;
 	}
 
+	stamp = rte_get_tsc_cycles();
+
+	if (shard != NULL) {
+		idx_port = port_id == RTE_METRICS_GLOBAL ?
+			RTE_METRICS_GLOBAL_IDX : port_id;
+		shard->seq++;
+		rte_smp_wmb();
+		for (idx_value = 0; idx_value < count; idx_value++) {
+			slot = &shard->value[key + idx_value][idx_port];
+			slot->value = values[idx_value];
+			slot->stamp = stamp;
+		}
+		rte_smp_wmb();
+		shard->seq++;
+		return 0;
+	}
+
 	if (port_id == RTE_METRICS_GLOBAL)
 		for (idx_value = 0; idx_value < count; idx_value++) {
 			idx_metric = key + idx_value;
 			stats->metadata[idx_metric].global_value =
 				values[idx_value];
+			stats->metadata[idx_metric].global_stamp = stamp;
 		}
 	else
 		for (idx_value = 0; idx_value < count; idx_value++) {
 			idx_metric = key + idx_value;
 			stats->metadata[idx_metric].value[port_id] =
 				values[idx_value];
+			stats->metadata[idx_metric].stamp[port_id] = stamp;
 		}
 	rte_spinlock_unlock(&stats->lock);
 	return 0;
@@ -203,15 +356,13 @@ rte_metrics_get_names(struct rte_metric_name *names,
 	uint16_t capacity)
 {
 	struct rte_metrics_data_s *stats;
-	const struct rte_memzone *memzone;
 	uint16_t idx_name;
 	int return_value;
 
-	memzone = rte_memzone_lookup(RTE_METRICS_MEMZONE_NAME);
-	if (memzone == NULL)
+	stats = metrics_data_get();
+	if (stats == NULL)
 		return -EIO;
 
-	stats = memzone->addr;
 	rte_spinlock_lock(&stats->lock);
 	if (names != NULL) {
 		if (capacity < stats->cnt_stats) {
@@ -229,14 +380,58 @@ rte_metrics_get_names(struct rte_metric_name *names,
 	return return_value;
 }
 
+/*
+ * Merge the values written by lcores into the shard-less values already
+ * in *values*, keeping the most recent write of each metric.
+ */
+static void
+metrics_merge_shards(struct rte_metrics_data_s *stats, uint16_t idx_port,
+	struct rte_metric_value *values, uint64_t *stamps, uint16_t cnt_stats)
+{
+	const struct rte_metrics_value_s *slot;
+	struct rte_metrics_shard_s *shard;
+	unsigned int lcore_id;
+	uint16_t idx_name;
+	uint64_t value;
+	uint64_t stamp;
+	uint32_t seq;
+
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		shard = metrics_shard_lookup(stats, lcore_id);
+		if (shard == NULL)
+			continue;
+		rte_smp_rmb();
+
+		for (idx_name = 0; idx_name < cnt_stats; idx_name++) {
+			slot = &shard->value[idx_name][idx_port];
+			do {
+				seq = shard->seq;
+				if (unlikely(seq & 1)) {
+					rte_pause();
+					continue;
+				}
+				rte_smp_rmb();
+				value = slot->value;
+				stamp = slot->stamp;
+				rte_smp_rmb();
+			} while (unlikely((seq & 1) || seq != shard->seq));
+
+			if (stamp > stamps[idx_name]) {
+				stamps[idx_name] = stamp;
+				values[idx_name].value = value;
+			}
+		}
+	}
+}
+
 int
 rte_metrics_get_values(int port_id,
 	struct rte_metric_value *values,
 	uint16_t capacity)
 {
+	uint64_t stamps[RTE_METRICS_MAX_METRICS];
 	struct rte_metrics_meta_s *entry;
 	struct rte_metrics_data_s *stats;
-	const struct rte_memzone *memzone;
 	uint16_t idx_name;
 	int return_value;
 
@@ -244,11 +439,10 @@ rte_metrics_get_values(int port_id,
 			(port_id < 0 || port_id >= RTE_MAX_ETHPORTS))
 		return -EINVAL;
 
-	memzone = rte_memzone_lookup(RTE_METRICS_MEMZONE_NAME);
-	if (memzone == NULL)
+	stats = metrics_data_get();
+	if (stats == NULL)
 		return -EIO;
 
-	stats = memzone->addr;
 	rte_spinlock_lock(&stats->lock);
 
 	if (values != NULL) {
@@ -264,6 +458,7 @@ rte_metrics_get_values(int port_id,
 				entry = &stats->metadata[idx_name];
 				values[idx_name].key = idx_name;
 				values[idx_name].value = entry->global_value;
+				stamps[idx_name] = entry->global_stamp;
 			}
 		else
 			for (idx_name = 0;
@@ -272,7 +467,11 @@ rte_metrics_get_values(int port_id,
 				entry = &stats->metadata[idx_name];
 				values[idx_name].key = idx_name;
 				values[idx_name].value = entry->value[port_id];
+				stamps[idx_name] = entry->stamp[port_id];
 			}
+		metrics_merge_shards(stats, port_id == RTE_METRICS_GLOBAL ?
+				RTE_METRICS_GLOBAL_IDX : port_id,
+				values, stamps, stats->cnt_stats);
 	}
 	return_value = stats->cnt_stats;
 	rte_spinlock_unlock(&stats->lock);
@@ -0,0 +1,645 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_ethdev.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_ring.h>
+#include <rte_string_fns.h>
+
+#include "rte_pcapng.h"
+
+int pcapng_logtype;
+
+#define PCAPNG_LOG(level, fmt, args...) \
+	rte_log(RTE_LOG_ ## level, pcapng_logtype, "%s(): " fmt "\n", \
+		__func__, ##args)
+
+/* Block types, see draft-tuexen-opsawg-pcapng */
+#define PCAPNG_SHB_TYPE		0x0A0D0D0A
+#define PCAPNG_IDB_TYPE		0x00000001
+#define PCAPNG_EPB_TYPE		0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+#define PCAPNG_MAJOR_VERSION	1
+#define PCAPNG_MINOR_VERSION	0
+#define PCAPNG_LINKTYPE_ETHERNET 1
+
+/* Option codes */
+#define PCAPNG_OPT_END		0
+#define PCAPNG_OPT_COMMENT	1
+#define PCAPNG_SHB_HARDWARE	2
+#define PCAPNG_SHB_OS		3
+#define PCAPNG_SHB_USERAPPL	4
+#define PCAPNG_IF_NAME		2
+#define PCAPNG_IF_DESCRIPTION	3
+#define PCAPNG_IF_TSRESOL	9
+#define PCAPNG_EPB_FLAGS	2
+
+/* Alignment of the write buffer and of O_DIRECT writes */
+#define PCAPNG_IO_ALIGN		4096
+
+/* Largest packet written, longer packets are truncated */
+#define PCAPNG_MAX_PKTLEN	UINT16_MAX
+
+#define PCAPNG_MAX_BURST	64
+
+#define NSEC_PER_SEC		1000000000ULL
+
+struct pcapng_block_header {
+	uint32_t type;
+	uint32_t length;
+};
+
+struct pcapng_option {
+	uint16_t code;
+	uint16_t length;
+	uint8_t data[];
+};
+
+struct pcapng_section_header {
+	struct pcapng_block_header hdr;
+	uint32_t byte_order_magic;
+	uint16_t major_version;
+	uint16_t minor_version;
+	uint64_t section_length;
+};
+
+struct pcapng_interface_block {
+	struct pcapng_block_header hdr;
+	uint16_t link_type;
+	uint16_t reserved;
+	uint32_t snap_len;
+};
+
+struct pcapng_enhanced_packet_block {
+	struct pcapng_block_header hdr;
+	uint32_t interface_id;
+	uint32_t timestamp_hi;
+	uint32_t timestamp_lo;
+	uint32_t capture_length;
+	uint32_t original_length;
+};
+
+struct pcapng_ring {
+	struct rte_ring *ring;
+	uint32_t ifid;
+	enum rte_pcapng_direction dir;
+};
+
+struct rte_pcapng {
+	int fd;
+	uint32_t flags;
+	uint32_t nb_interfaces;
+	uint32_t nb_rings;
+
+	/* TSC to wall clock conversion */
+	uint64_t tsc_base;
+	uint64_t ns_base;
+	uint64_t tsc_hz;
+	/* last conversion, packets of a burst often share a timestamp */
+	uint64_t last_tsc;
+	uint64_t last_ns;
+
+	struct rte_pcapng_stats stats;
+
+	uint32_t *snaplen;	/* per interface */
+	struct pcapng_ring rings[RTE_PCAPNG_MAX_RINGS];
+
+	uint32_t buf_size;
+	uint32_t buf_len;
+	uint8_t *buf;
+};
+
+/* Length of an option including its header and padding */
+static inline uint32_t
+pcapng_optlen(uint32_t len)
+{
+	return sizeof(struct pcapng_option) + RTE_ALIGN_CEIL(len, 4);
+}
+
+/* Append an option, returns pointer past it */
+static void *
+pcapng_add_option(void *p, uint16_t code, const void *data, uint16_t len)
+{
+	struct pcapng_option *opt = p;
+	uint32_t padded = RTE_ALIGN_CEIL(len, 4);
+
+	opt->code = code;
+	opt->length = len;
+	if (len > 0)
+		memcpy(opt->data, data, len);
+	if (padded > len)
+		memset(opt->data + len, 0, padded - len);
+
+	return opt->data + padded;
+}
+
+static int
+pcapng_write_all(struct rte_pcapng *self, const uint8_t *data, uint32_t len)
+{
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(self->fd, data, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			PCAPNG_LOG(ERR, "write failed: %s", strerror(errno));
+			return -errno;
+		}
+		self->stats.writes++;
+		self->stats.file_bytes += ret;
+		data += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+int __rte_experimental
+rte_pcapng_flush(struct rte_pcapng *self)
+{
+	uint32_t len = self->buf_len;
+	int ret;
+
+	/* O_DIRECT requires whole, aligned blocks */
+	if (self->flags & RTE_PCAPNG_F_DIRECT)
+		len = RTE_ALIGN_FLOOR(len, PCAPNG_IO_ALIGN);
+
+	if (len == 0)
+		return 0;
+
+	ret = pcapng_write_all(self, self->buf, len);
+	if (ret < 0)
+		return ret;
+
+	self->buf_len -= len;
+	if (self->buf_len > 0)
+		memmove(self->buf, self->buf + len, self->buf_len);
+
+	return 0;
+}
+
+/* Return room for a block of len bytes in the write buffer */
+static inline void *
+pcapng_reserve(struct rte_pcapng *self, uint32_t len)
+{
+	void *p;
+
+	if (unlikely(self->buf_len + len > self->buf_size)) {
+		if (rte_pcapng_flush(self) < 0)
+			return NULL;
+	}
+
+	p = self->buf + self->buf_len;
+	self->buf_len += len;
+	return p;
+}
+
+/* Close a block started at hdr whose content ends at end */
+static inline void
+pcapng_end_block(struct rte_pcapng *self, void *hdr, void *end)
+{
+	struct pcapng_block_header *bh = hdr;
+	uint32_t len = (uint8_t *)end - (uint8_t *)hdr + sizeof(uint32_t);
+
+	bh->length = len;
+	*(uint32_t *)end = len;
+	/* give back the space reserved but not used */
+	self->buf_len = (uint8_t *)end + sizeof(uint32_t) - self->buf;
+}
+
+static int
+pcapng_write_section_header(struct rte_pcapng *self,
+		const struct rte_pcapng_params *params)
+{
+	struct pcapng_section_header *shb;
+	struct utsname uts;
+	char os[256];
+	const char *osname = params->os;
+	uint32_t len;
+	void *p;
+
+	if (osname == NULL) {
+		if (uname(&uts) < 0)
+			strlcpy(os, "unknown", sizeof(os));
+		else
+			snprintf(os, sizeof(os), "%s %s",
+				 uts.sysname, uts.release);
+		osname = os;
+	}
+
+	len = sizeof(*shb) + pcapng_optlen(strlen(osname)) +
+		pcapng_optlen(0) + sizeof(uint32_t);
+	if (params->hardware != NULL)
+		len += pcapng_optlen(strlen(params->hardware));
+	if (params->appname != NULL)
+		len += pcapng_optlen(strlen(params->appname));
+
+	shb = pcapng_reserve(self, len);
+	if (shb == NULL)
+		return -EIO;
+
+	shb->hdr.type = PCAPNG_SHB_TYPE;
+	shb->byte_order_magic = PCAPNG_BYTE_ORDER_MAGIC;
+	shb->major_version = PCAPNG_MAJOR_VERSION;
+	shb->minor_version = PCAPNG_MINOR_VERSION;
+	shb->section_length = UINT64_MAX; /* unspecified */
+
+	p = shb + 1;
+	if (params->hardware != NULL)
+		p = pcapng_add_option(p, PCAPNG_SHB_HARDWARE, params->hardware,
+				      strlen(params->hardware));
+	p = pcapng_add_option(p, PCAPNG_SHB_OS, osname, strlen(osname));
+	if (params->appname != NULL)
+		p = pcapng_add_option(p, PCAPNG_SHB_USERAPPL, params->appname,
+				      strlen(params->appname));
+	p = pcapng_add_option(p, PCAPNG_OPT_END, NULL, 0);
+
+	pcapng_end_block(self, shb, p);
+	return 0;
+}
+
+/* Convert a TSC value to nanoseconds since the epoch */
+static inline uint64_t
+pcapng_tsc_to_ns(struct rte_pcapng *self, uint64_t tsc)
+{
+	uint64_t delta, ns;
+
+	if (tsc == self->last_tsc)
+		return self->last_ns;
+
+	/* split the conversion to avoid overflowing the product */
+	if (likely(tsc >= self->tsc_base)) {
+		delta = tsc - self->tsc_base;
+		ns = self->ns_base + (delta / self->tsc_hz) * NSEC_PER_SEC +
+			(delta % self->tsc_hz) * NSEC_PER_SEC / self->tsc_hz;
+	} else {
+		delta = self->tsc_base - tsc;
+		ns = self->ns_base - (delta / self->tsc_hz) * NSEC_PER_SEC -
+			(delta % self->tsc_hz) * NSEC_PER_SEC / self->tsc_hz;
+	}
+
+	self->last_tsc = tsc;
+	self->last_ns = ns;
+	return ns;
+}
+
+struct rte_pcapng * __rte_experimental
+rte_pcapng_fdopen(int fd, const struct rte_pcapng_params *params)
+{
+	static const struct rte_pcapng_params defaults = {
+		.socket_id = SOCKET_ID_ANY,
+	};
+	struct rte_pcapng *self;
+	struct timespec ts;
+	uint32_t bufsize;
+	int ret, fl;
+
+	if (params == NULL)
+		params = &defaults;
+
+	bufsize = params->bufsize;
+	if (bufsize == 0)
+		bufsize = RTE_PCAPNG_BUFSIZE_DEFAULT;
+	if (bufsize < RTE_PCAPNG_BUFSIZE_MIN) {
+		PCAPNG_LOG(ERR, "buffer size %u is below minimum %u",
+			   bufsize, RTE_PCAPNG_BUFSIZE_MIN);
+		rte_errno = EINVAL;
+		return NULL;
+	}
+	bufsize = RTE_ALIGN_CEIL(bufsize, PCAPNG_IO_ALIGN);
+
+	self = rte_zmalloc_socket("pcapng", sizeof(*self),
+				  RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (self == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	self->buf = rte_malloc_socket("pcapng_buf", bufsize,
+				      PCAPNG_IO_ALIGN, params->socket_id);
+	if (self->buf == NULL) {
+		PCAPNG_LOG(ERR, "cannot allocate %u byte buffer", bufsize);
+		rte_free(self);
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	self->fd = fd;
+	/* the descriptor flags decide whether writes must be aligned */
+	self->flags = params->flags & ~RTE_PCAPNG_F_DIRECT;
+	fl = fcntl(fd, F_GETFL);
+	if (fl >= 0 && (fl & O_DIRECT))
+		self->flags |= RTE_PCAPNG_F_DIRECT;
+	self->buf_size = bufsize;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	self->tsc_base = rte_get_tsc_cycles();
+	self->tsc_hz = rte_get_tsc_hz();
+	self->ns_base = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+	self->last_tsc = self->tsc_base;
+	self->last_ns = self->ns_base;
+
+	ret = pcapng_write_section_header(self, params);
+	if (ret < 0) {
+		rte_free(self->buf);
+		rte_free(self);
+		rte_errno = -ret;
+		return NULL;
+	}
+
+	return self;
+}
+
+struct rte_pcapng * __rte_experimental
+rte_pcapng_open(const char *path, const struct rte_pcapng_params *params)
+{
+	struct rte_pcapng_params p = {
+		.socket_id = SOCKET_ID_ANY,
+	};
+	struct rte_pcapng *self;
+	int oflags = O_WRONLY | O_CREAT | O_TRUNC;
+	int fd;
+
+	if (params != NULL)
+		p = *params;
+
+	if (p.flags & RTE_PCAPNG_F_DIRECT)
+		oflags |= O_DIRECT;
+
+	fd = open(path, oflags, 0644);
+	if (fd < 0) {
+		PCAPNG_LOG(ERR, "cannot open %s: %s", path, strerror(errno));
+		rte_errno = errno;
+		return NULL;
+	}
+
+	self = rte_pcapng_fdopen(fd, &p);
+	if (self == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	return self;
+}
+
+int __rte_experimental
+rte_pcapng_close(struct rte_pcapng *self)
+{
+	int ret, fl;
+
+	if (self == NULL)
+		return 0;
+
+	ret = rte_pcapng_flush(self);
+
+	/* the unaligned tail cannot go through O_DIRECT */
+	if (ret == 0 && self->buf_len > 0) {
+		fl = fcntl(self->fd, F_GETFL);
+		if (fl >= 0 && (fl & O_DIRECT))
+			fcntl(self->fd, F_SETFL, fl & ~O_DIRECT);
+		self->flags &= ~RTE_PCAPNG_F_DIRECT;
+		ret = rte_pcapng_flush(self);
+	}
+
+	close(self->fd);
+	rte_free(self->snaplen);
+	rte_free(self->buf);
+	rte_free(self);
+
+	return ret;
+}
+
+int __rte_experimental
+rte_pcapng_add_interface(struct rte_pcapng *self, uint16_t port,
+		uint16_t queue, uint32_t snaplen)
+{
+	struct pcapng_interface_block *idb;
+	char dev[RTE_ETH_NAME_MAX_LEN];
+	char name[RTE_ETH_NAME_MAX_LEN + 16];
+	char desc[64];
+	uint8_t tsresol = 9; /* nanoseconds */
+	uint32_t *snaps;
+	uint32_t len;
+	void *p;
+
+	if (self == NULL)
+		return -EINVAL;
+
+	if (snaplen == 0 || snaplen > PCAPNG_MAX_PKTLEN)
+		snaplen = PCAPNG_MAX_PKTLEN;
+
+	if (!rte_eth_dev_is_valid_port(port) ||
+			rte_eth_dev_get_name_by_port(port, dev) < 0)
+		snprintf(dev, sizeof(dev), "port%u", port);
+
+	if (queue == RTE_PCAPNG_ALL_QUEUES) {
+		strlcpy(name, dev, sizeof(name));
+		snprintf(desc, sizeof(desc), "DPDK port %u", port);
+	} else {
+		snprintf(name, sizeof(name), "%s:%u", dev, queue);
+		snprintf(desc, sizeof(desc), "DPDK port %u queue %u",
+			 port, queue);
+	}
+
+	snaps = rte_realloc(self->snaplen,
+			    (self->nb_interfaces + 1) * sizeof(*snaps), 0);
+	if (snaps == NULL)
+		return -ENOMEM;
+	self->snaplen = snaps;
+
+	len = sizeof(*idb) + pcapng_optlen(strlen(name)) +
+		pcapng_optlen(strlen(desc)) + pcapng_optlen(sizeof(tsresol)) +
+		pcapng_optlen(0) + sizeof(uint32_t);
+
+	idb = pcapng_reserve(self, len);
+	if (idb == NULL)
+		return -EIO;
+
+	idb->hdr.type = PCAPNG_IDB_TYPE;
+	idb->link_type = PCAPNG_LINKTYPE_ETHERNET;
+	idb->reserved = 0;
+	idb->snap_len = snaplen;
+
+	p = idb + 1;
+	p = pcapng_add_option(p, PCAPNG_IF_NAME, name, strlen(name));
+	p = pcapng_add_option(p, PCAPNG_IF_DESCRIPTION, desc, strlen(desc));
+	p = pcapng_add_option(p, PCAPNG_IF_TSRESOL, &tsresol, sizeof(tsresol));
+	p = pcapng_add_option(p, PCAPNG_OPT_END, NULL, 0);
+	pcapng_end_block(self, idb, p);
+
+	self->snaplen[self->nb_interfaces] = snaplen;
+	return self->nb_interfaces++;
+}
+
+/* Write one packet as an Enhanced Packet Block */
+static inline int
+pcapng_write_packet(struct rte_pcapng *self, uint32_t ifid,
+		const struct rte_mbuf *m, uint64_t ns, uint32_t epb_flags)
+{
+	struct pcapng_enhanced_packet_block *epb;
+	uint32_t caplen, len, copied, seglen;
+	uint8_t *data;
+	void *p;
+
+	caplen = RTE_MIN(rte_pktmbuf_pkt_len(m), self->snaplen[ifid]);
+
+	len = sizeof(*epb) + RTE_ALIGN_CEIL(caplen, 4) + sizeof(uint32_t);
+	if (epb_flags != 0)
+		len += pcapng_optlen(sizeof(epb_flags)) + pcapng_optlen(0);
+
+	epb = pcapng_reserve(self, len);
+	if (unlikely(epb == NULL))
+		return -EIO;
+
+	epb->hdr.type = PCAPNG_EPB_TYPE;
+	epb->interface_id = ifid;
+	epb->timestamp_hi = ns >> 32;
+	epb->timestamp_lo = (uint32_t)ns;
+	epb->capture_length = caplen;
+	epb->original_length = rte_pktmbuf_pkt_len(m);
+
+	/* gather the segments */
+	data = (uint8_t *)(epb + 1);
+	for (copied = 0; copied < caplen; m = m->next) {
+		seglen = RTE_MIN(rte_pktmbuf_data_len(m), caplen - copied);
+		rte_memcpy(data + copied, rte_pktmbuf_mtod(m, void *), seglen);
+		copied += seglen;
+	}
+	memset(data + caplen, 0, RTE_ALIGN_CEIL(caplen, 4) - caplen);
+
+	p = data + RTE_ALIGN_CEIL(caplen, 4);
+	if (epb_flags != 0) {
+		p = pcapng_add_option(p, PCAPNG_EPB_FLAGS,
+				      &epb_flags, sizeof(epb_flags));
+		p = pcapng_add_option(p, PCAPNG_OPT_END, NULL, 0);
+	}
+	pcapng_end_block(self, epb, p);
+
+	self->stats.pkts++;
+	self->stats.bytes += caplen;
+	if (caplen < epb->original_length)
+		self->stats.truncated++;
+
+	return 0;
+}
+
+uint16_t __rte_experimental
+rte_pcapng_write_packets(struct rte_pcapng *self, uint32_t ifid,
+		struct rte_mbuf *pkts[], uint16_t nb_pkts,
+		enum rte_pcapng_direction dir)
+{
+	uint64_t now = 0;
+	uint64_t tsc, ns;
+	uint16_t i;
+
+	if (unlikely(ifid >= self->nb_interfaces)) {
+		rte_errno = EINVAL;
+		return 0;
+	}
+
+	for (i = 0; i < nb_pkts; i++) {
+		tsc = pkts[i]->timestamp;
+		if (pkts[i]->ol_flags & PKT_RX_TIMESTAMP) {
+			ns = tsc;
+		} else {
+			if (tsc == 0) {
+				if (now == 0)
+					now = rte_get_tsc_cycles();
+				tsc = now;
+			}
+			ns = pcapng_tsc_to_ns(self, tsc);
+		}
+
+		if (i + 1 < nb_pkts)
+			rte_prefetch0(rte_pktmbuf_mtod(pkts[i + 1], void *));
+
+		if (unlikely(pcapng_write_packet(self, ifid, pkts[i],
+				ns, dir) < 0)) {
+			rte_errno = EIO;
+			break;
+		}
+	}
+
+	return i;
+}
+
+int __rte_experimental
+rte_pcapng_add_ring(struct rte_pcapng *self, struct rte_ring *ring,
+		uint32_t ifid, enum rte_pcapng_direction dir)
+{
+	struct pcapng_ring *r;
+
+	if (self == NULL || ring == NULL || ifid >= self->nb_interfaces)
+		return -EINVAL;
+
+	if (self->nb_rings == RTE_PCAPNG_MAX_RINGS)
+		return -ENOSPC;
+
+	r = &self->rings[self->nb_rings++];
+	r->ring = ring;
+	r->ifid = ifid;
+	r->dir = dir;
+
+	return 0;
+}
+
+int __rte_experimental
+rte_pcapng_drain(struct rte_pcapng *self, unsigned int burst)
+{
+	struct rte_mbuf *pkts[PCAPNG_MAX_BURST];
+	struct pcapng_ring *r;
+	unsigned int i, j, n;
+	uint16_t nb;
+	int total = 0;
+
+	if (burst == 0 || burst > PCAPNG_MAX_BURST)
+		burst = PCAPNG_MAX_BURST;
+
+	for (i = 0; i < self->nb_rings; i++) {
+		r = &self->rings[i];
+
+		n = rte_ring_dequeue_burst(r->ring, (void **)pkts, burst, NULL);
+		if (n == 0)
+			continue;
+
+		nb = rte_pcapng_write_packets(self, r->ifid, pkts, n, r->dir);
+		for (j = 0; j < n; j++)
+			rte_pktmbuf_free(pkts[j]);
+		if (nb < n)
+			return -EIO;
+
+		total += nb;
+	}
+
+	return total;
+}
+
+void __rte_experimental
+rte_pcapng_stats_get(const struct rte_pcapng *self,
+		struct rte_pcapng_stats *stats)
+{
+	*stats = self->stats;
+}
+
+RTE_INIT(librte_pcapng_init_log)
+{
+	pcapng_logtype = rte_log_register("lib.pcapng");
+	if (pcapng_logtype >= 0)
+		rte_log_set_level(pcapng_logtype, RTE_LOG_NOTICE);
+}
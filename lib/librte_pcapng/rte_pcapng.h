@@ -0,0 +1,288 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef _RTE_PCAPNG_H_
+#define _RTE_PCAPNG_H_
+
+/**
+ * @file
+ * RTE pcapng
+ *
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Native writer for the pcapng capture file format. Packets are taken from
+ * mbuf bursts, or drained from one or more rings (as filled by librte_pdump),
+ * and written as Enhanced Packet Blocks. Each port/queue pair gets its own
+ * Interface Description Block, so the capture keeps queue identity, and
+ * timestamps are written with nanosecond resolution derived from the TSC.
+ *
+ * Blocks are accumulated in a large write buffer which is flushed with
+ * a single write() call when full, optionally through O_DIRECT.
+ *
+ * A writer handle is not MT-safe: a single lcore is expected to own it.
+ * Producers hand packets over through rings, which keeps the capture path
+ * lock-free.
+ */
+
+#include <stdint.h>
+#include <rte_compat.h>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default size of the write buffer in bytes. */
+#define RTE_PCAPNG_BUFSIZE_DEFAULT (4U << 20)
+
+/** Minimum size of the write buffer in bytes. */
+#define RTE_PCAPNG_BUFSIZE_MIN (256U << 10)
+
+/** Maximum number of rings which can be attached to one writer. */
+#define RTE_PCAPNG_MAX_RINGS 128
+
+/** Open the output file with O_DIRECT, bypassing the page cache. */
+#define RTE_PCAPNG_F_DIRECT 0x1
+
+/** Packet direction, recorded in the epb_flags option of each packet. */
+enum rte_pcapng_direction {
+	RTE_PCAPNG_DIRECTION_UNKNOWN = 0, /**< Direction not recorded */
+	RTE_PCAPNG_DIRECTION_IN = 1,      /**< Received packet */
+	RTE_PCAPNG_DIRECTION_OUT = 2,     /**< Transmitted packet */
+};
+
+/** Parameters used when opening a pcapng file. */
+struct rte_pcapng_params {
+	const char *os;        /**< shb_os option, NULL to use uname(). */
+	const char *hardware;  /**< shb_hardware option, may be NULL. */
+	const char *appname;   /**< shb_userappl option, may be NULL. */
+	uint32_t bufsize;      /**< Write buffer size, 0 for default. */
+	uint32_t flags;        /**< RTE_PCAPNG_F_* flags. */
+	int socket_id;         /**< Socket used to allocate the buffer. */
+};
+
+/** Counters maintained by a pcapng writer. */
+struct rte_pcapng_stats {
+	uint64_t pkts;       /**< Packets written. */
+	uint64_t bytes;      /**< Bytes of packet data written. */
+	uint64_t file_bytes; /**< Bytes written to the file. */
+	uint64_t writes;     /**< Number of write() calls issued. */
+	uint64_t truncated;  /**< Packets truncated to the snap length. */
+};
+
+struct rte_pcapng;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create (or truncate) a pcapng file and write its Section Header Block.
+ *
+ * @param path
+ *   Path of the file to create.
+ * @param params
+ *   Writer parameters, NULL for defaults.
+ * @return
+ *   Writer handle, or NULL on error with rte_errno set.
+ */
+__rte_experimental
+struct rte_pcapng *
+rte_pcapng_open(const char *path, const struct rte_pcapng_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Start a pcapng stream on an already open file descriptor.
+ *
+ * The RTE_PCAPNG_F_DIRECT flag is ignored, the caller controls the
+ * flags of the descriptor: writes are kept aligned only if O_DIRECT is set
+ * on it. The descriptor is closed by rte_pcapng_close().
+ *
+ * @param fd
+ *   File descriptor open for writing.
+ * @param params
+ *   Writer parameters, NULL for defaults.
+ * @return
+ *   Writer handle, or NULL on error with rte_errno set.
+ */
+__rte_experimental
+struct rte_pcapng *
+rte_pcapng_fdopen(int fd, const struct rte_pcapng_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Flush all buffered blocks, close the file and free the writer.
+ *
+ * @param self
+ *   Writer handle.
+ * @return
+ *   0 on success, negative errno if the final write failed.
+ */
+__rte_experimental
+int
+rte_pcapng_close(struct rte_pcapng *self);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Write an Interface Description Block for a port/queue pair.
+ *
+ * @param self
+ *   Writer handle.
+ * @param port
+ *   Ethernet port id, used to name the interface.
+ * @param queue
+ *   Queue id, or RTE_PCAPNG_ALL_QUEUES if the interface covers the port.
+ * @param snaplen
+ *   Maximum number of bytes stored per packet, 0 for no limit.
+ * @return
+ *   Interface id (>= 0) to use when writing packets, or negative errno.
+ */
+__rte_experimental
+int
+rte_pcapng_add_interface(struct rte_pcapng *self, uint16_t port,
+		uint16_t queue, uint32_t snaplen);
+
+/** Queue id used for an interface covering all queues of a port. */
+#define RTE_PCAPNG_ALL_QUEUES UINT16_MAX
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Write a burst of packets as Enhanced Packet Blocks.
+ *
+ * The mbuf timestamp field is interpreted as a TSC value, as set by
+ * rte_pcapng_stamp() or librte_pdump, unless PKT_RX_TIMESTAMP is set:
+ * such a device timestamp is expected in nanoseconds and written as is.
+ * Packets with a zero timestamp are stamped with the TSC value read when
+ * the burst is written.
+ * The mbufs are not freed.
+ *
+ * @param self
+ *   Writer handle.
+ * @param ifid
+ *   Interface id returned by rte_pcapng_add_interface().
+ * @param pkts
+ *   Packets to write.
+ * @param nb_pkts
+ *   Number of packets.
+ * @param dir
+ *   Direction recorded for all packets of the burst.
+ * @return
+ *   Number of packets written, which is less than nb_pkts only on error
+ *   with rte_errno set.
+ */
+__rte_experimental
+uint16_t
+rte_pcapng_write_packets(struct rte_pcapng *self, uint32_t ifid,
+		struct rte_mbuf *pkts[], uint16_t nb_pkts,
+		enum rte_pcapng_direction dir);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Attach a ring to the writer. Packets dequeued from the ring by
+ * rte_pcapng_drain() are written on the given interface and then freed.
+ *
+ * @param self
+ *   Writer handle.
+ * @param ring
+ *   Ring carrying mbufs, typically the one given to rte_pdump_enable().
+ * @param ifid
+ *   Interface id returned by rte_pcapng_add_interface().
+ * @param dir
+ *   Direction recorded for packets taken from this ring.
+ * @return
+ *   0 on success, negative errno on error.
+ */
+__rte_experimental
+int
+rte_pcapng_add_ring(struct rte_pcapng *self, struct rte_ring *ring,
+		uint32_t ifid, enum rte_pcapng_direction dir);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Dequeue one burst from every attached ring and write it.
+ *
+ * @param self
+ *   Writer handle.
+ * @param burst
+ *   Maximum number of packets dequeued per ring, at most 64.
+ * @return
+ *   Number of packets written, or negative errno on write error.
+ */
+__rte_experimental
+int
+rte_pcapng_drain(struct rte_pcapng *self, unsigned int burst);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Write the content of the buffer to the file. With O_DIRECT only whole
+ * blocks are written, the remainder is kept until the next flush or close.
+ *
+ * @param self
+ *   Writer handle.
+ * @return
+ *   0 on success, negative errno on error.
+ */
+__rte_experimental
+int
+rte_pcapng_flush(struct rte_pcapng *self);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Retrieve the writer counters.
+ *
+ * @param self
+ *   Writer handle.
+ * @param stats
+ *   Filled with the current counters.
+ */
+__rte_experimental
+void
+rte_pcapng_stats_get(const struct rte_pcapng *self,
+		struct rte_pcapng_stats *stats);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Record the capture time of a burst in the mbuf timestamp field, using
+ * a single TSC read for the whole burst. Packets already carrying a device
+ * timestamp (PKT_RX_TIMESTAMP) are left unchanged.
+ *
+ * @param pkts
+ *   Packets to stamp.
+ * @param nb_pkts
+ *   Number of packets.
+ */
+static inline void __rte_experimental
+rte_pcapng_stamp(struct rte_mbuf *pkts[], uint16_t nb_pkts)
+{
+	uint64_t tsc = rte_get_tsc_cycles();
+	uint16_t i;
+
+	for (i = 0; i < nb_pkts; i++)
+		if (!(pkts[i]->ol_flags & PKT_RX_TIMESTAMP))
+			pkts[i]->timestamp = tsc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_PCAPNG_H_ */
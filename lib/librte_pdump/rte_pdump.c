@@ -6,6 +6,7 @@
 #include <rte_mbuf.h>
 #include <rte_ethdev.h>
 #include <rte_lcore.h>
+#include <rte_cycles.h>
 #include <rte_log.h>
 #include <rte_errno.h>
 #include <rte_string_fns.h>
@@ -80,6 +81,7 @@ pdump_pktmbuf_copy_data(struct rte_mbuf *seg, const struct rte_mbuf *m)
 	seg->ol_flags = m->ol_flags;
 	seg->packet_type = m->packet_type;
 	seg->vlan_tci_outer = m->vlan_tci_outer;
+	seg->timestamp = m->timestamp;
 	seg->data_len = m->data_len;
 	seg->pkt_len = seg->data_len;
 	rte_memcpy(rte_pktmbuf_mtod(seg, void *),
@@ -143,14 +145,21 @@ pdump_copy(struct rte_mbuf **pkts, uint16_t nb_pkts, void *user_params)
 	struct rte_ring *ring;
 	struct rte_mempool *mp;
 	struct rte_mbuf *p;
+	uint64_t tsc;
 
 	cbs  = user_params;
 	ring = cbs->ring;
 	mp = cbs->mp;
+	/* capture time of the burst, in TSC cycles */
+	tsc = rte_get_tsc_cycles();
 	for (i = 0; i < nb_pkts; i++) {
 		p = pdump_pktmbuf_copy(pkts[i], mp);
-		if (p)
+		if (p) {
+			/* keep the device timestamp if any */
+			if (!(p->ol_flags & PKT_RX_TIMESTAMP))
+				p->timestamp = tsc;
 			dup_bufs[d_pkts++] = p;
+		}
 	}
 
 	ring_enq = rte_ring_enqueue_burst(ring, (void *)dup_bufs, d_pkts, NULL);
@@ -28,6 +28,11 @@ EAL_REGISTER_TAILQ(rte_reorder_tailq)
 /* Macros for printing using RTE_LOG */
 #define RTE_LOGTYPE_REORDER	RTE_LOGTYPE_USER1
 
+/* Memory size of the reorder buffer of a stream */
+#define RTE_REORDER_STREAM_MEMSIZE(size) \
+	RTE_CACHE_LINE_ROUNDUP(sizeof(struct rte_reorder_buffer) + \
+			(2 * (size) * sizeof(struct rte_mbuf *)))
+
 /* A generic circular buffer */
 struct cir_buffer {
 	unsigned int size;   /**< Number of entries that can be stored */
@@ -47,6 +52,16 @@ struct rte_reorder_buffer {
 	int is_initialized;
 } __rte_cache_aligned;
 
+/* The multi-stream reorder buffer data structure */
+struct rte_reorder_ms_buffer {
+	char name[RTE_REORDER_NAMESIZE];
+	unsigned int nb_streams;  /**< number of independent streams */
+	unsigned int stream_memsize; /**< memory size of a stream buffer */
+	unsigned int next_stream; /**< first stream of the next drain */
+	__extension__ uint8_t streams[0] __rte_cache_aligned;
+	/**< reorder buffers of the streams */
+} __rte_cache_aligned;
+
 static void
 rte_reorder_free_mbufs(struct rte_reorder_buffer *b);
 
@@ -366,15 +381,23 @@ unsigned int
 rte_reorder_drain(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
 		unsigned max_mbufs)
 {
-	unsigned int drain_cnt = 0;
+	unsigned int drain_cnt, n;
 
 	struct cir_buffer *order_buf = &b->order_buf,
 			*ready_buf = &b->ready_buf;
 
 	/* Try to fetch requested number of mbufs from ready buffer */
-	while ((drain_cnt < max_mbufs) && (ready_buf->tail != ready_buf->head)) {
-		mbufs[drain_cnt++] = ready_buf->entries[ready_buf->tail];
-		ready_buf->tail = (ready_buf->tail + 1) & ready_buf->mask;
+	drain_cnt = RTE_MIN(max_mbufs,
+			(ready_buf->head - ready_buf->tail) & ready_buf->mask);
+	if (drain_cnt != 0) {
+		/* copy the entries up to the end of the ring, then the rest */
+		n = RTE_MIN(drain_cnt, ready_buf->size - ready_buf->tail);
+		memcpy(mbufs, &ready_buf->entries[ready_buf->tail],
+				n * sizeof(mbufs[0]));
+		memcpy(&mbufs[n], &ready_buf->entries[0],
+				(drain_cnt - n) * sizeof(mbufs[0]));
+		ready_buf->tail = (ready_buf->tail + drain_cnt) &
+				ready_buf->mask;
 	}
 
 	/*
@@ -391,3 +414,133 @@ rte_reorder_drain(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
 
 	return drain_cnt;
 }
+
+static inline struct rte_reorder_buffer *
+rte_reorder_ms_stream(struct rte_reorder_ms_buffer *b, unsigned int stream)
+{
+	return (struct rte_reorder_buffer *)RTE_PTR_ADD(b->streams,
+			(size_t)stream * b->stream_memsize);
+}
+
+struct rte_reorder_ms_buffer * __rte_experimental
+rte_reorder_ms_create(const char *name, unsigned int socket_id,
+		unsigned int nb_streams, unsigned int size)
+{
+	struct rte_reorder_ms_buffer *b;
+	unsigned int i, stream_memsize;
+	size_t bufsize;
+
+	/* Check user arguments. */
+	if (!rte_is_power_of_2(size)) {
+		RTE_LOG(ERR, REORDER, "Invalid reorder buffer size"
+				" - Not a power of 2\n");
+		rte_errno = EINVAL;
+		return NULL;
+	}
+	if (nb_streams == 0) {
+		RTE_LOG(ERR, REORDER, "Invalid number of reorder streams: 0\n");
+		rte_errno = EINVAL;
+		return NULL;
+	}
+	if (name == NULL) {
+		RTE_LOG(ERR, REORDER, "Invalid reorder buffer name ptr:"
+					" NULL\n");
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	stream_memsize = RTE_REORDER_STREAM_MEMSIZE(size);
+	bufsize = sizeof(*b) + (size_t)nb_streams * stream_memsize;
+
+	b = rte_zmalloc_socket("REORDER_MS_BUFFER", bufsize,
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (b == NULL) {
+		RTE_LOG(ERR, REORDER, "Memzone allocation failed\n");
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	strlcpy(b->name, name, sizeof(b->name));
+	b->nb_streams = nb_streams;
+	b->stream_memsize = stream_memsize;
+	for (i = 0; i < nb_streams; i++)
+		rte_reorder_init(rte_reorder_ms_stream(b, i), stream_memsize,
+				name, size);
+
+	return b;
+}
+
+void __rte_experimental
+rte_reorder_ms_free(struct rte_reorder_ms_buffer *b)
+{
+	unsigned int i;
+
+	/* Check user arguments. */
+	if (b == NULL)
+		return;
+
+	for (i = 0; i < b->nb_streams; i++)
+		rte_reorder_free_mbufs(rte_reorder_ms_stream(b, i));
+
+	rte_free(b);
+}
+
+unsigned int __rte_experimental
+rte_reorder_ms_insert_burst(struct rte_reorder_ms_buffer *b,
+		struct rte_mbuf **mbufs, const uint32_t *stream_ids,
+		unsigned int nb_mbufs)
+{
+	unsigned int i;
+
+	if (b == NULL || mbufs == NULL || stream_ids == NULL) {
+		rte_errno = EINVAL;
+		return 0;
+	}
+
+	for (i = 0; i < nb_mbufs; i++) {
+		if (stream_ids[i] >= b->nb_streams) {
+			rte_errno = EINVAL;
+			break;
+		}
+		if (rte_reorder_insert(rte_reorder_ms_stream(b, stream_ids[i]),
+				mbufs[i]) != 0)
+			break;
+	}
+
+	return i;
+}
+
+unsigned int __rte_experimental
+rte_reorder_ms_drain_stream(struct rte_reorder_ms_buffer *b,
+		uint32_t stream_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	if (stream_id >= b->nb_streams)
+		return 0;
+
+	return rte_reorder_drain(rte_reorder_ms_stream(b, stream_id), mbufs,
+			max_mbufs);
+}
+
+unsigned int __rte_experimental
+rte_reorder_ms_drain(struct rte_reorder_ms_buffer *b, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	unsigned int drain_cnt = 0;
+	unsigned int i, stream;
+
+	/*
+	 * Start from the stream following the last one drained, so that
+	 * the streams get a fair share of max_mbufs.
+	 */
+	stream = b->next_stream;
+	for (i = 0; i < b->nb_streams && drain_cnt < max_mbufs; i++) {
+		drain_cnt += rte_reorder_drain(rte_reorder_ms_stream(b, stream),
+				&mbufs[drain_cnt], max_mbufs - drain_cnt);
+		if (++stream == b->nb_streams)
+			stream = 0;
+	}
+	b->next_stream = stream;
+
+	return drain_cnt;
+}
@@ -15,6 +15,7 @@
  *
  */
 
+#include <rte_compat.h>
 #include <rte_mbuf.h>
 
 #ifdef __cplusplus
@@ -146,6 +147,122 @@ unsigned int
 rte_reorder_drain(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
 		unsigned max_mbufs);
 
+struct rte_reorder_ms_buffer;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Create a new multi-stream reorder buffer instance
+ *
+ * A multi-stream reorder buffer holds one reorder buffer per stream (e.g.
+ * per flow), each of them with its own sequence number space. So a late
+ * packet only delays the packets of its own stream.
+ *
+ * @param name
+ *   The name to be given to the reorder buffer instance.
+ * @param socket_id
+ *   The NUMA node on which the memory for the reorder buffer
+ *   instance is to be reserved.
+ * @param nb_streams
+ *   Number of independent streams
+ * @param size
+ *   Max number of elements that can be stored in the reorder buffer
+ *   of each stream
+ * @return
+ *   The initialized reorder buffer instance, or NULL on error
+ *   On error case, rte_errno will be set appropriately:
+ *    - ENOMEM - no appropriate memory area found
+ *    - EINVAL - invalid parameters
+ */
+struct rte_reorder_ms_buffer * __rte_experimental
+rte_reorder_ms_create(const char *name, unsigned int socket_id,
+		unsigned int nb_streams, unsigned int size);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Free multi-stream reorder buffer instance, and the mbufs it holds.
+ *
+ * @param b
+ *   multi-stream reorder buffer instance
+ */
+void __rte_experimental
+rte_reorder_ms_free(struct rte_reorder_ms_buffer *b);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Insert a burst of mbufs in the reorder buffers of their streams
+ *
+ * Each mbuf is inserted as with rte_reorder_insert() in the reorder buffer
+ * of its stream, using its sequence number in this stream. Insertion stops
+ * at the first mbuf which cannot be inserted.
+ *
+ * @param b
+ *   Multi-stream reorder buffer where the mbufs have to be inserted.
+ * @param mbufs
+ *   Array of mbufs that need to be inserted in the reorder buffer.
+ * @param stream_ids
+ *   Array of the stream ids of the mbufs, lower than the number of streams.
+ * @param nb_mbufs
+ *   Number of mbufs in the arrays.
+ * @return
+ *   The number of mbufs inserted. When lower than nb_mbufs, rte_errno is
+ *   set as for rte_reorder_insert() for the first mbuf not inserted, or
+ *   to EINVAL for an invalid stream id.
+ */
+unsigned int __rte_experimental
+rte_reorder_ms_insert_burst(struct rte_reorder_ms_buffer *b,
+		struct rte_mbuf **mbufs, const uint32_t *stream_ids,
+		unsigned int nb_mbufs);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Fetch reordered buffers from all the streams
+ *
+ * The in-order buffers of each stream are returned, starting with the
+ * stream following the last one drained by the previous call.
+ *
+ * @param b
+ *   Multi-stream reorder buffer instance from which packets are to be drained
+ * @param mbufs
+ *   array of mbufs where reordered packets will be inserted from reorder buffer
+ * @param max_mbufs
+ *   the number of elements in the mbufs array.
+ * @return
+ *   number of mbuf pointers written to mbufs. 0 <= N <= max_mbufs.
+ */
+unsigned int __rte_experimental
+rte_reorder_ms_drain(struct rte_reorder_ms_buffer *b, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Fetch reordered buffers of a single stream
+ *
+ * @param b
+ *   Multi-stream reorder buffer instance from which packets are to be drained
+ * @param stream_id
+ *   Stream to drain.
+ * @param mbufs
+ *   array of mbufs where reordered packets will be inserted from reorder buffer
+ * @param max_mbufs
+ *   the number of elements in the mbufs array.
+ * @return
+ *   number of mbuf pointers written to mbufs. 0 <= N <= max_mbufs.
+ */
+unsigned int __rte_experimental
+rte_reorder_ms_drain_stream(struct rte_reorder_ms_buffer *b,
+		uint32_t stream_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+
+#include "rte_codel.h"
+
+int __rte_experimental
+rte_codel_rt_data_init(struct rte_codel *codel)
+{
+	if (codel == NULL)
+		return -1;
+
+	memset(codel, 0, sizeof(*codel));
+	codel->rec_inv_sqrt = UINT32_MAX;
+	return 0;
+}
+
+int __rte_experimental
+rte_codel_config_init(struct rte_codel_config *codel_cfg,
+	uint32_t target,
+	uint32_t interval)
+{
+	uint64_t hz = rte_get_tsc_hz();
+	uint64_t interval_cycles;
+
+	if (codel_cfg == NULL)
+		return -1;
+	if (target == 0 || interval <= target)
+		return -2;
+
+	interval_cycles = hz * interval / 1000000;
+	if (interval_cycles > UINT32_MAX)
+		return -3;
+
+	codel_cfg->target = hz * target / 1000000;
+	codel_cfg->interval = (uint32_t)interval_cycles;
+	return 0;
+}
@@ -0,0 +1,244 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef __RTE_CODEL_H_INCLUDED__
+#define __RTE_CODEL_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * RTE Controlled Delay (CoDel)
+ *
+ * Active queue management based on the time spent by the packets in the
+ * queue (sojourn time), as described in RFC 8289. Packets are dropped at
+ * dequeue when the sojourn time stays above a target delay for at least one
+ * interval, with the drop rate increasing as the square root of the number
+ * of drops until the sojourn time goes below the target again.
+ *
+ * All the times are measured in CPU cycles.
+ *
+ ***/
+
+#include <stdint.h>
+#include <rte_common.h>
+#include <rte_compat.h>
+
+#define RTE_CODEL_TARGET_DEFAULT            5000    /**< Target delay (us) */
+#define RTE_CODEL_INTERVAL_DEFAULT          100000  /**< Interval (us) */
+
+/**
+ * CoDel configuration parameters passed by user
+ */
+struct rte_codel_params {
+	uint32_t target;   /**< Acceptable standing queue delay (microseconds) */
+	uint32_t interval; /**< Sliding window over which the minimum delay is
+			     * tracked, usually the worst case RTT
+			     * (microseconds) */
+};
+
+/**
+ * CoDel configuration parameters
+ */
+struct rte_codel_config {
+	uint64_t target;   /**< Target delay (CPU cycles) */
+	uint32_t interval; /**< Interval (CPU cycles) */
+};
+
+/**
+ * CoDel run-time data
+ */
+struct rte_codel {
+	uint64_t first_above_time; /**< Time when the sojourn time will have
+				     * been above target for one interval,
+				     * 0 when below target */
+	uint64_t drop_next;        /**< Time of the next drop in drop state */
+	uint32_t count;            /**< Packets dropped since entering the
+				     * drop state */
+	uint32_t lastcount;        /**< Value of count when the previous
+				     * drop state was left */
+	uint32_t rec_inv_sqrt;     /**< 1 / sqrt(count) in Q0.32 */
+	uint32_t dropping;         /**< Drop state */
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * @brief Initialises run-time data
+ *
+ * @param codel [in,out] data pointer to CoDel runtime data
+ *
+ * @return Operation status
+ * @retval 0 success
+ * @retval !0 error
+ */
+int __rte_experimental
+rte_codel_rt_data_init(struct rte_codel *codel);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * @brief Configures a single CoDel configuration parameter structure.
+ *
+ * @param codel_cfg [in,out] config pointer to a CoDel configuration
+ *   parameter structure
+ * @param target [in] target delay in microseconds, non-zero
+ * @param interval [in] interval in microseconds, larger than target and
+ *   no more than UINT32_MAX CPU cycles
+ *
+ * @return Operation status
+ * @retval 0 success
+ * @retval !0 error
+ */
+int __rte_experimental
+rte_codel_config_init(struct rte_codel_config *codel_cfg,
+	uint32_t target,
+	uint32_t interval);
+
+/** 1 / sqrt(n) in Q0.32 for the first drop counts */
+static const uint32_t __rte_codel_inv_sqrt[] = {
+	0xffffffff, 0xffffffff, 0xb504f333, 0x93cd3a2c,
+	0x80000000, 0x727c9716, 0x6882f5c0, 0x60c2479a,
+	0x5a827999, 0x55555555, 0x50f44d89, 0x4d2fd8f4,
+	0x49e69d16, 0x47006a80, 0x446b3b95, 0x4219528b,
+	0x40000000, 0x3e16d091, 0x3c56fbbb, 0x3abafd52,
+	0x393e4b8b, 0x37dd20ad, 0x36945278, 0x3561335d,
+	0x34417ae0, 0x33333333, 0x3234aac2, 0x314468b9,
+	0x306123cd, 0x2f89bacc, 0x2ebd2e8d, 0x2dfa9cf2,
+};
+
+/**
+ * @brief Updates 1 / sqrt(count) after count changed, from a table for the
+ * first counts, then with a Newton step from the previous value.
+ *
+ * @param codel [in,out] data pointer to CoDel runtime data
+ */
+static inline void
+__rte_codel_inv_sqrt_update(struct rte_codel *codel)
+{
+	uint32_t invsqrt = codel->rec_inv_sqrt;
+	uint32_t invsqrt2 = ((uint64_t)invsqrt * invsqrt) >> 32;
+	uint64_t val;
+
+	if (codel->count < RTE_DIM(__rte_codel_inv_sqrt)) {
+		codel->rec_inv_sqrt = __rte_codel_inv_sqrt[codel->count];
+		return;
+	}
+
+	val = (3ULL << 32) - ((uint64_t)codel->count * invsqrt2);
+	val >>= 2; /* avoid overflow in the following multiply */
+	val = (val * invsqrt) >> (32 - 2 + 1);
+	codel->rec_inv_sqrt = (uint32_t)val;
+}
+
+/**
+ * @brief Time of the next drop: t + interval / sqrt(count)
+ */
+static inline uint64_t
+__rte_codel_control_law(const struct rte_codel_config *codel_cfg,
+	const struct rte_codel *codel, uint64_t t)
+{
+	return t + (((uint64_t)codel_cfg->interval * codel->rec_inv_sqrt) >> 32);
+}
+
+/**
+ * @brief Decides whether the packet at the head of the queue is dropped
+ *
+ * Called at dequeue for each packet taken from the queue, including the
+ * ones following a dropped packet.
+ *
+ * @param codel_cfg [in] config pointer to a CoDel configuration parameter
+ *   structure
+ * @param codel [in,out] data pointer to CoDel runtime data
+ * @param sojourn [in] time spent by the packet in the queue
+ * @param qlen [in] packets in the queue, including this one
+ * @param time [in] current time
+ *
+ * @return Operation status
+ * @retval 0 dequeue the packet
+ * @retval 1 drop the packet
+ */
+static inline int
+rte_codel_dequeue(const struct rte_codel_config *codel_cfg,
+	struct rte_codel *codel,
+	uint64_t sojourn,
+	uint32_t qlen,
+	uint64_t time)
+{
+	uint32_t delta;
+	int ok_to_drop;
+
+	/* Sojourn time above target for at least one interval? A single
+	 * packet in the queue does not make a standing queue.
+	 */
+	if (sojourn < codel_cfg->target || qlen <= 1) {
+		codel->first_above_time = 0;
+		ok_to_drop = 0;
+	} else if (codel->first_above_time == 0) {
+		codel->first_above_time = time + codel_cfg->interval;
+		ok_to_drop = 0;
+	} else {
+		ok_to_drop = time >= codel->first_above_time;
+	}
+
+	if (codel->dropping) {
+		if (!ok_to_drop) {
+			/* Sojourn time below target, leave drop state */
+			codel->dropping = 0;
+			return 0;
+		}
+
+		if (time < codel->drop_next)
+			return 0;
+
+		/* Drop faster as long as the queue does not drain */
+		codel->count++;
+		__rte_codel_inv_sqrt_update(codel);
+		codel->drop_next = __rte_codel_control_law(codel_cfg, codel,
+			codel->drop_next);
+		return 1;
+	}
+
+	if (!ok_to_drop)
+		return 0;
+
+	/* Enter drop state, resuming close to the previous drop rate when
+	 * the last drop state was left recently
+	 */
+	codel->dropping = 1;
+	delta = codel->count - codel->lastcount;
+	if (delta > 1 &&
+	    time - codel->drop_next < 16 * (uint64_t)codel_cfg->interval) {
+		codel->count = delta;
+		__rte_codel_inv_sqrt_update(codel);
+	} else {
+		codel->count = 1;
+		codel->rec_inv_sqrt = UINT32_MAX;
+	}
+	codel->lastcount = codel->count;
+	codel->drop_next = __rte_codel_control_law(codel_cfg, codel, time);
+
+	return 1;
+}
+
+/**
+ * @brief Callback to record the queue becoming empty
+ *
+ * @param codel [in,out] data pointer to CoDel runtime data
+ */
+static inline void
+rte_codel_mark_queue_empty(struct rte_codel *codel)
+{
+	codel->first_above_time = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTE_CODEL_H_INCLUDED__ */
@@ -15,6 +15,7 @@
 #include <rte_mbuf.h>
 #include <rte_bitmap.h>
 #include <rte_reciprocal.h>
+#include <rte_atomic.h>
 
 #include "rte_sched.h"
 #include "rte_sched_common.h"
@@ -46,6 +47,11 @@
  */
 #define RTE_SCHED_TIME_SHIFT		      8
 
+/* Scaling for the port arbiter cycles_per_byte calculation. Larger than
+ * RTE_SCHED_TIME_SHIFT, as the arbiter rate is not limited to 32 bits.
+ */
+#define RTE_SCHED_ARBITER_TIME_SHIFT	      16
+
 struct rte_sched_subport {
 	/* Token bucket (TB) */
 	uint64_t tb_time; /* time of last update */
@@ -69,6 +75,13 @@ struct rte_sched_subport {
 	uint32_t tc_ov_n;
 	double tc_ov_rate;
 
+	/* Queue layout of the pipes */
+	uint32_t queue_sp;            /* no WRR between the queues of a TC */
+	uint16_t qsize[RTE_SCHED_QUEUES_PER_PIPE]; /* 0 for unused queues */
+	uint32_t qsize_add[RTE_SCHED_QUEUES_PER_PIPE];
+	uint32_t qsize_sum;
+	struct rte_mbuf **queue_array;
+
 	/* Statistics */
 	struct rte_sched_subport_stats stats;
 };
@@ -119,6 +132,9 @@ struct rte_sched_queue_extra {
 #ifdef RTE_SCHED_RED
 	struct rte_red red;
 #endif
+#ifdef RTE_SCHED_CODEL
+	struct rte_codel codel;
+#endif
 };
 
 enum grinder_state {
@@ -179,6 +195,10 @@ struct rte_sched_port {
 #ifdef RTE_SCHED_RED
 	struct rte_red_config red_config[RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE][RTE_COLORS];
 #endif
+#ifdef RTE_SCHED_CODEL
+	struct rte_codel_config codel_config[RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE];
+	uint64_t time_enqueue;        /* CPU time of the current enqueue */
+#endif
 
 	/* Timing */
 	uint64_t time_cpu_cycles;     /* Current CPU time measured in CPU cyles */
@@ -186,6 +206,13 @@ struct rte_sched_port {
 	uint64_t time;                /* Current NIC TX time measured in bytes */
 	struct rte_reciprocal inv_cycles_per_byte; /* CPU cycles per byte */
 
+	/* Sharding */
+	struct rte_sched_arbiter *arbiter; /* NULL if the port is not sharded */
+	uint32_t arbiter_credits;     /* Credits taken from the arbiter */
+	uint32_t n_subports_total;    /* Subports of all the shards */
+	uint32_t subport_base;        /* First subport owned by the shard */
+	uint32_t qindex_base;         /* First queue owned by the shard */
+
 	/* Scheduling loop detection */
 	uint32_t pipe_loop;
 	uint32_t pipe_exhaustion;
@@ -200,10 +227,6 @@ struct rte_sched_port {
 	struct rte_mbuf **pkts_out;
 	uint32_t n_pkts_out;
 
-	/* Queue base calculation */
-	uint32_t qsize_add[RTE_SCHED_QUEUES_PER_PIPE];
-	uint32_t qsize_sum;
-
 	/* Large data structures */
 	struct rte_sched_subport *subport;
 	struct rte_sched_pipe *pipe;
@@ -215,6 +238,15 @@ struct rte_sched_port {
 	uint8_t memory[0] __rte_cache_aligned;
 } __rte_cache_aligned;
 
+struct rte_sched_arbiter {
+	/* Token bucket (TB) shared by all the shards of a port */
+	volatile uint64_t tb_time;    /* CPU time of last update (cycles) */
+	rte_atomic64_t tb_credits;
+	uint64_t tb_size;
+	uint64_t tb_cycles_max;       /* CPU cycles to fill an empty TB */
+	struct rte_reciprocal_u64 inv_cycles_per_byte;
+} __rte_cache_aligned;
+
 enum rte_sched_port_array {
 	e_RTE_SCHED_PORT_ARRAY_SUBPORT = 0,
 	e_RTE_SCHED_PORT_ARRAY_PIPE,
@@ -242,22 +274,28 @@ rte_sched_port_queues_per_port(struct rte_sched_port *port)
 	return RTE_SCHED_QUEUES_PER_PIPE * port->n_pipes_per_subport * port->n_subports_per_port;
 }
 
+static inline struct rte_sched_subport *
+rte_sched_port_qsubport(struct rte_sched_port *port, uint32_t qindex)
+{
+	return port->subport + (qindex >> (port->n_pipes_per_subport_log2 + 4));
+}
+
 static inline struct rte_mbuf **
 rte_sched_port_qbase(struct rte_sched_port *port, uint32_t qindex)
 {
-	uint32_t pindex = qindex >> 4;
+	struct rte_sched_subport *s = rte_sched_port_qsubport(port, qindex);
+	uint32_t pindex = (qindex >> 4) & (port->n_pipes_per_subport - 1);
 	uint32_t qpos = qindex & 0xF;
 
-	return (port->queue_array + pindex *
-		port->qsize_sum + port->qsize_add[qpos]);
+	return (s->queue_array + pindex * s->qsize_sum + s->qsize_add[qpos]);
 }
 
 static inline uint16_t
 rte_sched_port_qsize(struct rte_sched_port *port, uint32_t qindex)
 {
-	uint32_t tc = (qindex >> 2) & 0x3;
+	struct rte_sched_subport *s = rte_sched_port_qsubport(port, qindex);
 
-	return port->qsize[tc];
+	return s->qsize[qindex & 0xF];
 }
 
 static int
@@ -346,6 +384,17 @@ rte_sched_port_check_params(struct rte_sched_port_params *params)
 			return -8;
 	}
 
+	/* subport_queues: used TCs and queues within limits */
+	for (i = 0; params->subport_queues != NULL &&
+	     i < params->n_subports_per_port; i++) {
+		struct rte_sched_subport_queue_params *sq =
+			params->subport_queues + i;
+
+		if (sq->n_tcs > RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE ||
+		    sq->n_queues_per_tc > RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS)
+			return -10;
+	}
+
 	/* pipe_profiles and n_pipe_profiles */
 	if (params->pipe_profiles == NULL ||
 	    params->n_pipe_profiles == 0 ||
@@ -364,6 +413,35 @@ rte_sched_port_check_params(struct rte_sched_port_params *params)
 	return 0;
 }
 
+/* Size of each queue of the pipes of a subport, 0 for unused queues */
+static uint32_t
+rte_sched_subport_queue_layout(struct rte_sched_port_params *params,
+	uint32_t subport_id, uint16_t *qsize)
+{
+	struct rte_sched_subport_queue_params *sq = NULL;
+	uint32_t n_tcs = RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE;
+	uint32_t n_queues = RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS;
+	uint32_t tc, q, qsize_sum = 0;
+
+	if (params->subport_queues != NULL)
+		sq = params->subport_queues + subport_id;
+	if (sq != NULL && sq->n_tcs != 0)
+		n_tcs = sq->n_tcs;
+	if (sq != NULL && sq->n_queues_per_tc != 0)
+		n_queues = sq->n_queues_per_tc;
+
+	for (tc = 0; tc < RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE; tc++)
+		for (q = 0; q < RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS; q++) {
+			uint32_t qpos = tc * RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS + q;
+
+			qsize[qpos] = (tc < n_tcs && q < n_queues) ?
+				params->qsize[tc] : 0;
+			qsize_sum += qsize[qpos];
+		}
+
+	return qsize_sum;
+}
+
 static uint32_t
 rte_sched_port_get_array_base(struct rte_sched_port_params *params, enum rte_sched_port_array array)
 {
@@ -380,16 +458,17 @@ rte_sched_port_get_array_base(struct rte_sched_port_params *params, enum rte_sch
 	uint32_t size_pipe_profiles
 		= RTE_SCHED_PIPE_PROFILES_PER_PORT * sizeof(struct rte_sched_pipe_profile);
 	uint32_t size_bmp_array = rte_bitmap_get_memory_footprint(n_queues_per_port);
-	uint32_t size_per_pipe_queue_array, size_queue_array;
+	uint16_t qsize[RTE_SCHED_QUEUES_PER_PIPE];
+	uint32_t size_queue_array;
 
 	uint32_t base, i;
 
-	size_per_pipe_queue_array = 0;
-	for (i = 0; i < RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE; i++) {
-		size_per_pipe_queue_array += RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS
-			* params->qsize[i] * sizeof(struct rte_mbuf *);
-	}
-	size_queue_array = n_pipes_per_port * size_per_pipe_queue_array;
+	/* Only the queues in use by each subport get some storage */
+	size_queue_array = 0;
+	for (i = 0; i < n_subports_per_port; i++)
+		size_queue_array += n_pipes_per_subport *
+			rte_sched_subport_queue_layout(params, i, qsize) *
+			sizeof(struct rte_mbuf *);
 
 	base = 0;
 
@@ -445,33 +524,30 @@ rte_sched_port_get_memory_footprint(struct rte_sched_port_params *params)
 }
 
 static void
-rte_sched_port_config_qsize(struct rte_sched_port *port)
+rte_sched_port_config_qsize(struct rte_sched_port *port,
+	struct rte_sched_port_params *params)
 {
-	/* TC 0 */
-	port->qsize_add[0] = 0;
-	port->qsize_add[1] = port->qsize_add[0] + port->qsize[0];
-	port->qsize_add[2] = port->qsize_add[1] + port->qsize[0];
-	port->qsize_add[3] = port->qsize_add[2] + port->qsize[0];
-
-	/* TC 1 */
-	port->qsize_add[4] = port->qsize_add[3] + port->qsize[0];
-	port->qsize_add[5] = port->qsize_add[4] + port->qsize[1];
-	port->qsize_add[6] = port->qsize_add[5] + port->qsize[1];
-	port->qsize_add[7] = port->qsize_add[6] + port->qsize[1];
-
-	/* TC 2 */
-	port->qsize_add[8] = port->qsize_add[7] + port->qsize[1];
-	port->qsize_add[9] = port->qsize_add[8] + port->qsize[2];
-	port->qsize_add[10] = port->qsize_add[9] + port->qsize[2];
-	port->qsize_add[11] = port->qsize_add[10] + port->qsize[2];
-
-	/* TC 3 */
-	port->qsize_add[12] = port->qsize_add[11] + port->qsize[2];
-	port->qsize_add[13] = port->qsize_add[12] + port->qsize[3];
-	port->qsize_add[14] = port->qsize_add[13] + port->qsize[3];
-	port->qsize_add[15] = port->qsize_add[14] + port->qsize[3];
-
-	port->qsize_sum = port->qsize_add[15] + port->qsize[3];
+	struct rte_mbuf **queue_array = port->queue_array;
+	uint32_t i, j;
+
+	for (i = 0; i < port->n_subports_per_port; i++) {
+		struct rte_sched_subport *s = port->subport + i;
+		struct rte_sched_subport_queue_params *sq =
+			params->subport_queues;
+
+		s->qsize_sum = rte_sched_subport_queue_layout(params, i,
+							      s->qsize);
+		s->qsize_add[0] = 0;
+		for (j = 1; j < RTE_SCHED_QUEUES_PER_PIPE; j++)
+			s->qsize_add[j] = s->qsize_add[j - 1] + s->qsize[j - 1];
+
+		s->queue_array = queue_array;
+		queue_array += port->n_pipes_per_subport * s->qsize_sum;
+
+		/* With a single queue per TC, there is nothing to share */
+		s->queue_sp = (sq != NULL && (sq[i].queue_sp ||
+					       sq[i].n_queues_per_tc == 1));
+	}
 }
 
 static void
@@ -629,6 +705,7 @@ rte_sched_port_config(struct rte_sched_port_params *params)
 
 	/* User parameters */
 	port->n_subports_per_port = params->n_subports_per_port;
+	port->n_subports_total = params->n_subports_per_port;
 	port->n_pipes_per_subport = params->n_pipes_per_subport;
 	port->n_pipes_per_subport_log2 =
 			__builtin_ctz(params->n_pipes_per_subport);
@@ -661,6 +738,21 @@ rte_sched_port_config(struct rte_sched_port_params *params)
 	}
 #endif
 
+#ifdef RTE_SCHED_CODEL
+	for (i = 0; i < RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE; i++) {
+		/* if target is zero, then CoDel is disabled */
+		if (params->codel_params[i].target == 0)
+			continue;
+
+		if (rte_codel_config_init(&port->codel_config[i],
+			params->codel_params[i].target,
+			params->codel_params[i].interval) != 0) {
+			rte_free(port);
+			return NULL;
+		}
+	}
+#endif
+
 	/* Timing */
 	port->time_cpu_cycles = rte_get_tsc_cycles();
 	port->time_cpu_bytes = 0;
@@ -670,6 +762,12 @@ rte_sched_port_config(struct rte_sched_port_params *params)
 		/ params->rate;
 	port->inv_cycles_per_byte = rte_reciprocal_value(cycles_per_byte);
 
+	/* Sharding */
+	port->arbiter = NULL;
+	port->arbiter_credits = UINT32_MAX;
+	port->subport_base = 0;
+	port->qindex_base = 0;
+
 	/* Scheduling loop detection */
 	port->pipe_loop = RTE_SCHED_PIPE_INVALID;
 	port->pipe_exhaustion = 0;
@@ -679,9 +777,6 @@ rte_sched_port_config(struct rte_sched_port_params *params)
 	port->pkts_out = NULL;
 	port->n_pkts_out = 0;
 
-	/* Queue base calculation */
-	rte_sched_port_config_qsize(port);
-
 	/* Large data structures */
 	port->subport = (struct rte_sched_subport *)
 		(port->memory + rte_sched_port_get_array_base(params,
@@ -704,6 +799,9 @@ rte_sched_port_config(struct rte_sched_port_params *params)
 		(port->memory + rte_sched_port_get_array_base(params,
 							      e_RTE_SCHED_PORT_ARRAY_QUEUE_ARRAY));
 
+	/* Queue base calculation */
+	rte_sched_port_config_qsize(port, params);
+
 	/* Pipe profile table */
 	rte_sched_port_config_pipe_profile_table(port, params);
 
@@ -753,6 +851,89 @@ rte_sched_port_free(struct rte_sched_port *port)
 	rte_free(port);
 }
 
+struct rte_sched_arbiter * __rte_experimental
+rte_sched_arbiter_create(uint64_t rate, uint64_t tb_size, int socket_id)
+{
+	struct rte_sched_arbiter *arbiter;
+	uint64_t cycles_per_byte;
+
+	/* Check user parameters */
+	if (rate == 0 || tb_size == 0 || tb_size > INT64_MAX) {
+		RTE_LOG(ERR, SCHED,
+			"%s: Incorrect value for rate or tb_size\n", __func__);
+		return NULL;
+	}
+
+	cycles_per_byte = (rte_get_tsc_hz() << RTE_SCHED_ARBITER_TIME_SHIFT)
+		/ rate;
+	if (cycles_per_byte == 0) {
+		RTE_LOG(ERR, SCHED, "%s: Rate too high\n", __func__);
+		return NULL;
+	}
+
+	arbiter = rte_zmalloc_socket("qos_arbiter", sizeof(*arbiter),
+		RTE_CACHE_LINE_SIZE, socket_id);
+	if (arbiter == NULL)
+		return NULL;
+
+	arbiter->tb_size = tb_size;
+	arbiter->tb_cycles_max = (RTE_MIN(tb_size, UINT64_MAX / cycles_per_byte)
+		* cycles_per_byte) >> RTE_SCHED_ARBITER_TIME_SHIFT;
+	arbiter->inv_cycles_per_byte = rte_reciprocal_value_u64(cycles_per_byte);
+
+	/* Start with a full token bucket */
+	rte_atomic64_set(&arbiter->tb_credits, tb_size);
+	arbiter->tb_time = rte_get_tsc_cycles();
+
+	return arbiter;
+}
+
+void __rte_experimental
+rte_sched_arbiter_free(struct rte_sched_arbiter *arbiter)
+{
+	rte_free(arbiter);
+}
+
+struct rte_sched_port * __rte_experimental
+rte_sched_port_shard_config(struct rte_sched_port_params *params,
+	struct rte_sched_arbiter *arbiter,
+	uint32_t shard_id, uint32_t n_shards)
+{
+	struct rte_sched_port_params shard_params;
+	struct rte_sched_port *port;
+
+	/* Check user parameters */
+	if (params == NULL || arbiter == NULL || n_shards == 0 ||
+	    !rte_is_power_of_2(n_shards) ||
+	    n_shards > params->n_subports_per_port ||
+	    shard_id >= n_shards) {
+		RTE_LOG(ERR, SCHED,
+			"%s: Incorrect value for shard_id or n_shards\n",
+			__func__);
+		return NULL;
+	}
+
+	/* Each shard is a port scheduler for its range of subports */
+	shard_params = *params;
+	shard_params.n_subports_per_port /= n_shards;
+	if (params->subport_queues != NULL)
+		shard_params.subport_queues +=
+			shard_id * shard_params.n_subports_per_port;
+
+	port = rte_sched_port_config(&shard_params);
+	if (port == NULL)
+		return NULL;
+
+	port->arbiter = arbiter;
+	port->arbiter_credits = 0;
+	port->n_subports_total = params->n_subports_per_port;
+	port->subport_base = shard_id * port->n_subports_per_port;
+	port->qindex_base = port->subport_base *
+		(RTE_SCHED_QUEUES_PER_PIPE * port->n_pipes_per_subport);
+
+	return port;
+}
+
 static void
 rte_sched_port_log_subport_config(struct rte_sched_port *port, uint32_t i)
 {
@@ -791,7 +972,7 @@ rte_sched_subport_config(struct rte_sched_port *port,
 
 	/* Check user parameters */
 	if (port == NULL ||
-	    subport_id >= port->n_subports_per_port ||
+	    subport_id - port->subport_base >= port->n_subports_per_port ||
 	    params == NULL)
 		return -1;
 
@@ -810,7 +991,7 @@ rte_sched_subport_config(struct rte_sched_port *port,
 	if (params->tc_period == 0)
 		return -5;
 
-	s = port->subport + subport_id;
+	s = port->subport + (subport_id - port->subport_base);
 
 	/* Token Bucket (TB) */
 	if (params->tb_rate == port->rate) {
@@ -871,18 +1052,19 @@ rte_sched_pipe_config(struct rte_sched_port *port,
 	deactivate = (pipe_profile < 0);
 
 	if (port == NULL ||
-	    subport_id >= port->n_subports_per_port ||
+	    subport_id - port->subport_base >= port->n_subports_per_port ||
 	    pipe_id >= port->n_pipes_per_subport ||
 	    (!deactivate && profile >= port->n_pipe_profiles))
 		return -1;
 
 
 	/* Check that subport configuration is valid */
-	s = port->subport + subport_id;
+	s = port->subport + (subport_id - port->subport_base);
 	if (s->tb_period == 0)
 		return -2;
 
-	p = port->pipe + (subport_id * port->n_pipes_per_subport + pipe_id);
+	p = port->pipe + ((subport_id - port->subport_base) *
+		port->n_pipes_per_subport + pipe_id);
 
 	/* Handle the case when pipe already has a valid configuration */
 	if (p->tb_time) {
@@ -1002,7 +1184,7 @@ rte_sched_port_qindex(struct rte_sched_port *port,
 	uint32_t traffic_class,
 	uint32_t queue)
 {
-	return ((subport & (port->n_subports_per_port - 1)) <<
+	return ((subport & (port->n_subports_total - 1)) <<
 			(port->n_pipes_per_subport_log2 + 4)) |
 			((pipe & (port->n_pipes_per_subport - 1)) << 4) |
 			((traffic_class &
@@ -1052,11 +1234,12 @@ rte_sched_subport_read_stats(struct rte_sched_port *port,
 	struct rte_sched_subport *s;
 
 	/* Check user parameters */
-	if (port == NULL || subport_id >= port->n_subports_per_port ||
+	if (port == NULL ||
+	    subport_id - port->subport_base >= port->n_subports_per_port ||
 	    stats == NULL || tc_ov == NULL)
 		return -1;
 
-	s = port->subport + subport_id;
+	s = port->subport + (subport_id - port->subport_base);
 
 	/* Copy subport stats and clear */
 	memcpy(stats, &s->stats, sizeof(struct rte_sched_subport_stats));
@@ -1079,13 +1262,14 @@ rte_sched_queue_read_stats(struct rte_sched_port *port,
 
 	/* Check user parameters */
 	if ((port == NULL) ||
-	    (queue_id >= rte_sched_port_queues_per_port(port)) ||
+	    (queue_id - port->qindex_base >=
+		rte_sched_port_queues_per_port(port)) ||
 		(stats == NULL) ||
 		(qlen == NULL)) {
 		return -1;
 	}
-	q = port->queue + queue_id;
-	qe = port->queue_extra + queue_id;
+	q = port->queue + (queue_id - port->qindex_base);
+	qe = port->queue_extra + (queue_id - port->qindex_base);
 
 	/* Copy queue stats and clear */
 	memcpy(stats, &qe->stats, sizeof(struct rte_sched_queue_stats));
@@ -1220,6 +1404,22 @@ rte_sched_port_set_queue_empty_timestamp(struct rte_sched_port *port, uint32_t q
 
 #endif /* RTE_SCHED_RED */
 
+#ifdef RTE_SCHED_CODEL
+
+static inline void
+rte_sched_port_codel_set_queue_empty(struct rte_sched_port *port, uint32_t qindex)
+{
+	struct rte_sched_queue_extra *qe = port->queue_extra + qindex;
+
+	rte_codel_mark_queue_empty(&qe->codel);
+}
+
+#else
+
+#define rte_sched_port_codel_set_queue_empty(port, qindex)
+
+#endif /* RTE_SCHED_CODEL */
+
 #ifdef RTE_SCHED_DEBUG
 
 static inline void
@@ -1257,7 +1457,7 @@ rte_sched_port_enqueue_qptrs_prefetch0(struct rte_sched_port *port,
 #ifdef RTE_SCHED_COLLECT_STATS
 	struct rte_sched_queue_extra *qe;
 #endif
-	uint32_t qindex = rte_mbuf_sched_queue_get(pkt);
+	uint32_t qindex = rte_mbuf_sched_queue_get(pkt) - port->qindex_base;
 
 	q = port->queue + qindex;
 	rte_prefetch0(q);
@@ -1300,19 +1500,24 @@ rte_sched_port_enqueue_qwa(struct rte_sched_port *port, uint32_t qindex,
 	/* Drop the packet (and update drop stats) when queue is full */
 	if (unlikely(rte_sched_port_red_drop(port, pkt, qindex, qlen) ||
 		     (qlen >= qsize))) {
-		rte_pktmbuf_free(pkt);
 #ifdef RTE_SCHED_COLLECT_STATS
 		rte_sched_port_update_subport_stats_on_drop(port, qindex, pkt,
 							    qlen < qsize);
 		rte_sched_port_update_queue_stats_on_drop(port, qindex, pkt,
 							  qlen < qsize);
 #endif
+		rte_pktmbuf_free(pkt);
 		return 0;
 	}
 
 	/* Enqueue packet */
 	qbase[q->qw & (qsize - 1)] = pkt;
 	q->qw++;
+#ifdef RTE_SCHED_CODEL
+	/* the sojourn time is only needed when CoDel runs on this class */
+	if (port->codel_config[(qindex >> 2) & 0x3].target != 0)
+		pkt->timestamp = port->time_enqueue;
+#endif
 
 	/* Activate queue in the port bitmap */
 	rte_bitmap_set(port->bmp, qindex);
@@ -1354,6 +1559,10 @@ rte_sched_port_enqueue(struct rte_sched_port *port, struct rte_mbuf **pkts,
 
 	result = 0;
 
+#ifdef RTE_SCHED_CODEL
+	port->time_enqueue = rte_get_tsc_cycles();
+#endif
+
 	/*
 	 * Less then 6 input packets available, which is not enough to
 	 * feed the pipeline
@@ -1708,19 +1917,80 @@ grinder_credits_check(struct rte_sched_port *port, uint32_t pos)
 #endif /* RTE_SCHED_SUBPORT_TC_OV */
 
 
+#ifdef RTE_SCHED_CODEL
+
+/*
+ * Drop the packets at the head of the current queue for as long as CoDel
+ * decides so, based on their sojourn time. Returns 0 when the queue has been
+ * emptied.
+ */
 static inline int
-grinder_schedule(struct rte_sched_port *port, uint32_t pos)
+grinder_codel(struct rte_sched_port *port, uint32_t pos)
 {
 	struct rte_sched_grinder *grinder = port->grinder + pos;
+	struct rte_codel_config *cfg = &port->codel_config[grinder->tc_index];
 	struct rte_sched_queue *queue = grinder->queue[grinder->qpos];
+	uint32_t qindex = grinder->qindex[grinder->qpos];
+	struct rte_sched_queue_extra *qe = port->queue_extra + qindex;
+	uint64_t time = port->time_cpu_cycles;
 	struct rte_mbuf *pkt = grinder->pkt;
-	uint32_t pkt_len = pkt->pkt_len + port->frame_overhead;
 
-	if (!grinder_credits_check(port, pos))
+	if (cfg->target == 0)
+		return 1;
+
+	while (rte_codel_dequeue(cfg, &qe->codel, time - pkt->timestamp,
+				 (uint16_t)(queue->qw - queue->qr), time)) {
+#ifdef RTE_SCHED_COLLECT_STATS
+		rte_sched_port_update_subport_stats_on_drop(port, qindex, pkt, 0);
+		rte_sched_port_update_queue_stats_on_drop(port, qindex, pkt, 0);
+#endif
+		rte_pktmbuf_free(pkt);
+		queue->qr++;
+
+		if (queue->qr == queue->qw) {
+			rte_bitmap_clear(port->bmp, qindex);
+			grinder->qmask &= ~(1 << grinder->qpos);
+			grinder->wrr_mask[grinder->qpos] = 0;
+			rte_sched_port_set_queue_empty_timestamp(port, qindex);
+			rte_codel_mark_queue_empty(&qe->codel);
+			return 0;
+		}
+
+		pkt = grinder->qbase[grinder->qpos][queue->qr &
+						    (grinder->qsize - 1)];
+		grinder->pkt = pkt;
+	}
+
+	return 1;
+}
+
+#else
+
+#define grinder_codel(port, pos)                                      1
+
+#endif /* RTE_SCHED_CODEL */
+
+static inline int
+grinder_schedule(struct rte_sched_port *port, uint32_t pos)
+{
+	struct rte_sched_grinder *grinder = port->grinder + pos;
+	struct rte_sched_queue *queue = grinder->queue[grinder->qpos];
+	struct rte_mbuf *pkt;
+	uint32_t pkt_len;
+
+	if (!grinder_codel(port, pos))
+		return 0;
+
+	pkt = grinder->pkt;
+	pkt_len = pkt->pkt_len + port->frame_overhead;
+
+	if (pkt_len > port->arbiter_credits ||
+	    !grinder_credits_check(port, pos))
 		return 0;
 
 	/* Advance port time */
 	port->time += pkt_len;
+	port->arbiter_credits -= pkt_len;
 
 	/* Send packet */
 	port->pkts_out[port->n_pkts_out++] = pkt;
@@ -1733,6 +2003,7 @@ grinder_schedule(struct rte_sched_port *port, uint32_t pos)
 		grinder->qmask &= ~(1 << grinder->qpos);
 		grinder->wrr_mask[grinder->qpos] = 0;
 		rte_sched_port_set_queue_empty_timestamp(port, qindex);
+		rte_sched_port_codel_set_queue_empty(port, qindex);
 	}
 
 	/* Reset pipe loop detection */
@@ -2010,6 +2281,12 @@ grinder_wrr(struct rte_sched_port *port, uint32_t pos)
 	struct rte_sched_grinder *grinder = port->grinder + pos;
 	uint16_t wrr_tokens_min;
 
+	/* Strict priority between the queues of the TC */
+	if (grinder->subport->queue_sp) {
+		grinder->qpos = __builtin_ctz(grinder->qmask);
+		return;
+	}
+
 	grinder->wrr_tokens[0] |= ~grinder->wrr_mask[0];
 	grinder->wrr_tokens[1] |= ~grinder->wrr_mask[1];
 	grinder->wrr_tokens[2] |= ~grinder->wrr_mask[2];
@@ -2187,6 +2464,50 @@ rte_sched_port_time_resync(struct rte_sched_port *port)
 	port->pipe_loop = RTE_SCHED_PIPE_INVALID;
 }
 
+static inline void
+rte_sched_arbiter_credits_add(struct rte_sched_arbiter *arbiter,
+	uint64_t n_credits)
+{
+	uint64_t credits;
+
+	do {
+		credits = rte_atomic64_read(&arbiter->tb_credits);
+	} while (!rte_atomic64_cmpset((volatile uint64_t *)
+			&arbiter->tb_credits.cnt, credits,
+			RTE_MIN(credits + n_credits, arbiter->tb_size)));
+}
+
+static inline uint32_t
+rte_sched_arbiter_credits_take(struct rte_sched_arbiter *arbiter,
+	uint32_t n_credits)
+{
+	uint64_t cycles = rte_get_tsc_cycles();
+	uint64_t tb_time = arbiter->tb_time;
+	uint64_t credits, taken, cycles_diff;
+
+	/* Refill the TB, only one of the competing shards succeeds */
+	if (cycles > tb_time &&
+	    rte_atomic64_cmpset(&arbiter->tb_time, tb_time, cycles)) {
+		cycles_diff = RTE_MIN(cycles - tb_time, arbiter->tb_cycles_max);
+		credits = rte_reciprocal_divide_u64(
+			cycles_diff << RTE_SCHED_ARBITER_TIME_SHIFT,
+			&arbiter->inv_cycles_per_byte);
+		if (credits != 0)
+			rte_sched_arbiter_credits_add(arbiter, credits);
+	}
+
+	/* Take up to n_credits from the TB */
+	do {
+		credits = rte_atomic64_read(&arbiter->tb_credits);
+		if (credits == 0)
+			return 0;
+		taken = RTE_MIN(credits, (uint64_t)n_credits);
+	} while (!rte_atomic64_cmpset((volatile uint64_t *)
+			&arbiter->tb_credits.cnt, credits, credits - taken));
+
+	return (uint32_t)taken;
+}
+
 static inline int
 rte_sched_port_exceptions(struct rte_sched_port *port, int second_pass)
 {
@@ -2212,6 +2533,19 @@ rte_sched_port_dequeue(struct rte_sched_port *port, struct rte_mbuf **pkts, uint
 
 	rte_sched_port_time_resync(port);
 
+	/* Sharded port: reserve enough credits of the shared port TB for a
+	 * full burst, the unused ones are returned below.
+	 */
+	if (port->arbiter != NULL) {
+		port->arbiter_credits = rte_sched_arbiter_credits_take(
+			port->arbiter, RTE_MIN((uint64_t)n_pkts * port->mtu,
+					       (uint64_t)UINT32_MAX));
+		if (port->arbiter_credits == 0)
+			return 0;
+	} else {
+		port->arbiter_credits = UINT32_MAX;
+	}
+
 	/* Take each queue in the grinder one step further */
 	for (i = 0, count = 0; ; i++)  {
 		count += grinder_handle(port, i & (RTE_SCHED_PORT_N_GRINDERS - 1));
@@ -2221,5 +2555,9 @@ rte_sched_port_dequeue(struct rte_sched_port *port, struct rte_mbuf **pkts, uint
 		}
 	}
 
+	if (port->arbiter != NULL && port->arbiter_credits != 0)
+		rte_sched_arbiter_credits_add(port->arbiter,
+					      port->arbiter_credits);
+
 	return count;
 }
@@ -66,12 +66,20 @@ extern "C" {
 #include "rte_red.h"
 #endif
 
+/** Controlled Delay (CoDel) */
+#ifdef RTE_SCHED_CODEL
+#include "rte_codel.h"
+#endif
+
 /** Number of traffic classes per pipe (as well as subport).
- * Cannot be changed.
+ * Cannot be changed. The number of traffic classes actually used by the
+ * pipes of each subport is set through struct rte_sched_subport_queue_params.
  */
 #define RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE    4
 
-/** Number of queues per pipe traffic class. Cannot be changed. */
+/** Number of queues per pipe traffic class. Cannot be changed. The number
+ * of queues actually used is set through struct rte_sched_subport_queue_params.
+ */
 #define RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS    4
 
 /** Number of queues per pipe. */
@@ -182,6 +190,24 @@ struct rte_sched_queue_stats {
 	uint32_t n_bytes_dropped;        /**< Bytes dropped */
 };
 
+/**
+ * Queue layout of the pipes of a subport. Only the n_tcs highest priority
+ * traffic classes of each pipe, and the n_queues_per_tc first queues of each
+ * of these traffic classes are used, no memory is reserved for the other
+ * queues and the packets written to them are dropped.
+ */
+struct rte_sched_subport_queue_params {
+	uint32_t n_tcs;
+	/**< Traffic classes used per pipe, up to
+	 * RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE, 0 means all of them */
+	uint32_t n_queues_per_tc;
+	/**< Queues used per pipe traffic class, up to
+	 * RTE_SCHED_QUEUES_PER_TRAFFIC_CLASS, 0 means all of them */
+	int queue_sp;
+	/**< Strict priority between the queues of the same traffic class,
+	 * lowest queue first, instead of WRR */
+};
+
 /** Port configuration parameters. */
 struct rte_sched_port_params {
 	const char *name;                /**< String to be associated */
@@ -207,6 +233,16 @@ struct rte_sched_port_params {
 #ifdef RTE_SCHED_RED
 	struct rte_red_params red_params[RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE][RTE_COLORS]; /**< RED parameters */
 #endif
+#ifdef RTE_SCHED_CODEL
+	struct rte_codel_params codel_params[RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE];
+	/**< CoDel parameters for each traffic class, CoDel is disabled for
+	 * the traffic classes with a zero target. The mbuf timestamp field of
+	 * the packets of the other classes is overwritten with the enqueue
+	 * time. */
+#endif
+	struct rte_sched_subport_queue_params *subport_queues;
+	/**< Queue layout of each subport, array of n_subports_per_port
+	 * entries. NULL to use all the queues of every subport. */
 };
 
 /*
@@ -234,6 +270,82 @@ rte_sched_port_config(struct rte_sched_port_params *params);
 void
 rte_sched_port_free(struct rte_sched_port *port);
 
+/**
+ * Port arbiter shared by the shards of a sharded scheduler port.
+ *
+ * The arbiter is a token bucket consulted by every shard on dequeue, so
+ * that the total rate of all shards does not exceed the output port rate.
+ */
+struct rte_sched_arbiter;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Hierarchical scheduler port arbiter create
+ *
+ * @param rate
+ *   Aggregate output port rate (measured in bytes per second)
+ * @param tb_size
+ *   Size of the shared token bucket (measured in credits). Should be at
+ *   least the number of shards times the largest dequeue burst times the
+ *   port MTU, otherwise shards may starve each other.
+ * @param socket_id
+ *   CPU socket ID to allocate the arbiter on
+ * @return
+ *   Handle to the arbiter upon success or NULL otherwise.
+ */
+struct rte_sched_arbiter * __rte_experimental
+rte_sched_arbiter_create(uint64_t rate, uint64_t tb_size, int socket_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Hierarchical scheduler port arbiter free. All the shards using the
+ * arbiter must be freed first.
+ *
+ * @param arbiter
+ *   Handle to the arbiter
+ */
+void __rte_experimental
+rte_sched_arbiter_free(struct rte_sched_arbiter *arbiter);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice.
+ *
+ * Hierarchical scheduler port shard configuration
+ *
+ * The subports of the port described by *params* are split evenly
+ * between *n_shards* scheduler instances, shard *shard_id* owning
+ * subports [shard_id * n, (shard_id + 1) * n), with n equal to
+ * n_subports_per_port / n_shards. Each shard has its own bitmap,
+ * grinders and queues, so that the shards can be run on different lcores;
+ * the enqueue and dequeue for a given shard must still run on the same
+ * lcore. The rate of each shard is limited to params->rate, while the
+ * aggregate rate of all the shards is enforced by the arbiter.
+ *
+ * Subport, pipe and queue IDs passed to the other functions of this API
+ * are the IDs of the full port. Packets must be enqueued to the shard
+ * owning their subport.
+ *
+ * @param params
+ *   Port scheduler configuration parameter structure for the full port
+ * @param arbiter
+ *   Port arbiter shared by all the shards
+ * @param shard_id
+ *   Shard ID, less than n_shards
+ * @param n_shards
+ *   Number of shards, power of 2 not greater than n_subports_per_port
+ * @return
+ *   Handle to port scheduler instance upon success or NULL otherwise.
+ */
+struct rte_sched_port * __rte_experimental
+rte_sched_port_shard_config(struct rte_sched_port_params *params,
+	struct rte_sched_arbiter *arbiter,
+	uint32_t shard_id, uint32_t n_shards);
+
 /**
  * @warning
  * @b EXPERIMENTAL: this API may change without prior notice.
@@ -0,0 +1,610 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_errno.h>
+#include <rte_malloc.h>
+#include <rte_prefetch.h>
+#include <rte_string_fns.h>
+#include <rte_jhash.h>
+#include <rte_vect.h>
+
+#include "rte_sketch.h"
+
+/* Same hash function as the membership library */
+#if defined(RTE_ARCH_X86) || defined(RTE_MACHINE_CPUFLAG_CRC32)
+#include <rte_hash_crc.h>
+#define SKETCH_HASH_FUNC rte_hash_crc
+#else
+#define SKETCH_HASH_FUNC rte_jhash
+#endif
+
+/* Number of keys hashed and prefetched at once by bulk updates */
+#define SKETCH_BULK_MAX 64
+
+/* Packets and bytes counters, updated together. */
+struct sketch_counter {
+	uint64_t pkts;
+	uint64_t bytes;
+} __rte_aligned(16);
+
+/* A heavy hitter flow, its key is stored in the keys array. */
+struct sketch_topk_entry {
+	uint64_t pkts;
+	uint64_t bytes;
+	uint32_t hash;		/* Primary hash of the key. */
+	uint32_t heap_pos;	/* Position of the entry in the heap. */
+};
+
+struct rte_sketch {
+	uint32_t key_len;
+	uint32_t width_mask;
+	uint32_t width_shift;	/* log2 of the width. */
+	uint32_t depth;
+	uint32_t seed;
+	uint32_t flags;
+	uint32_t topk;		/* Maximum number of heavy hitters. */
+	uint32_t topk_cnt;	/* Current number of heavy hitters. */
+	uint32_t index_mask;
+	/* Counters of all rows, row after row. */
+	struct sketch_counter *counters;
+	/* Heavy hitter entries and their keys. */
+	struct sketch_topk_entry *entries;
+	uint8_t *keys;
+	/* Min-heap of entry ids, the smallest heavy hitter is the root. */
+	uint32_t *heap;
+	/* Open addressing index of the entries, storing entry ids + 1. */
+	uint32_t *index;
+	int socket_id;
+	char name[RTE_SKETCH_NAMESIZE];
+};
+
+static inline void
+sketch_hash(const struct rte_sketch *sk, const void *key,
+		uint32_t *h1, uint32_t *h2)
+{
+	*h1 = SKETCH_HASH_FUNC(key, sk->key_len, sk->seed);
+	*h2 = rte_jhash_1word(*h1, sk->seed);
+}
+
+/*
+ * The counter of a row is derived from two hash values, as g(i) = h1 + i*h2,
+ * so that a single hash of the key is computed whatever the depth.
+ */
+static inline struct sketch_counter *
+sketch_counter(const struct rte_sketch *sk, uint32_t row, uint32_t h1,
+		uint32_t h2)
+{
+	return &sk->counters[((size_t)row << sk->width_shift)
+			+ ((h1 + row * h2) & sk->width_mask)];
+}
+
+static inline void
+sketch_counter_add(struct sketch_counter *c, uint32_t bytes)
+{
+#if defined(RTE_ARCH_X86)
+	/* Update both counters with a single 128-bit add */
+	xmm_t inc = _mm_set_epi64x(bytes, 1);
+
+	_mm_store_si128((xmm_t *)c,
+			_mm_add_epi64(_mm_load_si128((const xmm_t *)c), inc));
+#else
+	c->pkts++;
+	c->bytes += bytes;
+#endif
+}
+
+static inline void
+sketch_counter_merge(struct sketch_counter *dst,
+		const struct sketch_counter *src)
+{
+#if defined(RTE_ARCH_X86)
+	_mm_store_si128((xmm_t *)dst,
+			_mm_add_epi64(_mm_load_si128((const xmm_t *)dst),
+				_mm_load_si128((const xmm_t *)src)));
+#else
+	dst->pkts += src->pkts;
+	dst->bytes += src->bytes;
+#endif
+}
+
+static inline void
+sketch_estimate_hashed(const struct rte_sketch *sk, uint32_t h1, uint32_t h2,
+		uint64_t *pkts, uint64_t *bytes)
+{
+	const struct sketch_counter *c;
+	uint64_t pkts_min = UINT64_MAX, bytes_min = UINT64_MAX;
+	uint32_t i;
+
+	for (i = 0; i < sk->depth; i++) {
+		c = sketch_counter(sk, i, h1, h2);
+		pkts_min = RTE_MIN(pkts_min, c->pkts);
+		bytes_min = RTE_MIN(bytes_min, c->bytes);
+	}
+	*pkts = pkts_min;
+	*bytes = bytes_min;
+}
+
+static inline uint64_t
+topk_metric(const struct rte_sketch *sk, uint64_t pkts, uint64_t bytes)
+{
+	return (sk->flags & RTE_SKETCH_F_TOPK_BYTES) ? bytes : pkts;
+}
+
+static inline uint64_t
+topk_entry_metric(const struct rte_sketch *sk, uint32_t id)
+{
+	return topk_metric(sk, sk->entries[id].pkts, sk->entries[id].bytes);
+}
+
+static inline uint8_t *
+topk_key(const struct rte_sketch *sk, uint32_t id)
+{
+	return sk->keys + (size_t)id * sk->key_len;
+}
+
+static inline void
+topk_heap_set(struct rte_sketch *sk, uint32_t pos, uint32_t id)
+{
+	sk->heap[pos] = id;
+	sk->entries[id].heap_pos = pos;
+}
+
+static void
+topk_sift_up(struct rte_sketch *sk, uint32_t pos)
+{
+	uint32_t id = sk->heap[pos];
+	uint64_t m = topk_entry_metric(sk, id);
+	uint32_t parent;
+
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (topk_entry_metric(sk, sk->heap[parent]) <= m)
+			break;
+		topk_heap_set(sk, pos, sk->heap[parent]);
+		pos = parent;
+	}
+	topk_heap_set(sk, pos, id);
+}
+
+static void
+topk_sift_down(struct rte_sketch *sk, uint32_t pos)
+{
+	uint32_t id = sk->heap[pos];
+	uint64_t m = topk_entry_metric(sk, id);
+	uint32_t child;
+
+	while ((child = 2 * pos + 1) < sk->topk_cnt) {
+		if (child + 1 < sk->topk_cnt &&
+				topk_entry_metric(sk, sk->heap[child + 1]) <
+				topk_entry_metric(sk, sk->heap[child]))
+			child++;
+		if (m <= topk_entry_metric(sk, sk->heap[child]))
+			break;
+		topk_heap_set(sk, pos, sk->heap[child]);
+		pos = child;
+	}
+	topk_heap_set(sk, pos, id);
+}
+
+static int32_t
+topk_find(const struct rte_sketch *sk, const void *key, uint32_t hash)
+{
+	uint32_t slot = hash & sk->index_mask;
+	uint32_t id;
+
+	while (sk->index[slot] != 0) {
+		id = sk->index[slot] - 1;
+		if (sk->entries[id].hash == hash &&
+				memcmp(topk_key(sk, id), key, sk->key_len) == 0)
+			return id;
+		slot = (slot + 1) & sk->index_mask;
+	}
+	return -1;
+}
+
+static void
+topk_index_add(struct rte_sketch *sk, uint32_t id)
+{
+	uint32_t slot = sk->entries[id].hash & sk->index_mask;
+
+	while (sk->index[slot] != 0)
+		slot = (slot + 1) & sk->index_mask;
+	sk->index[slot] = id + 1;
+}
+
+/* Remove an entry from the index, moving back the entries probed after it */
+static void
+topk_index_del(struct rte_sketch *sk, uint32_t id)
+{
+	uint32_t i = sk->entries[id].hash & sk->index_mask;
+	uint32_t j, home;
+
+	while (sk->index[i] != id + 1)
+		i = (i + 1) & sk->index_mask;
+
+	for (j = (i + 1) & sk->index_mask; sk->index[j] != 0;
+			j = (j + 1) & sk->index_mask) {
+		home = sk->entries[sk->index[j] - 1].hash & sk->index_mask;
+		/* Move the entry back unless its home is in (i, j] */
+		if ((i < j && (home <= i || home > j)) ||
+				(i > j && home <= i && home > j)) {
+			sk->index[i] = sk->index[j];
+			i = j;
+		}
+	}
+	sk->index[i] = 0;
+}
+
+/* Offer a flow with its current estimate to the heavy hitters */
+static void
+topk_offer(struct rte_sketch *sk, const void *key, uint32_t hash,
+		uint64_t pkts, uint64_t bytes)
+{
+	struct sketch_topk_entry *e;
+	int32_t id;
+
+	/*
+	 * Estimates never decrease, so a flow whose estimate is not above
+	 * the smallest heavy hitter is either not a heavy hitter or already
+	 * has this estimate.
+	 */
+	if (sk->topk_cnt == sk->topk &&
+			topk_metric(sk, pkts, bytes) <=
+			topk_entry_metric(sk, sk->heap[0]))
+		return;
+
+	id = topk_find(sk, key, hash);
+	if (id >= 0) {
+		e = &sk->entries[id];
+		e->pkts = pkts;
+		e->bytes = bytes;
+		topk_sift_down(sk, e->heap_pos);
+		return;
+	}
+
+	if (sk->topk_cnt < sk->topk) {
+		/* Not full, add a new entry */
+		id = sk->topk_cnt++;
+		e = &sk->entries[id];
+		e->hash = hash;
+		e->pkts = pkts;
+		e->bytes = bytes;
+		memcpy(topk_key(sk, id), key, sk->key_len);
+		topk_index_add(sk, id);
+		topk_heap_set(sk, sk->topk_cnt - 1, id);
+		topk_sift_up(sk, sk->topk_cnt - 1);
+		return;
+	}
+
+	/* Replace the smallest heavy hitter */
+	id = sk->heap[0];
+	e = &sk->entries[id];
+	topk_index_del(sk, id);
+	e->hash = hash;
+	e->pkts = pkts;
+	e->bytes = bytes;
+	memcpy(topk_key(sk, id), key, sk->key_len);
+	topk_index_add(sk, id);
+	topk_sift_down(sk, 0);
+}
+
+static inline void
+sketch_update_hashed(struct rte_sketch *sk, const void *key, uint32_t h1,
+		uint32_t h2, uint32_t bytes)
+{
+	struct sketch_counter *c;
+	uint64_t pkts_min = UINT64_MAX, bytes_min = UINT64_MAX;
+	uint32_t i;
+
+	for (i = 0; i < sk->depth; i++) {
+		c = sketch_counter(sk, i, h1, h2);
+		sketch_counter_add(c, bytes);
+		pkts_min = RTE_MIN(pkts_min, c->pkts);
+		bytes_min = RTE_MIN(bytes_min, c->bytes);
+	}
+
+	if (sk->topk != 0)
+		topk_offer(sk, key, h1, pkts_min, bytes_min);
+}
+
+struct rte_sketch * __rte_experimental
+rte_sketch_create(const struct rte_sketch_params *params)
+{
+	struct rte_sketch *sk;
+	uint32_t index_size;
+
+	if (params == NULL || params->name == NULL ||
+			params->key_len == 0 ||
+			params->key_len > RTE_SKETCH_MAX_KEY_LEN ||
+			!rte_is_power_of_2(params->width) ||
+			params->width > (1U << 30) ||
+			params->depth == 0 ||
+			params->depth > RTE_SKETCH_MAX_DEPTH ||
+			params->topk > RTE_SKETCH_MAX_TOPK) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	sk = rte_zmalloc_socket(params->name, sizeof(*sk),
+			RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (sk == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+	strlcpy(sk->name, params->name, sizeof(sk->name));
+	sk->key_len = params->key_len;
+	sk->width_mask = params->width - 1;
+	sk->width_shift = rte_bsf32(params->width);
+	sk->depth = params->depth;
+	sk->seed = params->seed;
+	sk->flags = params->flags;
+	sk->topk = params->topk;
+	sk->socket_id = params->socket_id;
+
+	sk->counters = rte_zmalloc_socket(params->name,
+			(size_t)params->width * params->depth *
+			sizeof(struct sketch_counter),
+			RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (sk->counters == NULL)
+		goto nomem;
+
+	if (sk->topk != 0) {
+		/* Keep the index at most half full */
+		index_size = rte_align32pow2(2 * sk->topk);
+		sk->index_mask = index_size - 1;
+		sk->entries = rte_zmalloc_socket(params->name,
+				sk->topk * sizeof(*sk->entries),
+				RTE_CACHE_LINE_SIZE, params->socket_id);
+		sk->keys = rte_zmalloc_socket(params->name,
+				sk->topk * sk->key_len,
+				RTE_CACHE_LINE_SIZE, params->socket_id);
+		sk->heap = rte_zmalloc_socket(params->name,
+				sk->topk * sizeof(*sk->heap),
+				RTE_CACHE_LINE_SIZE, params->socket_id);
+		sk->index = rte_zmalloc_socket(params->name,
+				index_size * sizeof(*sk->index),
+				RTE_CACHE_LINE_SIZE, params->socket_id);
+		if (sk->entries == NULL || sk->keys == NULL ||
+				sk->heap == NULL || sk->index == NULL)
+			goto nomem;
+	}
+
+	return sk;
+
+nomem:
+	rte_sketch_free(sk);
+	rte_errno = ENOMEM;
+	return NULL;
+}
+
+void __rte_experimental
+rte_sketch_free(struct rte_sketch *sk)
+{
+	if (sk == NULL)
+		return;
+
+	rte_free(sk->index);
+	rte_free(sk->heap);
+	rte_free(sk->keys);
+	rte_free(sk->entries);
+	rte_free(sk->counters);
+	rte_free(sk);
+}
+
+void __rte_experimental
+rte_sketch_reset(struct rte_sketch *sk)
+{
+	memset(sk->counters, 0, (size_t)(sk->width_mask + 1) * sk->depth *
+			sizeof(struct sketch_counter));
+	if (sk->topk != 0)
+		memset(sk->index, 0,
+			(sk->index_mask + 1) * sizeof(*sk->index));
+	sk->topk_cnt = 0;
+}
+
+void __rte_experimental
+rte_sketch_update(struct rte_sketch *sk, const void *key, uint32_t bytes)
+{
+	uint32_t h1, h2;
+
+	sketch_hash(sk, key, &h1, &h2);
+	sketch_update_hashed(sk, key, h1, h2, bytes);
+}
+
+void __rte_experimental
+rte_sketch_update_bulk(struct rte_sketch *sk, const void **keys,
+		const uint32_t *bytes, uint32_t num)
+{
+	uint32_t h1[SKETCH_BULK_MAX], h2[SKETCH_BULK_MAX];
+	uint32_t i, j, n;
+
+	while (num > 0) {
+		n = RTE_MIN(num, (uint32_t)SKETCH_BULK_MAX);
+
+		/* Hash the keys and prefetch all their counters first */
+		for (i = 0; i < n; i++) {
+			sketch_hash(sk, keys[i], &h1[i], &h2[i]);
+			for (j = 0; j < sk->depth; j++)
+				rte_prefetch0(sketch_counter(sk, j, h1[i],
+							h2[i]));
+		}
+		for (i = 0; i < n; i++)
+			sketch_update_hashed(sk, keys[i], h1[i], h2[i],
+					bytes[i]);
+
+		keys += n;
+		bytes += n;
+		num -= n;
+	}
+}
+
+uint16_t __rte_experimental
+rte_sketch_update_burst(struct rte_sketch *sk, struct rte_mbuf **pkts,
+		uint16_t nb_pkts, uint32_t key_offset)
+{
+	const void *keys[SKETCH_BULK_MAX];
+	uint32_t bytes[SKETCH_BULK_MAX];
+	uint16_t i, n = 0, nb_accounted = 0;
+
+	for (i = 0; i < nb_pkts; i++) {
+		if (rte_pktmbuf_data_len(pkts[i]) < key_offset + sk->key_len)
+			continue;
+		keys[n] = rte_pktmbuf_mtod_offset(pkts[i], const void *,
+				key_offset);
+		bytes[n] = rte_pktmbuf_pkt_len(pkts[i]);
+		if (++n == SKETCH_BULK_MAX) {
+			rte_sketch_update_bulk(sk, keys, bytes, n);
+			nb_accounted += n;
+			n = 0;
+		}
+	}
+	rte_sketch_update_bulk(sk, keys, bytes, n);
+	return nb_accounted + n;
+}
+
+void __rte_experimental
+rte_sketch_estimate(const struct rte_sketch *sk, const void *key,
+		uint64_t *pkts, uint64_t *bytes)
+{
+	uint64_t p, b;
+	uint32_t h1, h2;
+
+	sketch_hash(sk, key, &h1, &h2);
+	sketch_estimate_hashed(sk, h1, h2, &p, &b);
+	if (pkts != NULL)
+		*pkts = p;
+	if (bytes != NULL)
+		*bytes = b;
+}
+
+int __rte_experimental
+rte_sketch_merge(struct rte_sketch *dst, const struct rte_sketch *src)
+{
+	struct sketch_topk_entry *e;
+	uint64_t pkts, bytes;
+	uint32_t i, n;
+
+	if (dst == NULL || src == NULL || dst == src ||
+			dst->key_len != src->key_len ||
+			dst->width_mask != src->width_mask ||
+			dst->depth != src->depth || dst->seed != src->seed)
+		return -EINVAL;
+
+	n = (dst->width_mask + 1) * dst->depth;
+	for (i = 0; i < n; i++)
+		sketch_counter_merge(&dst->counters[i], &src->counters[i]);
+
+	if (dst->topk == 0)
+		return 0;
+
+	/*
+	 * The estimates of the heavy hitters of dst increased, update them
+	 * and rebuild the heap. The second hash value is derived from the
+	 * first one, so the keys don't need to be hashed again.
+	 */
+	for (i = 0; i < dst->topk_cnt; i++) {
+		e = &dst->entries[dst->heap[i]];
+		sketch_estimate_hashed(dst, e->hash,
+				rte_jhash_1word(e->hash, dst->seed),
+				&e->pkts, &e->bytes);
+	}
+	for (i = dst->topk_cnt / 2; i-- > 0; )
+		topk_sift_down(dst, i);
+
+	/* Then offer the heavy hitters of src with the merged estimates */
+	for (i = 0; i < src->topk_cnt; i++) {
+		e = &src->entries[src->heap[i]];
+		sketch_estimate_hashed(dst, e->hash,
+				rte_jhash_1word(e->hash, dst->seed),
+				&pkts, &bytes);
+		topk_offer(dst, topk_key(src, src->heap[i]), e->hash,
+				pkts, bytes);
+	}
+	return 0;
+}
+
+static int
+topk_cmp_pkts(const void *a, const void *b)
+{
+	const struct rte_sketch_flow *fa = a, *fb = b;
+
+	return (fa->pkts < fb->pkts) - (fa->pkts > fb->pkts);
+}
+
+static int
+topk_cmp_bytes(const void *a, const void *b)
+{
+	const struct rte_sketch_flow *fa = a, *fb = b;
+
+	return (fa->bytes < fb->bytes) - (fa->bytes > fb->bytes);
+}
+
+static void
+topk_flow_fill(const struct rte_sketch *sk, struct rte_sketch_flow *f,
+		uint32_t id)
+{
+	f->key = topk_key(sk, id);
+	f->pkts = sk->entries[id].pkts;
+	f->bytes = sk->entries[id].bytes;
+}
+
+/* Sift down in a min-heap of n flows, ordered by the top-k metric. */
+static void
+topk_flow_sift_down(const struct rte_sketch *sk, struct rte_sketch_flow *flows,
+		uint32_t n, uint32_t pos)
+{
+	struct rte_sketch_flow f = flows[pos];
+	uint64_t m = topk_metric(sk, f.pkts, f.bytes);
+	uint32_t child;
+
+	while ((child = 2 * pos + 1) < n) {
+		if (child + 1 < n &&
+				topk_metric(sk, flows[child + 1].pkts,
+					flows[child + 1].bytes) <
+				topk_metric(sk, flows[child].pkts,
+					flows[child].bytes))
+			child++;
+		if (m <= topk_metric(sk, flows[child].pkts, flows[child].bytes))
+			break;
+		flows[pos] = flows[child];
+		pos = child;
+	}
+	flows[pos] = f;
+}
+
+uint32_t __rte_experimental
+rte_sketch_topk(const struct rte_sketch *sk, struct rte_sketch_flow *flows,
+		uint32_t max_flows)
+{
+	uint32_t i, n;
+
+	n = RTE_MIN(sk->topk_cnt, max_flows);
+	if (flows == NULL || n == 0)
+		return 0;
+
+	/*
+	 * Select the n biggest flows in a min-heap built in the output array,
+	 * so that no temporary copy of all the heavy hitters is needed.
+	 */
+	for (i = 0; i < n; i++)
+		topk_flow_fill(sk, &flows[i], i);
+	for (i = n / 2; i-- > 0; )
+		topk_flow_sift_down(sk, flows, n, i);
+	for (i = n; i < sk->topk_cnt; i++) {
+		if (topk_entry_metric(sk, i) <=
+				topk_metric(sk, flows[0].pkts, flows[0].bytes))
+			continue;
+		topk_flow_fill(sk, &flows[0], i);
+		topk_flow_sift_down(sk, flows, n, 0);
+	}
+
+	qsort(flows, n, sizeof(flows[0]),
+		(sk->flags & RTE_SKETCH_F_TOPK_BYTES) ?
+		topk_cmp_bytes : topk_cmp_pkts);
+	return n;
+}
@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef _RTE_SKETCH_H_
+#define _RTE_SKETCH_H_
+
+/**
+ * @file
+ * RTE sketch
+ *
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Streaming sketch estimating the packets and bytes of each flow without
+ * a table entry per flow. A Count-Min sketch made of depth rows of width
+ * counters is updated for every packet: each row maps the flow key to one
+ * of its counters, and the estimate of a flow is the minimum of its counters
+ * over the rows. The estimate never underestimates the real value, and
+ * overestimates it by at most e/width of the total traffic, with a
+ * probability of at least 1 - 1/e^depth.
+ *
+ * Optionally, the sketch tracks the top-k flows with the highest estimates
+ * (heavy hitters), ranked by packets or bytes, and keeps their keys.
+ *
+ * A sketch is not MT-safe. Each lcore is expected to update its own sketch,
+ * and the sketches of several lcores can be merged to get the estimates of
+ * the whole traffic.
+ */
+
+#include <stdint.h>
+#include <rte_compat.h>
+#include <rte_mbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of rows of a sketch. */
+#define RTE_SKETCH_MAX_DEPTH 8
+
+/** Maximum size of a flow key in bytes. */
+#define RTE_SKETCH_MAX_KEY_LEN 64
+
+/** Maximum number of flows tracked as heavy hitters. */
+#define RTE_SKETCH_MAX_TOPK 4096
+
+/** Maximum number of characters in a sketch name. */
+#define RTE_SKETCH_NAMESIZE 32
+
+/** Rank the heavy hitters by bytes instead of packets. */
+#define RTE_SKETCH_F_TOPK_BYTES 0x1
+
+/** Parameters used to create a sketch. */
+struct rte_sketch_params {
+	const char *name;  /**< Name of the sketch. */
+	int socket_id;     /**< NUMA socket used for the memory. */
+	uint32_t key_len;  /**< Length of the flow keys. */
+	uint32_t width;    /**< Counters per row, a power of 2. */
+	uint32_t depth;    /**< Number of rows, up to RTE_SKETCH_MAX_DEPTH. */
+	uint32_t topk;     /**< Number of heavy hitters, 0 to disable. */
+	uint32_t seed;     /**< Hash seed, identical for merged sketches. */
+	uint32_t flags;    /**< RTE_SKETCH_F_* flags. */
+};
+
+/** Estimated traffic of a heavy hitter flow. */
+struct rte_sketch_flow {
+	const void *key;   /**< Flow key, valid until the sketch changes. */
+	uint64_t pkts;     /**< Estimated number of packets. */
+	uint64_t bytes;    /**< Estimated number of bytes. */
+};
+
+struct rte_sketch;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a sketch.
+ *
+ * @param params
+ *   Parameters of the sketch.
+ * @return
+ *   The sketch on success, or NULL with rte_errno set to EINVAL for invalid
+ *   parameters or ENOMEM.
+ */
+struct rte_sketch * __rte_experimental
+rte_sketch_create(const struct rte_sketch_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Free a sketch.
+ *
+ * @param sketch
+ *   The sketch, may be NULL.
+ */
+void __rte_experimental
+rte_sketch_free(struct rte_sketch *sketch);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Reset all the counters and heavy hitters of a sketch.
+ *
+ * @param sketch
+ *   The sketch.
+ */
+void __rte_experimental
+rte_sketch_reset(struct rte_sketch *sketch);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Account one packet of a flow.
+ *
+ * @param sketch
+ *   The sketch.
+ * @param key
+ *   The flow key, of the key_len given at creation.
+ * @param bytes
+ *   The length of the packet.
+ */
+void __rte_experimental
+rte_sketch_update(struct rte_sketch *sketch, const void *key, uint32_t bytes);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Account a bulk of packets. The keys are hashed and the counters are
+ * prefetched before being updated, which is faster than updating the
+ * packets one by one.
+ *
+ * @param sketch
+ *   The sketch.
+ * @param keys
+ *   The flow key of each packet.
+ * @param bytes
+ *   The length of each packet.
+ * @param num
+ *   The number of packets.
+ */
+void __rte_experimental
+rte_sketch_update_bulk(struct rte_sketch *sketch, const void **keys,
+		const uint32_t *bytes, uint32_t num);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Account a burst of mbufs, the flow key being read at a fixed offset of
+ * the packet data, and the packet length being pkt_len. For example, with
+ * untagged IPv4 packets without options, the addresses and the L4 ports are
+ * the 12 bytes at offset 26. Packets whose first segment is too short to
+ * hold the key are not accounted.
+ *
+ * @param sketch
+ *   The sketch.
+ * @param pkts
+ *   The mbufs.
+ * @param nb_pkts
+ *   The number of mbufs.
+ * @param key_offset
+ *   The offset of the flow key in the packet data.
+ * @return
+ *   The number of packets accounted.
+ */
+uint16_t __rte_experimental
+rte_sketch_update_burst(struct rte_sketch *sketch, struct rte_mbuf **pkts,
+		uint16_t nb_pkts, uint32_t key_offset);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the estimated traffic of a flow.
+ *
+ * @param sketch
+ *   The sketch.
+ * @param key
+ *   The flow key.
+ * @param pkts
+ *   Return the estimated number of packets, may be NULL.
+ * @param bytes
+ *   Return the estimated number of bytes, may be NULL.
+ */
+void __rte_experimental
+rte_sketch_estimate(const struct rte_sketch *sketch, const void *key,
+		uint64_t *pkts, uint64_t *bytes);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add the counters of a sketch to another one, typically to aggregate the
+ * sketches of several lcores. The heavy hitters of both sketches are
+ * ranked again with the merged counters. src must not be updated during
+ * the merge.
+ *
+ * @param dst
+ *   The sketch updated with the counters of src.
+ * @param src
+ *   The sketch to add.
+ * @return
+ *   0 on success, or -EINVAL if the sketches have different key lengths,
+ *   sizes or seeds.
+ */
+int __rte_experimental
+rte_sketch_merge(struct rte_sketch *dst, const struct rte_sketch *src);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the heavy hitters of a sketch, from the biggest flow.
+ *
+ * @param sketch
+ *   The sketch.
+ * @param flows
+ *   Array filled with the heavy hitters.
+ * @param max_flows
+ *   The size of the flows array.
+ * @return
+ *   The number of flows returned.
+ */
+uint32_t __rte_experimental
+rte_sketch_topk(const struct rte_sketch *sketch, struct rte_sketch_flow *flows,
+		uint32_t max_flows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_SKETCH_H_ */
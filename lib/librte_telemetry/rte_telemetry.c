@@ -16,6 +16,7 @@
 #include <rte_string_fns.h>
 
 #include "rte_telemetry.h"
+#include "rte_telemetry_data.h"
 #include "rte_telemetry_internal.h"
 #include "rte_telemetry_parser.h"
 #include "rte_telemetry_parser_test.h"
@@ -958,6 +959,11 @@ rte_telemetry_init()
 		return -EPERM;
 	}
 
+	/* registered commands are served on a socket of their own */
+	ret = rte_telemetry_cmd_listener_start();
+	if (ret < 0)
+		TELEMETRY_LOG_WARN("Telemetry commands socket unavailable");
+
 	return 0;
 }
 
@@ -985,6 +991,8 @@ rte_telemetry_cleanup(void)
 	struct telemetry_impl *telemetry = static_telemetry;
 	telemetry_client *client, *temp_client;
 
+	rte_telemetry_cmd_listener_stop();
+
 	TAILQ_FOREACH_SAFE(client, &telemetry->client_list_head, client_list,
 		temp_client) {
 		TAILQ_REMOVE(&telemetry->client_list_head, client, client_list);
@@ -1306,6 +1314,10 @@ rte_telemetry_selftest(void)
 
 	TELEMETRY_LOG_INFO("Success - Valid cleanup test passed");
 
+	ret = rte_telemetry_cmd_selftest();
+	if (ret < 0)
+		return -1;
+
 	return 0;
 }
 
@@ -2,7 +2,9 @@
  * Copyright(c) 2018 Intel Corporation
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <rte_compat.h>
 
 #ifndef _RTE_TELEMETRY_H_
 #define _RTE_TELEMETRY_H_
@@ -14,8 +16,295 @@
  * The telemetry library provides a method to retrieve statistics from
  * DPDK by sending a JSON encoded message over a socket. DPDK will send
  * a JSON encoded response containing telemetry data.
+ *
+ * In addition, any library or application can register command callbacks
+ * with rte_telemetry_register_cmd(). Those commands are served on the
+ * "dpdk_telemetry.v2" socket of the runtime directory, and can be run
+ * in-process with rte_telemetry_query(). A callback fills a fixed-size
+ * struct rte_tel_data, allocated once per client or calling thread, which
+ * is then encoded as JSON or in a compact binary format.
  ***/
 
+/** Maximum number of telemetry callbacks allowed */
+#define RTE_TEL_MAX_CALLBACKS 64
+/** Maximum length for string used in object */
+#define RTE_TEL_MAX_STRING_LEN 64
+/** Maximum length of string */
+#define RTE_TEL_MAX_SINGLE_STRING_LEN 8192
+/** Maximum number of dictionary entries, enough for the xstats of a port */
+#define RTE_TEL_MAX_DICT_ENTRIES 2048
+/** Maximum number of array entries */
+#define RTE_TEL_MAX_ARRAY_ENTRIES 512
+/** Maximum length of a command name, including the leading '/' */
+#define RTE_TEL_MAX_CMD_LEN 56
+
+/** opaque structure used internally for managing data from callbacks */
+struct rte_tel_data;
+
+/**
+ * The types of data that can be managed in arrays or dicts.
+ * For arrays, this must be specified at creation time, while for
+ * dicts this is specified implicitly each time an element is added
+ * via calling a type-specific function.
+ */
+enum rte_tel_value_type {
+	RTE_TEL_STRING_VAL, /** a string value */
+	RTE_TEL_INT_VAL,    /** a signed 32-bit int value */
+	RTE_TEL_U64_VAL,    /** an unsigned 64-bit int value */
+};
+
+/** Output encodings supported by rte_telemetry_query(). */
+enum rte_tel_format {
+	/** JSON object keyed by the command name */
+	RTE_TEL_FORMAT_JSON,
+	/**
+	 * Binary: one byte container type (1 string, 2 dict, 3 string array,
+	 * 4 int array, 5 u64 array), a 16-bit item count, then the items.
+	 * Dict items are a name (one byte length, bytes), one byte value type
+	 * (enum rte_tel_value_type) and the value. Strings are a 16-bit length
+	 * and bytes, ints and u64s are 4 and 8 bytes.
+	 * All integers are in host byte order.
+	 */
+	RTE_TEL_FORMAT_BINARY,
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Start an array of the specified type for returning from a callback
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param type
+ *   The type of the array of data
+ * @return
+ *   0 on success, negative errno on error
+ */
+int __rte_experimental
+rte_tel_data_start_array(struct rte_tel_data *d,
+		enum rte_tel_value_type type);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Start a dictionary of values for returning from a callback
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @return
+ *   0 on success, negative errno on error
+ */
+int __rte_experimental
+rte_tel_data_start_dict(struct rte_tel_data *d);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Set a string for returning from a callback
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param str
+ *   The string to be returned in the data structure
+ * @return
+ *   0 on success, negative errno on error, E2BIG on string truncation
+ */
+int __rte_experimental
+rte_tel_data_string(struct rte_tel_data *d, const char *str);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add a string to an array.
+ * The array must have been started by rte_tel_data_start_array() with
+ * RTE_TEL_STRING_VAL as the type parameter.
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param str
+ *   The string to be returned in the array
+ * @return
+ *   0 on success, negative errno on error, E2BIG on string truncation
+ */
+int __rte_experimental
+rte_tel_data_add_array_string(struct rte_tel_data *d, const char *str);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add an int to an array.
+ * The array must have been started by rte_tel_data_start_array() with
+ * RTE_TEL_INT_VAL as the type parameter.
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param x
+ *   The number to be returned in the array
+ * @return
+ *   0 on success, negative errno on error
+ */
+int __rte_experimental
+rte_tel_data_add_array_int(struct rte_tel_data *d, int x);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add a uint64_t to an array.
+ * The array must have been started by rte_tel_data_start_array() with
+ * RTE_TEL_U64_VAL as the type parameter.
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param x
+ *   The number to be returned in the array
+ * @return
+ *   0 on success, negative errno on error
+ */
+int __rte_experimental
+rte_tel_data_add_array_u64(struct rte_tel_data *d, uint64_t x);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add a string value to a dictionary.
+ * The dict must have been started by rte_tel_data_start_dict().
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param name
+ *   The name the value is to be stored under in the dict
+ * @param val
+ *   The string to be stored in the dict
+ * @return
+ *   0 on success, negative errno on error, E2BIG on string truncation of
+ *   either name or value.
+ */
+int __rte_experimental
+rte_tel_data_add_dict_string(struct rte_tel_data *d, const char *name,
+		const char *val);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add an int value to a dictionary.
+ * The dict must have been started by rte_tel_data_start_dict().
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param name
+ *   The name the value is to be stored under in the dict
+ * @param val
+ *   The number to be stored in the dict
+ * @return
+ *   0 on success, negative errno on error, E2BIG on string truncation of name.
+ */
+int __rte_experimental
+rte_tel_data_add_dict_int(struct rte_tel_data *d, const char *name, int val);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add a uint64_t value to a dictionary.
+ * The dict must have been started by rte_tel_data_start_dict().
+ *
+ * @param d
+ *   The data structure passed to the callback
+ * @param name
+ *   The name the value is to be stored under in the dict
+ * @param val
+ *   The number to be stored in the dict
+ * @return
+ *   0 on success, negative errno on error, E2BIG on string truncation of name.
+ */
+int __rte_experimental
+rte_tel_data_add_dict_u64(struct rte_tel_data *d,
+		const char *name, uint64_t val);
+
+/**
+ * This telemetry callback is used when registering a telemetry command.
+ * It handles getting and formatting information to be returned to telemetry
+ * when requested.
+ *
+ * @param cmd
+ * The cmd that was requested by the client.
+ * @param params
+ * Contains data required by the callback function, may be NULL.
+ * @param info
+ * The information to be returned to the caller.
+ *
+ * @return
+ * Length of buffer used on success.
+ * @return
+ * Negative integer on error.
+ */
+typedef int (*telemetry_cb)(const char *cmd, const char *params,
+		struct rte_tel_data *info);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Used when registering a command and callback function with telemetry.
+ * Commands can be registered at any time, including from constructors
+ * before rte_eal_init(). Callbacks may run on the telemetry socket threads
+ * concurrently with the datapath and must only read shared state.
+ *
+ * @param cmd
+ * The command to register with telemetry, starting with '/'.
+ * @param fn
+ * Callback function to be called when the command is requested.
+ * @param help
+ * Help text for the command.
+ * @return
+ *  0 on success.
+ * @return
+ *  -EINVAL for invalid parameters failure.
+ * @return
+ *  -EEXIST if the command is already registered.
+ * @return
+ *  -ENOENT if max callbacks limit has been reached.
+ */
+int __rte_experimental
+rte_telemetry_register_cmd(const char *cmd, telemetry_cb fn, const char *help);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Run a registered command in the calling thread and encode its output.
+ * The response is built in a buffer of about 300 KB, allocated by the first
+ * query of the thread and freed when the thread exits. The command callback
+ * must not call this function.
+ *
+ * @param cmd
+ *  The command to run.
+ * @param params
+ *  Parameters passed to the callback, may be NULL.
+ * @param format
+ *  Output encoding.
+ * @param buf
+ *  Output buffer.
+ * @param len
+ *  Size of the output buffer.
+ * @return
+ *  Number of bytes written to buf (excluding the NUL terminator for JSON),
+ *  -ENOENT if the command is unknown, -ENOMEM if the response buffer cannot
+ *  be allocated, -ENOSPC if buf is too small, or the negative error returned
+ *  by the callback.
+ */
+int __rte_experimental
+rte_telemetry_query(const char *cmd, const char *params,
+		enum rte_tel_format format, void *buf, size_t len);
+
 /**
  * @warning
  * @b EXPERIMENTAL: this API may change without prior notice
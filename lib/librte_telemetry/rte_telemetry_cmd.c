@@ -0,0 +1,657 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <rte_atomic.h>
+#include <rte_common.h>
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_lcore.h>
+#include <rte_spinlock.h>
+#include <rte_string_fns.h>
+#include <rte_version.h>
+
+#include "rte_telemetry.h"
+#include "rte_telemetry_data.h"
+#include "rte_telemetry_internal.h"
+
+#define TELEMETRY_V2_SOCKET "dpdk_telemetry.v2"
+#define MAX_CMD_LEN RTE_TEL_MAX_CMD_LEN
+#define MAX_HELP_LEN 128
+#define MAX_INPUT_LEN (MAX_CMD_LEN + 1024)
+/* room for the xstats of a port, below the default socket send buffer */
+#define MAX_OUTPUT_LEN (1024 * 192)
+#define MAX_CONNECTIONS 10
+
+struct cmd_callback {
+	char cmd[MAX_CMD_LEN];
+	telemetry_cb fn;
+	char help[MAX_HELP_LEN];
+};
+
+/*
+ * Registered commands. Entries are only ever appended, and num_callbacks is
+ * written after the entry, so readers need no lock.
+ */
+static struct cmd_callback callbacks[RTE_TEL_MAX_CALLBACKS];
+static volatile unsigned int num_callbacks;
+static rte_spinlock_t callback_sl = RTE_SPINLOCK_INITIALIZER;
+
+static int listen_fd = -1;
+static pthread_t listen_thread;
+static char listen_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static rte_atomic16_t v2_clients;
+
+int __rte_experimental
+rte_telemetry_register_cmd(const char *cmd, telemetry_cb fn, const char *help)
+{
+	unsigned int i;
+
+	if (fn == NULL || cmd == NULL || cmd[0] != '/' ||
+			strlen(cmd) >= MAX_CMD_LEN)
+		return -EINVAL;
+
+	rte_spinlock_lock(&callback_sl);
+	for (i = 0; i < num_callbacks; i++) {
+		if (strcmp(callbacks[i].cmd, cmd) == 0) {
+			rte_spinlock_unlock(&callback_sl);
+			return -EEXIST;
+		}
+	}
+	if (num_callbacks >= RTE_TEL_MAX_CALLBACKS) {
+		rte_spinlock_unlock(&callback_sl);
+		return -ENOENT;
+	}
+
+	strlcpy(callbacks[i].cmd, cmd, MAX_CMD_LEN);
+	callbacks[i].fn = fn;
+	strlcpy(callbacks[i].help, help != NULL ? help : "", MAX_HELP_LEN);
+	rte_smp_wmb();
+	num_callbacks = i + 1;
+	rte_spinlock_unlock(&callback_sl);
+
+	return 0;
+}
+
+static const struct cmd_callback *
+find_cmd(const char *cmd)
+{
+	unsigned int i, n = num_callbacks;
+
+	rte_smp_rmb();
+	for (i = 0; i < n; i++)
+		if (strcmp(cmd, callbacks[i].cmd) == 0)
+			return &callbacks[i];
+
+	return NULL;
+}
+
+/*
+ * Response of rte_telemetry_query(), too large for the stack of the calling
+ * thread. It is allocated by the first query of each thread, and freed when
+ * the thread exits.
+ */
+static pthread_key_t query_key;
+static pthread_once_t query_once = PTHREAD_ONCE_INIT;
+static int query_key_ret;
+
+static void
+query_key_create(void)
+{
+	query_key_ret = pthread_key_create(&query_key, free);
+}
+
+static struct rte_tel_data *
+query_data(void)
+{
+	struct rte_tel_data *data;
+
+	pthread_once(&query_once, query_key_create);
+	if (query_key_ret != 0)
+		return NULL;
+
+	data = pthread_getspecific(query_key);
+	if (data == NULL) {
+		data = malloc(sizeof(*data));
+		if (data != NULL && pthread_setspecific(query_key, data) != 0) {
+			free(data);
+			data = NULL;
+		}
+	}
+
+	return data;
+}
+
+int __rte_experimental
+rte_telemetry_query(const char *cmd, const char *params,
+		enum rte_tel_format format, void *buf, size_t len)
+{
+	const struct cmd_callback *cb;
+	struct rte_tel_data *data;
+	int ret;
+
+	if (cmd == NULL || buf == NULL)
+		return -EINVAL;
+
+	cb = find_cmd(cmd);
+	if (cb == NULL)
+		return -ENOENT;
+
+	data = query_data();
+	if (data == NULL)
+		return -ENOMEM;
+
+	memset(data, 0, offsetof(struct rte_tel_data, data));
+	ret = cb->fn(cmd, params, data);
+	if (ret < 0)
+		return ret;
+
+	if (format == RTE_TEL_FORMAT_BINARY)
+		return rte_tel_data_encode_binary(data, buf, len);
+
+	return rte_tel_data_encode_json(data, cmd, buf, len);
+}
+
+/* Built-in commands */
+
+static int
+list_commands(const char *cmd __rte_unused, const char *params __rte_unused,
+		struct rte_tel_data *d)
+{
+	unsigned int i, n = num_callbacks;
+
+	rte_smp_rmb();
+	rte_tel_data_start_array(d, RTE_TEL_STRING_VAL);
+	for (i = 0; i < n; i++)
+		rte_tel_data_add_array_string(d, callbacks[i].cmd);
+	return 0;
+}
+
+static int
+json_info(const char *cmd __rte_unused, const char *params __rte_unused,
+		struct rte_tel_data *d)
+{
+	rte_tel_data_start_dict(d);
+	rte_tel_data_add_dict_string(d, "version", rte_version());
+	rte_tel_data_add_dict_int(d, "pid", getpid());
+	rte_tel_data_add_dict_int(d, "max_output_len", MAX_OUTPUT_LEN);
+	return 0;
+}
+
+static int
+command_help(const char *cmd __rte_unused, const char *params,
+		struct rte_tel_data *d)
+{
+	const struct cmd_callback *cb;
+
+	if (params == NULL)
+		return -EINVAL;
+
+	cb = find_cmd(params);
+	if (cb == NULL)
+		return -EINVAL;
+
+	rte_tel_data_start_dict(d);
+	rte_tel_data_add_dict_string(d, params, cb->help);
+	return 0;
+}
+
+static int
+handle_port_list(const char *cmd __rte_unused, const char *params __rte_unused,
+		struct rte_tel_data *d)
+{
+	uint16_t port_id;
+
+	rte_tel_data_start_array(d, RTE_TEL_INT_VAL);
+	RTE_ETH_FOREACH_DEV(port_id)
+		rte_tel_data_add_array_int(d, port_id);
+	return 0;
+}
+
+static int
+parse_port_id(const char *params)
+{
+	unsigned long port_id;
+	char *end;
+
+	if (params == NULL || params[0] == '\0')
+		return -EINVAL;
+
+	port_id = strtoul(params, &end, 0);
+	if (*end != '\0' || !rte_eth_dev_is_valid_port(port_id))
+		return -EINVAL;
+
+	return port_id;
+}
+
+static int
+handle_port_stats(const char *cmd __rte_unused, const char *params,
+		struct rte_tel_data *d)
+{
+	struct rte_eth_stats stats;
+	int port_id;
+
+	port_id = parse_port_id(params);
+	if (port_id < 0)
+		return port_id;
+
+	if (rte_eth_stats_get(port_id, &stats) != 0)
+		return -EINVAL;
+
+	rte_tel_data_start_dict(d);
+	rte_tel_data_add_dict_u64(d, "ipackets", stats.ipackets);
+	rte_tel_data_add_dict_u64(d, "opackets", stats.opackets);
+	rte_tel_data_add_dict_u64(d, "ibytes", stats.ibytes);
+	rte_tel_data_add_dict_u64(d, "obytes", stats.obytes);
+	rte_tel_data_add_dict_u64(d, "imissed", stats.imissed);
+	rte_tel_data_add_dict_u64(d, "ierrors", stats.ierrors);
+	rte_tel_data_add_dict_u64(d, "oerrors", stats.oerrors);
+	rte_tel_data_add_dict_u64(d, "rx_nombuf", stats.rx_nombuf);
+	return 0;
+}
+
+static int
+handle_port_xstats(const char *cmd __rte_unused, const char *params,
+		struct rte_tel_data *d)
+{
+	struct rte_eth_xstat_name *names;
+	struct rte_eth_xstat *values;
+	int port_id, num, i, ret;
+
+	port_id = parse_port_id(params);
+	if (port_id < 0)
+		return port_id;
+
+	num = rte_eth_xstats_get(port_id, NULL, 0);
+	if (num < 0)
+		return -EINVAL;
+	if (num > RTE_TEL_MAX_DICT_ENTRIES)
+		return -ENOSPC;
+
+	names = malloc(num * sizeof(*names));
+	values = malloc(num * sizeof(*values));
+	if (names == NULL || values == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = -EINVAL;
+	if (rte_eth_xstats_get(port_id, values, num) != num ||
+			rte_eth_xstats_get_names(port_id, names, num) != num)
+		goto out;
+
+	rte_tel_data_start_dict(d);
+	for (i = 0; i < num; i++)
+		rte_tel_data_add_dict_u64(d, names[values[i].id].name,
+				values[i].value);
+	ret = 0;
+out:
+	free(names);
+	free(values);
+	return ret;
+}
+
+/* Socket server: one thread per connected client, blocking on its socket */
+
+/*
+ * Buffers of a connection, allocated once when the client connects as they
+ * are too large for the stack of the thread.
+ */
+struct client_bufs {
+	struct rte_tel_data data;
+	char out[MAX_OUTPUT_LEN];
+};
+
+static void
+perform_command(const struct cmd_callback *cb, const char *cmd,
+		const char *param, int s, struct client_bufs *bufs)
+{
+	struct rte_tel_data *data = &bufs->data;
+	char *out_buf = bufs->out;
+	int ret;
+
+	memset(data, 0, offsetof(struct rte_tel_data, data));
+	ret = cb->fn(cmd, param, data);
+	if (ret < 0) {
+		ret = snprintf(out_buf, MAX_OUTPUT_LEN, "{\"%.*s\":null}",
+				MAX_CMD_LEN, cmd);
+	} else {
+		ret = rte_tel_data_encode_json(data, cmd, out_buf,
+				MAX_OUTPUT_LEN);
+		if (ret < 0)
+			ret = snprintf(out_buf, MAX_OUTPUT_LEN,
+					"{\"%.*s\":null}", MAX_CMD_LEN, cmd);
+	}
+
+	if (write(s, out_buf, ret) < 0)
+		TELEMETRY_LOG_ERR("Error writing to socket: %s",
+				strerror(errno));
+}
+
+static void *
+client_handler(void *sock_id)
+{
+	int s = (int)(uintptr_t)sock_id;
+	int sndbuf = MAX_OUTPUT_LEN;
+	char buffer[MAX_INPUT_LEN];
+	struct client_bufs *bufs;
+	const struct cmd_callback *cb;
+	char *cmd, *param;
+	int bytes;
+
+	bufs = malloc(sizeof(*bufs));
+	if (bufs == NULL) {
+		TELEMETRY_LOG_ERR("Cannot allocate client buffers");
+		goto out;
+	}
+
+	/* a response is a single message, let the largest one through */
+	setsockopt(s, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+	/* greet the client with the same content as the /info command */
+	memset(&bufs->data, 0, offsetof(struct rte_tel_data, data));
+	json_info(NULL, NULL, &bufs->data);
+	bytes = rte_tel_data_encode_json(&bufs->data, "/info", bufs->out,
+			MAX_OUTPUT_LEN);
+	if (bytes > 0 && write(s, bufs->out, bytes) < 0)
+		goto out;
+
+	/* receive data is not null terminated */
+	bytes = read(s, buffer, sizeof(buffer) - 1);
+	while (bytes > 0) {
+		buffer[bytes] = 0;
+		cmd = strtok(buffer, ",");
+		param = strtok(NULL, ",");
+		cb = NULL;
+		if (cmd != NULL && strlen(cmd) < MAX_CMD_LEN)
+			cb = find_cmd(cmd);
+		if (cb != NULL)
+			perform_command(cb, cmd, param, s, bufs);
+		else if (write(s, "{\"error\":null}", 14) < 0)
+			break;
+
+		bytes = read(s, buffer, sizeof(buffer) - 1);
+	}
+
+out:
+	free(bufs);
+	close(s);
+	rte_atomic16_dec(&v2_clients);
+	return NULL;
+}
+
+static void *
+socket_listener(void *arg __rte_unused)
+{
+	pthread_t th;
+	int s;
+
+	while (1) {
+		s = accept(listen_fd, NULL, NULL);
+		if (s < 0) {
+			if (errno == EINTR)
+				continue;
+			/* the socket was closed by the cleanup */
+			return NULL;
+		}
+
+		if (rte_atomic16_add_return(&v2_clients, 1) > MAX_CONNECTIONS) {
+			TELEMETRY_LOG_WARN("Too many telemetry clients");
+			rte_atomic16_dec(&v2_clients);
+			close(s);
+			continue;
+		}
+
+		if (pthread_create(&th, NULL, client_handler,
+				(void *)(uintptr_t)s) != 0) {
+			TELEMETRY_LOG_ERR("Cannot create client thread");
+			rte_atomic16_dec(&v2_clients);
+			close(s);
+			continue;
+		}
+		pthread_detach(th);
+	}
+
+	return NULL;
+}
+
+int
+rte_telemetry_cmd_listener_start(void)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int ret;
+
+	if (listen_fd >= 0)
+		return -EALREADY;
+
+	listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (listen_fd < 0) {
+		TELEMETRY_LOG_ERR("Failed to open v2 socket");
+		return -errno;
+	}
+
+	snprintf(listen_path, sizeof(listen_path), "%s/%s",
+		 rte_eal_get_runtime_dir(), TELEMETRY_V2_SOCKET);
+	strlcpy(addr.sun_path, listen_path, sizeof(addr.sun_path));
+	unlink(listen_path);
+
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+			listen(listen_fd, 1) < 0) {
+		TELEMETRY_LOG_ERR("Failed to bind v2 socket %s: %s",
+				  listen_path, strerror(errno));
+		ret = -errno;
+		goto close_socket;
+	}
+
+	ret = pthread_create(&listen_thread, NULL, socket_listener, NULL);
+	if (ret != 0) {
+		TELEMETRY_LOG_ERR("Failed to create v2 listener thread");
+		ret = -ret;
+		unlink(listen_path);
+		goto close_socket;
+	}
+	rte_thread_setname(listen_thread, "telemetry-v2");
+
+	return 0;
+
+close_socket:
+	close(listen_fd);
+	listen_fd = -1;
+	return ret;
+}
+
+void
+rte_telemetry_cmd_listener_stop(void)
+{
+	if (listen_fd < 0)
+		return;
+
+	/* wake up accept() and let the thread exit */
+	shutdown(listen_fd, SHUT_RDWR);
+	pthread_join(listen_thread, NULL);
+	close(listen_fd);
+	unlink(listen_path);
+	listen_fd = -1;
+}
+
+/*
+ * Self test callback, called directly rather than registered so that no
+ * test command is left reachable from the socket.
+ */
+static int
+selftest_cb(const char *cmd __rte_unused, const char *params,
+		struct rte_tel_data *d)
+{
+	if (params == NULL)
+		return -EINVAL;
+
+	rte_tel_data_start_dict(d);
+	rte_tel_data_add_dict_string(d, "param", params);
+	rte_tel_data_add_dict_int(d, "int", -1);
+	rte_tel_data_add_dict_u64(d, "u64", UINT64_MAX);
+	return 0;
+}
+
+/* Encode a dict of the maximum size, as for the xstats of a large port */
+static int
+selftest_large_dict(struct rte_tel_data *d, char *buf)
+{
+	char name[RTE_TEL_MAX_STRING_LEN];
+	unsigned int i;
+	int ret;
+
+	rte_tel_data_start_dict(d);
+	for (i = 0; i < RTE_TEL_MAX_DICT_ENTRIES; i++) {
+		snprintf(name, sizeof(name), "rx_q%u_priority_xoff_to_xon_packets",
+				i);
+		if (rte_tel_data_add_dict_u64(d, name, UINT64_MAX) != 0) {
+			TELEMETRY_LOG_ERR("Large dict add failed at %u", i);
+			return -1;
+		}
+	}
+	if (rte_tel_data_add_dict_u64(d, "overflow", 0) != -ENOSPC) {
+		TELEMETRY_LOG_ERR("Large dict overflow test failed");
+		return -1;
+	}
+
+	ret = rte_tel_data_encode_json(d, "/ethdev/xstats", buf,
+			MAX_OUTPUT_LEN);
+	if (ret < 0 || buf[ret - 1] != '}') {
+		TELEMETRY_LOG_ERR("Large dict JSON encoding failed: %d", ret);
+		return -1;
+	}
+
+	ret = rte_tel_data_encode_binary(d, (uint8_t *)buf, MAX_OUTPUT_LEN);
+	if (ret < 0) {
+		TELEMETRY_LOG_ERR("Large dict binary encoding failed: %d", ret);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+selftest_run(struct rte_tel_data *d, char *buf)
+{
+	static const char expected[] = "{\"/selftest\":{\"param\":\"a\\\"b\","
+		"\"int\":-1,\"u64\":18446744073709551615}}";
+	int ret;
+
+	if (rte_telemetry_register_cmd("/", selftest_cb, NULL) != -EEXIST ||
+			rte_telemetry_register_cmd("selftest", selftest_cb,
+			NULL) != -EINVAL ||
+			rte_telemetry_register_cmd(NULL, selftest_cb,
+			NULL) != -EINVAL) {
+		TELEMETRY_LOG_ERR("Invalid command registration test failed");
+		return -1;
+	}
+
+	memset(d, 0, offsetof(struct rte_tel_data, data));
+	if (selftest_cb("/selftest", NULL, d) != -EINVAL) {
+		TELEMETRY_LOG_ERR("Missing parameter test failed");
+		return -1;
+	}
+	rte_tel_data_start_dict(d);
+	if (rte_tel_data_add_dict_string(d, "param", NULL) != -EINVAL ||
+			rte_tel_data_add_dict_u64(d, NULL, 0) != -EINVAL ||
+			rte_tel_data_string(d, NULL) != -EINVAL ||
+			d->data_len != 0) {
+		TELEMETRY_LOG_ERR("NULL string test failed");
+		return -1;
+	}
+
+	if (selftest_cb("/selftest", "a\"b", d) != 0) {
+		TELEMETRY_LOG_ERR("Callback test failed");
+		return -1;
+	}
+	ret = rte_tel_data_encode_json(d, "/selftest", buf, MAX_OUTPUT_LEN);
+	if (ret != (int)strlen(expected) || strcmp(buf, expected) != 0) {
+		TELEMETRY_LOG_ERR("JSON encoding test failed: %s", buf);
+		return -1;
+	}
+
+	if (rte_tel_data_encode_json(d, "/selftest", buf, 16) != -ENOSPC) {
+		TELEMETRY_LOG_ERR("JSON overflow test failed");
+		return -1;
+	}
+
+	/* type, count, then 3 x (name length, name, type, value) */
+	ret = rte_tel_data_encode_binary(d, (uint8_t *)buf, MAX_OUTPUT_LEN);
+	if (ret != 1 + 2 + (1 + 5 + 1 + 2 + 3) + (1 + 3 + 1 + 4) +
+			(1 + 3 + 1 + 8) || buf[0] != RTE_TEL_DICT) {
+		TELEMETRY_LOG_ERR("Binary encoding test failed: %d", ret);
+		return -1;
+	}
+
+	if (selftest_large_dict(d, buf) != 0)
+		return -1;
+
+	ret = rte_telemetry_query("/help", NULL, RTE_TEL_FORMAT_JSON,
+			buf, MAX_OUTPUT_LEN);
+	if (ret != -EINVAL) {
+		TELEMETRY_LOG_ERR("Query without parameter test failed: %d",
+				ret);
+		return -1;
+	}
+
+	ret = rte_telemetry_query("/help", "/info", RTE_TEL_FORMAT_JSON,
+			buf, MAX_OUTPUT_LEN);
+	if (ret <= 0 || strncmp(buf, "{\"/help\":{\"/info\":", 18) != 0) {
+		TELEMETRY_LOG_ERR("Query test failed: %d", ret);
+		return -1;
+	}
+
+	if (rte_telemetry_query("/nonexistent", NULL, RTE_TEL_FORMAT_JSON,
+			buf, MAX_OUTPUT_LEN) != -ENOENT) {
+		TELEMETRY_LOG_ERR("Unknown command test failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+rte_telemetry_cmd_selftest(void)
+{
+	struct rte_tel_data *d;
+	char *buf;
+	int ret = -1;
+
+	d = malloc(sizeof(*d));
+	buf = malloc(MAX_OUTPUT_LEN);
+	if (d != NULL && buf != NULL)
+		ret = selftest_run(d, buf);
+	else
+		TELEMETRY_LOG_ERR("Cannot allocate test buffers");
+	free(d);
+	free(buf);
+
+	if (ret == 0)
+		TELEMETRY_LOG_INFO("Success - Command registry tests passed");
+	return ret;
+}
+
+RTE_INIT(telemetry_cmd_register_default)
+{
+	rte_telemetry_register_cmd("/", list_commands,
+			"Returns list of available commands, Takes no parameters");
+	rte_telemetry_register_cmd("/info", json_info,
+			"Returns DPDK Telemetry information. Takes no parameters");
+	rte_telemetry_register_cmd("/help", command_help,
+			"Returns help text for a command. Parameters: string command");
+	rte_telemetry_register_cmd("/ethdev/list", handle_port_list,
+			"Returns list of available ports. Takes no parameters");
+	rte_telemetry_register_cmd("/ethdev/stats", handle_port_stats,
+			"Returns the common stats for a port. Parameters: int port_id");
+	rte_telemetry_register_cmd("/ethdev/xstats", handle_port_xstats,
+			"Returns the extended stats for a port. Parameters: int port_id");
+}
@@ -0,0 +1,375 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_string_fns.h>
+
+#include "rte_telemetry_data.h"
+
+int __rte_experimental
+rte_tel_data_start_array(struct rte_tel_data *d, enum rte_tel_value_type type)
+{
+	enum tel_container_types array_types[] = {
+			RTE_TEL_ARRAY_STRING, /* RTE_TEL_STRING_VAL = 0 */
+			RTE_TEL_ARRAY_INT,    /* RTE_TEL_INT_VAL = 1 */
+			RTE_TEL_ARRAY_U64,    /* RTE_TEL_U64_VAL = 2 */
+	};
+
+	if ((unsigned int)type >= RTE_DIM(array_types))
+		return -EINVAL;
+	d->type = array_types[type];
+	d->data_len = 0;
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_start_dict(struct rte_tel_data *d)
+{
+	d->type = RTE_TEL_DICT;
+	d->data_len = 0;
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_string(struct rte_tel_data *d, const char *str)
+{
+	if (str == NULL)
+		return -EINVAL;
+	d->type = RTE_TEL_STRING;
+	d->data_len = strlcpy(d->data.str, str, sizeof(d->data.str));
+	if (d->data_len >= RTE_TEL_MAX_SINGLE_STRING_LEN) {
+		d->data_len = RTE_TEL_MAX_SINGLE_STRING_LEN - 1;
+		return E2BIG; /* not necessarily an error, just truncation */
+	}
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_add_array_string(struct rte_tel_data *d, const char *str)
+{
+	size_t bytes;
+
+	if (d->type != RTE_TEL_ARRAY_STRING || str == NULL)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_ARRAY_ENTRIES)
+		return -ENOSPC;
+	bytes = strlcpy(d->data.array[d->data_len++].sval,
+			str, RTE_TEL_MAX_STRING_LEN);
+	return bytes < RTE_TEL_MAX_STRING_LEN ? 0 : E2BIG;
+}
+
+int __rte_experimental
+rte_tel_data_add_array_int(struct rte_tel_data *d, int x)
+{
+	if (d->type != RTE_TEL_ARRAY_INT)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_ARRAY_ENTRIES)
+		return -ENOSPC;
+	d->data.array[d->data_len++].ival = x;
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_add_array_u64(struct rte_tel_data *d, uint64_t x)
+{
+	if (d->type != RTE_TEL_ARRAY_U64)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_ARRAY_ENTRIES)
+		return -ENOSPC;
+	d->data.array[d->data_len++].u64val = x;
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_add_dict_string(struct rte_tel_data *d, const char *name,
+		const char *val)
+{
+	struct tel_dict_entry *e;
+	size_t nbytes, vbytes;
+
+	if (d->type != RTE_TEL_DICT || name == NULL || val == NULL)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_DICT_ENTRIES)
+		return -ENOSPC;
+
+	e = &d->data.dict[d->data_len++];
+	e->type = RTE_TEL_STRING_VAL;
+	vbytes = strlcpy(e->value.sval, val, RTE_TEL_MAX_STRING_LEN);
+	nbytes = strlcpy(e->name, name, RTE_TEL_MAX_STRING_LEN);
+	if (vbytes >= RTE_TEL_MAX_STRING_LEN ||
+			nbytes >= RTE_TEL_MAX_STRING_LEN)
+		return E2BIG;
+	return 0;
+}
+
+int __rte_experimental
+rte_tel_data_add_dict_int(struct rte_tel_data *d, const char *name, int val)
+{
+	struct tel_dict_entry *e;
+	size_t bytes;
+
+	if (d->type != RTE_TEL_DICT || name == NULL)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_DICT_ENTRIES)
+		return -ENOSPC;
+
+	e = &d->data.dict[d->data_len++];
+	e->type = RTE_TEL_INT_VAL;
+	e->value.ival = val;
+	bytes = strlcpy(e->name, name, RTE_TEL_MAX_STRING_LEN);
+	return bytes < RTE_TEL_MAX_STRING_LEN ? 0 : E2BIG;
+}
+
+int __rte_experimental
+rte_tel_data_add_dict_u64(struct rte_tel_data *d,
+		const char *name, uint64_t val)
+{
+	struct tel_dict_entry *e;
+	size_t bytes;
+
+	if (d->type != RTE_TEL_DICT || name == NULL)
+		return -EINVAL;
+	if (d->data_len >= RTE_TEL_MAX_DICT_ENTRIES)
+		return -ENOSPC;
+
+	e = &d->data.dict[d->data_len++];
+	e->type = RTE_TEL_U64_VAL;
+	e->value.u64val = val;
+	bytes = strlcpy(e->name, name, RTE_TEL_MAX_STRING_LEN);
+	return bytes < RTE_TEL_MAX_STRING_LEN ? 0 : E2BIG;
+}
+
+/*
+ * JSON writer: output is appended to a caller supplied buffer, tracking
+ * overflow so that callers only check once at the end.
+ */
+struct json_buf {
+	char *buf;
+	size_t len;
+	size_t used;
+	int overflow;
+};
+
+static void
+json_printf(struct json_buf *jb, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (jb->overflow)
+		return;
+
+	va_start(ap, fmt);
+	ret = vsnprintf(jb->buf + jb->used, jb->len - jb->used, fmt, ap);
+	va_end(ap);
+
+	if (ret < 0 || (size_t)ret >= jb->len - jb->used)
+		jb->overflow = 1;
+	else
+		jb->used += ret;
+}
+
+/* Write a quoted string, escaping characters which would break JSON */
+static void
+json_str(struct json_buf *jb, const char *s)
+{
+	char c;
+
+	json_printf(jb, "\"");
+	for (; (c = *s) != '\0' && !jb->overflow; s++) {
+		if (c == '"' || c == '\\')
+			json_printf(jb, "\\%c", c);
+		else if ((unsigned char)c < 0x20)
+			json_printf(jb, "\\u%04x", c);
+		else if (jb->used + 1 < jb->len)
+			jb->buf[jb->used++] = c;
+		else
+			jb->overflow = 1;
+	}
+	json_printf(jb, "\"");
+}
+
+static void
+json_value(struct json_buf *jb, enum rte_tel_value_type type,
+		const union tel_value *v)
+{
+	switch (type) {
+	case RTE_TEL_STRING_VAL:
+		json_str(jb, v->sval);
+		break;
+	case RTE_TEL_INT_VAL:
+		json_printf(jb, "%d", v->ival);
+		break;
+	case RTE_TEL_U64_VAL:
+		json_printf(jb, "%" PRIu64, v->u64val);
+		break;
+	}
+}
+
+int
+rte_tel_data_encode_json(const struct rte_tel_data *d, const char *cmd,
+		char *buf, size_t len)
+{
+	static const enum rte_tel_value_type array_val[] = {
+		[RTE_TEL_ARRAY_STRING] = RTE_TEL_STRING_VAL,
+		[RTE_TEL_ARRAY_INT] = RTE_TEL_INT_VAL,
+		[RTE_TEL_ARRAY_U64] = RTE_TEL_U64_VAL,
+	};
+	struct json_buf jb = { .buf = buf, .len = len };
+	const struct tel_dict_entry *e;
+	unsigned int i;
+
+	if (len == 0)
+		return -ENOSPC;
+	buf[0] = '\0';
+
+	json_printf(&jb, "{");
+	json_str(&jb, cmd);
+	json_printf(&jb, ":");
+
+	switch (d->type) {
+	case RTE_TEL_NULL:
+		json_printf(&jb, "null");
+		break;
+	case RTE_TEL_STRING:
+		json_str(&jb, d->data.str);
+		break;
+	case RTE_TEL_DICT:
+		json_printf(&jb, "{");
+		for (i = 0; i < d->data_len; i++) {
+			e = &d->data.dict[i];
+			if (i > 0)
+				json_printf(&jb, ",");
+			json_str(&jb, e->name);
+			json_printf(&jb, ":");
+			json_value(&jb, e->type, &e->value);
+		}
+		json_printf(&jb, "}");
+		break;
+	case RTE_TEL_ARRAY_STRING:
+	case RTE_TEL_ARRAY_INT:
+	case RTE_TEL_ARRAY_U64:
+		json_printf(&jb, "[");
+		for (i = 0; i < d->data_len; i++) {
+			if (i > 0)
+				json_printf(&jb, ",");
+			json_value(&jb, array_val[d->type], &d->data.array[i]);
+		}
+		json_printf(&jb, "]");
+		break;
+	}
+	json_printf(&jb, "}");
+
+	return jb.overflow ? -ENOSPC : (int)jb.used;
+}
+
+/* Binary writer, see RTE_TEL_FORMAT_BINARY for the layout */
+struct bin_buf {
+	uint8_t *buf;
+	size_t len;
+	size_t used;
+	int overflow;
+};
+
+static void
+bin_put(struct bin_buf *bb, const void *p, size_t n)
+{
+	if (bb->overflow || n > bb->len - bb->used) {
+		bb->overflow = 1;
+		return;
+	}
+	memcpy(bb->buf + bb->used, p, n);
+	bb->used += n;
+}
+
+static void
+bin_put_u8(struct bin_buf *bb, uint8_t v)
+{
+	bin_put(bb, &v, sizeof(v));
+}
+
+static void
+bin_put_u16(struct bin_buf *bb, uint16_t v)
+{
+	bin_put(bb, &v, sizeof(v));
+}
+
+static void
+bin_put_str(struct bin_buf *bb, const char *s)
+{
+	uint16_t n = strlen(s);
+
+	bin_put_u16(bb, n);
+	bin_put(bb, s, n);
+}
+
+static void
+bin_value(struct bin_buf *bb, enum rte_tel_value_type type,
+		const union tel_value *v)
+{
+	switch (type) {
+	case RTE_TEL_STRING_VAL:
+		bin_put_str(bb, v->sval);
+		break;
+	case RTE_TEL_INT_VAL:
+		bin_put(bb, &v->ival, sizeof(v->ival));
+		break;
+	case RTE_TEL_U64_VAL:
+		bin_put(bb, &v->u64val, sizeof(v->u64val));
+		break;
+	}
+}
+
+int
+rte_tel_data_encode_binary(const struct rte_tel_data *d, uint8_t *buf,
+		size_t len)
+{
+	static const enum rte_tel_value_type array_val[] = {
+		[RTE_TEL_ARRAY_STRING] = RTE_TEL_STRING_VAL,
+		[RTE_TEL_ARRAY_INT] = RTE_TEL_INT_VAL,
+		[RTE_TEL_ARRAY_U64] = RTE_TEL_U64_VAL,
+	};
+	struct bin_buf bb = { .buf = buf, .len = len };
+	const struct tel_dict_entry *e;
+	unsigned int i;
+	uint8_t n;
+
+	bin_put_u8(&bb, d->type);
+
+	switch (d->type) {
+	case RTE_TEL_NULL:
+		bin_put_u16(&bb, 0);
+		break;
+	case RTE_TEL_STRING:
+		bin_put_u16(&bb, 1);
+		bin_put_str(&bb, d->data.str);
+		break;
+	case RTE_TEL_DICT:
+		bin_put_u16(&bb, d->data_len);
+		for (i = 0; i < d->data_len; i++) {
+			e = &d->data.dict[i];
+			n = strlen(e->name);
+			bin_put_u8(&bb, n);
+			bin_put(&bb, e->name, n);
+			bin_put_u8(&bb, e->type);
+			bin_value(&bb, e->type, &e->value);
+		}
+		break;
+	case RTE_TEL_ARRAY_STRING:
+	case RTE_TEL_ARRAY_INT:
+	case RTE_TEL_ARRAY_U64:
+		bin_put_u16(&bb, d->data_len);
+		for (i = 0; i < d->data_len; i++)
+			bin_value(&bb, array_val[d->type], &d->data.array[i]);
+		break;
+	}
+
+	return bb.overflow ? -ENOSPC : (int)bb.used;
+}
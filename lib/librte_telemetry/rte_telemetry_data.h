@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2019 Intel Corporation
+ */
+
+#ifndef _RTE_TELEMETRY_DATA_H_
+#define _RTE_TELEMETRY_DATA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rte_telemetry.h"
+
+/* Kind of container held by a struct rte_tel_data */
+enum tel_container_types {
+	RTE_TEL_NULL,	      /** null, used as error or default */
+	RTE_TEL_STRING,	      /** basic string type, no included data */
+	RTE_TEL_DICT,	      /** name-value pairs, of individual value type */
+	RTE_TEL_ARRAY_STRING, /** array of string values only */
+	RTE_TEL_ARRAY_INT,    /** array of signed, 32-bit int values */
+	RTE_TEL_ARRAY_U64,    /** array of unsigned 64-bit int values */
+};
+
+union tel_value {
+	char sval[RTE_TEL_MAX_STRING_LEN];
+	int ival;
+	uint64_t u64val;
+};
+
+struct tel_dict_entry {
+	char name[RTE_TEL_MAX_STRING_LEN];
+	enum rte_tel_value_type type;
+	union tel_value value;
+};
+
+/*
+ * Fixed-size response buffer filled by a command callback. It is too large
+ * for the stack of a thread: one is allocated for each socket client and for
+ * each thread calling rte_telemetry_query(), and reused by their requests.
+ */
+struct rte_tel_data {
+	enum tel_container_types type;
+	unsigned int data_len; /* for array or object, how many items */
+	union {
+		char str[RTE_TEL_MAX_SINGLE_STRING_LEN];
+		struct tel_dict_entry dict[RTE_TEL_MAX_DICT_ENTRIES];
+		union tel_value array[RTE_TEL_MAX_ARRAY_ENTRIES];
+	} data; /* data container */
+};
+
+/*
+ * Encode a response as a JSON object keyed by the command name.
+ * Returns the length written, excluding the terminating NUL, or -ENOSPC.
+ */
+int
+rte_tel_data_encode_json(const struct rte_tel_data *d, const char *cmd,
+		char *buf, size_t len);
+
+/*
+ * Encode a response in the compact binary format described in
+ * rte_telemetry.h. Returns the length written or -ENOSPC.
+ */
+int
+rte_tel_data_encode_binary(const struct rte_tel_data *d, uint8_t *buf,
+		size_t len);
+
+/* Start and stop the listener serving registered commands on a socket */
+int
+rte_telemetry_cmd_listener_start(void);
+
+void
+rte_telemetry_cmd_listener_stop(void);
+
+/* Self test of the command registry and encoders */
+int
+rte_telemetry_cmd_selftest(void);
+
+#endif